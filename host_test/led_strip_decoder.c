@@ -0,0 +1,104 @@
+/*
+ * Implementation of the LED strip waveform decoder described in led_strip_decoder.h.
+ */
+#include <string.h>
+#include "led_strip_decoder.h"
+
+// [min, max] ticks of ns +- tolerance_ns, rounded inwards so every accepted tick count is within the window
+static void led_strip_decoder_window(uint32_t resolution, uint32_t ns, uint32_t tolerance_ns, uint16_t window[2])
+{
+    uint64_t min_ns = ns > tolerance_ns ? ns - tolerance_ns : 0;
+    uint64_t min_ticks = (min_ns * resolution + 999999999) / 1000000000;
+    uint64_t max_ticks = ((uint64_t)(ns + tolerance_ns) * resolution) / 1000000000;
+    window[0] = min_ticks ? (min_ticks > 0x7FFF ? 0x7FFF : min_ticks) : 1; // a zero duration ends the stream
+    window[1] = max_ticks > 0x7FFF ? 0x7FFF : max_ticks;
+}
+
+static inline bool led_strip_decoder_fits(const uint16_t window[2], uint32_t ticks)
+{
+    return ticks >= window[0] && ticks <= window[1];
+}
+
+bool led_strip_decoder_init(led_strip_decoder_t *decoder, led_strip_chip_t chip, uint32_t resolution)
+{
+    const led_strip_chip_info_t *info = led_strip_get_chip_info(chip);
+    if (!info || !resolution) {
+        return false;
+    }
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->resolution = resolution;
+    led_strip_decoder_window(resolution, info->t0h_ns, info->tolerance_ns, decoder->high0);
+    led_strip_decoder_window(resolution, info->t0l_ns, info->tolerance_ns, decoder->low0);
+    led_strip_decoder_window(resolution, info->t1h_ns, info->tolerance_ns, decoder->high1);
+    led_strip_decoder_window(resolution, info->t1l_ns, info->tolerance_ns, decoder->low1);
+    decoder->threshold = (uint64_t)(info->t0h_ns + info->t1h_ns) * resolution / 2000000000;
+    decoder->reset_ticks = ((uint64_t)info->reset_us * resolution + 999999) / 1000000;
+    return true;
+}
+
+bool led_strip_decode(const led_strip_decoder_t *decoder, const rmt_symbol_word_t *symbols, size_t num_symbols,
+                      uint8_t *bytes, size_t max_bytes, led_strip_decode_report_t *report)
+{
+    memset(report, 0, sizeof(*report));
+    report->first_bad_bit = SIZE_MAX;
+    report->well_formed = true;
+    size_t num_bits = 0;
+    uint32_t byte = 0;
+    size_t i = 0;
+    for (; i < num_symbols; i++) {
+        rmt_symbol_word_t symbol = symbols[i];
+        if (!symbol.level0) {
+            break; // the reset gap
+        }
+        uint32_t high = symbol.duration0;
+        uint32_t low = symbol.duration1;
+        if (symbol.level1 || !high || !low) {
+            report->well_formed = false; // a zero duration would end the transmission right here
+            break;
+        }
+        bool bit;
+        if (led_strip_decoder_fits(decoder->high1, high) && led_strip_decoder_fits(decoder->low1, low)) {
+            bit = true;
+        } else if (led_strip_decoder_fits(decoder->high0, high) && led_strip_decoder_fits(decoder->low0, low)) {
+            bit = false;
+        } else {
+            bit = high > decoder->threshold;
+            if (!report->bad_bits++) {
+                report->first_bad_bit = num_bits;
+            }
+        }
+        byte = (byte << 1) | bit;
+        if (++num_bits % 8 == 0) {
+            if (report->num_bytes < max_bytes) {
+                bytes[report->num_bytes] = byte;
+            }
+            report->num_bytes++;
+            byte = 0;
+        }
+    }
+    if (num_bits % 8) {
+        report->well_formed = false;
+    }
+    // everything after the bits must stay low, the gap ends at the first zero duration
+    uint64_t reset_ticks = 0;
+    for (; i < num_symbols && report->well_formed; i++) {
+        rmt_symbol_word_t symbol = symbols[i];
+        if (symbol.level0 && symbol.duration0) {
+            report->well_formed = false;
+        }
+        reset_ticks += symbol.duration0;
+        if (!symbol.duration0) {
+            break;
+        }
+        if (symbol.level1 && symbol.duration1) {
+            report->well_formed = false;
+        }
+        reset_ticks += symbol.duration1;
+        if (!symbol.duration1) {
+            break;
+        }
+    }
+    report->reset_ns = reset_ticks * 1000000000 / decoder->resolution;
+    report->reset_ok = reset_ticks >= decoder->reset_ticks;
+    return report->well_formed && !report->bad_bits && report->reset_ok;
+}
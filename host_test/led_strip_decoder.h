@@ -0,0 +1,62 @@
+/*
+ * Host side decoder of LED strip waveforms, the oracle the tests check the encoders and outputs against.
+ *
+ * It turns a captured RMT symbol stream back into pixel bytes and verifies the timing on the way: every high and low
+ * time must be within the chip's tolerance of its datasheet value, and the stream must end with a reset gap of at
+ * least the chip's reset time. The windows are converted to ticks once, so decoding is a few integer compares per
+ * symbol.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "driver/rmt_encoder.h"
+#include "led_strip_encoder.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Tick windows of one chip at one resolution
+ */
+typedef struct {
+    uint32_t resolution;
+    uint32_t reset_ticks;  // minimum low time after the last bit
+    uint16_t high0[2];     // accepted [min, max] high ticks of a 0 bit
+    uint16_t low0[2];
+    uint16_t high1[2];
+    uint16_t low1[2];
+    uint16_t threshold;    // a high time above this many ticks reads as a 1 bit when it fits neither window
+} led_strip_decoder_t;
+
+/**
+ * @brief What the decoder found in a stream
+ */
+typedef struct {
+    size_t num_bytes;      // pixel bytes decoded
+    size_t bad_bits;       // bits with a high or low time outside the tolerance window
+    size_t first_bad_bit;  // index of the first of them, SIZE_MAX if there is none
+    uint64_t reset_ns;     // length of the low gap at the end
+    bool reset_ok;         // the gap is at least the chip's reset time
+    bool well_formed;      // only high-then-low bit symbols, whole bytes, then nothing but low level
+} led_strip_decode_report_t;
+
+/**
+ * @brief Prepare the tick windows of a chip, false if the chip is unknown or the resolution is zero
+ */
+bool led_strip_decoder_init(led_strip_decoder_t *decoder, led_strip_chip_t chip, uint32_t resolution);
+
+/**
+ * @brief Decode a symbol stream into pixel bytes, MSB first
+ *
+ * @param bytes Decoded bytes, at most max_bytes are written, the rest are only counted
+ * @return Whether the stream is well formed, every bit is within tolerance and the reset gap is long enough
+ */
+bool led_strip_decode(const led_strip_decoder_t *decoder, const rmt_symbol_word_t *symbols, size_t num_symbols,
+                      uint8_t *bytes, size_t max_bytes, led_strip_decode_report_t *report);
+
+#ifdef __cplusplus
+}
+#endif
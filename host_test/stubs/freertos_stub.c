@@ -0,0 +1,473 @@
+/*
+ * Host implementation of the FreeRTOS and esp_timer stand-ins on top of pthreads.
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+
+volatile uint32_t freertos_stub_tick_us = 1000000 / configTICK_RATE_HZ;
+
+struct freertos_stub_task {
+    pthread_t thread;
+    TaskFunction_t task_code;
+    void *arg;
+    BaseType_t core_id;         // tskNO_AFFINITY for unpinned tasks
+    pthread_t pinned_thread;    // set by the thread itself, while it is in s_pinned_tasks
+    struct freertos_stub_task *next_pinned;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t notify_value;
+};
+
+struct esp_timer {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;        // on CLOCK_MONOTONIC, signalled on start, stop and delete
+    esp_timer_create_args_t args;
+    bool running;
+    bool deleted;
+    uint64_t period_us;
+    int64_t next_us;            // esp_timer_get_time() of the next expiry
+};
+
+struct freertos_stub_semaphore {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    UBaseType_t count;
+    UBaseType_t max_count;
+};
+
+static pthread_mutex_t s_critical_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static __thread struct freertos_stub_task *s_current_task;
+
+static pthread_mutex_t s_cores_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct freertos_stub_task *s_pinned_tasks;   // running tasks pinned to a core
+static uint64_t s_retired_busy_ns[CONFIG_FREERTOS_NUMBER_OF_CORES]; // CPU time of pinned tasks that have ended
+
+static struct timespec s_start_time;
+
+__attribute__((constructor)) static void freertos_stub_init_start_time(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &s_start_time);
+}
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)(now.tv_sec - s_start_time.tv_sec) * 1000000 + (now.tv_nsec - s_start_time.tv_nsec) / 1000;
+}
+
+void freertos_stub_enter_critical(void)
+{
+    pthread_mutex_lock(&s_critical_lock);
+}
+
+void freertos_stub_exit_critical(void)
+{
+    pthread_mutex_unlock(&s_critical_lock);
+}
+
+// absolute deadline of a wait, NULL for portMAX_DELAY
+static struct timespec *freertos_stub_deadline(TickType_t ticks, struct timespec *ts)
+{
+    if (ticks == portMAX_DELAY) {
+        return NULL;
+    }
+    clock_gettime(CLOCK_REALTIME, ts);
+    uint64_t ns = ts->tv_nsec + (uint64_t)ticks * freertos_stub_tick_us * 1000;
+    ts->tv_sec += ns / 1000000000;
+    ts->tv_nsec = ns % 1000000000;
+    return ts;
+}
+
+// wait on cond until woken or the deadline passes, returns false on timeout
+static bool freertos_stub_wait(pthread_cond_t *cond, pthread_mutex_t *lock, const struct timespec *deadline)
+{
+    if (!deadline) {
+        pthread_cond_wait(cond, lock);
+        return true;
+    }
+    return pthread_cond_timedwait(cond, lock, deadline) != ETIMEDOUT;
+}
+
+static struct freertos_stub_task *freertos_stub_new_task(void)
+{
+    struct freertos_stub_task *task = calloc(1, sizeof(struct freertos_stub_task));
+    task->core_id = tskNO_AFFINITY;
+    pthread_mutex_init(&task->lock, NULL);
+    pthread_cond_init(&task->cond, NULL);
+    return task;
+}
+
+static bool freertos_stub_is_pinned(const struct freertos_stub_task *task)
+{
+    return task->core_id >= 0 && task->core_id < CONFIG_FREERTOS_NUMBER_OF_CORES;
+}
+
+static uint64_t freertos_stub_cpu_ns(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Start accounting the calling thread's CPU time to its task's core. The thread still runs on any host CPU: tests
+// run side by side, and all of them pinning their timers to one CPU would only make them late
+static void freertos_stub_pin_current(void)
+{
+    struct freertos_stub_task *task = s_current_task;
+    if (!freertos_stub_is_pinned(task)) {
+        return;
+    }
+    pthread_mutex_lock(&s_cores_lock);
+    task->pinned_thread = pthread_self();
+    task->next_pinned = s_pinned_tasks;
+    s_pinned_tasks = task;
+    pthread_mutex_unlock(&s_cores_lock);
+}
+
+// The calling thread ends, keep its CPU time
+static void freertos_stub_unpin_current(void)
+{
+    struct freertos_stub_task *task = s_current_task;
+    if (!task || !freertos_stub_is_pinned(task)) {
+        return;
+    }
+    pthread_mutex_lock(&s_cores_lock);
+    for (struct freertos_stub_task **link = &s_pinned_tasks; *link; link = &(*link)->next_pinned) {
+        if (*link == task) {
+            *link = task->next_pinned;
+            break;
+        }
+    }
+    s_retired_busy_ns[task->core_id] += freertos_stub_cpu_ns(CLOCK_THREAD_CPUTIME_ID);
+    pthread_mutex_unlock(&s_cores_lock);
+}
+
+static void *freertos_stub_task_entry(void *arg)
+{
+    struct freertos_stub_task *task = arg;
+    s_current_task = task;
+    freertos_stub_pin_current();
+    task->task_code(task->arg);
+    freertos_stub_unpin_current();
+    return NULL;
+}
+
+BaseType_t xPortGetCoreID(void)
+{
+    return s_current_task && freertos_stub_is_pinned(s_current_task) ? s_current_task->core_id : 0;
+}
+
+uint32_t ulTaskGetIdleRunTimeCounterForCore(BaseType_t core_id)
+{
+    if (core_id < 0 || core_id >= CONFIG_FREERTOS_NUMBER_OF_CORES) {
+        return 0;
+    }
+    pthread_mutex_lock(&s_cores_lock);
+    uint64_t busy_ns = s_retired_busy_ns[core_id];
+    for (struct freertos_stub_task *task = s_pinned_tasks; task; task = task->next_pinned) {
+        clockid_t clock;
+        if (task->core_id == core_id && pthread_getcpuclockid(task->pinned_thread, &clock) == 0) {
+            busy_ns += freertos_stub_cpu_ns(clock);
+        }
+    }
+    pthread_mutex_unlock(&s_cores_lock);
+    int64_t idle_us = esp_timer_get_time() - (int64_t)(busy_ns / 1000);
+    return idle_us > 0 ? idle_us : 0;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task_code, const char *name, uint32_t stack_depth, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *ret_task, BaseType_t core_id)
+{
+    struct freertos_stub_task *task = freertos_stub_new_task();
+    task->task_code = task_code;
+    task->arg = arg;
+    task->core_id = core_id;
+    if (ret_task) {
+        *ret_task = task;
+    }
+    if (pthread_create(&task->thread, NULL, freertos_stub_task_entry, task) != 0) {
+        return pdFAIL;
+    }
+    pthread_detach(task->thread);
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t task_code, const char *name, uint32_t stack_depth, void *arg,
+                       UBaseType_t priority, TaskHandle_t *ret_task)
+{
+    return xTaskCreatePinnedToCore(task_code, name, stack_depth, arg, priority, ret_task, tskNO_AFFINITY);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    // threads not created through xTaskCreate (the test's main thread) get a handle on first use
+    if (!s_current_task) {
+        s_current_task = freertos_stub_new_task();
+        s_current_task->thread = pthread_self();
+    }
+    return s_current_task;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return esp_timer_get_time() / freertos_stub_tick_us;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    usleep((useconds_t)ticks * freertos_stub_tick_us);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    assert(task == NULL && "only self deletion is supported");
+    freertos_stub_unpin_current();
+    pthread_exit(NULL);
+}
+
+void vTaskSuspend(TaskHandle_t task)
+{
+    assert(task == NULL && "only self suspension is supported");
+    while (1) {
+        pause();
+    }
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait)
+{
+    struct freertos_stub_task *task = xTaskGetCurrentTaskHandle();
+    struct timespec ts;
+    struct timespec *deadline = freertos_stub_deadline(ticks_to_wait, &ts);
+    pthread_mutex_lock(&task->lock);
+    while (!task->notify_value && ticks_to_wait && freertos_stub_wait(&task->cond, &task->lock, deadline)) {
+    }
+    uint32_t value = task->notify_value;
+    if (value) {
+        task->notify_value = clear_on_exit ? 0 : value - 1;
+    }
+    pthread_mutex_unlock(&task->lock);
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    pthread_mutex_lock(&task->lock);
+    task->notify_value++;
+    pthread_cond_broadcast(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higher_priority_task_woken)
+{
+    xTaskNotifyGive(task);
+    if (higher_priority_task_woken) {
+        *higher_priority_task_woken = pdFALSE;
+    }
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count)
+{
+    struct freertos_stub_semaphore *sem = calloc(1, sizeof(struct freertos_stub_semaphore));
+    if (!sem) {
+        return NULL;
+    }
+    pthread_mutex_init(&sem->lock, NULL);
+    pthread_cond_init(&sem->cond, NULL);
+    sem->count = initial_count;
+    sem->max_count = max_count;
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks_to_wait)
+{
+    struct timespec ts;
+    struct timespec *deadline = freertos_stub_deadline(ticks_to_wait, &ts);
+    pthread_mutex_lock(&sem->lock);
+    while (!sem->count && ticks_to_wait && freertos_stub_wait(&sem->cond, &sem->lock, deadline)) {
+    }
+    BaseType_t taken = pdFALSE;
+    if (sem->count) {
+        sem->count--;
+        taken = pdTRUE;
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return taken;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    BaseType_t given = pdFALSE;
+    pthread_mutex_lock(&sem->lock);
+    if (sem->count < sem->max_count) {
+        sem->count++;
+        given = pdTRUE;
+        pthread_cond_broadcast(&sem->cond);
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return given;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *higher_priority_task_woken)
+{
+    if (higher_priority_task_woken) {
+        *higher_priority_task_woken = pdFALSE;
+    }
+    return xSemaphoreGive(sem);
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t sem)
+{
+    pthread_mutex_lock(&sem->lock);
+    UBaseType_t count = sem->count;
+    pthread_mutex_unlock(&sem->lock);
+    return count;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    pthread_mutex_destroy(&sem->lock);
+    pthread_cond_destroy(&sem->cond);
+    free(sem);
+}
+
+static void *esp_timer_stub_thread(void *arg)
+{
+    esp_timer_handle_t timer = arg;
+    // callbacks run from the esp_timer task, on CPU0 by default
+    s_current_task = freertos_stub_new_task();
+    s_current_task->thread = pthread_self();
+    s_current_task->core_id = 0;
+    freertos_stub_pin_current();
+    pthread_mutex_lock(&timer->lock);
+    while (!timer->deleted) {
+        if (!timer->running) {
+            pthread_cond_wait(&timer->cond, &timer->lock);
+            continue;
+        }
+        int64_t now_us = esp_timer_get_time();
+        if (now_us < timer->next_us) {
+            struct timespec deadline = s_start_time;
+            uint64_t ns = deadline.tv_nsec + (uint64_t)timer->next_us * 1000;
+            deadline.tv_sec += ns / 1000000000;
+            deadline.tv_nsec = ns % 1000000000;
+            pthread_cond_timedwait(&timer->cond, &timer->lock, &deadline);
+            continue;
+        }
+        timer->next_us += timer->period_us;
+        if (timer->args.skip_unhandled_events) {
+            while (timer->next_us <= now_us) {
+                timer->next_us += timer->period_us;
+            }
+        }
+        pthread_mutex_unlock(&timer->lock);
+        timer->args.callback(timer->args.arg);
+        pthread_mutex_lock(&timer->lock);
+    }
+    pthread_mutex_unlock(&timer->lock);
+    freertos_stub_unpin_current();
+    pthread_mutex_destroy(&s_current_task->lock);
+    pthread_cond_destroy(&s_current_task->cond);
+    free(s_current_task);
+    s_current_task = NULL;
+    return NULL;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    if (!create_args || !create_args->callback || !out_handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_timer_handle_t timer = calloc(1, sizeof(struct esp_timer));
+    if (!timer) {
+        return ESP_ERR_NO_MEM;
+    }
+    timer->args = *create_args;
+    pthread_mutex_init(&timer->lock, NULL);
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&timer->cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+    if (pthread_create(&timer->thread, NULL, esp_timer_stub_thread, timer) != 0) {
+        free(timer);
+        return ESP_ERR_NO_MEM;
+    }
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    if (!timer || !period) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t ret = ESP_OK;
+    pthread_mutex_lock(&timer->lock);
+    if (timer->running) {
+        ret = ESP_ERR_INVALID_STATE;
+    } else {
+        timer->period_us = period;
+        timer->next_us = esp_timer_get_time() + period;
+        timer->running = true;
+        pthread_cond_broadcast(&timer->cond);
+    }
+    pthread_mutex_unlock(&timer->lock);
+    return ret;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (!timer) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t ret = ESP_OK;
+    pthread_mutex_lock(&timer->lock);
+    if (!timer->running) {
+        ret = ESP_ERR_INVALID_STATE;
+    }
+    timer->running = false;
+    pthread_cond_broadcast(&timer->cond);
+    pthread_mutex_unlock(&timer->lock);
+    return ret;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    if (!timer) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&timer->lock);
+    if (timer->running) {
+        pthread_mutex_unlock(&timer->lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->deleted = true;
+    pthread_cond_broadcast(&timer->cond);
+    pthread_mutex_unlock(&timer->lock);
+    // a callback that is running completes before the timer is freed
+    pthread_join(timer->thread, NULL);
+    pthread_mutex_destroy(&timer->lock);
+    pthread_cond_destroy(&timer->cond);
+    free(timer);
+    return ESP_OK;
+}
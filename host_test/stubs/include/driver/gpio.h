@@ -0,0 +1,6 @@
+/*
+ * Host stand-in for driver/gpio.h, only the GPIO number type.
+ */
+#pragma once
+
+typedef int gpio_num_t;
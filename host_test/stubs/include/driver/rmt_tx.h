@@ -0,0 +1,73 @@
+/*
+ * Host stand-in for the ESP-IDF RMT TX channel API (driver/rmt_tx.h and the channel calls of rmt_common.h).
+ *
+ * A TX channel runs every transaction through its encoder right away and captures the symbols, see rmt_stub.h for
+ * how tests inspect them and control when transactions finish.
+ */
+#pragma once
+
+#include "driver/rmt_encoder.h"
+#include "driver/gpio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    RMT_CLK_SRC_DEFAULT,
+} rmt_clock_source_t;
+
+typedef struct rmt_sync_manager_t *rmt_sync_manager_handle_t;
+
+typedef struct {
+    gpio_num_t gpio_num;
+    rmt_clock_source_t clk_src;
+    uint32_t resolution_hz;
+    size_t mem_block_symbols;
+    size_t trans_queue_depth;
+    int intr_priority;
+    struct {
+        uint32_t invert_out: 1;
+        uint32_t with_dma: 1;
+        uint32_t io_loop_back: 1;
+        uint32_t io_od_mode: 1;
+    } flags;
+} rmt_tx_channel_config_t;
+
+typedef struct {
+    int loop_count;
+    struct {
+        uint32_t eot_level: 1;
+        uint32_t queue_nonblocking: 1;
+    } flags;
+} rmt_transmit_config_t;
+
+typedef struct {
+    size_t num_symbols;
+} rmt_tx_done_event_data_t;
+
+typedef bool (*rmt_tx_done_callback_t)(rmt_channel_handle_t tx_chan, const rmt_tx_done_event_data_t *edata, void *user_ctx);
+
+typedef struct {
+    rmt_tx_done_callback_t on_trans_done;
+} rmt_tx_event_callbacks_t;
+
+typedef struct {
+    const rmt_channel_handle_t *tx_channel_array;
+    size_t array_size;
+} rmt_sync_manager_config_t;
+
+esp_err_t rmt_new_tx_channel(const rmt_tx_channel_config_t *config, rmt_channel_handle_t *ret_chan);
+esp_err_t rmt_del_channel(rmt_channel_handle_t channel);
+esp_err_t rmt_enable(rmt_channel_handle_t channel);
+esp_err_t rmt_disable(rmt_channel_handle_t channel);
+esp_err_t rmt_transmit(rmt_channel_handle_t tx_channel, rmt_encoder_handle_t encoder, const void *payload, size_t payload_bytes,
+                       const rmt_transmit_config_t *config);
+esp_err_t rmt_tx_wait_all_done(rmt_channel_handle_t tx_channel, int timeout_ms);
+esp_err_t rmt_tx_register_event_callbacks(rmt_channel_handle_t tx_channel, const rmt_tx_event_callbacks_t *cbs, void *user_data);
+esp_err_t rmt_new_sync_manager(const rmt_sync_manager_config_t *config, rmt_sync_manager_handle_t *ret_synchro);
+esp_err_t rmt_del_sync_manager(rmt_sync_manager_handle_t synchro);
+
+#ifdef __cplusplus
+}
+#endif
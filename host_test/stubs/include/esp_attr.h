@@ -0,0 +1,7 @@
+/*
+ * Host stand-in for esp_attr.h, memory placement attributes have no meaning on the host.
+ */
+#pragma once
+
+#define IRAM_ATTR
+#define DRAM_ATTR
@@ -0,0 +1,13 @@
+/*
+ * Host stand-in for esp_heap_caps.h, every allocation is plain heap memory whatever the capabilities.
+ */
+#pragma once
+
+#include <stdlib.h>
+
+#define MALLOC_CAP_DMA      (1 << 3)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+#define heap_caps_malloc(size, caps)         malloc(size)
+#define heap_caps_calloc(n, size, caps)      calloc(n, size)
+#define heap_caps_free(ptr)                  free(ptr)
@@ -0,0 +1,13 @@
+/*
+ * Host stand-in for the ESP-IDF logging macros, errors and warnings go to stderr, the rest is
+ * only format checked.
+ */
+#pragma once
+
+#include <stdio.h>
+
+#define ESP_LOGE(tag, fmt, ...) fprintf(stderr, "E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) fprintf(stderr, "W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) do { if (0) fprintf(stderr, "%s: " fmt "\n", tag, ##__VA_ARGS__); } while (0)
+#define ESP_LOGD(tag, fmt, ...) do { if (0) fprintf(stderr, "%s: " fmt "\n", tag, ##__VA_ARGS__); } while (0)
+#define ESP_LOGV(tag, fmt, ...) do { if (0) fprintf(stderr, "%s: " fmt "\n", tag, ##__VA_ARGS__); } while (0)
@@ -0,0 +1,36 @@
+/*
+ * Host side flash partition model.
+ *
+ * A test registers a buffer as a partition, `esp_partition_find_first` then finds it and `esp_partition_mmap`
+ * "maps" it by handing out a pointer into the buffer. Mappings are counted, so a test can check they are released.
+ */
+#pragma once
+
+#include <stddef.h>
+#include "esp_partition.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Register a partition backed by a buffer, which must outlive it
+ *
+ * @return The partition, NULL when the partition table is full
+ */
+const esp_partition_t *esp_partition_stub_add(esp_partition_type_t type, uint8_t subtype, const char *label,
+                                              const void *data, size_t size);
+
+/**
+ * @brief Remove every partition
+ */
+void esp_partition_stub_clear(void);
+
+/**
+ * @brief Number of mappings not unmapped yet
+ */
+size_t esp_partition_stub_get_num_mapped(void);
+
+#ifdef __cplusplus
+}
+#endif
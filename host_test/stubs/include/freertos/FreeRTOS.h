@@ -0,0 +1,62 @@
+/*
+ * Host stand-in for FreeRTOS.h on top of pthreads.
+ *
+ * Tasks are threads, critical sections take one global recursive mutex. A tick lasts `freertos_stub_tick_us`
+ * microseconds of real time, tests shorten it to run delay heavy code faster. Pinned tasks run on any host CPU, but
+ * the CPU time of the threads pinned to a core (esp_timer callbacks count to core 0, like the esp_timer task) is that
+ * core's busy time, the rest is its idle task's run time.
+ */
+#pragma once
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdFALSE             0
+#define pdTRUE              1
+#define pdPASS              pdTRUE
+#define pdFAIL              pdFALSE
+#define portMAX_DELAY       ((TickType_t)0xFFFFFFFF)
+#define configTICK_RATE_HZ  CONFIG_FREERTOS_HZ
+#define portTICK_PERIOD_MS  (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)   ((TickType_t)((uint64_t)(ms) * configTICK_RATE_HZ / 1000))
+
+typedef struct {
+    int unused;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+
+void freertos_stub_enter_critical(void);
+void freertos_stub_exit_critical(void);
+
+#define portENTER_CRITICAL(mux)     freertos_stub_enter_critical()
+#define portEXIT_CRITICAL(mux)      freertos_stub_exit_critical()
+#define portENTER_CRITICAL_ISR(mux) freertos_stub_enter_critical()
+#define portEXIT_CRITICAL_ISR(mux)  freertos_stub_exit_critical()
+#define portENTER_CRITICAL_SAFE(mux) freertos_stub_enter_critical()
+#define portEXIT_CRITICAL_SAFE(mux)  freertos_stub_exit_critical()
+#define portYIELD_FROM_ISR()        do { } while (0)
+
+/**
+ * @brief Core the calling task is pinned to, 0 for unpinned tasks and threads not created as tasks
+ */
+BaseType_t xPortGetCoreID(void);
+
+/**
+ * @brief Real time length of one tick, in us, 1000000 / configTICK_RATE_HZ unless a test changes it
+ */
+extern volatile uint32_t freertos_stub_tick_us;
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,33 @@
+/*
+ * Host stand-in for FreeRTOS task.h, see FreeRTOS.h.
+ */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct freertos_stub_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *arg);
+
+#define tskNO_AFFINITY ((BaseType_t)0x7FFFFFFF)
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task_code, const char *name, uint32_t stack_depth, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *ret_task, BaseType_t core_id);
+BaseType_t xTaskCreate(TaskFunction_t task_code, const char *name, uint32_t stack_depth, void *arg,
+                       UBaseType_t priority, TaskHandle_t *ret_task);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+TickType_t xTaskGetTickCount(void);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelete(TaskHandle_t task);
+void vTaskSuspend(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higher_priority_task_woken);
+uint32_t ulTaskGetIdleRunTimeCounterForCore(BaseType_t core_id);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,121 @@
+/*
+ * Host side RMT channel model.
+ *
+ * A stub channel owns one memory block of `mem_block_symbols` symbols. Running an encoder through it mimics the
+ * refill ISR: the encoder is called until it reports RMT_ENCODING_COMPLETE, and every time it yields with
+ * RMT_ENCODING_MEM_FULL the block is drained into a capture buffer, which tests can inspect afterwards. Like the
+ * hardware's ping-pong buffer, the first call fills the whole block and every later one (a refill interrupt) half
+ * of it. A DMA channel (`flags.with_dma`) works the same on its DMA buffer; as on the ESP32-S3, only one TX channel
+ * can use DMA.
+ *
+ * Channels created with `rmt_new_tx_channel` work the same way and also log where every transaction ends. Their
+ * transactions are reported done (on_trans_done) before `rmt_transmit` returns, unless the test asked for manual
+ * completion. Those calls are thread safe, so a test can watch the channels of code running in other threads.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "driver/rmt_encoder.h"
+#include "driver/rmt_tx.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Create a stub channel with a memory block of the given size, in symbols
+ */
+rmt_channel_handle_t rmt_stub_new_channel(size_t mem_block_symbols);
+
+/**
+ * @brief Delete a stub channel and its capture buffer
+ */
+void rmt_stub_del_channel(rmt_channel_handle_t channel);
+
+/**
+ * @brief Run one transaction through the encoder, appending the emitted symbols to the capture buffer
+ *
+ * @return Number of symbols emitted by this transaction
+ */
+size_t rmt_stub_encode(rmt_channel_handle_t channel, rmt_encoder_handle_t encoder, const void *data, size_t data_size);
+
+/**
+ * @brief Get the captured symbol stream
+ */
+const rmt_symbol_word_t *rmt_stub_get_symbols(rmt_channel_handle_t channel, size_t *ret_num_symbols);
+
+/**
+ * @brief Number of encoder invocations since the channel was created or cleared
+ *
+ * @note Every transaction takes one call to fill the block before it starts, the others are refill interrupts.
+ */
+size_t rmt_stub_get_refills(rmt_channel_handle_t channel);
+
+/**
+ * @brief Call `hook` between every two refills of a transaction, as other code may run while a block is shifted out
+ *
+ * @param[in] hook Function to call, NULL to remove it
+ */
+void rmt_stub_set_refill_hook(rmt_channel_handle_t channel, void (*hook)(void *arg), void *arg);
+
+/**
+ * @brief Drop the captured symbols and reset the refill counter
+ */
+void rmt_stub_clear(rmt_channel_handle_t channel);
+
+/**
+ * @brief Find the TX channel driving a GPIO, NULL if there is none
+ */
+rmt_channel_handle_t rmt_stub_find_channel(int gpio_num);
+
+/**
+ * @brief Keep transactions pending until `rmt_stub_complete` instead of finishing them in `rmt_transmit`
+ *
+ * @note `rmt_transmit` fails with ESP_ERR_INVALID_STATE when trans_queue_depth transactions are pending, where the
+ *       driver would block.
+ */
+void rmt_stub_set_manual_done(rmt_channel_handle_t channel, bool manual_done);
+
+/**
+ * @brief Finish up to `count` pending transactions in order, calling on_trans_done for each
+ *
+ * @return Number of transactions finished
+ */
+size_t rmt_stub_complete(rmt_channel_handle_t channel, size_t count);
+
+/**
+ * @brief Number of transactions queued and not finished yet
+ */
+size_t rmt_stub_get_pending(rmt_channel_handle_t channel);
+
+/**
+ * @brief Whether the channel belongs to a sync manager
+ */
+bool rmt_stub_is_synced(rmt_channel_handle_t channel);
+
+/**
+ * @brief Number of transactions submitted through `rmt_transmit` since the channel was created
+ */
+size_t rmt_stub_get_num_transactions(rmt_channel_handle_t channel);
+
+/**
+ * @brief Copy the symbols of one transaction
+ *
+ * @return Number of symbols in the transaction, only up to `max_symbols` of them are copied
+ */
+size_t rmt_stub_copy_transaction(rmt_channel_handle_t channel, size_t index, rmt_symbol_word_t *symbols, size_t max_symbols);
+
+/**
+ * @brief Time `rmt_transmit` was called for a transaction, on the `esp_timer_get_time` clock, -1 for no such transaction
+ */
+int64_t rmt_stub_get_transaction_time(rmt_channel_handle_t channel, size_t index);
+
+/**
+ * @brief Core the channel's interrupt would be allocated on, the core of the task that created the channel
+ */
+int rmt_stub_get_intr_core(rmt_channel_handle_t channel);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,21 @@
+/*
+ * Host stand-in for the generated sdkconfig.h, the project options the code under test reads.
+ */
+#pragma once
+
+#define CONFIG_FREERTOS_HZ 100
+#define CONFIG_FREERTOS_NUMBER_OF_CORES 2
+#define CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS 1
+#define CONFIG_FREERTOS_RUN_TIME_STATS_USING_ESP_TIMER 1
+#define CONFIG_APP_QUIT_PIN 0
+#define CONFIG_CLASS_DRIVER_MIDI_IN_TRANSFERS 3
+#define CONFIG_LED_STRIP_OUTPUT_RMT 1
+#define CONFIG_LED_STRIP_RMT_MEM_BLOCK_SYMBOLS 64
+#define CONFIG_APP_USB_CORE 0
+#define CONFIG_APP_RENDER_CORE 1
+
+// the keyboard layout test builds once per layout, with its own options
+#ifndef CONFIG_KEYBOARD_NUM_LEDS
+#define CONFIG_KEYBOARD_LAYOUT_61_KEYS 1
+#define CONFIG_KEYBOARD_NUM_LEDS 61
+#endif
@@ -0,0 +1,8 @@
+/*
+ * Host stand-in for soc/soc_caps.h, the capabilities of an ESP32-S3.
+ */
+#pragma once
+
+#define SOC_RMT_TX_CANDIDATES_PER_GROUP 4
+#define SOC_RMT_MEM_WORDS_PER_CHANNEL   48 // symbols of one RMT RAM block
+#define SOC_RMT_SUPPORT_DMA             1  // only the last TX channel can be fed by DMA
@@ -0,0 +1,42 @@
+/*
+ * Host side SPI bus model.
+ *
+ * `spi_device_queue_trans` copies the transmitted bytes into a log and finishes the transaction at once: post_cb
+ * runs before it returns and the result waits for `spi_device_get_trans_result`. Tests find a device by the MOSI
+ * GPIO of its bus and read back what it sent.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "driver/spi_master.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Find the device on the bus whose MOSI is the given GPIO, NULL if there is none
+ */
+spi_device_handle_t spi_stub_find_device(int mosi_io_num);
+
+/**
+ * @brief Clock the device was added with, in Hz
+ */
+int spi_stub_get_clock_hz(spi_device_handle_t device);
+
+/**
+ * @brief Number of transactions queued since the device was added
+ */
+size_t spi_stub_get_num_transactions(spi_device_handle_t device);
+
+/**
+ * @brief Get the bytes sent by one transaction
+ *
+ * @return The bytes, NULL if there is no such transaction
+ */
+const uint8_t *spi_stub_get_transaction(spi_device_handle_t device, size_t index, size_t *ret_num_bytes);
+
+#ifdef __cplusplus
+}
+#endif
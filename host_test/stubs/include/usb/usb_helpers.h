@@ -0,0 +1,19 @@
+/*
+ * Host stand-in for the ESP-IDF USB descriptor helpers.
+ */
+#pragma once
+
+#include "usb/usb_host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+const usb_standard_desc_t *usb_parse_next_descriptor(const usb_standard_desc_t *cur_desc, uint16_t wTotalLength, int *offset);
+
+// Nothing is printed on the host
+void usb_print_config_descriptor(const usb_config_desc_t *cfg_desc, void *class_specific_cb);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,195 @@
+/*
+ * Host stand-in for the ESP-IDF USB Host Library API (usb/usb_host.h and the USB types it pulls in).
+ *
+ * Devices are attached and fed by the test through usb_host_stub.h. Client events and transfer completions are
+ * delivered from `usb_host_client_handle_events`, in the client's task, like on target.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ESP_INTR_FLAG_LEVEL1 (1 << 1)
+
+typedef struct usb_host_client_handle_s *usb_host_client_handle_t;
+typedef struct usb_device_handle_s *usb_device_handle_t;
+
+// ---------------------------------------------------------------- Descriptors
+
+#define USB_B_DESCRIPTOR_TYPE_CONFIGURATION     0x02
+#define USB_B_DESCRIPTOR_TYPE_INTERFACE         0x04
+#define USB_B_DESCRIPTOR_TYPE_ENDPOINT          0x05
+
+#define USB_CLASS_AUDIO                         0x01
+
+#define USB_BM_ATTRIBUTES_XFERTYPE_MASK         0x03
+#define USB_BM_ATTRIBUTES_XFER_CONTROL          (0 << 0)
+#define USB_BM_ATTRIBUTES_XFER_ISOC             (1 << 0)
+#define USB_BM_ATTRIBUTES_XFER_BULK             (2 << 0)
+#define USB_BM_ATTRIBUTES_XFER_INT              (3 << 0)
+#define USB_B_ENDPOINT_ADDRESS_EP_DIR_MASK      (1 << 7)
+#define USB_EP_DESC_GET_MPS(desc_ptr)           ((desc_ptr)->wMaxPacketSize & 0x7FF)
+
+typedef union {
+    struct {
+        uint8_t bLength;
+        uint8_t bDescriptorType;
+    } __attribute__((packed));
+    uint8_t val[2];
+} usb_standard_desc_t;
+
+typedef struct {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint16_t wTotalLength;
+    uint8_t bNumInterfaces;
+    uint8_t bConfigurationValue;
+    uint8_t iConfiguration;
+    uint8_t bmAttributes;
+    uint8_t bMaxPower;
+} __attribute__((packed)) usb_config_desc_t;
+
+typedef struct {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bInterfaceNumber;
+    uint8_t bAlternateSetting;
+    uint8_t bNumEndpoints;
+    uint8_t bInterfaceClass;
+    uint8_t bInterfaceSubClass;
+    uint8_t bInterfaceProtocol;
+    uint8_t iInterface;
+} __attribute__((packed)) usb_intf_desc_t;
+
+typedef struct {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bEndpointAddress;
+    uint8_t bmAttributes;
+    uint16_t wMaxPacketSize;
+    uint8_t bInterval;
+} __attribute__((packed)) usb_ep_desc_t;
+
+// ---------------------------------------------------------------- Transfers
+
+typedef enum {
+    USB_TRANSFER_STATUS_COMPLETED,
+    USB_TRANSFER_STATUS_ERROR,
+    USB_TRANSFER_STATUS_TIMED_OUT,
+    USB_TRANSFER_STATUS_CANCELED,
+    USB_TRANSFER_STATUS_STALL,
+    USB_TRANSFER_STATUS_OVERFLOW,
+    USB_TRANSFER_STATUS_SKIPPED,
+    USB_TRANSFER_STATUS_NO_DEVICE,
+} usb_transfer_status_t;
+
+typedef struct usb_transfer_s usb_transfer_t;
+typedef void (*usb_transfer_cb_t)(usb_transfer_t *transfer);
+
+struct usb_transfer_s {
+    uint8_t *const data_buffer;
+    const size_t data_buffer_size;
+    size_t num_bytes;
+    int actual_num_bytes;
+    uint32_t flags;
+    usb_device_handle_t device_handle;
+    uint8_t bEndpointAddress;
+    usb_transfer_status_t status;
+    uint32_t timeout_ms;
+    usb_transfer_cb_t callback;
+    void *context;
+    const int num_isoc_packets;
+};
+
+// ---------------------------------------------------------------- Host Library and clients
+
+#define USB_HOST_LIB_EVENT_FLAGS_NO_CLIENTS     0x01
+#define USB_HOST_LIB_EVENT_FLAGS_ALL_FREE       0x02
+
+typedef enum {
+    USB_SPEED_LOW = 0,
+    USB_SPEED_FULL,
+    USB_SPEED_HIGH,
+} usb_speed_t;
+
+typedef struct {
+    usb_speed_t speed;
+    uint8_t dev_addr;
+    uint8_t bMaxPacketSize0;
+    uint8_t bConfigurationValue;
+} usb_device_info_t;
+
+typedef enum {
+    USB_HOST_CLIENT_EVENT_NEW_DEV,
+    USB_HOST_CLIENT_EVENT_DEV_GONE,
+} usb_host_client_event_t;
+
+typedef struct {
+    usb_host_client_event_t event;
+    union {
+        struct {
+            uint8_t address;
+        } new_dev;
+        struct {
+            usb_device_handle_t dev_hdl;
+        } dev_gone;
+    };
+} usb_host_client_event_msg_t;
+
+typedef void (*usb_host_client_event_cb_t)(const usb_host_client_event_msg_t *event_msg, void *arg);
+
+typedef struct {
+    bool skip_phy_setup;
+    bool root_port_unpowered;
+    int intr_flags;
+    void *enum_filter_cb;
+} usb_host_config_t;
+
+typedef struct {
+    bool is_synchronous;
+    int max_num_event_msg;
+    struct {
+        usb_host_client_event_cb_t client_event_callback;
+        void *callback_arg;
+    } async;
+} usb_host_client_config_t;
+
+esp_err_t usb_host_install(const usb_host_config_t *config);
+esp_err_t usb_host_uninstall(void);
+esp_err_t usb_host_lib_handle_events(TickType_t timeout_ticks, uint32_t *event_flags_ret);
+esp_err_t usb_host_device_free_all(void);
+esp_err_t usb_host_device_addr_list_fill(int list_len, uint8_t *dev_addr_list, int *num_dev_ret);
+
+esp_err_t usb_host_client_register(const usb_host_client_config_t *client_config, usb_host_client_handle_t *client_hdl_ret);
+esp_err_t usb_host_client_deregister(usb_host_client_handle_t client_hdl);
+esp_err_t usb_host_client_handle_events(usb_host_client_handle_t client_hdl, TickType_t timeout_ticks);
+esp_err_t usb_host_client_unblock(usb_host_client_handle_t client_hdl);
+
+esp_err_t usb_host_device_open(usb_host_client_handle_t client_hdl, uint8_t dev_addr, usb_device_handle_t *dev_hdl_ret);
+esp_err_t usb_host_device_close(usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl);
+esp_err_t usb_host_device_info(usb_device_handle_t dev_hdl, usb_device_info_t *dev_info);
+esp_err_t usb_host_get_active_config_descriptor(usb_device_handle_t dev_hdl, const usb_config_desc_t **config_desc);
+
+esp_err_t usb_host_interface_claim(usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl,
+                                   uint8_t bInterfaceNumber, uint8_t bAlternateSetting);
+esp_err_t usb_host_interface_release(usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl,
+                                     uint8_t bInterfaceNumber);
+
+esp_err_t usb_host_endpoint_halt(usb_device_handle_t dev_hdl, uint8_t bEndpointAddress);
+esp_err_t usb_host_endpoint_flush(usb_device_handle_t dev_hdl, uint8_t bEndpointAddress);
+esp_err_t usb_host_endpoint_clear(usb_device_handle_t dev_hdl, uint8_t bEndpointAddress);
+
+esp_err_t usb_host_transfer_alloc(size_t data_buffer_size, int num_isoc_packets, usb_transfer_t **transfer);
+esp_err_t usb_host_transfer_free(usb_transfer_t *transfer);
+esp_err_t usb_host_transfer_submit(usb_transfer_t *transfer);
+
+#ifdef __cplusplus
+}
+#endif
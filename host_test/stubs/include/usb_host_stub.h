@@ -0,0 +1,79 @@
+/*
+ * Scripting side of the host USB Host Library stand-in.
+ *
+ * Tests play the device: attach a configuration descriptor at an address, answer the IN transfers the code under test
+ * queues on an endpoint, then unplug it. Every call is thread safe and only queues work, the client callbacks run
+ * later from `usb_host_client_handle_events` in the client's task.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Plug a device in, reported as NEW_DEV to every registered client
+ *
+ * @param[in] dev_addr Address of the device, 1 to 127
+ * @param[in] config_desc Full configuration descriptor, copied
+ * @param[in] size Size of config_desc, must match its wTotalLength
+ * @return
+ *      - ESP_ERR_INVALID_ARG for an invalid address or descriptor
+ *      - ESP_ERR_INVALID_STATE if the address is taken
+ *      - ESP_ERR_NO_MEM if the device table is full
+ *      - ESP_OK on success
+ */
+esp_err_t usb_stub_attach(uint8_t dev_addr, const uint8_t *config_desc, size_t size);
+
+/**
+ * @brief Unplug a device, its queued transfers complete with USB_TRANSFER_STATUS_NO_DEVICE and every client that
+ *        opened it gets DEV_GONE
+ *
+ * @return
+ *      - ESP_ERR_NOT_FOUND if no device is attached at the address
+ *      - ESP_OK on success
+ */
+esp_err_t usb_stub_detach(uint8_t dev_addr);
+
+/**
+ * @brief Unplug a device, but report DEV_GONE before its queued transfers complete, as the real library may
+ *
+ * @note The transfers stay queued until the client halts and flushes their endpoints, they then complete with
+ *       USB_TRANSFER_STATUS_CANCELED. Until then neither their interface can be released nor the device closed.
+ *
+ * @return
+ *      - ESP_ERR_NOT_FOUND if no device is attached at the address
+ *      - ESP_OK on success
+ */
+esp_err_t usb_stub_detach_late(uint8_t dev_addr);
+
+/**
+ * @brief Complete the oldest IN transfer queued on an endpoint with the given data
+ *
+ * @note The data is truncated to the num_bytes of the transfer, like a device sending too much would overflow.
+ *
+ * @return
+ *      - ESP_ERR_NOT_FOUND if no device is attached at the address
+ *      - ESP_ERR_INVALID_STATE if no transfer is queued on the endpoint, the device would be NAKed
+ *      - ESP_OK on success
+ */
+esp_err_t usb_stub_send_in(uint8_t dev_addr, uint8_t ep_addr, const void *data, size_t size);
+
+/**
+ * @brief Number of transfers queued on an endpoint and waiting for data, -1 if no device is attached at the address
+ */
+int usb_stub_get_num_queued(uint8_t dev_addr, uint8_t ep_addr);
+
+/**
+ * @brief Whether any client holds the device open
+ */
+bool usb_stub_is_open(uint8_t dev_addr);
+
+#ifdef __cplusplus
+}
+#endif
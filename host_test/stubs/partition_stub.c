@@ -0,0 +1,71 @@
+#include <string.h>
+#include "esp_partition_stub.h"
+
+#define PARTITION_STUB_MAX 4
+
+typedef struct {
+    esp_partition_t partition;
+    const void *data;
+} partition_stub_t;
+
+static partition_stub_t s_partitions[PARTITION_STUB_MAX];
+static size_t s_num_partitions;
+static size_t s_num_mapped;
+
+const esp_partition_t *esp_partition_stub_add(esp_partition_type_t type, uint8_t subtype, const char *label,
+                                              const void *data, size_t size)
+{
+    if (s_num_partitions == PARTITION_STUB_MAX) {
+        return NULL;
+    }
+    partition_stub_t *stub = &s_partitions[s_num_partitions++];
+    memset(stub, 0, sizeof(*stub));
+    stub->partition.type = type;
+    stub->partition.subtype = (esp_partition_subtype_t)subtype;
+    stub->partition.size = size;
+    strncpy(stub->partition.label, label, sizeof(stub->partition.label) - 1);
+    stub->data = data;
+    return &stub->partition;
+}
+
+void esp_partition_stub_clear(void)
+{
+    s_num_partitions = 0;
+}
+
+size_t esp_partition_stub_get_num_mapped(void)
+{
+    return s_num_mapped;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    for (size_t i = 0; i < s_num_partitions; i++) {
+        const esp_partition_t *partition = &s_partitions[i].partition;
+        if ((type == ESP_PARTITION_TYPE_ANY || partition->type == type) &&
+                (subtype == ESP_PARTITION_SUBTYPE_ANY || partition->subtype == subtype) &&
+                (!label || strcmp(partition->label, label) == 0)) {
+            return partition;
+        }
+    }
+    return NULL;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t *partition, size_t offset, size_t size,
+                             esp_partition_mmap_memory_t memory, const void **out_ptr,
+                             esp_partition_mmap_handle_t *out_handle)
+{
+    if (!partition || !out_ptr || !out_handle || offset > partition->size || size > partition->size - offset) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const partition_stub_t *stub = (const partition_stub_t *)partition;
+    *out_ptr = (const uint8_t *)stub->data + offset;
+    *out_handle = ++s_num_mapped;
+    return ESP_OK;
+}
+
+void esp_partition_munmap(esp_partition_mmap_handle_t handle)
+{
+    s_num_mapped--;
+}
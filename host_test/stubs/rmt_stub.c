@@ -0,0 +1,618 @@
+/*
+ * Host implementation of the RMT encoders, the TX channel API and the stub channel described in rmt_stub.h.
+ */
+#include <pthread.h>
+#include <string.h>
+#include "driver/rmt_tx.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "soc/soc_caps.h"
+#include "rmt_stub.h"
+
+#define RMT_STUB_MAX_TX_CHANNELS 8
+
+struct rmt_channel_t {
+    rmt_symbol_word_t *mem;
+    size_t mem_size;
+    size_t mem_off;
+    size_t mem_end;             // the encoder fills the whole block first, then half of it per refill
+    rmt_symbol_word_t *capture;
+    size_t capture_len;
+    size_t capture_cap;
+    size_t refills;
+    void (*refill_hook)(void *arg); // runs while the block is shifted out, between two refills
+    void *refill_hook_arg;
+    // TX channel API only
+    pthread_mutex_t lock;       // protects the capture and the transaction log against test threads
+    gpio_num_t gpio_num;
+    bool with_dma;
+    size_t queue_depth;
+    bool enabled;
+    bool synced;
+    bool manual_done;
+    size_t pending;             // transactions captured but not reported done
+    size_t *trans_ends;         // capture offset after every transaction
+    int64_t *trans_times;       // esp_timer_get_time() of every rmt_transmit
+    int intr_core;              // the driver allocates the interrupt on the core that creates the channel
+    size_t num_trans;
+    rmt_tx_done_callback_t on_trans_done;
+    void *user_ctx;
+};
+
+struct rmt_sync_manager_t {
+    rmt_channel_handle_t channels[RMT_STUB_MAX_TX_CHANNELS];
+    size_t num_channels;
+};
+
+static pthread_mutex_t s_tx_channels_lock = PTHREAD_MUTEX_INITIALIZER;
+static rmt_channel_handle_t s_tx_channels[RMT_STUB_MAX_TX_CHANNELS];
+
+typedef struct {
+    rmt_encoder_t base;
+    rmt_symbol_word_t bit0;
+    rmt_symbol_word_t bit1;
+    bool msb_first;
+    size_t last_byte_index;
+    int last_bit_index;
+} rmt_stub_bytes_encoder_t;
+
+typedef struct {
+    rmt_encoder_t base;
+    size_t last_symbol_index;
+} rmt_stub_copy_encoder_t;
+
+typedef struct {
+    rmt_encoder_t base;
+    rmt_encode_simple_cb_t callback;
+    void *arg;
+    size_t min_chunk_size;
+    size_t symbols_written;
+} rmt_stub_simple_encoder_t;
+
+static size_t rmt_stub_encode_bytes(rmt_encoder_t *encoder, rmt_channel_handle_t channel, const void *primary_data, size_t data_size, rmt_encode_state_t *ret_state)
+{
+    rmt_stub_bytes_encoder_t *bytes_encoder = __containerof(encoder, rmt_stub_bytes_encoder_t, base);
+    const uint8_t *data = primary_data;
+    size_t start = channel->mem_off;
+    rmt_encode_state_t state = RMT_ENCODING_RESET;
+    while (bytes_encoder->last_byte_index < data_size) {
+        uint8_t value = data[bytes_encoder->last_byte_index];
+        while (bytes_encoder->last_bit_index < 8) {
+            if (channel->mem_off == channel->mem_end) {
+                state |= RMT_ENCODING_MEM_FULL;
+                goto out;
+            }
+            int bit = bytes_encoder->msb_first ? 7 - bytes_encoder->last_bit_index : bytes_encoder->last_bit_index;
+            channel->mem[channel->mem_off++] = (value & (1 << bit)) ? bytes_encoder->bit1 : bytes_encoder->bit0;
+            bytes_encoder->last_bit_index++;
+        }
+        bytes_encoder->last_bit_index = 0;
+        bytes_encoder->last_byte_index++;
+    }
+    bytes_encoder->last_byte_index = 0;
+    state |= RMT_ENCODING_COMPLETE;
+    if (channel->mem_off == channel->mem_end) {
+        state |= RMT_ENCODING_MEM_FULL;
+    }
+out:
+    *ret_state = state;
+    return channel->mem_off - start;
+}
+
+static esp_err_t rmt_stub_reset_bytes(rmt_encoder_t *encoder)
+{
+    rmt_stub_bytes_encoder_t *bytes_encoder = __containerof(encoder, rmt_stub_bytes_encoder_t, base);
+    bytes_encoder->last_byte_index = 0;
+    bytes_encoder->last_bit_index = 0;
+    return ESP_OK;
+}
+
+static size_t rmt_stub_encode_copy(rmt_encoder_t *encoder, rmt_channel_handle_t channel, const void *primary_data, size_t data_size, rmt_encode_state_t *ret_state)
+{
+    rmt_stub_copy_encoder_t *copy_encoder = __containerof(encoder, rmt_stub_copy_encoder_t, base);
+    const rmt_symbol_word_t *symbols = primary_data;
+    size_t num_symbols = data_size / sizeof(rmt_symbol_word_t);
+    size_t start = channel->mem_off;
+    rmt_encode_state_t state = RMT_ENCODING_RESET;
+    while (copy_encoder->last_symbol_index < num_symbols) {
+        if (channel->mem_off == channel->mem_end) {
+            state |= RMT_ENCODING_MEM_FULL;
+            goto out;
+        }
+        channel->mem[channel->mem_off++] = symbols[copy_encoder->last_symbol_index++];
+    }
+    copy_encoder->last_symbol_index = 0;
+    state |= RMT_ENCODING_COMPLETE;
+    if (channel->mem_off == channel->mem_end) {
+        state |= RMT_ENCODING_MEM_FULL;
+    }
+out:
+    *ret_state = state;
+    return channel->mem_off - start;
+}
+
+static esp_err_t rmt_stub_reset_copy(rmt_encoder_t *encoder)
+{
+    rmt_stub_copy_encoder_t *copy_encoder = __containerof(encoder, rmt_stub_copy_encoder_t, base);
+    copy_encoder->last_symbol_index = 0;
+    return ESP_OK;
+}
+
+static size_t rmt_stub_encode_simple(rmt_encoder_t *encoder, rmt_channel_handle_t channel, const void *primary_data, size_t data_size, rmt_encode_state_t *ret_state)
+{
+    rmt_stub_simple_encoder_t *simple_encoder = __containerof(encoder, rmt_stub_simple_encoder_t, base);
+    size_t start = channel->mem_off;
+    rmt_encode_state_t state = RMT_ENCODING_RESET;
+    bool done = false;
+    while (!done) {
+        size_t symbols_free = channel->mem_end - channel->mem_off;
+        size_t written = 0;
+        if (symbols_free) {
+            written = simple_encoder->callback(primary_data, data_size, simple_encoder->symbols_written, symbols_free,
+                                               &channel->mem[channel->mem_off], &done, simple_encoder->arg);
+        }
+        if (!written && !done) {
+            // the real driver falls back to an overflow buffer here, the stub simply waits for the next block
+            if (channel->mem_off == 0) {
+                fprintf(stderr, "simple encoder made no progress in an empty block of %zu symbols\n", channel->mem_end);
+                abort();
+            }
+            state |= RMT_ENCODING_MEM_FULL;
+            goto out;
+        }
+        channel->mem_off += written;
+        simple_encoder->symbols_written += written;
+    }
+    simple_encoder->symbols_written = 0;
+    state |= RMT_ENCODING_COMPLETE;
+    if (channel->mem_off == channel->mem_end) {
+        state |= RMT_ENCODING_MEM_FULL;
+    }
+out:
+    *ret_state = state;
+    return channel->mem_off - start;
+}
+
+static esp_err_t rmt_stub_reset_simple(rmt_encoder_t *encoder)
+{
+    rmt_stub_simple_encoder_t *simple_encoder = __containerof(encoder, rmt_stub_simple_encoder_t, base);
+    simple_encoder->symbols_written = 0;
+    return ESP_OK;
+}
+
+static esp_err_t rmt_stub_del_encoder(rmt_encoder_t *encoder)
+{
+    free(encoder);
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_bytes_encoder(const rmt_bytes_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+{
+    if (!config || !ret_encoder) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    rmt_stub_bytes_encoder_t *bytes_encoder = calloc(1, sizeof(rmt_stub_bytes_encoder_t));
+    if (!bytes_encoder) {
+        return ESP_ERR_NO_MEM;
+    }
+    bytes_encoder->base.encode = rmt_stub_encode_bytes;
+    bytes_encoder->base.reset = rmt_stub_reset_bytes;
+    bytes_encoder->base.del = rmt_stub_del_encoder;
+    bytes_encoder->bit0 = config->bit0;
+    bytes_encoder->bit1 = config->bit1;
+    bytes_encoder->msb_first = config->flags.msb_first;
+    *ret_encoder = &bytes_encoder->base;
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_copy_encoder(const rmt_copy_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+{
+    if (!config || !ret_encoder) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    rmt_stub_copy_encoder_t *copy_encoder = calloc(1, sizeof(rmt_stub_copy_encoder_t));
+    if (!copy_encoder) {
+        return ESP_ERR_NO_MEM;
+    }
+    copy_encoder->base.encode = rmt_stub_encode_copy;
+    copy_encoder->base.reset = rmt_stub_reset_copy;
+    copy_encoder->base.del = rmt_stub_del_encoder;
+    *ret_encoder = &copy_encoder->base;
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_simple_encoder(const rmt_simple_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+{
+    if (!config || !config->callback || !ret_encoder) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    rmt_stub_simple_encoder_t *simple_encoder = calloc(1, sizeof(rmt_stub_simple_encoder_t));
+    if (!simple_encoder) {
+        return ESP_ERR_NO_MEM;
+    }
+    simple_encoder->base.encode = rmt_stub_encode_simple;
+    simple_encoder->base.reset = rmt_stub_reset_simple;
+    simple_encoder->base.del = rmt_stub_del_encoder;
+    simple_encoder->callback = config->callback;
+    simple_encoder->arg = config->arg;
+    simple_encoder->min_chunk_size = config->min_chunk_size ? config->min_chunk_size : 64;
+    *ret_encoder = &simple_encoder->base;
+    return ESP_OK;
+}
+
+esp_err_t rmt_del_encoder(rmt_encoder_handle_t encoder)
+{
+    if (!encoder) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return encoder->del(encoder);
+}
+
+esp_err_t rmt_encoder_reset(rmt_encoder_handle_t encoder)
+{
+    if (!encoder) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return encoder->reset(encoder);
+}
+
+void *rmt_alloc_encoder_mem(size_t size)
+{
+    return calloc(1, size);
+}
+
+rmt_channel_handle_t rmt_stub_new_channel(size_t mem_block_symbols)
+{
+    rmt_channel_handle_t channel = calloc(1, sizeof(struct rmt_channel_t));
+    channel->mem = calloc(mem_block_symbols, sizeof(rmt_symbol_word_t));
+    channel->mem_size = mem_block_symbols;
+    pthread_mutex_init(&channel->lock, NULL);
+    channel->gpio_num = -1;
+    return channel;
+}
+
+void rmt_stub_del_channel(rmt_channel_handle_t channel)
+{
+    pthread_mutex_destroy(&channel->lock);
+    free(channel->trans_ends);
+    free(channel->trans_times);
+    free(channel->capture);
+    free(channel->mem);
+    free(channel);
+}
+
+static void rmt_stub_drain(rmt_channel_handle_t channel)
+{
+    if (channel->capture_len + channel->mem_off > channel->capture_cap) {
+        size_t cap = channel->capture_cap ? channel->capture_cap * 2 : 1024;
+        while (cap < channel->capture_len + channel->mem_off) {
+            cap *= 2;
+        }
+        channel->capture = realloc(channel->capture, cap * sizeof(rmt_symbol_word_t));
+        channel->capture_cap = cap;
+    }
+    memcpy(&channel->capture[channel->capture_len], channel->mem, channel->mem_off * sizeof(rmt_symbol_word_t));
+    channel->capture_len += channel->mem_off;
+    channel->mem_off = 0;
+}
+
+size_t rmt_stub_encode(rmt_channel_handle_t channel, rmt_encoder_handle_t encoder, const void *data, size_t data_size)
+{
+    size_t start = channel->capture_len;
+    channel->mem_off = 0;
+    channel->mem_end = channel->mem_size;
+    while (1) {
+        rmt_encode_state_t state = RMT_ENCODING_RESET;
+        size_t before = channel->mem_off;
+        size_t encoded = encoder->encode(encoder, channel, data, data_size, &state);
+        channel->refills++;
+        if (encoded != channel->mem_off - before) {
+            fprintf(stderr, "encoder reported %zu symbols but wrote %zu\n", encoded, channel->mem_off - before);
+            abort();
+        }
+        if (state & RMT_ENCODING_COMPLETE) {
+            break;
+        }
+        if (!(state & RMT_ENCODING_MEM_FULL)) {
+            fprintf(stderr, "encoder yielded without completing or filling the memory block\n");
+            abort();
+        }
+        rmt_stub_drain(channel);
+        if (channel->refill_hook) {
+            channel->refill_hook(channel->refill_hook_arg);
+        }
+        // ping-pong: the refill interrupt fires once half of the block has been shifted out and refills that half
+        channel->mem_end = channel->mem_size > 1 ? channel->mem_size / 2 : 1;
+    }
+    rmt_stub_drain(channel);
+    return channel->capture_len - start;
+}
+
+const rmt_symbol_word_t *rmt_stub_get_symbols(rmt_channel_handle_t channel, size_t *ret_num_symbols)
+{
+    *ret_num_symbols = channel->capture_len;
+    return channel->capture;
+}
+
+size_t rmt_stub_get_refills(rmt_channel_handle_t channel)
+{
+    return channel->refills;
+}
+
+void rmt_stub_set_refill_hook(rmt_channel_handle_t channel, void (*hook)(void *arg), void *arg)
+{
+    channel->refill_hook = hook;
+    channel->refill_hook_arg = arg;
+}
+
+void rmt_stub_clear(rmt_channel_handle_t channel)
+{
+    channel->capture_len = 0;
+    channel->refills = 0;
+}
+
+esp_err_t rmt_new_tx_channel(const rmt_tx_channel_config_t *config, rmt_channel_handle_t *ret_chan)
+{
+    if (!config || !ret_chan || !config->mem_block_symbols || !config->resolution_hz) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // a DMA buffer is split into two halves, and cannot be smaller than the RMT RAM it feeds
+    if (config->flags.with_dma && (config->mem_block_symbols % 2 || config->mem_block_symbols < SOC_RMT_MEM_WORDS_PER_CHANNEL)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    rmt_channel_handle_t channel = rmt_stub_new_channel(config->mem_block_symbols);
+    channel->gpio_num = config->gpio_num;
+    channel->with_dma = config->flags.with_dma;
+    channel->intr_core = xPortGetCoreID();
+    channel->queue_depth = config->trans_queue_depth ? config->trans_queue_depth : 1;
+    pthread_mutex_lock(&s_tx_channels_lock);
+    size_t i = 0;
+    for (size_t j = 0; j < RMT_STUB_MAX_TX_CHANNELS && channel->with_dma; j++) {
+        if (s_tx_channels[j] && s_tx_channels[j]->with_dma) {
+            i = RMT_STUB_MAX_TX_CHANNELS; // the one DMA capable channel is taken
+        }
+    }
+    while (i < RMT_STUB_MAX_TX_CHANNELS && s_tx_channels[i]) {
+        i++;
+    }
+    if (i < RMT_STUB_MAX_TX_CHANNELS) {
+        s_tx_channels[i] = channel;
+    }
+    pthread_mutex_unlock(&s_tx_channels_lock);
+    if (i == RMT_STUB_MAX_TX_CHANNELS) {
+        rmt_stub_del_channel(channel);
+        return ESP_ERR_NOT_FOUND; // all channels are used
+    }
+    *ret_chan = channel;
+    return ESP_OK;
+}
+
+esp_err_t rmt_del_channel(rmt_channel_handle_t channel)
+{
+    if (!channel) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (channel->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    pthread_mutex_lock(&s_tx_channels_lock);
+    for (size_t i = 0; i < RMT_STUB_MAX_TX_CHANNELS; i++) {
+        if (s_tx_channels[i] == channel) {
+            s_tx_channels[i] = NULL;
+        }
+    }
+    pthread_mutex_unlock(&s_tx_channels_lock);
+    rmt_stub_del_channel(channel);
+    return ESP_OK;
+}
+
+esp_err_t rmt_enable(rmt_channel_handle_t channel)
+{
+    if (!channel) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (channel->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    channel->enabled = true;
+    return ESP_OK;
+}
+
+esp_err_t rmt_disable(rmt_channel_handle_t channel)
+{
+    if (!channel) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!channel->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    channel->enabled = false;
+    return ESP_OK;
+}
+
+esp_err_t rmt_tx_register_event_callbacks(rmt_channel_handle_t tx_channel, const rmt_tx_event_callbacks_t *cbs, void *user_data)
+{
+    if (!tx_channel || !cbs) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // the driver only accepts callbacks in the init state
+    if (tx_channel->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    tx_channel->on_trans_done = cbs->on_trans_done;
+    tx_channel->user_ctx = user_data;
+    return ESP_OK;
+}
+
+// report the oldest pending transaction as done, like the end of transmission interrupt
+static void rmt_stub_finish_one(rmt_channel_handle_t channel)
+{
+    pthread_mutex_lock(&channel->lock);
+    size_t index = channel->num_trans - channel->pending;
+    size_t start = index ? channel->trans_ends[index - 1] : 0;
+    rmt_tx_done_event_data_t edata = {
+        .num_symbols = channel->trans_ends[index] - start,
+    };
+    channel->pending--;
+    pthread_mutex_unlock(&channel->lock);
+    if (channel->on_trans_done) {
+        channel->on_trans_done(channel, &edata, channel->user_ctx);
+    }
+}
+
+esp_err_t rmt_transmit(rmt_channel_handle_t tx_channel, rmt_encoder_handle_t encoder, const void *payload, size_t payload_bytes,
+                       const rmt_transmit_config_t *config)
+{
+    if (!tx_channel || !encoder || !payload || !payload_bytes || !config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!tx_channel->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    pthread_mutex_lock(&tx_channel->lock);
+    if (tx_channel->pending == tx_channel->queue_depth) {
+        // the driver would block until a transaction finishes, with manual completion that never happens here
+        pthread_mutex_unlock(&tx_channel->lock);
+        fprintf(stderr, "rmt_transmit on GPIO %d with a full queue of %zu\n", tx_channel->gpio_num, tx_channel->queue_depth);
+        return ESP_ERR_INVALID_STATE;
+    }
+    rmt_stub_encode(tx_channel, encoder, payload, payload_bytes);
+    tx_channel->trans_ends = realloc(tx_channel->trans_ends, (tx_channel->num_trans + 1) * sizeof(size_t));
+    tx_channel->trans_times = realloc(tx_channel->trans_times, (tx_channel->num_trans + 1) * sizeof(int64_t));
+    tx_channel->trans_times[tx_channel->num_trans] = esp_timer_get_time();
+    tx_channel->trans_ends[tx_channel->num_trans++] = tx_channel->capture_len;
+    tx_channel->pending++;
+    bool manual_done = tx_channel->manual_done;
+    pthread_mutex_unlock(&tx_channel->lock);
+    if (!manual_done) {
+        rmt_stub_finish_one(tx_channel);
+    }
+    return ESP_OK;
+}
+
+esp_err_t rmt_tx_wait_all_done(rmt_channel_handle_t tx_channel, int timeout_ms)
+{
+    if (!tx_channel) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&tx_channel->lock);
+    size_t pending = tx_channel->pending;
+    pthread_mutex_unlock(&tx_channel->lock);
+    // nothing finishes while the caller waits, unless the test completes transactions from another thread
+    return pending ? ESP_ERR_TIMEOUT : ESP_OK;
+}
+
+esp_err_t rmt_new_sync_manager(const rmt_sync_manager_config_t *config, rmt_sync_manager_handle_t *ret_synchro)
+{
+    if (!config || !ret_synchro || !config->tx_channel_array || !config->array_size ||
+            config->array_size > RMT_STUB_MAX_TX_CHANNELS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < config->array_size; i++) {
+        rmt_channel_handle_t channel = config->tx_channel_array[i];
+        // the driver refuses channels that are not enabled yet or already in another group
+        if (!channel || !channel->enabled || channel->synced) {
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+    rmt_sync_manager_handle_t synchro = calloc(1, sizeof(struct rmt_sync_manager_t));
+    if (!synchro) {
+        return ESP_ERR_NO_MEM;
+    }
+    for (size_t i = 0; i < config->array_size; i++) {
+        synchro->channels[i] = config->tx_channel_array[i];
+        synchro->channels[i]->synced = true;
+    }
+    synchro->num_channels = config->array_size;
+    *ret_synchro = synchro;
+    return ESP_OK;
+}
+
+esp_err_t rmt_del_sync_manager(rmt_sync_manager_handle_t synchro)
+{
+    if (!synchro) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < synchro->num_channels; i++) {
+        synchro->channels[i]->synced = false;
+    }
+    free(synchro);
+    return ESP_OK;
+}
+
+rmt_channel_handle_t rmt_stub_find_channel(int gpio_num)
+{
+    rmt_channel_handle_t channel = NULL;
+    pthread_mutex_lock(&s_tx_channels_lock);
+    for (size_t i = 0; i < RMT_STUB_MAX_TX_CHANNELS; i++) {
+        if (s_tx_channels[i] && s_tx_channels[i]->gpio_num == gpio_num) {
+            channel = s_tx_channels[i];
+        }
+    }
+    pthread_mutex_unlock(&s_tx_channels_lock);
+    return channel;
+}
+
+void rmt_stub_set_manual_done(rmt_channel_handle_t channel, bool manual_done)
+{
+    pthread_mutex_lock(&channel->lock);
+    channel->manual_done = manual_done;
+    pthread_mutex_unlock(&channel->lock);
+}
+
+size_t rmt_stub_complete(rmt_channel_handle_t channel, size_t count)
+{
+    size_t done = 0;
+    while (done < count && rmt_stub_get_pending(channel)) {
+        rmt_stub_finish_one(channel);
+        done++;
+    }
+    return done;
+}
+
+size_t rmt_stub_get_pending(rmt_channel_handle_t channel)
+{
+    pthread_mutex_lock(&channel->lock);
+    size_t pending = channel->pending;
+    pthread_mutex_unlock(&channel->lock);
+    return pending;
+}
+
+bool rmt_stub_is_synced(rmt_channel_handle_t channel)
+{
+    return channel->synced;
+}
+
+size_t rmt_stub_get_num_transactions(rmt_channel_handle_t channel)
+{
+    pthread_mutex_lock(&channel->lock);
+    size_t num_trans = channel->num_trans;
+    pthread_mutex_unlock(&channel->lock);
+    return num_trans;
+}
+
+size_t rmt_stub_copy_transaction(rmt_channel_handle_t channel, size_t index, rmt_symbol_word_t *symbols, size_t max_symbols)
+{
+    pthread_mutex_lock(&channel->lock);
+    size_t num_symbols = 0;
+    if (index < channel->num_trans) {
+        size_t start = index ? channel->trans_ends[index - 1] : 0;
+        num_symbols = channel->trans_ends[index] - start;
+        memcpy(symbols, &channel->capture[start], (num_symbols < max_symbols ? num_symbols : max_symbols) * sizeof(rmt_symbol_word_t));
+    }
+    pthread_mutex_unlock(&channel->lock);
+    return num_symbols;
+}
+
+int64_t rmt_stub_get_transaction_time(rmt_channel_handle_t channel, size_t index)
+{
+    pthread_mutex_lock(&channel->lock);
+    int64_t time_us = index < channel->num_trans ? channel->trans_times[index] : -1;
+    pthread_mutex_unlock(&channel->lock);
+    return time_us;
+}
+
+int rmt_stub_get_intr_core(rmt_channel_handle_t channel)
+{
+    return channel->intr_core;
+}
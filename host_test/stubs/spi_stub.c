@@ -0,0 +1,207 @@
+/*
+ * Host implementation of the SPI master calls in driver/spi_master.h and the bus model described in spi_stub.h.
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "spi_stub.h"
+
+typedef struct {
+    bool initialized;
+    spi_bus_config_t config;
+    spi_device_handle_t device; // one device per bus is all the LED strip needs
+} spi_stub_bus_t;
+
+struct spi_device_t {
+    spi_host_device_t host_id;
+    spi_device_interface_config_t config;
+    pthread_mutex_t lock;       // protects everything below against test threads
+    size_t pending;             // finished transactions whose result was not taken yet
+    spi_transaction_t **results;
+    size_t results_head;
+    uint8_t **trans_data;       // bytes of every transaction
+    size_t *trans_sizes;
+    size_t num_trans;
+};
+
+static pthread_mutex_t s_buses_lock = PTHREAD_MUTEX_INITIALIZER;
+static spi_stub_bus_t s_buses[SPI_HOST_MAX];
+
+esp_err_t spi_bus_initialize(spi_host_device_t host_id, const spi_bus_config_t *bus_config, spi_common_dma_t dma_chan)
+{
+    if (host_id <= SPI1_HOST || host_id >= SPI_HOST_MAX || !bus_config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_buses_lock);
+    esp_err_t ret = ESP_OK;
+    if (s_buses[host_id].initialized) {
+        ret = ESP_ERR_INVALID_STATE;
+    } else {
+        s_buses[host_id].initialized = true;
+        s_buses[host_id].config = *bus_config;
+        // without DMA the driver cannot send more than 64 bytes at once
+        if (dma_chan == SPI_DMA_DISABLED && s_buses[host_id].config.max_transfer_sz > 64) {
+            s_buses[host_id].config.max_transfer_sz = 64;
+        }
+    }
+    pthread_mutex_unlock(&s_buses_lock);
+    return ret;
+}
+
+esp_err_t spi_bus_free(spi_host_device_t host_id)
+{
+    if (host_id >= SPI_HOST_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_buses_lock);
+    esp_err_t ret = ESP_OK;
+    if (!s_buses[host_id].initialized || s_buses[host_id].device) {
+        ret = ESP_ERR_INVALID_STATE;
+    } else {
+        s_buses[host_id].initialized = false;
+    }
+    pthread_mutex_unlock(&s_buses_lock);
+    return ret;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host_id, const spi_device_interface_config_t *dev_config, spi_device_handle_t *handle)
+{
+    if (host_id >= SPI_HOST_MAX || !dev_config || !handle || dev_config->queue_size < 1 || dev_config->clock_speed_hz <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    spi_device_handle_t device = calloc(1, sizeof(struct spi_device_t));
+    if (!device) {
+        return ESP_ERR_NO_MEM;
+    }
+    device->results = calloc(dev_config->queue_size, sizeof(spi_transaction_t *));
+    device->host_id = host_id;
+    device->config = *dev_config;
+    pthread_mutex_init(&device->lock, NULL);
+    pthread_mutex_lock(&s_buses_lock);
+    esp_err_t ret = ESP_OK;
+    if (!s_buses[host_id].initialized || s_buses[host_id].device) {
+        ret = ESP_ERR_INVALID_STATE;
+    } else {
+        s_buses[host_id].device = device;
+    }
+    pthread_mutex_unlock(&s_buses_lock);
+    if (ret != ESP_OK) {
+        pthread_mutex_destroy(&device->lock);
+        free(device->results);
+        free(device);
+        return ret;
+    }
+    *handle = device;
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_remove_device(spi_device_handle_t handle)
+{
+    if (!handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (handle->pending) {
+        // the driver refuses to remove a device with results not taken
+        return ESP_ERR_INVALID_STATE;
+    }
+    pthread_mutex_lock(&s_buses_lock);
+    s_buses[handle->host_id].device = NULL;
+    pthread_mutex_unlock(&s_buses_lock);
+    for (size_t i = 0; i < handle->num_trans; i++) {
+        free(handle->trans_data[i]);
+    }
+    free(handle->trans_data);
+    free(handle->trans_sizes);
+    free(handle->results);
+    pthread_mutex_destroy(&handle->lock);
+    free(handle);
+    return ESP_OK;
+}
+
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t *trans_desc, TickType_t ticks_to_wait)
+{
+    if (!handle || !trans_desc || !trans_desc->length || !trans_desc->tx_buffer || trans_desc->length % 8) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t num_bytes = trans_desc->length / 8;
+    if (num_bytes > (size_t)s_buses[handle->host_id].config.max_transfer_sz) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&handle->lock);
+    if (handle->pending == (size_t)handle->config.queue_size) {
+        // the driver would block until a result is taken, which never happens while the caller waits here
+        pthread_mutex_unlock(&handle->lock);
+        fprintf(stderr, "spi_device_queue_trans with a full queue of %d\n", handle->config.queue_size);
+        return ESP_ERR_TIMEOUT;
+    }
+    uint8_t *data = malloc(num_bytes);
+    memcpy(data, trans_desc->tx_buffer, num_bytes);
+    handle->trans_data = realloc(handle->trans_data, (handle->num_trans + 1) * sizeof(uint8_t *));
+    handle->trans_sizes = realloc(handle->trans_sizes, (handle->num_trans + 1) * sizeof(size_t));
+    handle->trans_data[handle->num_trans] = data;
+    handle->trans_sizes[handle->num_trans] = num_bytes;
+    handle->num_trans++;
+    handle->results[(handle->results_head + handle->pending) % handle->config.queue_size] = trans_desc;
+    handle->pending++;
+    pthread_mutex_unlock(&handle->lock);
+    if (handle->config.post_cb) {
+        handle->config.post_cb(trans_desc);
+    }
+    return ESP_OK;
+}
+
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t **trans_desc, TickType_t ticks_to_wait)
+{
+    if (!handle || !trans_desc) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&handle->lock);
+    esp_err_t ret = ESP_ERR_TIMEOUT;
+    if (handle->pending) {
+        *trans_desc = handle->results[handle->results_head];
+        handle->results_head = (handle->results_head + 1) % handle->config.queue_size;
+        handle->pending--;
+        ret = ESP_OK;
+    }
+    pthread_mutex_unlock(&handle->lock);
+    return ret;
+}
+
+spi_device_handle_t spi_stub_find_device(int mosi_io_num)
+{
+    spi_device_handle_t device = NULL;
+    pthread_mutex_lock(&s_buses_lock);
+    for (int i = 0; i < SPI_HOST_MAX; i++) {
+        if (s_buses[i].initialized && s_buses[i].device && s_buses[i].config.mosi_io_num == mosi_io_num) {
+            device = s_buses[i].device;
+        }
+    }
+    pthread_mutex_unlock(&s_buses_lock);
+    return device;
+}
+
+int spi_stub_get_clock_hz(spi_device_handle_t device)
+{
+    return device->config.clock_speed_hz;
+}
+
+size_t spi_stub_get_num_transactions(spi_device_handle_t device)
+{
+    pthread_mutex_lock(&device->lock);
+    size_t num_trans = device->num_trans;
+    pthread_mutex_unlock(&device->lock);
+    return num_trans;
+}
+
+const uint8_t *spi_stub_get_transaction(spi_device_handle_t device, size_t index, size_t *ret_num_bytes)
+{
+    const uint8_t *data = NULL;
+    pthread_mutex_lock(&device->lock);
+    if (index < device->num_trans) {
+        data = device->trans_data[index];
+        *ret_num_bytes = device->trans_sizes[index];
+    }
+    pthread_mutex_unlock(&device->lock);
+    return data;
+}
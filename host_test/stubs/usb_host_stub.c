@@ -0,0 +1,734 @@
+/*
+ * Host implementation of the USB Host Library stand-in and of the scripting calls in usb_host_stub.h.
+ *
+ * One mutex guards the whole bus. Completed transfers and client events are queued to the client that owns them
+ * and handed over from `usb_host_client_handle_events`, outside the lock so callbacks can resubmit.
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "usb/usb_host.h"
+#include "usb/usb_helpers.h"
+#include "usb_host_stub.h"
+
+#define USB_STUB_MAX_DEVICES    8
+#define USB_STUB_MAX_CLIENTS    4
+#define USB_STUB_MAX_INTERFACES 8
+#define USB_STUB_MAX_EVENTS     16
+
+typedef struct usb_stub_transfer {
+    usb_transfer_t transfer;            // first member, the part handed to the code under test
+    struct usb_stub_transfer *next;     // in a device queue while waiting for data, then in a client done queue
+    bool in_flight;                     // submitted and its callback not called yet
+} usb_stub_transfer_t;
+
+struct usb_host_client_handle_s {
+    bool registered;
+    usb_host_client_config_t config;
+    usb_host_client_event_msg_t events[USB_STUB_MAX_EVENTS];
+    size_t events_head;
+    size_t num_events;
+    usb_stub_transfer_t *done_head;
+    usb_stub_transfer_t *done_tail;
+    bool unblocked;
+};
+
+struct usb_device_handle_s {
+    uint8_t addr;                       // 0 for a free entry
+    bool gone;
+    uint8_t *config_desc;
+    bool opened_by[USB_STUB_MAX_CLIENTS];
+    struct usb_host_client_handle_s *claimed_by[USB_STUB_MAX_INTERFACES];
+    uint8_t claimed_alt[USB_STUB_MAX_INTERFACES];
+    usb_stub_transfer_t *queue;         // submitted transfers waiting for data, oldest first
+    uint32_t halted;                    // one bit per endpoint, see usb_stub_ep_bit
+};
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;                // broadcast whenever a client or the library may have work
+    bool installed;
+    uint32_t lib_flags;
+    struct usb_device_handle_s devices[USB_STUB_MAX_DEVICES];
+    struct usb_host_client_handle_s clients[USB_STUB_MAX_CLIENTS];
+} s_usb = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+};
+
+const usb_standard_desc_t *usb_parse_next_descriptor(const usb_standard_desc_t *cur_desc, uint16_t wTotalLength, int *offset)
+{
+    if (*offset >= wTotalLength || *offset + cur_desc->bLength >= wTotalLength) {
+        return NULL;
+    }
+    *offset += cur_desc->bLength;
+    return (const usb_standard_desc_t *)((const uint8_t *)cur_desc + cur_desc->bLength);
+}
+
+void usb_print_config_descriptor(const usb_config_desc_t *cfg_desc, void *class_specific_cb)
+{
+}
+
+// absolute deadline of a wait in ticks, NULL for portMAX_DELAY
+static struct timespec *usb_stub_deadline(TickType_t ticks, struct timespec *ts)
+{
+    if (ticks == portMAX_DELAY) {
+        return NULL;
+    }
+    clock_gettime(CLOCK_REALTIME, ts);
+    uint64_t ns = ts->tv_nsec + (uint64_t)ticks * freertos_stub_tick_us * 1000;
+    ts->tv_sec += ns / 1000000000;
+    ts->tv_nsec = ns % 1000000000;
+    return ts;
+}
+
+// wait for a broadcast, false once the deadline has passed
+static bool usb_stub_wait(const struct timespec *deadline)
+{
+    if (!deadline) {
+        pthread_cond_wait(&s_usb.cond, &s_usb.lock);
+        return true;
+    }
+    return pthread_cond_timedwait(&s_usb.cond, &s_usb.lock, deadline) != ETIMEDOUT;
+}
+
+static struct usb_device_handle_s *usb_stub_find_device(uint8_t dev_addr)
+{
+    for (int i = 0; i < USB_STUB_MAX_DEVICES; i++) {
+        if (s_usb.devices[i].addr == dev_addr && !s_usb.devices[i].gone) {
+            return &s_usb.devices[i];
+        }
+    }
+    return NULL;
+}
+
+static int usb_stub_client_index(usb_host_client_handle_t client_hdl)
+{
+    return client_hdl - s_usb.clients;
+}
+
+static void usb_stub_post_event(usb_host_client_handle_t client, const usb_host_client_event_msg_t *msg)
+{
+    if (client->num_events == USB_STUB_MAX_EVENTS) {
+        fprintf(stderr, "usb stub: client event queue full, event %d dropped\n", msg->event);
+        return;
+    }
+    client->events[(client->events_head + client->num_events++) % USB_STUB_MAX_EVENTS] = *msg;
+    pthread_cond_broadcast(&s_usb.cond);
+}
+
+static void usb_stub_post_done(usb_host_client_handle_t client, usb_stub_transfer_t *stub_transfer)
+{
+    stub_transfer->next = NULL;
+    if (client->done_tail) {
+        client->done_tail->next = stub_transfer;
+    } else {
+        client->done_head = stub_transfer;
+    }
+    client->done_tail = stub_transfer;
+    pthread_cond_broadcast(&s_usb.cond);
+}
+
+// Look an endpoint up in the alternate setting its interface is claimed with
+static const usb_ep_desc_t *usb_stub_find_ep(struct usb_device_handle_s *device, uint8_t ep_addr, int *ret_intf)
+{
+    const usb_config_desc_t *config_desc = (const usb_config_desc_t *)device->config_desc;
+    const usb_standard_desc_t *desc = (const usb_standard_desc_t *)config_desc;
+    const usb_intf_desc_t *intf = NULL;
+    int offset = 0;
+    while ((desc = usb_parse_next_descriptor(desc, config_desc->wTotalLength, &offset)) != NULL) {
+        if (desc->bDescriptorType == USB_B_DESCRIPTOR_TYPE_INTERFACE) {
+            intf = (const usb_intf_desc_t *)desc;
+        } else if (desc->bDescriptorType == USB_B_DESCRIPTOR_TYPE_ENDPOINT && intf &&
+                   intf->bInterfaceNumber < USB_STUB_MAX_INTERFACES && device->claimed_by[intf->bInterfaceNumber] &&
+                   device->claimed_alt[intf->bInterfaceNumber] == intf->bAlternateSetting &&
+                   ((const usb_ep_desc_t *)desc)->bEndpointAddress == ep_addr) {
+            *ret_intf = intf->bInterfaceNumber;
+            return (const usb_ep_desc_t *)desc;
+        }
+    }
+    return NULL;
+}
+
+static uint32_t usb_stub_ep_bit(uint8_t ep_addr)
+{
+    return 1u << ((ep_addr & 0x0F) + (ep_addr & USB_B_ENDPOINT_ADDRESS_EP_DIR_MASK ? 16 : 0));
+}
+
+static bool usb_stub_has_alt_setting(struct usb_device_handle_s *device, uint8_t intf_num, uint8_t alt_setting)
+{
+    const usb_config_desc_t *config_desc = (const usb_config_desc_t *)device->config_desc;
+    const usb_standard_desc_t *desc = (const usb_standard_desc_t *)config_desc;
+    int offset = 0;
+    while ((desc = usb_parse_next_descriptor(desc, config_desc->wTotalLength, &offset)) != NULL) {
+        const usb_intf_desc_t *intf = (const usb_intf_desc_t *)desc;
+        if (desc->bDescriptorType == USB_B_DESCRIPTOR_TYPE_INTERFACE && intf->bInterfaceNumber == intf_num &&
+                intf->bAlternateSetting == alt_setting) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void usb_stub_free_device(struct usb_device_handle_s *device)
+{
+    free(device->config_desc);
+    memset(device, 0, sizeof(*device));
+}
+
+static bool usb_stub_is_opened(struct usb_device_handle_s *device)
+{
+    for (int i = 0; i < USB_STUB_MAX_CLIENTS; i++) {
+        if (device->opened_by[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------- Host Library
+
+esp_err_t usb_host_install(const usb_host_config_t *config)
+{
+    pthread_mutex_lock(&s_usb.lock);
+    esp_err_t ret = s_usb.installed ? ESP_ERR_INVALID_STATE : ESP_OK;
+    s_usb.installed = true;
+    pthread_mutex_unlock(&s_usb.lock);
+    return ret;
+}
+
+esp_err_t usb_host_uninstall(void)
+{
+    pthread_mutex_lock(&s_usb.lock);
+    s_usb.installed = false;
+    pthread_mutex_unlock(&s_usb.lock);
+    return ESP_OK;
+}
+
+esp_err_t usb_host_lib_handle_events(TickType_t timeout_ticks, uint32_t *event_flags_ret)
+{
+    struct timespec ts;
+    struct timespec *deadline = usb_stub_deadline(timeout_ticks, &ts);
+    pthread_mutex_lock(&s_usb.lock);
+    // enumeration happens in usb_stub_attach, only the library events are left to wait for
+    while (!s_usb.lib_flags && usb_stub_wait(deadline)) {
+    }
+    uint32_t flags = s_usb.lib_flags;
+    s_usb.lib_flags = 0;
+    pthread_mutex_unlock(&s_usb.lock);
+    if (event_flags_ret) {
+        *event_flags_ret = flags;
+    }
+    return flags ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t usb_host_device_free_all(void)
+{
+    esp_err_t ret = ESP_OK;
+    pthread_mutex_lock(&s_usb.lock);
+    for (int i = 0; i < USB_STUB_MAX_DEVICES; i++) {
+        if (!s_usb.devices[i].addr) {
+            continue;
+        }
+        if (usb_stub_is_opened(&s_usb.devices[i])) {
+            ret = ESP_ERR_NOT_FINISHED;
+        } else {
+            usb_stub_free_device(&s_usb.devices[i]);
+        }
+    }
+    pthread_mutex_unlock(&s_usb.lock);
+    return ret;
+}
+
+esp_err_t usb_host_device_addr_list_fill(int list_len, uint8_t *dev_addr_list, int *num_dev_ret)
+{
+    if (!dev_addr_list || !num_dev_ret) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    int num_devs = 0;
+    pthread_mutex_lock(&s_usb.lock);
+    for (int i = 0; i < USB_STUB_MAX_DEVICES && num_devs < list_len; i++) {
+        if (s_usb.devices[i].addr && !s_usb.devices[i].gone) {
+            dev_addr_list[num_devs++] = s_usb.devices[i].addr;
+        }
+    }
+    pthread_mutex_unlock(&s_usb.lock);
+    *num_dev_ret = num_devs;
+    return ESP_OK;
+}
+
+// ---------------------------------------------------------------- Clients
+
+esp_err_t usb_host_client_register(const usb_host_client_config_t *client_config, usb_host_client_handle_t *client_hdl_ret)
+{
+    if (!client_config || !client_hdl_ret || client_config->is_synchronous ||
+            !client_config->async.client_event_callback) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    pthread_mutex_lock(&s_usb.lock);
+    if (!s_usb.installed) {
+        ret = ESP_ERR_INVALID_STATE;
+    }
+    for (int i = 0; i < USB_STUB_MAX_CLIENTS && ret == ESP_ERR_NO_MEM; i++) {
+        if (!s_usb.clients[i].registered) {
+            memset(&s_usb.clients[i], 0, sizeof(s_usb.clients[i]));
+            s_usb.clients[i].registered = true;
+            s_usb.clients[i].config = *client_config;
+            *client_hdl_ret = &s_usb.clients[i];
+            ret = ESP_OK;
+        }
+    }
+    pthread_mutex_unlock(&s_usb.lock);
+    return ret;
+}
+
+esp_err_t usb_host_client_deregister(usb_host_client_handle_t client_hdl)
+{
+    esp_err_t ret = ESP_OK;
+    pthread_mutex_lock(&s_usb.lock);
+    for (int i = 0; i < USB_STUB_MAX_DEVICES; i++) {
+        if (s_usb.devices[i].opened_by[usb_stub_client_index(client_hdl)]) {
+            ret = ESP_ERR_INVALID_STATE; // devices must be closed first
+        }
+    }
+    if (ret == ESP_OK) {
+        client_hdl->registered = false;
+        bool has_clients = false;
+        for (int i = 0; i < USB_STUB_MAX_CLIENTS; i++) {
+            has_clients |= s_usb.clients[i].registered;
+        }
+        if (!has_clients) {
+            s_usb.lib_flags |= USB_HOST_LIB_EVENT_FLAGS_NO_CLIENTS;
+            pthread_cond_broadcast(&s_usb.cond);
+        }
+    }
+    pthread_mutex_unlock(&s_usb.lock);
+    return ret;
+}
+
+esp_err_t usb_host_client_handle_events(usb_host_client_handle_t client_hdl, TickType_t timeout_ticks)
+{
+    struct timespec ts;
+    struct timespec *deadline = usb_stub_deadline(timeout_ticks, &ts);
+    bool handled = false;
+    pthread_mutex_lock(&s_usb.lock);
+    while (!client_hdl->done_head && !client_hdl->num_events && !client_hdl->unblocked && usb_stub_wait(deadline)) {
+    }
+    client_hdl->unblocked = false;
+    // transfers first, a device's DEV_GONE then comes after the completions it caused
+    while (client_hdl->done_head || client_hdl->num_events) {
+        if (client_hdl->done_head) {
+            usb_stub_transfer_t *stub_transfer = client_hdl->done_head;
+            client_hdl->done_head = stub_transfer->next;
+            if (!client_hdl->done_head) {
+                client_hdl->done_tail = NULL;
+            }
+            stub_transfer->next = NULL;
+            stub_transfer->in_flight = false;
+            pthread_mutex_unlock(&s_usb.lock);
+            stub_transfer->transfer.callback(&stub_transfer->transfer);
+        } else {
+            usb_host_client_event_msg_t msg = client_hdl->events[client_hdl->events_head];
+            client_hdl->events_head = (client_hdl->events_head + 1) % USB_STUB_MAX_EVENTS;
+            client_hdl->num_events--;
+            pthread_mutex_unlock(&s_usb.lock);
+            client_hdl->config.async.client_event_callback(&msg, client_hdl->config.async.callback_arg);
+        }
+        handled = true;
+        pthread_mutex_lock(&s_usb.lock);
+    }
+    pthread_mutex_unlock(&s_usb.lock);
+    return handled ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t usb_host_client_unblock(usb_host_client_handle_t client_hdl)
+{
+    pthread_mutex_lock(&s_usb.lock);
+    client_hdl->unblocked = true;
+    pthread_cond_broadcast(&s_usb.cond);
+    pthread_mutex_unlock(&s_usb.lock);
+    return ESP_OK;
+}
+
+// ---------------------------------------------------------------- Devices
+
+esp_err_t usb_host_device_open(usb_host_client_handle_t client_hdl, uint8_t dev_addr, usb_device_handle_t *dev_hdl_ret)
+{
+    if (!client_hdl || !dev_hdl_ret) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    pthread_mutex_lock(&s_usb.lock);
+    struct usb_device_handle_s *device = usb_stub_find_device(dev_addr);
+    if (device) {
+        device->opened_by[usb_stub_client_index(client_hdl)] = true;
+        *dev_hdl_ret = device;
+        ret = ESP_OK;
+    }
+    pthread_mutex_unlock(&s_usb.lock);
+    return ret;
+}
+
+esp_err_t usb_host_device_close(usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl)
+{
+    if (!client_hdl || !dev_hdl) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t ret = ESP_OK;
+    int client_index = usb_stub_client_index(client_hdl);
+    pthread_mutex_lock(&s_usb.lock);
+    if (!dev_hdl->opened_by[client_index]) {
+        ret = ESP_ERR_INVALID_STATE;
+    }
+    for (int i = 0; i < USB_STUB_MAX_INTERFACES; i++) {
+        if (dev_hdl->claimed_by[i] == client_hdl) {
+            ret = ESP_ERR_INVALID_STATE; // interfaces must be released first
+        }
+    }
+    if (ret == ESP_OK) {
+        dev_hdl->opened_by[client_index] = false;
+        if (dev_hdl->gone && !usb_stub_is_opened(dev_hdl)) {
+            usb_stub_free_device(dev_hdl);
+        }
+    }
+    pthread_mutex_unlock(&s_usb.lock);
+    return ret;
+}
+
+esp_err_t usb_host_device_info(usb_device_handle_t dev_hdl, usb_device_info_t *dev_info)
+{
+    if (!dev_hdl || !dev_info) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_usb.lock);
+    dev_info->speed = USB_SPEED_FULL;
+    dev_info->dev_addr = dev_hdl->addr;
+    dev_info->bMaxPacketSize0 = 64;
+    dev_info->bConfigurationValue = ((const usb_config_desc_t *)dev_hdl->config_desc)->bConfigurationValue;
+    pthread_mutex_unlock(&s_usb.lock);
+    return ESP_OK;
+}
+
+esp_err_t usb_host_get_active_config_descriptor(usb_device_handle_t dev_hdl, const usb_config_desc_t **config_desc)
+{
+    if (!dev_hdl || !config_desc) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // stays valid until the device is freed, as on target
+    *config_desc = (const usb_config_desc_t *)dev_hdl->config_desc;
+    return ESP_OK;
+}
+
+esp_err_t usb_host_interface_claim(usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl,
+                                   uint8_t bInterfaceNumber, uint8_t bAlternateSetting)
+{
+    if (!client_hdl || !dev_hdl || bInterfaceNumber >= USB_STUB_MAX_INTERFACES) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t ret = ESP_OK;
+    pthread_mutex_lock(&s_usb.lock);
+    if (!dev_hdl->opened_by[usb_stub_client_index(client_hdl)] || dev_hdl->claimed_by[bInterfaceNumber]) {
+        ret = ESP_ERR_INVALID_STATE;
+    } else if (!usb_stub_has_alt_setting(dev_hdl, bInterfaceNumber, bAlternateSetting)) {
+        ret = ESP_ERR_NOT_FOUND;
+    } else {
+        dev_hdl->claimed_by[bInterfaceNumber] = client_hdl;
+        dev_hdl->claimed_alt[bInterfaceNumber] = bAlternateSetting;
+    }
+    pthread_mutex_unlock(&s_usb.lock);
+    return ret;
+}
+
+esp_err_t usb_host_interface_release(usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl,
+                                     uint8_t bInterfaceNumber)
+{
+    if (!client_hdl || !dev_hdl || bInterfaceNumber >= USB_STUB_MAX_INTERFACES) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t ret = ESP_OK;
+    pthread_mutex_lock(&s_usb.lock);
+    if (dev_hdl->claimed_by[bInterfaceNumber] != client_hdl) {
+        ret = ESP_ERR_INVALID_STATE;
+    }
+    for (usb_stub_transfer_t *queued = dev_hdl->queue; queued && ret == ESP_OK; queued = queued->next) {
+        int intf = -1;
+        usb_stub_find_ep(dev_hdl, queued->transfer.bEndpointAddress, &intf);
+        if (intf == bInterfaceNumber) {
+            ret = ESP_ERR_INVALID_STATE; // endpoints must be idle
+        }
+    }
+    if (ret == ESP_OK) {
+        dev_hdl->claimed_by[bInterfaceNumber] = NULL;
+    }
+    pthread_mutex_unlock(&s_usb.lock);
+    return ret;
+}
+
+// ---------------------------------------------------------------- Transfers
+
+esp_err_t usb_host_transfer_alloc(size_t data_buffer_size, int num_isoc_packets, usb_transfer_t **transfer)
+{
+    if (!transfer || num_isoc_packets) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    usb_stub_transfer_t *stub_transfer = calloc(1, sizeof(usb_stub_transfer_t));
+    uint8_t *data_buffer = calloc(1, data_buffer_size ? data_buffer_size : 1);
+    if (!stub_transfer || !data_buffer) {
+        free(stub_transfer);
+        free(data_buffer);
+        return ESP_ERR_NO_MEM;
+    }
+    // the buffer fields are const, fill them in through a template like the library does
+    usb_transfer_t init = {
+        .data_buffer = data_buffer,
+        .data_buffer_size = data_buffer_size,
+    };
+    memcpy(&stub_transfer->transfer, &init, sizeof(init));
+    *transfer = &stub_transfer->transfer;
+    return ESP_OK;
+}
+
+esp_err_t usb_host_transfer_free(usb_transfer_t *transfer)
+{
+    if (!transfer) {
+        return ESP_OK;
+    }
+    usb_stub_transfer_t *stub_transfer = (usb_stub_transfer_t *)transfer;
+    pthread_mutex_lock(&s_usb.lock);
+    bool in_flight = stub_transfer->in_flight;
+    pthread_mutex_unlock(&s_usb.lock);
+    if (in_flight) {
+        fprintf(stderr, "usb stub: freeing a transfer still in flight on EP 0x%02X\n", transfer->bEndpointAddress);
+        return ESP_ERR_NOT_FINISHED;
+    }
+    free(transfer->data_buffer);
+    free(stub_transfer);
+    return ESP_OK;
+}
+
+esp_err_t usb_host_transfer_submit(usb_transfer_t *transfer)
+{
+    if (!transfer || !transfer->device_handle || !transfer->callback) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    usb_stub_transfer_t *stub_transfer = (usb_stub_transfer_t *)transfer;
+    struct usb_device_handle_s *device = transfer->device_handle;
+    esp_err_t ret = ESP_OK;
+    pthread_mutex_lock(&s_usb.lock);
+    int intf = -1;
+    const usb_ep_desc_t *ep = device->gone ? NULL : usb_stub_find_ep(device, transfer->bEndpointAddress, &intf);
+    if (stub_transfer->in_flight) {
+        ret = ESP_ERR_NOT_FINISHED;
+    } else if (!ep || device->halted & usb_stub_ep_bit(transfer->bEndpointAddress)) {
+        ret = ESP_ERR_INVALID_STATE; // gone, or the interface of the endpoint is not claimed
+    } else if (!(ep->bEndpointAddress & USB_B_ENDPOINT_ADDRESS_EP_DIR_MASK)) {
+        ret = ESP_ERR_NOT_SUPPORTED; // only IN endpoints are modelled
+    } else if (!transfer->num_bytes || transfer->num_bytes > transfer->data_buffer_size ||
+               transfer->num_bytes % USB_EP_DESC_GET_MPS(ep)) {
+        ret = ESP_ERR_INVALID_ARG; // IN transfers must be a multiple of the MPS
+    } else {
+        stub_transfer->in_flight = true;
+        stub_transfer->next = NULL;
+        usb_stub_transfer_t **tail = &device->queue;
+        while (*tail) {
+            tail = &(*tail)->next;
+        }
+        *tail = stub_transfer;
+    }
+    pthread_mutex_unlock(&s_usb.lock);
+    return ret;
+}
+
+// ---------------------------------------------------------------- Endpoints
+
+// the endpoint must be in an interface the device has claimed, gone devices included
+static esp_err_t usb_stub_check_ep(usb_device_handle_t dev_hdl, uint8_t ep_addr)
+{
+    int intf = -1;
+    if (!dev_hdl) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return usb_stub_find_ep(dev_hdl, ep_addr, &intf) ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t usb_host_endpoint_halt(usb_device_handle_t dev_hdl, uint8_t bEndpointAddress)
+{
+    pthread_mutex_lock(&s_usb.lock);
+    esp_err_t ret = usb_stub_check_ep(dev_hdl, bEndpointAddress);
+    if (ret == ESP_OK) {
+        dev_hdl->halted |= usb_stub_ep_bit(bEndpointAddress);
+    }
+    pthread_mutex_unlock(&s_usb.lock);
+    return ret;
+}
+
+esp_err_t usb_host_endpoint_flush(usb_device_handle_t dev_hdl, uint8_t bEndpointAddress)
+{
+    pthread_mutex_lock(&s_usb.lock);
+    esp_err_t ret = usb_stub_check_ep(dev_hdl, bEndpointAddress);
+    if (ret == ESP_OK && !(dev_hdl->halted & usb_stub_ep_bit(bEndpointAddress))) {
+        ret = ESP_ERR_INVALID_STATE; // only halted endpoints can be flushed
+    }
+    for (usb_stub_transfer_t **link = &dev_hdl->queue; ret == ESP_OK && *link;) {
+        usb_stub_transfer_t *stub_transfer = *link;
+        if (stub_transfer->transfer.bEndpointAddress != bEndpointAddress) {
+            link = &stub_transfer->next;
+            continue;
+        }
+        *link = stub_transfer->next;
+        int intf = -1;
+        usb_stub_find_ep(dev_hdl, bEndpointAddress, &intf);
+        stub_transfer->transfer.status = USB_TRANSFER_STATUS_CANCELED;
+        stub_transfer->transfer.actual_num_bytes = 0;
+        usb_stub_post_done(dev_hdl->claimed_by[intf], stub_transfer);
+    }
+    pthread_mutex_unlock(&s_usb.lock);
+    return ret;
+}
+
+esp_err_t usb_host_endpoint_clear(usb_device_handle_t dev_hdl, uint8_t bEndpointAddress)
+{
+    pthread_mutex_lock(&s_usb.lock);
+    esp_err_t ret = usb_stub_check_ep(dev_hdl, bEndpointAddress);
+    if (ret == ESP_OK) {
+        dev_hdl->halted &= ~usb_stub_ep_bit(bEndpointAddress);
+    }
+    pthread_mutex_unlock(&s_usb.lock);
+    return ret;
+}
+
+// ---------------------------------------------------------------- Scripting
+
+esp_err_t usb_stub_attach(uint8_t dev_addr, const uint8_t *config_desc, size_t size)
+{
+    if (!dev_addr || dev_addr > 127 || !config_desc || size < sizeof(usb_config_desc_t) ||
+            ((const usb_config_desc_t *)config_desc)->wTotalLength != size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    pthread_mutex_lock(&s_usb.lock);
+    if (usb_stub_find_device(dev_addr)) {
+        ret = ESP_ERR_INVALID_STATE;
+    }
+    for (int i = 0; i < USB_STUB_MAX_DEVICES && ret == ESP_ERR_NO_MEM; i++) {
+        struct usb_device_handle_s *device = &s_usb.devices[i];
+        if (device->addr) {
+            continue;
+        }
+        device->config_desc = malloc(size);
+        memcpy(device->config_desc, config_desc, size);
+        device->addr = dev_addr;
+        usb_host_client_event_msg_t msg = {
+            .event = USB_HOST_CLIENT_EVENT_NEW_DEV,
+            .new_dev.address = dev_addr,
+        };
+        for (int c = 0; c < USB_STUB_MAX_CLIENTS; c++) {
+            if (s_usb.clients[c].registered) {
+                usb_stub_post_event(&s_usb.clients[c], &msg);
+            }
+        }
+        ret = ESP_OK;
+    }
+    pthread_mutex_unlock(&s_usb.lock);
+    return ret;
+}
+
+static esp_err_t usb_stub_unplug(uint8_t dev_addr, bool complete_transfers)
+{
+    pthread_mutex_lock(&s_usb.lock);
+    struct usb_device_handle_s *device = usb_stub_find_device(dev_addr);
+    if (!device) {
+        pthread_mutex_unlock(&s_usb.lock);
+        return ESP_ERR_NOT_FOUND;
+    }
+    device->gone = true;
+    while (complete_transfers && device->queue) {
+        usb_stub_transfer_t *stub_transfer = device->queue;
+        device->queue = stub_transfer->next;
+        int intf = -1;
+        usb_stub_find_ep(device, stub_transfer->transfer.bEndpointAddress, &intf);
+        stub_transfer->transfer.status = USB_TRANSFER_STATUS_NO_DEVICE;
+        stub_transfer->transfer.actual_num_bytes = 0;
+        usb_stub_post_done(device->claimed_by[intf], stub_transfer);
+    }
+    usb_host_client_event_msg_t msg = {
+        .event = USB_HOST_CLIENT_EVENT_DEV_GONE,
+        .dev_gone.dev_hdl = device,
+    };
+    for (int c = 0; c < USB_STUB_MAX_CLIENTS; c++) {
+        if (device->opened_by[c]) {
+            usb_stub_post_event(&s_usb.clients[c], &msg);
+        }
+    }
+    if (!usb_stub_is_opened(device)) {
+        usb_stub_free_device(device);
+    }
+    pthread_mutex_unlock(&s_usb.lock);
+    return ESP_OK;
+}
+
+esp_err_t usb_stub_detach(uint8_t dev_addr)
+{
+    return usb_stub_unplug(dev_addr, true);
+}
+
+esp_err_t usb_stub_detach_late(uint8_t dev_addr)
+{
+    return usb_stub_unplug(dev_addr, false);
+}
+
+esp_err_t usb_stub_send_in(uint8_t dev_addr, uint8_t ep_addr, const void *data, size_t size)
+{
+    esp_err_t ret = ESP_ERR_INVALID_STATE;
+    pthread_mutex_lock(&s_usb.lock);
+    struct usb_device_handle_s *device = usb_stub_find_device(dev_addr);
+    if (!device) {
+        ret = ESP_ERR_NOT_FOUND;
+    }
+    for (usb_stub_transfer_t **link = device ? &device->queue : NULL; link && *link; link = &(*link)->next) {
+        usb_stub_transfer_t *stub_transfer = *link;
+        usb_transfer_t *transfer = &stub_transfer->transfer;
+        if (transfer->bEndpointAddress != ep_addr) {
+            continue;
+        }
+        *link = stub_transfer->next;
+        size_t num_bytes = size < transfer->num_bytes ? size : transfer->num_bytes;
+        memcpy(transfer->data_buffer, data, num_bytes);
+        transfer->actual_num_bytes = num_bytes;
+        transfer->status = size > transfer->num_bytes ? USB_TRANSFER_STATUS_OVERFLOW : USB_TRANSFER_STATUS_COMPLETED;
+        int intf = -1;
+        usb_stub_find_ep(device, ep_addr, &intf);
+        usb_stub_post_done(device->claimed_by[intf], stub_transfer);
+        ret = ESP_OK;
+        break;
+    }
+    pthread_mutex_unlock(&s_usb.lock);
+    return ret;
+}
+
+int usb_stub_get_num_queued(uint8_t dev_addr, uint8_t ep_addr)
+{
+    int num_queued = -1;
+    pthread_mutex_lock(&s_usb.lock);
+    struct usb_device_handle_s *device = usb_stub_find_device(dev_addr);
+    if (device) {
+        num_queued = 0;
+        for (usb_stub_transfer_t *queued = device->queue; queued; queued = queued->next) {
+            num_queued += queued->transfer.bEndpointAddress == ep_addr;
+        }
+    }
+    pthread_mutex_unlock(&s_usb.lock);
+    return num_queued;
+}
+
+bool usb_stub_is_open(uint8_t dev_addr)
+{
+    pthread_mutex_lock(&s_usb.lock);
+    struct usb_device_handle_s *device = usb_stub_find_device(dev_addr);
+    bool is_open = device && usb_stub_is_opened(device);
+    pthread_mutex_unlock(&s_usb.lock);
+    return is_open;
+}
@@ -0,0 +1,55 @@
+/*
+ * Minimal Unity-style assertions and timing helpers shared by the host tests.
+ */
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+static int s_test_failures;
+
+#define TEST_ASSERT_MESSAGE(cond, msg) do {                                             \
+        if (!(cond)) {                                                                  \
+            fprintf(stderr, "%s:%d: assertion failed: %s (%s)\n", __FILE__, __LINE__, #cond, msg); \
+            s_test_failures++;                                                          \
+            return;                                                                     \
+        }                                                                               \
+    } while (0)
+
+#define TEST_ASSERT(cond) TEST_ASSERT_MESSAGE(cond, "")
+
+#define TEST_ASSERT_EQUAL(expected, actual) do {                                        \
+        long long e_ = (long long)(expected), a_ = (long long)(actual);                 \
+        if (e_ != a_) {                                                                 \
+            fprintf(stderr, "%s:%d: expected %lld, got %lld (%s)\n", __FILE__, __LINE__, e_, a_, #actual); \
+            s_test_failures++;                                                          \
+            return;                                                                     \
+        }                                                                               \
+    } while (0)
+
+#define RUN_TEST(fn) do {                                                               \
+        int before_ = s_test_failures;                                                  \
+        fn();                                                                           \
+        printf("%s:%s\n", #fn, s_test_failures == before_ ? "PASS" : "FAIL");           \
+    } while (0)
+
+#define TEST_EXIT() (s_test_failures ? EXIT_FAILURE : EXIT_SUCCESS)
+
+static inline double test_now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// xorshift32, deterministic across hosts
+static inline uint32_t test_rand(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
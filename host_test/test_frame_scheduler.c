@@ -0,0 +1,132 @@
+/*
+ * Host test for the frame scheduler on the esp_timer and FreeRTOS stand-ins.
+ *
+ * Fast frames must come one per slot with frame times on the period grid. Slow frames must be counted as overruns
+ * and the slots they cover dropped, never rendered late in a burst. Every rendered frame records how late it
+ * started after its slot was due.
+ */
+#include <string.h>
+#include <unistd.h>
+#include "test_common.h"
+#include "frame_scheduler.h"
+
+#define TEST_FPS 500 // 2 ms period
+
+typedef struct {
+    uint32_t render_us;      // time each render call takes
+    uint32_t num_frames;
+    uint32_t last_frame;
+    bool ordered;            // frames strictly increasing and frame times on the grid
+    double last_start_sec;
+    double min_gap_sec;      // shortest time between two render calls
+    latency_histogram_t start_latency;
+} test_render_ctx_t;
+
+static void test_render(uint32_t frame, uint32_t frame_time_us, void *user_ctx)
+{
+    test_render_ctx_t *ctx = (test_render_ctx_t *)user_ctx;
+    double now = test_now_sec();
+    if (ctx->num_frames) {
+        ctx->ordered &= frame > ctx->last_frame;
+        if (now - ctx->last_start_sec < ctx->min_gap_sec) {
+            ctx->min_gap_sec = now - ctx->last_start_sec;
+        }
+    }
+    ctx->ordered &= frame_time_us == frame * (1000000 / TEST_FPS);
+    ctx->last_frame = frame;
+    ctx->last_start_sec = now;
+    ctx->num_frames++;
+    if (ctx->render_us) {
+        usleep(ctx->render_us);
+    }
+}
+
+static void run_scheduler(test_render_ctx_t *ctx, uint32_t run_ms, frame_scheduler_stats_t *ret_stats)
+{
+    ctx->ordered = true;
+    ctx->min_gap_sec = 1.0;
+    frame_scheduler_handle_t scheduler = NULL;
+    frame_scheduler_config_t config = {
+        .fps = TEST_FPS,
+        .render = test_render,
+        .user_ctx = ctx,
+        .task_stack = 4096,
+        .task_priority = 5,
+        .task_core = tskNO_AFFINITY,
+        .start_latency = &ctx->start_latency,
+    };
+    ESP_ERROR_CHECK(frame_scheduler_new(&config, &scheduler));
+    ESP_ERROR_CHECK(frame_scheduler_start(scheduler));
+    usleep(run_ms * 1000);
+    ESP_ERROR_CHECK(frame_scheduler_stop(scheduler));
+    // stopping only closes the slots, let a frame still being rendered finish and count
+    usleep(ctx->render_us + 2 * 1000000 / TEST_FPS);
+    ESP_ERROR_CHECK(frame_scheduler_get_stats(scheduler, ret_stats));
+    ESP_ERROR_CHECK(frame_scheduler_del(scheduler));
+}
+
+static void test_scheduler_args(void)
+{
+    frame_scheduler_handle_t scheduler = NULL;
+    frame_scheduler_config_t config = {
+        .fps = 0,
+        .render = test_render,
+        .task_stack = 4096,
+    };
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, frame_scheduler_new(&config, &scheduler));
+    config.fps = 1001;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, frame_scheduler_new(&config, &scheduler));
+    config.fps = 60;
+    config.render = NULL;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, frame_scheduler_new(&config, &scheduler));
+    config.render = test_render;
+    TEST_ASSERT_EQUAL(ESP_OK, frame_scheduler_new(&config, &scheduler));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, frame_scheduler_stop(scheduler));
+    TEST_ASSERT_EQUAL(ESP_OK, frame_scheduler_start(scheduler));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, frame_scheduler_start(scheduler));
+    // deleting a running scheduler stops it first
+    TEST_ASSERT_EQUAL(ESP_OK, frame_scheduler_del(scheduler));
+}
+
+static void test_scheduler_holds_rate(void)
+{
+    test_render_ctx_t ctx = {0};
+    frame_scheduler_stats_t stats;
+    run_scheduler(&ctx, 200, &stats);
+    TEST_ASSERT(ctx.ordered);
+    TEST_ASSERT_EQUAL(ctx.num_frames, stats.frames_rendered);
+    TEST_ASSERT_EQUAL(0, stats.overruns);
+    // about 100 slots, loose bounds for a loaded host
+    TEST_ASSERT(stats.frames_rendered + stats.deadlines_missed >= 50);
+    TEST_ASSERT(stats.frames_rendered + stats.deadlines_missed <= 110);
+    TEST_ASSERT(stats.frames_rendered >= 25);
+    TEST_ASSERT_EQUAL(stats.frames_rendered, ctx.start_latency.count);
+}
+
+static void test_scheduler_skips_slow_frames(void)
+{
+    // every frame covers two to three periods
+    test_render_ctx_t ctx = {
+        .render_us = 5000,
+    };
+    frame_scheduler_stats_t stats;
+    run_scheduler(&ctx, 200, &stats);
+    TEST_ASSERT(ctx.ordered);
+    TEST_ASSERT_EQUAL(ctx.num_frames, stats.frames_rendered);
+    TEST_ASSERT_EQUAL(stats.frames_rendered, stats.overruns);
+    TEST_ASSERT(stats.deadlines_missed >= stats.frames_rendered);
+    TEST_ASSERT(stats.render_us_max >= 5000);
+    // dropped slots are not made up for: frames never come back to back
+    TEST_ASSERT(ctx.min_gap_sec >= 0.005);
+    // frames start with the slot that frees up, not late for the ones they dropped
+    TEST_ASSERT_EQUAL(stats.frames_rendered, ctx.start_latency.count);
+    TEST_ASSERT(ctx.start_latency.sum_us / ctx.start_latency.count < 1000000 / TEST_FPS);
+}
+
+int main(int argc, char **argv)
+{
+    RUN_TEST(test_scheduler_args);
+    RUN_TEST(test_scheduler_holds_rate);
+    RUN_TEST(test_scheduler_skips_slow_frames);
+    return TEST_EXIT();
+}
@@ -0,0 +1,225 @@
+/*
+ * Host test for the key envelope engine, drawing into a frame pipeline on a stub RMT channel.
+ *
+ * Envelope levels must follow velocity, attack and release, be composited over the key's background, and a frame
+ * must only visit the keys that are still changing.
+ */
+#include <string.h>
+#include "test_common.h"
+#include "rmt_stub.h"
+#include "led_strip_encoder.h"
+#include "esp_timer.h"
+#include "key_envelope.h"
+
+#define TEST_NUM_KEYS 200
+
+static rmt_channel_handle_t s_channel;
+static rmt_encoder_handle_t s_encoder;
+static led_strip_output_handle_t s_output;
+static led_strip_pipeline_handle_t s_pipeline;
+static latency_histogram_t s_submit_latency = LATENCY_HISTOGRAM_INIT("submit");
+
+static void test_pipeline_new(void)
+{
+    rmt_tx_channel_config_t tx_chan_config = {
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .gpio_num = 16,
+        .mem_block_symbols = 64,
+        .resolution_hz = 10000000,
+        .trans_queue_depth = 4,
+    };
+    ESP_ERROR_CHECK(rmt_new_tx_channel(&tx_chan_config, &s_channel));
+    led_strip_encoder_config_t encoder_config = {
+        .resolution = 10000000,
+    };
+    ESP_ERROR_CHECK(rmt_new_led_strip_encoder(&encoder_config, &s_encoder));
+    led_strip_rmt_output_config_t output_config = {
+        .channels = &s_channel,
+        .encoders = &s_encoder,
+        .num_channels = 1,
+        .num_pixels = TEST_NUM_KEYS,
+    };
+    ESP_ERROR_CHECK(led_strip_new_rmt_output(&output_config, &s_output));
+    led_strip_pipeline_config_t pipeline_config = {
+        .output = s_output,
+        .frame_size = TEST_NUM_KEYS * 3,
+        .num_buffers = 2,
+        .submit_latency = &s_submit_latency,
+    };
+    ESP_ERROR_CHECK(led_strip_pipeline_new(&pipeline_config, &s_pipeline));
+    ESP_ERROR_CHECK(led_strip_pipeline_enable(s_pipeline));
+}
+
+static key_envelope_handle_t test_engine_new(uint32_t attack_us, uint32_t release_us)
+{
+    key_envelope_handle_t engine = NULL;
+    key_envelope_config_t config = {
+        .num_keys = TEST_NUM_KEYS,
+        .attack_us = attack_us,
+        .release_us = release_us,
+    };
+    ESP_ERROR_CHECK(key_envelope_new(&config, &engine));
+    return engine;
+}
+
+// render and present a frame at now_us, returns the number of keys drawn and leaves the pixel of key in rgb
+static size_t render_key(key_envelope_handle_t engine, uint32_t now_us, int key, uint8_t rgb[3])
+{
+    size_t num_drawn = key_envelope_render(engine, s_pipeline, now_us);
+    const uint8_t *pixel = led_strip_pipeline_get_frame(s_pipeline) + key * 3;
+    rgb[0] = pixel[1];
+    rgb[1] = pixel[0];
+    rgb[2] = pixel[2];
+    ESP_ERROR_CHECK(led_strip_pipeline_present(s_pipeline));
+    return num_drawn;
+}
+
+static void test_envelope_velocity_and_release(void)
+{
+    key_envelope_handle_t engine = test_engine_new(0, 1000);
+    uint8_t rgb[3];
+    key_envelope_note_on(engine, 10, 127, 0, 200, 0, 1000);
+    TEST_ASSERT_EQUAL(1, render_key(engine, 1000, 10, rgb));
+    TEST_ASSERT_EQUAL(0, rgb[0]);
+    TEST_ASSERT_EQUAL(200, rgb[1]);
+    // held at the peak, nothing left to draw
+    TEST_ASSERT_EQUAL(0, render_key(engine, 2000, 10, rgb));
+
+    key_envelope_note_off(engine, 10, 3000);
+    TEST_ASSERT_EQUAL(1, render_key(engine, 3500, 10, rgb));
+    TEST_ASSERT_EQUAL(200 * 127 / 255, rgb[1]);
+    TEST_ASSERT_EQUAL(1, render_key(engine, 4000, 10, rgb));
+    TEST_ASSERT_EQUAL(0, rgb[1]);
+    TEST_ASSERT_EQUAL(0, render_key(engine, 5000, 10, rgb));
+    // a second note off has nothing to release
+    key_envelope_note_off(engine, 10, 6000);
+    TEST_ASSERT_EQUAL(0, render_key(engine, 6000, 10, rgb));
+
+    // half velocity, half brightness
+    key_envelope_note_on(engine, 11, 64, 0, 0, 254, 7000);
+    TEST_ASSERT_EQUAL(1, render_key(engine, 7000, 11, rgb));
+    TEST_ASSERT_EQUAL(254 * 129 / 255, rgb[2]);
+    key_envelope_note_off(engine, 11, 7000);
+    TEST_ASSERT_EQUAL(1, render_key(engine, 8000, 11, rgb));
+    TEST_ASSERT_EQUAL(0, rgb[2]);
+    key_envelope_del(engine);
+}
+
+static void test_envelope_attack(void)
+{
+    key_envelope_handle_t engine = test_engine_new(1000, 1000);
+    uint8_t rgb[3];
+    key_envelope_note_on(engine, 0, 127, 255, 0, 0, 10000);
+    // events stamped after the frame time count as just started
+    TEST_ASSERT_EQUAL(1, render_key(engine, 9000, 0, rgb));
+    TEST_ASSERT_EQUAL(0, rgb[0]);
+    TEST_ASSERT_EQUAL(1, render_key(engine, 10500, 0, rgb));
+    TEST_ASSERT_EQUAL(127, rgb[0]);
+    // released during the attack, the fade starts from where the attack got to
+    key_envelope_note_off(engine, 0, 10500);
+    TEST_ASSERT_EQUAL(1, render_key(engine, 11000, 0, rgb));
+    TEST_ASSERT_EQUAL(63, rgb[0]);
+    TEST_ASSERT_EQUAL(1, render_key(engine, 11500, 0, rgb));
+    TEST_ASSERT_EQUAL(0, rgb[0]);
+    key_envelope_del(engine);
+}
+
+static void test_envelope_background(void)
+{
+    key_envelope_handle_t engine = test_engine_new(0, 1000);
+    uint8_t rgb[3];
+    key_envelope_set_background(engine, 199, 0, 0, 200);
+    TEST_ASSERT_EQUAL(1, render_key(engine, 0, 199, rgb));
+    TEST_ASSERT_EQUAL(200, rgb[2]);
+    // a full velocity note covers the background, its fade blends back into it
+    key_envelope_note_on(engine, 199, 127, 0, 200, 0, 0);
+    TEST_ASSERT_EQUAL(1, render_key(engine, 0, 199, rgb));
+    TEST_ASSERT_EQUAL(200, rgb[1]);
+    TEST_ASSERT_EQUAL(0, rgb[2]);
+    key_envelope_note_off(engine, 199, 1000);
+    TEST_ASSERT_EQUAL(1, render_key(engine, 1500, 199, rgb));
+    TEST_ASSERT_EQUAL(200 * 127 / 255, rgb[1]);
+    TEST_ASSERT_EQUAL(200 - 200 * 127 / 255, rgb[2]);
+    TEST_ASSERT_EQUAL(1, render_key(engine, 2000, 199, rgb));
+    TEST_ASSERT_EQUAL(0, rgb[1]);
+    TEST_ASSERT_EQUAL(200, rgb[2]);
+    key_envelope_set_background(engine, 199, 0, 0, 0);
+    TEST_ASSERT_EQUAL(1, render_key(engine, 2000, 199, rgb));
+    TEST_ASSERT_EQUAL(0, rgb[2]);
+    // out of range keys are ignored
+    key_envelope_note_on(engine, -1, 127, 1, 1, 1, 0);
+    key_envelope_note_on(engine, TEST_NUM_KEYS, 127, 1, 1, 1, 0);
+    key_envelope_set_background(engine, TEST_NUM_KEYS, 1, 1, 1);
+    TEST_ASSERT_EQUAL(0, render_key(engine, 3000, 0, rgb));
+    key_envelope_del(engine);
+}
+
+static void test_envelope_visits_active_keys_only(void)
+{
+    key_envelope_handle_t engine = test_engine_new(0, 100000);
+    uint8_t rgb[3];
+    static const int keys[] = {0, 31, 32, 63, 150, 199};
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        key_envelope_note_on(engine, keys[i], 127, 10, 20, 30, 0);
+        key_envelope_note_off(engine, keys[i], 0);
+    }
+    // every fading key is drawn each frame, the other keys never
+    for (uint32_t t = 1000; t < 100000; t += 10000) {
+        TEST_ASSERT_EQUAL(sizeof(keys) / sizeof(keys[0]), render_key(engine, t, 150, rgb));
+    }
+    TEST_ASSERT_EQUAL(sizeof(keys) / sizeof(keys[0]), render_key(engine, 100000, 150, rgb));
+    TEST_ASSERT_EQUAL(0, rgb[0]);
+    TEST_ASSERT_EQUAL(0, render_key(engine, 100000, 150, rgb));
+    key_envelope_del(engine);
+}
+
+static void test_envelope_draws_key_spans(void)
+{
+    // keys of 1, 2 and 3 pixels
+    static const uint16_t key_leds[] = {0, 1, 3, 6};
+    key_envelope_handle_t engine = NULL;
+    key_envelope_config_t config = {
+        .num_keys = 3,
+        .key_leds = key_leds,
+    };
+    ESP_ERROR_CHECK(key_envelope_new(&config, &engine));
+    uint8_t rgb[3];
+    render_key(engine, 0, 0, rgb); // clear what the other tests left
+    key_envelope_note_on(engine, 1, 127, 0, 0, 255, 0);
+    key_envelope_note_on(engine, 3, 127, 0, 0, 255, 0); // past the last key
+    TEST_ASSERT_EQUAL(1, key_envelope_render(engine, s_pipeline, 0));
+    const uint8_t *frame = led_strip_pipeline_get_frame(s_pipeline);
+    for (int led = 0; led < 7; led++) {
+        TEST_ASSERT_EQUAL(led == 1 || led == 2 ? 255 : 0, frame[led * 3 + 2]);
+    }
+    ESP_ERROR_CHECK(led_strip_pipeline_present(s_pipeline));
+    key_envelope_del(engine);
+}
+
+static void test_envelope_sets_latency_origin(void)
+{
+    key_envelope_handle_t engine = test_engine_new(0, 1000);
+    uint8_t rgb[3];
+    latency_histogram_reset(&s_submit_latency);
+    uint32_t now_us = esp_timer_get_time();
+    key_envelope_note_on(engine, 5, 127, 1, 2, 3, now_us);
+    render_key(engine, now_us, 5, rgb);
+    TEST_ASSERT_EQUAL(1, s_submit_latency.count);
+    // the origin is used once
+    key_envelope_note_off(engine, 5, now_us);
+    render_key(engine, now_us + 1000, 5, rgb);
+    TEST_ASSERT_EQUAL(1, s_submit_latency.count);
+    key_envelope_del(engine);
+}
+
+int main(int argc, char **argv)
+{
+    test_pipeline_new();
+    RUN_TEST(test_envelope_velocity_and_release);
+    RUN_TEST(test_envelope_attack);
+    RUN_TEST(test_envelope_background);
+    RUN_TEST(test_envelope_visits_active_keys_only);
+    RUN_TEST(test_envelope_draws_key_spans);
+    RUN_TEST(test_envelope_sets_latency_origin);
+    return TEST_EXIT();
+}
@@ -0,0 +1,63 @@
+/*
+ * Host test for the build time keyboard layout tables, built once per layout (see CMakeLists.txt).
+ *
+ * Every key must own a contiguous, non empty run of LEDs, the runs must tile the strip in key order, the LED to note
+ * table must invert it, and notes off the keyboard must map to nothing.
+ */
+#include "test_common.h"
+#include "keyboard_layout.h"
+
+static void test_layout_range(void)
+{
+#if CONFIG_KEYBOARD_LAYOUT_88_KEYS
+    TEST_ASSERT_EQUAL(21, KEYBOARD_LOWEST_NOTE);  // A0
+    TEST_ASSERT_EQUAL(108, KEYBOARD_HIGHEST_NOTE); // C8
+#elif CONFIG_KEYBOARD_LAYOUT_76_KEYS
+    TEST_ASSERT_EQUAL(28, KEYBOARD_LOWEST_NOTE);  // E1
+    TEST_ASSERT_EQUAL(103, KEYBOARD_HIGHEST_NOTE); // G7
+#elif CONFIG_KEYBOARD_LAYOUT_61_KEYS
+    TEST_ASSERT_EQUAL(36, KEYBOARD_LOWEST_NOTE);  // C2
+    TEST_ASSERT_EQUAL(96, KEYBOARD_HIGHEST_NOTE);  // C7
+#else
+    TEST_ASSERT_EQUAL(36, KEYBOARD_LOWEST_NOTE);  // C2
+    TEST_ASSERT_EQUAL(84, KEYBOARD_HIGHEST_NOTE);  // C6
+#endif
+    for (int note = 0; note < 128; note++) {
+        int first_led, num_leds;
+        bool on_keyboard = note >= KEYBOARD_LOWEST_NOTE && note <= KEYBOARD_HIGHEST_NOTE;
+        TEST_ASSERT_EQUAL(on_keyboard ? note - KEYBOARD_LOWEST_NOTE : -1, keyboard_note_to_key(note));
+        TEST_ASSERT_EQUAL(on_keyboard, keyboard_note_to_leds(note, &first_led, &num_leds));
+        TEST_ASSERT_EQUAL(on_keyboard, num_leds > 0);
+    }
+    // only 7 bits count
+    TEST_ASSERT_EQUAL(keyboard_note_to_key(60), keyboard_note_to_key(60 | 0x80));
+}
+
+static void test_layout_keys_tile_the_strip(void)
+{
+    int next_led = 0;
+    int min_leds = KEYBOARD_MAX_LEDS, max_leds = 0;
+    for (int note = KEYBOARD_LOWEST_NOTE; note <= KEYBOARD_HIGHEST_NOTE; note++) {
+        int first_led, num_leds;
+        TEST_ASSERT(keyboard_note_to_leds(note, &first_led, &num_leds));
+        TEST_ASSERT_EQUAL(next_led, first_led);
+        for (int led = first_led; led < first_led + num_leds; led++) {
+            TEST_ASSERT_EQUAL(note, keyboard_led_to_note(led));
+        }
+        next_led += num_leds;
+        min_leds = num_leds < min_leds ? num_leds : min_leds;
+        max_leds = num_leds > max_leds ? num_leds : max_leds;
+    }
+    TEST_ASSERT_EQUAL(KEYBOARD_NUM_LEDS, next_led);
+    TEST_ASSERT_EQUAL(KEYBOARD_NUM_LEDS, keyboard_key_leds[KEYBOARD_NUM_KEYS]);
+    // evenly shared: key sizes differ by one LED at most
+    TEST_ASSERT(max_leds - min_leds <= 1);
+    TEST_ASSERT_EQUAL(KEYBOARD_NUM_LEDS / KEYBOARD_NUM_KEYS, min_leds);
+}
+
+int main(int argc, char **argv)
+{
+    RUN_TEST(test_layout_range);
+    RUN_TEST(test_layout_keys_tile_the_strip);
+    return TEST_EXIT();
+}
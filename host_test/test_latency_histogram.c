@@ -0,0 +1,53 @@
+/*
+ * Host test for the latency histogram bucketing and percentiles.
+ */
+#include "test_common.h"
+#include "latency_histogram.h"
+
+static void test_histogram_buckets(void)
+{
+    TEST_ASSERT_EQUAL(0, latency_histogram_bucket(0));
+    TEST_ASSERT_EQUAL(0, latency_histogram_bucket(63));
+    TEST_ASSERT_EQUAL(1, latency_histogram_bucket(64));
+    TEST_ASSERT_EQUAL(1, latency_histogram_bucket(127));
+    TEST_ASSERT_EQUAL(2, latency_histogram_bucket(128));
+    TEST_ASSERT_EQUAL(14, latency_histogram_bucket((1 << 20) - 1));
+    TEST_ASSERT_EQUAL(15, latency_histogram_bucket(1 << 20));
+    TEST_ASSERT_EQUAL(15, latency_histogram_bucket(UINT32_MAX));
+    // every value lands in the bucket whose range holds it
+    for (uint32_t us = 64; us < (1 << 20); us += 7) {
+        uint32_t bucket = latency_histogram_bucket(us);
+        TEST_ASSERT(us >= (32u << bucket) && us < (64u << bucket));
+    }
+}
+
+static void test_histogram_percentiles(void)
+{
+    latency_histogram_t hist = LATENCY_HISTOGRAM_INIT("test");
+    TEST_ASSERT_EQUAL(0, latency_histogram_percentile(&hist, 50));
+    for (int i = 0; i < 98; i++) {
+        latency_histogram_record(&hist, 100);
+    }
+    latency_histogram_record(&hist, 3000);
+    latency_histogram_record(&hist, 5000);
+    TEST_ASSERT_EQUAL(100, hist.count);
+    TEST_ASSERT_EQUAL(5000, hist.max_us);
+    TEST_ASSERT_EQUAL(98 * 100 + 8000, hist.sum_us);
+    TEST_ASSERT_EQUAL(98, hist.buckets[1]);
+    TEST_ASSERT_EQUAL(128, latency_histogram_percentile(&hist, 50));
+    TEST_ASSERT_EQUAL(128, latency_histogram_percentile(&hist, 98));
+    TEST_ASSERT_EQUAL(4096, latency_histogram_percentile(&hist, 99));
+    TEST_ASSERT_EQUAL(5000, latency_histogram_percentile(&hist, 100));
+    latency_histogram_dump(&hist);
+    latency_histogram_reset(&hist);
+    TEST_ASSERT_EQUAL(0, hist.count);
+    TEST_ASSERT_EQUAL(0, hist.buckets[1]);
+    TEST_ASSERT(hist.name != NULL);
+}
+
+int main(void)
+{
+    RUN_TEST(test_histogram_buckets);
+    RUN_TEST(test_histogram_percentiles);
+    return TEST_EXIT();
+}
@@ -0,0 +1,166 @@
+/*
+ * Host test and benchmark for the integer HSV to RGB conversion.
+ */
+#include <string.h>
+#include "test_common.h"
+#include "led_color.h"
+
+// led_strip_hsv2rgb as it was in led_strip_example_main.c, percent based S/V with float scaling
+static void reference_hsv2rgb(uint32_t h, uint32_t s, uint32_t v, uint32_t *r, uint32_t *g, uint32_t *b)
+{
+    h %= 360; // h -> [0,360]
+    uint32_t rgb_max = v * 2.55f;
+    uint32_t rgb_min = rgb_max * (100 - s) / 100.0f;
+
+    uint32_t i = h / 60;
+    uint32_t diff = h % 60;
+
+    // RGB adjustment amount by hue
+    uint32_t rgb_adj = (rgb_max - rgb_min) * diff / 60;
+
+    switch (i) {
+    case 0:
+        *r = rgb_max;
+        *g = rgb_min + rgb_adj;
+        *b = rgb_min;
+        break;
+    case 1:
+        *r = rgb_max - rgb_adj;
+        *g = rgb_max;
+        *b = rgb_min;
+        break;
+    case 2:
+        *r = rgb_min;
+        *g = rgb_max;
+        *b = rgb_min + rgb_adj;
+        break;
+    case 3:
+        *r = rgb_min;
+        *g = rgb_max - rgb_adj;
+        *b = rgb_max;
+        break;
+    case 4:
+        *r = rgb_min + rgb_adj;
+        *g = rgb_min;
+        *b = rgb_max;
+        break;
+    default:
+        *r = rgb_max;
+        *g = rgb_min;
+        *b = rgb_max - rgb_adj;
+        break;
+    }
+}
+
+static int abs_diff(int a, int b)
+{
+    return a > b ? a - b : b - a;
+}
+
+static void test_hsv2rgb_within_one_lsb_of_reference(void)
+{
+    int max_error = 0;
+    for (uint32_t v = 0; v <= 100; v++) {
+        for (uint32_t s = 0; s <= 100; s++) {
+            for (uint32_t h = 0; h < 720; h++) {
+                uint32_t r_ref, g_ref, b_ref;
+                uint8_t r, g, b;
+                reference_hsv2rgb(h, s, v, &r_ref, &g_ref, &b_ref);
+                // same truncation of V as the float version's v * 2.55f
+                led_color_hsv2rgb(h, (s * 255 + 50) / 100, v * 255 / 100, &r, &g, &b);
+                int error = abs_diff(r, r_ref);
+                error = abs_diff(g, g_ref) > error ? abs_diff(g, g_ref) : error;
+                error = abs_diff(b, b_ref) > error ? abs_diff(b, b_ref) : error;
+                max_error = error > max_error ? error : max_error;
+            }
+        }
+    }
+    printf("max error against the float version: %d LSB\n", max_error);
+    TEST_ASSERT(max_error <= 1);
+}
+
+static void test_hsv2rgb_primaries(void)
+{
+    uint8_t r, g, b;
+    led_color_hsv2rgb(0, 255, 255, &r, &g, &b);
+    TEST_ASSERT(r == 255 && g == 0 && b == 0);
+    led_color_hsv2rgb(120, 255, 255, &r, &g, &b);
+    TEST_ASSERT(r == 0 && g == 255 && b == 0);
+    led_color_hsv2rgb(240 + 360, 255, 255, &r, &g, &b);
+    TEST_ASSERT(r == 0 && g == 0 && b == 255);
+    led_color_hsv2rgb(77, 0, 200, &r, &g, &b);
+    TEST_ASSERT(r == 200 && g == 200 && b == 200);
+}
+
+static void test_fill_rainbow_matches_single_pixel(void)
+{
+    enum { NUM_LEDS = 72 };
+    uint8_t grb[NUM_LEDS * 3];
+    for (int offset = 0; offset < 3; offset++) {
+        memset(grb, 0xAA, sizeof(grb));
+        uint32_t start = LED_COLOR_HUE_Q8(300) + offset * LED_COLOR_HUE_Q8(360) / NUM_LEDS;
+        uint32_t step = 3 * LED_COLOR_HUE_Q8(360) / NUM_LEDS;
+        size_t count = (NUM_LEDS - offset + 2) / 3;
+        led_color_fill_rainbow(&grb[offset * 3], count, 3, start, step, 255, 128);
+        for (int j = 0; j < NUM_LEDS; j++) {
+            if (j % 3 != offset) {
+                TEST_ASSERT_EQUAL(0xAA, grb[j * 3]);
+                continue;
+            }
+            uint8_t r, g, b;
+            led_color_hsv2rgb(300 + j * 360 / NUM_LEDS, 255, 128, &r, &g, &b);
+            TEST_ASSERT_EQUAL(g, grb[j * 3 + 0]);
+            TEST_ASSERT_EQUAL(r, grb[j * 3 + 1]);
+            TEST_ASSERT_EQUAL(b, grb[j * 3 + 2]);
+        }
+    }
+}
+
+static void run_bench(void)
+{
+    enum { NUM_LEDS = 72 };
+    static uint8_t grb[NUM_LEDS * 3];
+    volatile uint32_t hue_offset = 0;
+    size_t pixels = 0;
+    double start = test_now_sec();
+    while (test_now_sec() - start < 0.3) {
+        for (int iter = 0; iter < 1000; iter++) {
+            for (int j = 0; j < NUM_LEDS; j++) {
+                uint32_t r, g, b;
+                reference_hsv2rgb(j * 360 / NUM_LEDS + hue_offset, 100, 100, &r, &g, &b);
+                grb[j * 3 + 0] = g;
+                grb[j * 3 + 1] = b;
+                grb[j * 3 + 2] = r;
+            }
+            hue_offset += 60;
+            pixels += NUM_LEDS;
+        }
+    }
+    double float_rate = pixels / (test_now_sec() - start);
+
+    pixels = 0;
+    start = test_now_sec();
+    while (test_now_sec() - start < 0.3) {
+        for (int iter = 0; iter < 1000; iter++) {
+            led_color_fill_rainbow(grb, NUM_LEDS, 1, LED_COLOR_HUE_Q8(hue_offset), LED_COLOR_HUE_Q8(360) / NUM_LEDS, 255, 255);
+            hue_offset += 60;
+            pixels += NUM_LEDS;
+        }
+    }
+    double batch_rate = pixels / (test_now_sec() - start);
+    printf("%-28s %14s\n", "hsv2rgb", "pixels/s");
+    printf("%-28s %14.0f\n", "float, per pixel", float_rate);
+    printf("%-28s %14.0f (%.2fx)\n", "integer, fill_rainbow", batch_rate, batch_rate / float_rate);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        run_bench();
+        return EXIT_SUCCESS;
+    }
+    RUN_TEST(test_hsv2rgb_within_one_lsb_of_reference);
+    RUN_TEST(test_hsv2rgb_primaries);
+    RUN_TEST(test_fill_rainbow_matches_single_pixel);
+    return TEST_EXIT();
+}
@@ -0,0 +1,259 @@
+/*
+ * Host test and benchmark for the LED frame buffer, every bulk operation against a per-pixel reference.
+ */
+#include <string.h>
+#include "test_common.h"
+#include "led_frame.h"
+
+#define MAX_PIXELS 300
+
+// pixel bytes of the reference frame, one pixel at a time with the bounds check in every call
+typedef struct {
+    uint8_t bytes[MAX_PIXELS * 4];
+    const led_strip_chip_info_t *chip;
+    int num_pixels;
+} reference_frame_t;
+
+static void reference_set(reference_frame_t *ref, int index, uint8_t r, uint8_t g, uint8_t b)
+{
+    if (index < 0 || index >= ref->num_pixels) {
+        return;
+    }
+    uint8_t *pixel = &ref->bytes[index * ref->chip->bytes_per_pixel];
+    pixel[ref->chip->red] = r;
+    pixel[ref->chip->green] = g;
+    pixel[ref->chip->blue] = b;
+    if (ref->chip->bytes_per_pixel == 4) {
+        pixel[ref->chip->white] = 0;
+    }
+}
+
+static void reference_move(reference_frame_t *ref, int offset, bool wrap)
+{
+    int bytes_per_pixel = ref->chip->bytes_per_pixel;
+    uint8_t moved[sizeof(ref->bytes)] = {0};
+    for (int i = 0; i < ref->num_pixels; i++) {
+        long to = (long)i + offset;
+        if (wrap) {
+            to = ((to % ref->num_pixels) + ref->num_pixels) % ref->num_pixels;
+        } else if (to < 0 || to >= ref->num_pixels) {
+            continue;
+        }
+        memcpy(&moved[to * bytes_per_pixel], &ref->bytes[i * bytes_per_pixel], bytes_per_pixel);
+    }
+    memcpy(ref->bytes, moved, sizeof(moved));
+}
+
+// highest pixel that differs between two frames plus one, 0 if they are the same
+static size_t changed_end(const uint8_t *a, const uint8_t *b, size_t num_pixels, size_t bytes_per_pixel)
+{
+    while (num_pixels && memcmp(&a[(num_pixels - 1) * bytes_per_pixel], &b[(num_pixels - 1) * bytes_per_pixel],
+                                bytes_per_pixel) == 0) {
+        num_pixels--;
+    }
+    return num_pixels;
+}
+
+static void run_random_ops(led_strip_chip_t chip_id, int num_pixels, uint32_t seed)
+{
+    led_frame_t frame;
+    TEST_ASSERT_EQUAL(ESP_OK, led_frame_init(&frame, chip_id, num_pixels));
+    TEST_ASSERT(((uintptr_t)frame.pixels & 3) == 0);
+    reference_frame_t ref = {.chip = frame.chip, .num_pixels = num_pixels};
+    size_t bytes_per_pixel = frame.chip->bytes_per_pixel;
+    size_t frame_bytes = num_pixels * bytes_per_pixel;
+    size_t padded_bytes = (frame_bytes + 3) / 4 * 4;
+    uint8_t before[MAX_PIXELS * 4];
+    uint8_t pixels[(MAX_PIXELS + 20) * 4];
+    int failed_op = -1;
+    for (int op_index = 0; op_index < 4000 && failed_op < 0; op_index++) {
+        memcpy(before, frame.pixels, frame_bytes);
+        frame.dirty_end = 0;
+        int op = test_rand(&seed) % 8;
+        int start = (int)(test_rand(&seed) % (num_pixels + 20)) - 10;
+        int count = (int)(test_rand(&seed) % (num_pixels + 20)) - 5;
+        int offset = (int)(test_rand(&seed) % (4 * num_pixels + 1)) - 2 * num_pixels;
+        uint8_t r = test_rand(&seed), g = test_rand(&seed), b = test_rand(&seed);
+        switch (op) {
+        case 0:
+        case 1:
+            led_frame_fill(&frame, start, count, r, g, b);
+            for (int i = start; i < start + count; i++) {
+                reference_set(&ref, i, r, g, b);
+            }
+            break;
+        case 2:
+            led_frame_set_pixel(&frame, start, r, g, b);
+            reference_set(&ref, start, r, g, b);
+            break;
+        case 3:
+            led_frame_clear(&frame);
+            memset(ref.bytes, 0, sizeof(ref.bytes));
+            break;
+        case 4:
+            for (size_t i = 0; i < sizeof(pixels); i++) {
+                pixels[i] = test_rand(&seed);
+            }
+            led_frame_blit(&frame, start, pixels, count);
+            for (int i = 0; i < count; i++) {
+                if (start + i >= 0 && start + i < num_pixels) {
+                    memcpy(&ref.bytes[(start + i) * bytes_per_pixel], &pixels[i * bytes_per_pixel], bytes_per_pixel);
+                }
+            }
+            break;
+        case 5:
+            led_frame_scale(&frame, r);
+            for (size_t i = 0; i < frame_bytes; i++) {
+                ref.bytes[i] = ref.bytes[i] * (r + 1) >> 8;
+            }
+            break;
+        case 6:
+            led_frame_shift(&frame, offset);
+            reference_move(&ref, offset, false);
+            break;
+        default:
+            led_frame_rotate(&frame, offset);
+            reference_move(&ref, offset, true);
+            break;
+        }
+        if (memcmp(frame.pixels, ref.bytes, frame_bytes) != 0 ||
+            changed_end(frame.pixels, before, num_pixels, bytes_per_pixel) > frame.dirty_end ||
+            frame.dirty_end > (size_t)num_pixels) {
+            failed_op = op;
+        }
+        for (size_t i = frame_bytes; i < padded_bytes; i++) {
+            if (frame.pixels[i]) {
+                failed_op = op;
+            }
+        }
+    }
+    led_frame_deinit(&frame);
+    TEST_ASSERT_EQUAL(-1, failed_op);
+}
+
+static void test_random_ops_match_reference(void)
+{
+    // odd sizes leave padding after the last pixel, unaligned starts exercise the byte head and tail of fills
+    static const int sizes[] = {1, 2, 3, 5, 7, 72, 144, 299};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        run_random_ops(LED_STRIP_CHIP_WS2812, sizes[i], 0x1234 + i);
+        run_random_ops(LED_STRIP_CHIP_SK6812_RGBW, sizes[i], 0x5678 + i);
+    }
+}
+
+static void test_set_pixel_and_clear_only_mark_changes(void)
+{
+    led_frame_t frame;
+    TEST_ASSERT_EQUAL(ESP_OK, led_frame_init(&frame, LED_STRIP_CHIP_WS2812, 72));
+    led_frame_set_pixel(&frame, 10, 1, 2, 3);
+    TEST_ASSERT_EQUAL(11, frame.dirty_end);
+    TEST_ASSERT_EQUAL(2, frame.pixels[10 * 3 + 0]); // GRB
+    TEST_ASSERT_EQUAL(1, frame.pixels[10 * 3 + 1]);
+    TEST_ASSERT_EQUAL(3, frame.pixels[10 * 3 + 2]);
+    frame.dirty_end = 0;
+    led_frame_set_pixel(&frame, 10, 1, 2, 3);
+    led_frame_set_pixel(&frame, 72, 1, 2, 3);
+    led_frame_set_pixel(&frame, -1, 1, 2, 3);
+    TEST_ASSERT_EQUAL(0, frame.dirty_end);
+    // the clear stops at the word holding the last lit byte
+    led_frame_clear(&frame);
+    TEST_ASSERT_EQUAL(11, frame.dirty_end);
+    frame.dirty_end = 0;
+    led_frame_clear(&frame);
+    led_frame_scale(&frame, 100);
+    TEST_ASSERT_EQUAL(0, frame.dirty_end);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, led_frame_init(&frame, LED_STRIP_CHIP_MAX, 72));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, led_frame_init(&frame, LED_STRIP_CHIP_WS2812, 0));
+    led_frame_deinit(&frame);
+}
+
+static void test_scale_extremes(void)
+{
+    led_frame_t frame;
+    TEST_ASSERT_EQUAL(ESP_OK, led_frame_init(&frame, LED_STRIP_CHIP_SK6812_RGBW, 5));
+    uint8_t *pixels = led_frame_get_pixels(&frame);
+    for (int i = 0; i < 20; i++) {
+        pixels[i] = i * 13 + 7;
+    }
+    led_frame_scale(&frame, 255);
+    for (int i = 0; i < 20; i++) {
+        TEST_ASSERT_EQUAL(i * 13 + 7, pixels[i]);
+    }
+    led_frame_scale(&frame, 0);
+    for (int i = 0; i < 20; i++) {
+        TEST_ASSERT_EQUAL(0, pixels[i]);
+    }
+    led_frame_deinit(&frame);
+}
+
+static void run_bench(void)
+{
+    enum { NUM_LEDS = 144 };
+    led_frame_t frame;
+    if (led_frame_init(&frame, LED_STRIP_CHIP_WS2812, NUM_LEDS) != ESP_OK) {
+        return;
+    }
+    uint8_t rainbow[NUM_LEDS * 3];
+    for (int i = 0; i < NUM_LEDS * 3; i++) {
+        rainbow[i] = i * 7;
+    }
+    volatile uint8_t level = 0;
+    static const char *names[] = {"fill", "scale", "rotate 1"};
+    for (int op = 0; op < 3; op++) {
+        double rates[2];
+        for (int bulk = 0; bulk < 2; bulk++) {
+            size_t pixels = 0;
+            double start = test_now_sec();
+            while (test_now_sec() - start < 0.2) {
+                for (int iter = 0; iter < 1000; iter++) {
+                    uint8_t v = level++;
+                    if (op == 0 && bulk) {
+                        led_frame_fill(&frame, 1, NUM_LEDS - 1, v, v, v);
+                    } else if (op == 0) {
+                        for (int i = 1; i < NUM_LEDS; i++) {
+                            led_frame_set_pixel(&frame, i, v, v, v);
+                        }
+                    } else if (op == 1 && bulk) {
+                        led_frame_blit(&frame, 0, rainbow, NUM_LEDS);
+                        led_frame_scale(&frame, v);
+                    } else if (op == 1) {
+                        // a fade through set_pixel, GRB bytes
+                        led_frame_blit(&frame, 0, rainbow, NUM_LEDS);
+                        const uint8_t *bytes = frame.pixels;
+                        for (int i = 0; i < NUM_LEDS; i++) {
+                            led_frame_set_pixel(&frame, i, bytes[i * 3 + 1] * (v + 1) >> 8, bytes[i * 3] * (v + 1) >> 8,
+                                                bytes[i * 3 + 2] * (v + 1) >> 8);
+                        }
+                    } else if (bulk) {
+                        led_frame_rotate(&frame, 1);
+                    } else {
+                        // the way a chase was written before, one pixel at a time
+                        uint8_t *bytes = led_frame_get_pixels(&frame);
+                        uint8_t last[3] = {bytes[(NUM_LEDS - 1) * 3], bytes[(NUM_LEDS - 1) * 3 + 1], bytes[(NUM_LEDS - 1) * 3 + 2]};
+                        for (int i = NUM_LEDS - 1; i > 0; i--) {
+                            led_frame_set_pixel(&frame, i, bytes[(i - 1) * 3 + 1], bytes[(i - 1) * 3], bytes[(i - 1) * 3 + 2]);
+                        }
+                        led_frame_set_pixel(&frame, 0, last[1], last[0], last[2]);
+                    }
+                    pixels += NUM_LEDS;
+                }
+            }
+            rates[bulk] = pixels / (test_now_sec() - start);
+        }
+        printf("%-8s per pixel: %7.1f Mpixel/s, bulk: %7.1f Mpixel/s (x%.1f)\n", names[op], rates[0] / 1e6, rates[1] / 1e6,
+               rates[1] / rates[0]);
+    }
+    led_frame_deinit(&frame);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        run_bench();
+        return EXIT_SUCCESS;
+    }
+    RUN_TEST(test_random_ops_match_reference);
+    RUN_TEST(test_set_pixel_and_clear_only_mark_changes);
+    RUN_TEST(test_scale_extremes);
+    return TEST_EXIT();
+}
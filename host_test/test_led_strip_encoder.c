@@ -0,0 +1,545 @@
+/*
+ * Host test and benchmark for the LED strip encoders.
+ *
+ * The LUT encoder must emit exactly the same symbol stream as the bytes encoder based one, for every resolution
+ * and memory block size, including frames that split a byte across refills. Whatever resolution an encoder accepts,
+ * its waveforms must decode back to the frame with every bit within the chip's tolerance.
+ */
+#include <inttypes.h>
+#include <math.h>
+#include <string.h>
+#include "test_common.h"
+#include "rmt_stub.h"
+#include "led_strip_encoder.h"
+#include "led_strip_decoder.h"
+
+static const uint32_t s_resolutions[] = {8000000, 10000000, 20000000, 40000000, 80000000};
+static const size_t s_mem_block_sizes[] = {48, 64, 100, 128, 1024};
+
+static void encode_frame(rmt_encoder_handle_t encoder, size_t mem_block_symbols, const uint8_t *frame, size_t size,
+                         rmt_symbol_word_t **ret_symbols, size_t *ret_num_symbols)
+{
+    rmt_channel_handle_t channel = rmt_stub_new_channel(mem_block_symbols);
+    size_t num_symbols = rmt_stub_encode(channel, encoder, frame, size);
+    const rmt_symbol_word_t *symbols = rmt_stub_get_symbols(channel, &num_symbols);
+    *ret_symbols = malloc(num_symbols * sizeof(rmt_symbol_word_t));
+    memcpy(*ret_symbols, symbols, num_symbols * sizeof(rmt_symbol_word_t));
+    *ret_num_symbols = num_symbols;
+    rmt_stub_del_channel(channel);
+}
+
+static void test_lut_encoder_matches_bytes_encoder(void)
+{
+    uint32_t seed = 0x12345678;
+    uint8_t frame[3 * 300];
+    for (size_t r = 0; r < sizeof(s_resolutions) / sizeof(s_resolutions[0]); r++) {
+        led_strip_encoder_config_t config = {
+            .resolution = s_resolutions[r],
+        };
+        rmt_encoder_handle_t bytes_encoder = NULL;
+        rmt_encoder_handle_t lut_encoder = NULL;
+        TEST_ASSERT_EQUAL(ESP_OK, rmt_new_led_strip_encoder(&config, &bytes_encoder));
+        TEST_ASSERT_EQUAL(ESP_OK, rmt_new_led_strip_lut_encoder(&config, &lut_encoder));
+        for (size_t m = 0; m < sizeof(s_mem_block_sizes) / sizeof(s_mem_block_sizes[0]); m++) {
+            for (int iter = 0; iter < 20; iter++) {
+                size_t size = 1 + test_rand(&seed) % sizeof(frame);
+                for (size_t i = 0; i < size; i++) {
+                    frame[i] = test_rand(&seed);
+                }
+                rmt_symbol_word_t *expected, *actual;
+                size_t num_expected, num_actual;
+                encode_frame(bytes_encoder, s_mem_block_sizes[m], frame, size, &expected, &num_expected);
+                encode_frame(lut_encoder, s_mem_block_sizes[m], frame, size, &actual, &num_actual);
+                TEST_ASSERT_EQUAL(size * 8 + 1, num_expected);
+                TEST_ASSERT_EQUAL(num_expected, num_actual);
+                int same = memcmp(expected, actual, num_expected * sizeof(rmt_symbol_word_t)) == 0;
+                free(expected);
+                free(actual);
+                TEST_ASSERT_MESSAGE(same, "symbol streams differ");
+            }
+        }
+        rmt_del_encoder(bytes_encoder);
+        rmt_del_encoder(lut_encoder);
+    }
+}
+
+static void test_lut_encoder_bit_order(void)
+{
+    led_strip_encoder_config_t config = {
+        .resolution = 10000000,
+    };
+    rmt_encoder_handle_t lut_encoder = NULL;
+    TEST_ASSERT_EQUAL(ESP_OK, rmt_new_led_strip_lut_encoder(&config, &lut_encoder));
+    const uint8_t pixel[3] = {0x80, 0x01, 0xA5};
+    rmt_symbol_word_t *symbols;
+    size_t num_symbols;
+    encode_frame(lut_encoder, 64, pixel, sizeof(pixel), &symbols, &num_symbols);
+    rmt_del_encoder(lut_encoder);
+    TEST_ASSERT_EQUAL(25, num_symbols);
+    for (int i = 0; i < 24; i++) {
+        int bit = (pixel[i / 8] >> (7 - i % 8)) & 1;
+        TEST_ASSERT_EQUAL(1, symbols[i].level0);
+        TEST_ASSERT_EQUAL(bit ? 9 : 3, symbols[i].duration0);
+        TEST_ASSERT_EQUAL(bit ? 3 : 9, symbols[i].duration1);
+    }
+    // reset code, 50us split across both halves of the last symbol
+    TEST_ASSERT_EQUAL(0, symbols[24].level0);
+    TEST_ASSERT_EQUAL(250, symbols[24].duration0);
+    TEST_ASSERT_EQUAL(250, symbols[24].duration1);
+    free(symbols);
+}
+
+static void test_encoder_chip_profiles(void)
+{
+    static const uint8_t pixel[4] = {0x80, 0x01, 0xA5, 0x3C};
+    for (int chip = 0; chip < LED_STRIP_CHIP_MAX; chip++) {
+        const led_strip_chip_info_t *info = led_strip_get_chip_info(chip);
+        TEST_ASSERT(info && (info->bytes_per_pixel == 3 || info->bytes_per_pixel == 4));
+        led_strip_encoder_config_t config = {
+            .resolution = 40000000,
+            .chip = chip,
+        };
+        rmt_encoder_handle_t bytes_encoder = NULL;
+        rmt_encoder_handle_t lut_encoder = NULL;
+        TEST_ASSERT_EQUAL(ESP_OK, rmt_new_led_strip_encoder(&config, &bytes_encoder));
+        TEST_ASSERT_EQUAL(ESP_OK, rmt_new_led_strip_lut_encoder(&config, &lut_encoder));
+        rmt_symbol_word_t *expected, *actual;
+        size_t num_expected, num_actual;
+        encode_frame(bytes_encoder, 64, pixel, info->bytes_per_pixel, &expected, &num_expected);
+        encode_frame(lut_encoder, 64, pixel, info->bytes_per_pixel, &actual, &num_actual);
+        rmt_del_encoder(bytes_encoder);
+        rmt_del_encoder(lut_encoder);
+        TEST_ASSERT_EQUAL(info->bytes_per_pixel * 8 + 1, num_expected);
+        TEST_ASSERT_EQUAL(num_expected, num_actual);
+        TEST_ASSERT(memcmp(expected, actual, num_expected * sizeof(rmt_symbol_word_t)) == 0);
+        // 40 ticks per us
+        for (int i = 0; i < info->bytes_per_pixel * 8; i++) {
+            int bit = (pixel[i / 8] >> (7 - i % 8)) & 1;
+            TEST_ASSERT_EQUAL((bit ? info->t1h_ns : info->t0h_ns) * 40 / 1000, expected[i].duration0);
+            TEST_ASSERT_EQUAL((bit ? info->t1l_ns : info->t0l_ns) * 40 / 1000, expected[i].duration1);
+        }
+        TEST_ASSERT_EQUAL(info->reset_us * 40, expected[num_expected - 1].duration0 + expected[num_expected - 1].duration1);
+        free(expected);
+        free(actual);
+    }
+
+    led_strip_encoder_config_t config = {
+        .resolution = 10000000,
+        .chip = LED_STRIP_CHIP_MAX,
+    };
+    rmt_encoder_handle_t encoder = NULL;
+    TEST_ASSERT(!led_strip_get_chip_info(LED_STRIP_CHIP_MAX));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rmt_new_led_strip_encoder(&config, &encoder));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rmt_new_led_strip_lut_encoder(&config, &encoder));
+    // 1 MHz cannot express the 0.25us high time of a WS2811 0 bit
+    config.resolution = 1000000;
+    config.chip = LED_STRIP_CHIP_WS2811;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rmt_new_led_strip_encoder(&config, &encoder));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rmt_new_led_strip_lut_encoder(&config, &encoder));
+}
+
+// recover the pixel bytes from a WS2812 stream at 10 MHz, false if its timing is off
+static bool decode_bytes(const rmt_symbol_word_t *symbols, size_t num_symbols, uint8_t *bytes, size_t max_bytes)
+{
+    led_strip_decoder_t decoder;
+    led_strip_decode_report_t report;
+    led_strip_decoder_init(&decoder, LED_STRIP_CHIP_WS2812, 10000000);
+    return led_strip_decode(&decoder, symbols, num_symbols, bytes, max_bytes, &report) && report.num_bytes == max_bytes;
+}
+
+static void test_lut_encoder_gamma_and_brightness(void)
+{
+    led_strip_encoder_config_t config = {
+        .resolution = 10000000,
+        .gamma = 2.2f,
+        .brightness = 128,
+    };
+    rmt_encoder_handle_t lut_encoder = NULL;
+    TEST_ASSERT_EQUAL(ESP_OK, rmt_new_led_strip_lut_encoder(&config, &lut_encoder));
+    uint8_t frame[256];
+    for (int i = 0; i < 256; i++) {
+        frame[i] = i;
+    }
+    rmt_symbol_word_t *symbols;
+    size_t num_symbols;
+    uint8_t decoded[256];
+    encode_frame(lut_encoder, 64, frame, sizeof(frame), &symbols, &num_symbols);
+    bool decoded_ok = decode_bytes(symbols, num_symbols, decoded, sizeof(decoded));
+    free(symbols);
+    TEST_ASSERT(decoded_ok);
+    for (int i = 0; i < 256; i++) {
+        // the frame itself is never modified
+        TEST_ASSERT_EQUAL(i, frame[i]);
+        TEST_ASSERT_EQUAL((int)(powf(i / 255.0f, 2.2f) * 128 + 0.5f), decoded[i]);
+    }
+    TEST_ASSERT_EQUAL(0, decoded[0]);
+    TEST_ASSERT_EQUAL(128, decoded[255]);
+
+    TEST_ASSERT_EQUAL(ESP_OK, rmt_led_strip_encoder_set_brightness(lut_encoder, 255));
+    encode_frame(lut_encoder, 64, frame, sizeof(frame), &symbols, &num_symbols);
+    decoded_ok = decode_bytes(symbols, num_symbols, decoded, sizeof(decoded));
+    free(symbols);
+    TEST_ASSERT(decoded_ok);
+    TEST_ASSERT_EQUAL(255, decoded[255]);
+    TEST_ASSERT_EQUAL((int)(powf(128 / 255.0f, 2.2f) * 255 + 0.5f), decoded[128]);
+    rmt_del_encoder(lut_encoder);
+
+    // the bytes encoder cannot apply a curve while encoding
+    rmt_encoder_handle_t bytes_encoder = NULL;
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, rmt_new_led_strip_encoder(&config, &bytes_encoder));
+    config.gamma = 0;
+    config.brightness = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, rmt_new_led_strip_encoder(&config, &bytes_encoder));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rmt_led_strip_encoder_set_brightness(bytes_encoder, 10));
+    rmt_del_encoder(bytes_encoder);
+}
+
+// a render task changing the brightness twice while one frame is being sent
+static void change_brightness_twice(void *arg)
+{
+    rmt_led_strip_encoder_set_brightness((rmt_encoder_handle_t)arg, 10);
+    rmt_led_strip_encoder_set_brightness((rmt_encoder_handle_t)arg, 20);
+}
+
+static void test_lut_encoder_brightness_applies_per_frame(void)
+{
+    led_strip_encoder_config_t config = {
+        .resolution = 10000000,
+    };
+    rmt_encoder_handle_t lut_encoder = NULL;
+    TEST_ASSERT_EQUAL(ESP_OK, rmt_new_led_strip_lut_encoder(&config, &lut_encoder));
+    uint8_t frame[256];
+    memset(frame, 255, sizeof(frame));
+    uint8_t decoded[256];
+    rmt_channel_handle_t channel = rmt_stub_new_channel(64);
+    rmt_stub_set_refill_hook(channel, change_brightness_twice, lut_encoder);
+    rmt_stub_encode(channel, lut_encoder, frame, sizeof(frame));
+    rmt_stub_set_refill_hook(channel, NULL, NULL);
+    TEST_ASSERT(rmt_stub_get_refills(channel) > 2);
+    size_t num_symbols;
+    const rmt_symbol_word_t *symbols = rmt_stub_get_symbols(channel, &num_symbols);
+    TEST_ASSERT(decode_bytes(symbols, num_symbols, decoded, sizeof(decoded)));
+    // the frame keeps the brightness it started with
+    for (size_t i = 0; i < sizeof(decoded); i++) {
+        TEST_ASSERT_EQUAL(255, decoded[i]);
+    }
+    // the next one takes the last brightness set
+    rmt_stub_clear(channel);
+    rmt_stub_encode(channel, lut_encoder, frame, sizeof(frame));
+    symbols = rmt_stub_get_symbols(channel, &num_symbols);
+    TEST_ASSERT(decode_bytes(symbols, num_symbols, decoded, sizeof(decoded)));
+    for (size_t i = 0; i < sizeof(decoded); i++) {
+        TEST_ASSERT_EQUAL(20, decoded[i]);
+    }
+    rmt_stub_del_channel(channel);
+    rmt_del_encoder(lut_encoder);
+}
+
+static void test_encoders_pass_timing_verifier(void)
+{
+    uint32_t seed = 0xC0FFEE;
+    uint8_t frame[4 * 100];
+    uint8_t decoded[4 * 100];
+    size_t accepted = 0;
+    for (int iter = 0; iter < 400; iter++) {
+        // any resolution the RMT can run at, down to where ticks get too coarse for the chip
+        uint32_t resolution = 1000000 + test_rand(&seed) % 79000001;
+        led_strip_chip_t chip = test_rand(&seed) % LED_STRIP_CHIP_MAX;
+        bool lut = iter % 2;
+        led_strip_encoder_config_t config = {
+            .resolution = resolution,
+            .chip = chip,
+        };
+        rmt_encoder_handle_t encoder = NULL;
+        esp_err_t err = lut ? rmt_new_led_strip_lut_encoder(&config, &encoder) : rmt_new_led_strip_encoder(&config, &encoder);
+        if (err != ESP_OK) {
+            // rounding to 250ns ticks stays within the 150ns tolerance, only slower clocks may be refused
+            TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, err);
+            TEST_ASSERT_MESSAGE(resolution < 4000000, "resolution refused");
+            continue;
+        }
+        accepted++;
+        size_t size = led_strip_get_chip_info(chip)->bytes_per_pixel * (1 + test_rand(&seed) % 100);
+        for (size_t i = 0; i < size; i++) {
+            frame[i] = test_rand(&seed);
+        }
+        rmt_symbol_word_t *symbols;
+        size_t num_symbols;
+        encode_frame(encoder, s_mem_block_sizes[test_rand(&seed) % 5], frame, size, &symbols, &num_symbols);
+        rmt_del_encoder(encoder);
+        led_strip_decoder_t decoder;
+        led_strip_decode_report_t report;
+        TEST_ASSERT(led_strip_decoder_init(&decoder, chip, resolution));
+        bool ok = led_strip_decode(&decoder, symbols, num_symbols, decoded, sizeof(decoded), &report);
+        free(symbols);
+        if (!ok) {
+            fprintf(stderr, "chip %d at %" PRIu32 " Hz: %zu bad bits from bit %zu, reset %llu ns\n", chip, resolution,
+                    report.bad_bits, report.first_bad_bit, (unsigned long long)report.reset_ns);
+        }
+        TEST_ASSERT(ok);
+        TEST_ASSERT_EQUAL(size, report.num_bytes);
+        TEST_ASSERT_MESSAGE(memcmp(frame, decoded, size) == 0, "decoded bytes differ");
+    }
+    TEST_ASSERT(accepted > 300);
+}
+
+static void test_decoder_flags_bad_timing(void)
+{
+    led_strip_encoder_config_t config = {
+        .resolution = 10000000,
+    };
+    rmt_encoder_handle_t encoder = NULL;
+    TEST_ASSERT_EQUAL(ESP_OK, rmt_new_led_strip_encoder(&config, &encoder));
+    const uint8_t pixel[3] = {0x12, 0x34, 0x56};
+    rmt_symbol_word_t *symbols;
+    size_t num_symbols;
+    encode_frame(encoder, 64, pixel, sizeof(pixel), &symbols, &num_symbols);
+    rmt_del_encoder(encoder);
+    led_strip_decoder_t decoder;
+    led_strip_decode_report_t report;
+    uint8_t decoded[3];
+    TEST_ASSERT(led_strip_decoder_init(&decoder, LED_STRIP_CHIP_WS2812, 10000000));
+    TEST_ASSERT(led_strip_decode(&decoder, symbols, num_symbols, decoded, sizeof(decoded), &report));
+    TEST_ASSERT_EQUAL(50000, report.reset_ns);
+
+    // 0.6us high fits neither a 0 (0.3us) nor a 1 (0.9us)
+    rmt_symbol_word_t good = symbols[5];
+    symbols[5].duration0 = 6;
+    TEST_ASSERT(!led_strip_decode(&decoder, symbols, num_symbols, decoded, sizeof(decoded), &report));
+    TEST_ASSERT_EQUAL(1, report.bad_bits);
+    TEST_ASSERT_EQUAL(5, report.first_bad_bit);
+    TEST_ASSERT(report.well_formed && report.reset_ok);
+    // a low time off by 0.2us is out of tolerance too
+    symbols[5] = good;
+    symbols[7].duration1 += 2;
+    TEST_ASSERT(!led_strip_decode(&decoder, symbols, num_symbols, decoded, sizeof(decoded), &report));
+    TEST_ASSERT_EQUAL(7, report.first_bad_bit);
+    symbols[7].duration1 -= 2;
+    // a reset gap of 40us does not latch
+    symbols[num_symbols - 1].duration0 = 200;
+    symbols[num_symbols - 1].duration1 = 200;
+    TEST_ASSERT(!led_strip_decode(&decoder, symbols, num_symbols, decoded, sizeof(decoded), &report));
+    TEST_ASSERT(!report.reset_ok && !report.bad_bits);
+    TEST_ASSERT_EQUAL(40000, report.reset_ns);
+    symbols[num_symbols - 1].duration0 = 250;
+    symbols[num_symbols - 1].duration1 = 250;
+    // a bit short of a whole byte, and a high level inside the gap
+    TEST_ASSERT(!led_strip_decode(&decoder, &symbols[1], num_symbols - 1, decoded, sizeof(decoded), &report));
+    TEST_ASSERT(!report.well_formed);
+    symbols[num_symbols - 1].level1 = 1;
+    TEST_ASSERT(!led_strip_decode(&decoder, symbols, num_symbols, decoded, sizeof(decoded), &report));
+    TEST_ASSERT(!report.well_formed);
+    free(symbols);
+}
+
+static void test_refills_follow_block_size(void)
+{
+    led_strip_encoder_config_t config = {
+        .resolution = 10000000,
+    };
+    rmt_encoder_handle_t lut_encoder = NULL;
+    TEST_ASSERT_EQUAL(ESP_OK, rmt_new_led_strip_lut_encoder(&config, &lut_encoder));
+    uint8_t frame[300 * 3] = {0};
+    // RMT RAM blocks and DMA buffers alike: one full block before the start, then one interrupt per half block
+    static const size_t block_sizes[] = {48, 64, 96, 192, 512, 1024, 4096};
+    for (size_t b = 0; b < sizeof(block_sizes) / sizeof(block_sizes[0]); b++) {
+        size_t block = block_sizes[b];
+        rmt_channel_handle_t channel = rmt_stub_new_channel(block);
+        size_t num_symbols = rmt_stub_encode(channel, lut_encoder, frame, sizeof(frame));
+        size_t refills = rmt_stub_get_refills(channel);
+        rmt_stub_del_channel(channel);
+        TEST_ASSERT_EQUAL(sizeof(frame) * 8 + 1, num_symbols);
+        size_t interrupts = num_symbols > block ? (num_symbols - block + block / 2 - 1) / (block / 2) : 0;
+        TEST_ASSERT_EQUAL(1 + interrupts, refills);
+    }
+    rmt_del_encoder(lut_encoder);
+
+    // DMA buffers come in two halves, at least as large as a RAM block, and only one TX channel has DMA
+    rmt_tx_channel_config_t tx_chan_config = {
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .gpio_num = 10,
+        .mem_block_symbols = 1024,
+        .resolution_hz = 10000000,
+        .trans_queue_depth = 4,
+        .flags.with_dma = true,
+    };
+    rmt_channel_handle_t dma_channel = NULL, other_channel = NULL;
+    TEST_ASSERT_EQUAL(ESP_OK, rmt_new_tx_channel(&tx_chan_config, &dma_channel));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, rmt_new_tx_channel(&tx_chan_config, &other_channel));
+    tx_chan_config.flags.with_dma = false;
+    TEST_ASSERT_EQUAL(ESP_OK, rmt_new_tx_channel(&tx_chan_config, &other_channel));
+    TEST_ASSERT_EQUAL(ESP_OK, rmt_del_channel(other_channel));
+    TEST_ASSERT_EQUAL(ESP_OK, rmt_del_channel(dma_channel));
+    tx_chan_config.flags.with_dma = true;
+    tx_chan_config.mem_block_symbols = 1023;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rmt_new_tx_channel(&tx_chan_config, &dma_channel));
+    tx_chan_config.mem_block_symbols = 32;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rmt_new_tx_channel(&tx_chan_config, &dma_channel));
+}
+
+static double bench_encoder(rmt_encoder_handle_t encoder, size_t num_leds, size_t mem_block_symbols, size_t *ret_refills)
+{
+    uint8_t *frame = malloc(num_leds * 3);
+    uint32_t seed = 42;
+    for (size_t i = 0; i < num_leds * 3; i++) {
+        frame[i] = test_rand(&seed);
+    }
+    rmt_channel_handle_t channel = rmt_stub_new_channel(mem_block_symbols);
+    size_t total_symbols = 0;
+    double start = test_now_sec();
+    double elapsed;
+    do {
+        for (int i = 0; i < 100; i++) {
+            total_symbols += rmt_stub_encode(channel, encoder, frame, num_leds * 3);
+        }
+        *ret_refills = rmt_stub_get_refills(channel) / 100;
+        rmt_stub_clear(channel);
+        elapsed = test_now_sec() - start;
+    } while (elapsed < 0.2);
+    rmt_stub_del_channel(channel);
+    free(frame);
+    return total_symbols / elapsed;
+}
+
+// symbols per second the decoder verifies, the frame must decode cleanly
+static double bench_decoder(rmt_encoder_handle_t encoder, size_t num_leds)
+{
+    uint8_t *frame = malloc(num_leds * 3);
+    uint8_t *decoded = malloc(num_leds * 3);
+    uint32_t seed = 42;
+    for (size_t i = 0; i < num_leds * 3; i++) {
+        frame[i] = test_rand(&seed);
+    }
+    rmt_symbol_word_t *symbols;
+    size_t num_symbols;
+    encode_frame(encoder, 64, frame, num_leds * 3, &symbols, &num_symbols);
+    led_strip_decoder_t decoder;
+    led_strip_decode_report_t report;
+    led_strip_decoder_init(&decoder, LED_STRIP_CHIP_WS2812, 10000000);
+    size_t total_symbols = 0;
+    double start = test_now_sec();
+    double elapsed;
+    do {
+        for (int i = 0; i < 100; i++) {
+            if (!led_strip_decode(&decoder, symbols, num_symbols, decoded, num_leds * 3, &report) ||
+                memcmp(frame, decoded, num_leds * 3) != 0) {
+                fprintf(stderr, "frame of %zu LEDs does not decode\n", num_leds);
+                abort();
+            }
+            total_symbols += num_symbols;
+        }
+        elapsed = test_now_sec() - start;
+    } while (elapsed < 0.2);
+    free(symbols);
+    free(decoded);
+    free(frame);
+    return total_symbols / elapsed;
+}
+
+static void run_bench(void)
+{
+    static const size_t led_counts[] = {72, 300, 1000};
+    led_strip_encoder_config_t config = {
+        .resolution = 10000000,
+    };
+    rmt_encoder_handle_t bytes_encoder = NULL;
+    rmt_encoder_handle_t lut_encoder = NULL;
+    ESP_ERROR_CHECK(rmt_new_led_strip_encoder(&config, &bytes_encoder));
+    ESP_ERROR_CHECK(rmt_new_led_strip_lut_encoder(&config, &lut_encoder));
+    printf("%-8s %-10s %14s %14s %8s %10s %14s\n", "leds", "mem_block", "bytes sym/s", "lut sym/s", "speedup", "refills",
+           "decode sym/s");
+    for (size_t i = 0; i < sizeof(led_counts) / sizeof(led_counts[0]); i++) {
+        size_t refills;
+        double bytes_rate = bench_encoder(bytes_encoder, led_counts[i], 64, &refills);
+        double lut_rate = bench_encoder(lut_encoder, led_counts[i], 64, &refills);
+        double decode_rate = bench_decoder(lut_encoder, led_counts[i]);
+        printf("%-8zu %-10d %14.0f %14.0f %7.2fx %10zu %14.0f\n", led_counts[i], 64, bytes_rate, lut_rate,
+               lut_rate / bytes_rate, refills, decode_rate);
+    }
+    rmt_del_encoder(bytes_encoder);
+    rmt_del_encoder(lut_encoder);
+
+    // time on the wire of a full frame, the bits and the reset code that latches it
+    static const char *chip_names[LED_STRIP_CHIP_MAX] = {"WS2812", "SK6812W", "WS2811", "WS2813"};
+    printf("\n%-8s %-6s %12s %10s\n", "chip", "leds", "frame us", "max fps");
+    for (int chip = 0; chip < LED_STRIP_CHIP_MAX; chip++) {
+        const led_strip_chip_info_t *info = led_strip_get_chip_info(chip);
+        config.chip = chip;
+        ESP_ERROR_CHECK(rmt_new_led_strip_lut_encoder(&config, &lut_encoder));
+        for (size_t i = 0; i < sizeof(led_counts) / sizeof(led_counts[0]); i++) {
+            size_t size = led_counts[i] * info->bytes_per_pixel;
+            uint8_t *frame = calloc(1, size);
+            rmt_symbol_word_t *symbols;
+            size_t num_symbols;
+            encode_frame(lut_encoder, 64, frame, size, &symbols, &num_symbols);
+            uint64_t ticks = 0;
+            for (size_t s = 0; s < num_symbols; s++) {
+                ticks += symbols[s].duration0 + symbols[s].duration1;
+            }
+            double frame_us = ticks / (config.resolution / 1e6);
+            printf("%-8s %-6zu %12.0f %10.0f\n", chip_names[chip], led_counts[i], frame_us, 1e6 / frame_us);
+            free(symbols);
+            free(frame);
+        }
+        rmt_del_encoder(lut_encoder);
+    }
+}
+
+// Cost of a WS2812 frame against strip length, for RMT RAM blocks (a channel can take up to 4 of 48 symbols) and
+// DMA buffers. Every refill interrupt must refill half of the block while the other half, block / 2 bits of
+// 1.25us each, is shifted out: that is its deadline, and what a late interrupt turns into flicker. The encode time
+// is measured on the host, compare it between rows only.
+static void run_sweep(void)
+{
+    static const size_t led_counts[] = {60, 150, 300, 600, 1000, 2000};
+    static const struct {
+        const char *mode;
+        size_t symbols;
+    } blocks[] = {
+        {"ram", 48}, {"ram", 64}, {"ram", 96}, {"ram", 192}, {"dma", 512}, {"dma", 1024}, {"dma", 4096},
+    };
+    led_strip_encoder_config_t config = {
+        .resolution = 10000000,
+    };
+    const led_strip_chip_info_t *info = led_strip_get_chip_info(LED_STRIP_CHIP_WS2812);
+    double bit_us = (info->t0h_ns + info->t0l_ns) / 1000.0;
+    rmt_encoder_handle_t lut_encoder = NULL;
+    ESP_ERROR_CHECK(rmt_new_led_strip_lut_encoder(&config, &lut_encoder));
+    printf("%-5s %-7s %-6s %10s %12s %10s %10s %8s %8s\n", "mode", "symbols", "leds", "irq/frame", "deadline us",
+           "encode us", "wire us", "fps", "cpu %");
+    for (size_t b = 0; b < sizeof(blocks) / sizeof(blocks[0]); b++) {
+        for (size_t i = 0; i < sizeof(led_counts) / sizeof(led_counts[0]); i++) {
+            size_t num_symbols = led_counts[i] * 24 + 1;
+            size_t refills;
+            double encode_us = num_symbols / bench_encoder(lut_encoder, led_counts[i], blocks[b].symbols, &refills) * 1e6;
+            double wire_us = (num_symbols - 1) * bit_us + info->reset_us;
+            // the pipeline encodes the next frame while the current one is on the wire
+            double frame_us = encode_us > wire_us ? encode_us : wire_us;
+            printf("%-5s %-7zu %-6zu %10zu %12.1f %10.1f %10.0f %8.0f %8.2f\n", blocks[b].mode, blocks[b].symbols,
+                   led_counts[i], refills - 1, blocks[b].symbols / 2 * bit_us, encode_us, wire_us, 1e6 / frame_us,
+                   encode_us / frame_us * 100);
+        }
+    }
+    rmt_del_encoder(lut_encoder);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        run_bench();
+        return EXIT_SUCCESS;
+    }
+    if (argc > 1 && strcmp(argv[1], "--sweep") == 0) {
+        run_sweep();
+        return EXIT_SUCCESS;
+    }
+    RUN_TEST(test_lut_encoder_matches_bytes_encoder);
+    RUN_TEST(test_lut_encoder_bit_order);
+    RUN_TEST(test_lut_encoder_gamma_and_brightness);
+    RUN_TEST(test_lut_encoder_brightness_applies_per_frame);
+    RUN_TEST(test_encoder_chip_profiles);
+    RUN_TEST(test_encoders_pass_timing_verifier);
+    RUN_TEST(test_decoder_flags_bad_timing);
+    RUN_TEST(test_refills_follow_block_size);
+    return TEST_EXIT();
+}
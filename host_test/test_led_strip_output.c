@@ -0,0 +1,302 @@
+/*
+ * Host test for the LED strip outputs.
+ *
+ * The same frames pushed through the RMT output (stub channel, decoded symbol by symbol), the SPI output (stub bus,
+ * decoded pulse by pulse) and the capture output must carry exactly the same bytes, for every chip and with gamma
+ * correction, and the SPI pulses must keep the chip's timing.
+ */
+#include <string.h>
+#include "test_common.h"
+#include "rmt_stub.h"
+#include "spi_stub.h"
+#include "led_strip_output.h"
+#include "led_strip_decoder.h"
+
+#define TEST_NUM_PIXELS   50
+#define TEST_NUM_FRAMES   20
+#define TEST_RMT_GPIO     10
+#define TEST_SPI_GPIO     20
+#define TEST_RESOLUTION   10000000 // 0.1us per RMT tick
+
+typedef struct {
+    rmt_channel_handle_t channel;
+    rmt_encoder_handle_t encoder;
+    led_strip_output_handle_t rmt;
+    led_strip_output_handle_t spi;
+    led_strip_output_handle_t capture;
+    size_t frames_done[3];
+} test_outputs_t;
+
+static bool test_count_done(led_strip_output_handle_t output, void *user_ctx)
+{
+    (*(size_t *)user_ctx)++;
+    return false;
+}
+
+static void test_outputs_new(test_outputs_t *outputs, led_strip_chip_t chip, float gamma)
+{
+    memset(outputs, 0, sizeof(*outputs));
+    rmt_tx_channel_config_t tx_chan_config = {
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .gpio_num = TEST_RMT_GPIO,
+        .mem_block_symbols = 64,
+        .resolution_hz = TEST_RESOLUTION,
+        .trans_queue_depth = 4,
+    };
+    ESP_ERROR_CHECK(rmt_new_tx_channel(&tx_chan_config, &outputs->channel));
+    led_strip_encoder_config_t encoder_config = {
+        .resolution = TEST_RESOLUTION,
+        .chip = chip,
+        .gamma = gamma,
+    };
+    ESP_ERROR_CHECK(rmt_new_led_strip_lut_encoder(&encoder_config, &outputs->encoder));
+    led_strip_rmt_output_config_t rmt_config = {
+        .channels = &outputs->channel,
+        .encoders = &outputs->encoder,
+        .num_channels = 1,
+        .num_pixels = TEST_NUM_PIXELS,
+        .chip = chip,
+    };
+    ESP_ERROR_CHECK(led_strip_new_rmt_output(&rmt_config, &outputs->rmt));
+    led_strip_spi_output_config_t spi_config = {
+        .spi_host = SPI2_HOST,
+        .gpio_num = TEST_SPI_GPIO,
+        .num_pixels = TEST_NUM_PIXELS,
+        .chip = chip,
+        .gamma = gamma,
+        .trans_queue_depth = 2,
+    };
+    ESP_ERROR_CHECK(led_strip_new_spi_output(&spi_config, &outputs->spi));
+    led_strip_capture_output_config_t capture_config = {
+        .num_pixels = TEST_NUM_PIXELS,
+        .chip = chip,
+        .max_frames = TEST_NUM_FRAMES,
+    };
+    ESP_ERROR_CHECK(led_strip_new_capture_output(&capture_config, &outputs->capture));
+    led_strip_output_handle_t all[] = {outputs->rmt, outputs->spi, outputs->capture};
+    for (size_t i = 0; i < 3; i++) {
+        ESP_ERROR_CHECK(led_strip_output_register_done_callback(all[i], test_count_done, &outputs->frames_done[i]));
+        ESP_ERROR_CHECK(led_strip_output_enable(all[i]));
+    }
+}
+
+static void test_outputs_del(test_outputs_t *outputs)
+{
+    ESP_ERROR_CHECK(led_strip_del_output(outputs->rmt));
+    ESP_ERROR_CHECK(led_strip_del_output(outputs->spi));
+    ESP_ERROR_CHECK(led_strip_del_output(outputs->capture));
+    ESP_ERROR_CHECK(rmt_disable(outputs->channel));
+    ESP_ERROR_CHECK(rmt_del_channel(outputs->channel));
+    rmt_del_encoder(outputs->encoder);
+}
+
+// recover the bytes of one RMT transaction, 0 if its timing is off
+static size_t decode_rmt(rmt_channel_handle_t channel, size_t index, led_strip_chip_t chip, uint8_t *bytes)
+{
+    static rmt_symbol_word_t symbols[TEST_NUM_PIXELS * 4 * 8 + 1];
+    size_t num_symbols = rmt_stub_copy_transaction(channel, index, symbols, sizeof(symbols) / sizeof(symbols[0]));
+    led_strip_decoder_t decoder;
+    led_strip_decoder_init(&decoder, chip, TEST_RESOLUTION);
+    led_strip_decode_report_t report;
+    if (!led_strip_decode(&decoder, symbols, num_symbols, bytes, TEST_NUM_PIXELS * 4, &report)) {
+        return 0;
+    }
+    return report.num_bytes;
+}
+
+// same for a SPI transaction, every LED bit is a pulse of bits_per_bit SPI bits followed by the all zero reset code
+static size_t decode_spi(spi_device_handle_t device, size_t index, const led_strip_chip_info_t *chip, uint8_t *bytes,
+                         size_t *ret_reset_ns)
+{
+    size_t num_spi_bytes = 0;
+    const uint8_t *data = spi_stub_get_transaction(device, index, &num_spi_bytes);
+    uint32_t unit_ns = 1000000000 / spi_stub_get_clock_hz(device);
+    size_t bits_per_bit = (chip->t0h_ns + chip->t0l_ns + unit_ns / 2) / unit_ns;
+    uint32_t threshold_ns = (chip->t0h_ns + chip->t1h_ns) / 2;
+    size_t num_bytes = 0;
+    size_t spi_bit = 0;
+    // a LED byte takes exactly bits_per_bit SPI bytes and always starts high
+    while (spi_bit / 8 + bits_per_bit <= num_spi_bytes && (data[spi_bit / 8] & 0x80)) {
+        uint8_t byte = 0;
+        for (int bit = 0; bit < 8; bit++) {
+            size_t high = 0;
+            for (size_t i = 0; i < bits_per_bit; i++, spi_bit++) {
+                bool level = data[spi_bit / 8] & (0x80 >> (spi_bit % 8));
+                // one pulse per LED bit: high first, then low
+                if (level && high != i) {
+                    return 0;
+                }
+                high += level;
+            }
+            byte = (byte << 1) | (high * unit_ns > threshold_ns);
+        }
+        bytes[num_bytes++] = byte;
+    }
+    for (size_t i = spi_bit / 8; i < num_spi_bytes; i++) {
+        if (data[i]) {
+            return 0;
+        }
+    }
+    *ret_reset_ns = (uint64_t)(num_spi_bytes - spi_bit / 8) * 8 * 1000000000 / spi_stub_get_clock_hz(device);
+    return num_bytes;
+}
+
+static void fill_random(uint8_t *frame, size_t size, uint32_t *seed)
+{
+    for (size_t i = 0; i < size; i++) {
+        frame[i] = test_rand(seed);
+    }
+}
+
+static void test_outputs_match(led_strip_chip_t chip, float gamma)
+{
+    const led_strip_chip_info_t *chip_info = led_strip_get_chip_info(chip);
+    size_t bytes_per_pixel = chip_info->bytes_per_pixel;
+    test_outputs_t outputs;
+    test_outputs_new(&outputs, chip, gamma);
+    spi_device_handle_t device = spi_stub_find_device(TEST_SPI_GPIO);
+    TEST_ASSERT(device);
+
+    uint32_t seed = 0x2545F491 + chip;
+    uint8_t frame[TEST_NUM_PIXELS * 4];
+    uint8_t rmt_bytes[TEST_NUM_PIXELS * 4];
+    uint8_t spi_bytes[TEST_NUM_PIXELS * 4];
+    for (size_t f = 0; f < TEST_NUM_FRAMES; f++) {
+        // whole frames and changed prefixes, down to a single pixel
+        size_t num_pixels = f < 2 ? TEST_NUM_PIXELS : 1 + test_rand(&seed) % TEST_NUM_PIXELS;
+        size_t num_bytes = num_pixels * bytes_per_pixel;
+        fill_random(frame, sizeof(frame), &seed);
+        size_t pixels_sent = 0;
+        TEST_ASSERT_EQUAL(ESP_OK, led_strip_output_transmit(outputs.rmt, frame, num_pixels, &pixels_sent));
+        TEST_ASSERT_EQUAL(num_pixels, pixels_sent);
+        TEST_ASSERT_EQUAL(ESP_OK, led_strip_output_transmit(outputs.spi, frame, num_pixels, &pixels_sent));
+        TEST_ASSERT_EQUAL(num_pixels, pixels_sent);
+        TEST_ASSERT_EQUAL(ESP_OK, led_strip_output_transmit(outputs.capture, frame, num_pixels, &pixels_sent));
+        TEST_ASSERT_EQUAL(num_pixels, pixels_sent);
+
+        TEST_ASSERT_EQUAL(num_bytes, decode_rmt(outputs.channel, f, chip, rmt_bytes));
+        size_t reset_ns = 0;
+        TEST_ASSERT_EQUAL(num_bytes, decode_spi(device, f, chip_info, spi_bytes, &reset_ns));
+        TEST_ASSERT_MESSAGE(memcmp(rmt_bytes, spi_bytes, num_bytes) == 0, "SPI bytes differ from RMT bytes");
+        TEST_ASSERT(reset_ns >= chip_info->reset_us * 1000);
+        // the capture output keeps the frame as given, before any gamma correction
+        size_t captured_pixels = 0;
+        const uint8_t *captured = led_strip_capture_output_get_frame(outputs.capture, f, &captured_pixels);
+        TEST_ASSERT(captured);
+        TEST_ASSERT_EQUAL(num_pixels, captured_pixels);
+        TEST_ASSERT(memcmp(captured, frame, num_bytes) == 0);
+        if (gamma == 0) {
+            TEST_ASSERT_MESSAGE(memcmp(rmt_bytes, frame, num_bytes) == 0, "linear output changed the bytes");
+        }
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, led_strip_output_wait_all_done(outputs.spi, 0));
+    TEST_ASSERT_EQUAL(ESP_OK, led_strip_output_wait_all_done(outputs.rmt, 0));
+    for (size_t i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL(TEST_NUM_FRAMES, outputs.frames_done[i]);
+    }
+    TEST_ASSERT_EQUAL(TEST_NUM_FRAMES, spi_stub_get_num_transactions(device));
+    test_outputs_del(&outputs);
+}
+
+static void test_outputs_match_every_chip(void)
+{
+    for (led_strip_chip_t chip = 0; chip < LED_STRIP_CHIP_MAX; chip++) {
+        int before = s_test_failures;
+        test_outputs_match(chip, 0);
+        test_outputs_match(chip, 2.2f);
+        if (s_test_failures != before) {
+            fprintf(stderr, "chip %d\n", chip);
+            return;
+        }
+    }
+}
+
+static void test_spi_output_timing(void)
+{
+    for (led_strip_chip_t chip = 0; chip < LED_STRIP_CHIP_MAX; chip++) {
+        const led_strip_chip_info_t *chip_info = led_strip_get_chip_info(chip);
+        led_strip_spi_output_config_t spi_config = {
+            .spi_host = SPI2_HOST,
+            .gpio_num = TEST_SPI_GPIO,
+            .num_pixels = 1,
+            .chip = chip,
+            .trans_queue_depth = 1,
+        };
+        led_strip_output_handle_t spi = NULL;
+        TEST_ASSERT_EQUAL(ESP_OK, led_strip_new_spi_output(&spi_config, &spi));
+        spi_device_handle_t device = spi_stub_find_device(TEST_SPI_GPIO);
+        double unit_ns = 1e9 / spi_stub_get_clock_hz(device);
+        // a 0 byte and a 0xFF byte, the pulses of each must match the chip's high times and bit period
+        const uint8_t pixels[2][4] = {{0}, {0xFF, 0xFF, 0xFF, 0xFF}};
+        for (int p = 0; p < 2; p++) {
+            size_t pixels_sent = 0;
+            TEST_ASSERT_EQUAL(ESP_OK, led_strip_output_transmit(spi, pixels[p], 1, &pixels_sent));
+            size_t num_spi_bytes = 0;
+            const uint8_t *data = spi_stub_get_transaction(device, p, &num_spi_bytes);
+            size_t high = 0;
+            while (data[high / 8] & (0x80 >> (high % 8))) {
+                high++;
+            }
+            double high_ns = high * unit_ns;
+            double expected_ns = p ? chip_info->t1h_ns : chip_info->t0h_ns;
+            TEST_ASSERT_MESSAGE(high_ns > expected_ns - 150 && high_ns < expected_ns + 150, "high time off");
+        }
+        size_t bits_per_bit = (size_t)((chip_info->t0h_ns + chip_info->t0l_ns) / unit_ns + 0.5);
+        TEST_ASSERT(bits_per_bit >= 3 && bits_per_bit <= 8);
+        double period_ns = bits_per_bit * unit_ns;
+        TEST_ASSERT(period_ns > chip_info->t0h_ns + chip_info->t0l_ns - 10 &&
+                    period_ns < chip_info->t0h_ns + chip_info->t0l_ns + 10);
+        TEST_ASSERT_EQUAL(ESP_OK, led_strip_del_output(spi));
+    }
+    // the bus is taken while an output owns it
+    led_strip_spi_output_config_t spi_config = {
+        .spi_host = SPI2_HOST,
+        .gpio_num = TEST_SPI_GPIO,
+        .num_pixels = 1,
+        .trans_queue_depth = 1,
+    };
+    led_strip_output_handle_t spi = NULL, other = NULL;
+    TEST_ASSERT_EQUAL(ESP_OK, led_strip_new_spi_output(&spi_config, &spi));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, led_strip_new_spi_output(&spi_config, &other));
+    TEST_ASSERT_EQUAL(ESP_OK, led_strip_del_output(spi));
+    spi_config.num_pixels = 0;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, led_strip_new_spi_output(&spi_config, &spi));
+}
+
+static void test_capture_output_drops_old_frames(void)
+{
+    led_strip_capture_output_config_t capture_config = {
+        .num_pixels = 4,
+        .max_frames = 3,
+    };
+    led_strip_output_handle_t capture = NULL;
+    TEST_ASSERT_EQUAL(ESP_OK, led_strip_new_capture_output(&capture_config, &capture));
+    uint8_t frame[4 * 3] = {0};
+    for (int f = 0; f < 5; f++) {
+        frame[0] = f;
+        size_t pixels_sent = 0;
+        TEST_ASSERT_EQUAL(ESP_OK, led_strip_output_transmit(capture, frame, 1 + f % 4, &pixels_sent));
+    }
+    TEST_ASSERT_EQUAL(5, led_strip_capture_output_get_num_frames(capture));
+    size_t num_pixels = 0;
+    TEST_ASSERT(!led_strip_capture_output_get_frame(capture, 1, &num_pixels));
+    TEST_ASSERT(!led_strip_capture_output_get_frame(capture, 5, &num_pixels));
+    for (int f = 2; f < 5; f++) {
+        const uint8_t *captured = led_strip_capture_output_get_frame(capture, f, &num_pixels);
+        TEST_ASSERT(captured);
+        TEST_ASSERT_EQUAL(f, captured[0]);
+        TEST_ASSERT_EQUAL(1 + f % 4, num_pixels);
+    }
+    // frames longer than the strip are refused
+    size_t pixels_sent = 0;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, led_strip_output_transmit(capture, frame, 5, &pixels_sent));
+    TEST_ASSERT_EQUAL(ESP_OK, led_strip_del_output(capture));
+}
+
+int main(int argc, char **argv)
+{
+    RUN_TEST(test_outputs_match_every_chip);
+    RUN_TEST(test_spi_output_timing);
+    RUN_TEST(test_capture_output_drops_old_frames);
+    return TEST_EXIT();
+}
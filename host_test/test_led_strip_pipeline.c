@@ -0,0 +1,322 @@
+/*
+ * Host test for the LED strip frame pipeline on the stub RMT TX channels.
+ *
+ * Frames must carry only the changed prefix of the strip, split across the channels' segments, and buffers must
+ * only be recycled once every channel has finished with them.
+ */
+#include <string.h>
+#include "test_common.h"
+#include "esp_timer.h"
+#include "rmt_stub.h"
+#include "led_strip_encoder.h"
+#include "led_strip_pipeline.h"
+#include "led_strip_decoder.h"
+
+#define TEST_NUM_PIXELS 10
+#define TEST_MAX_CHANNELS 4
+
+typedef struct {
+    rmt_channel_handle_t channels[TEST_MAX_CHANNELS];
+    rmt_encoder_handle_t encoders[TEST_MAX_CHANNELS];
+    size_t num_channels;
+    led_strip_output_handle_t output;
+    led_strip_pipeline_handle_t pipeline;
+} test_strip_t;
+
+static latency_histogram_t s_done_latency = LATENCY_HISTOGRAM_INIT("done");
+static led_strip_decoder_t s_decoder; // chip of the last strip created
+
+static void test_strip_new_strip(test_strip_t *strip, size_t num_channels, size_t num_pixels, led_strip_chip_t chip)
+{
+    memset(strip, 0, sizeof(*strip));
+    strip->num_channels = num_channels;
+    led_strip_decoder_init(&s_decoder, chip, 10000000);
+    led_strip_encoder_config_t encoder_config = {
+        .resolution = 10000000,
+        .chip = chip,
+    };
+    for (size_t i = 0; i < num_channels; i++) {
+        rmt_tx_channel_config_t tx_chan_config = {
+            .clk_src = RMT_CLK_SRC_DEFAULT,
+            .gpio_num = 10 + i,
+            .mem_block_symbols = 64,
+            .resolution_hz = 10000000,
+            .trans_queue_depth = 4,
+        };
+        ESP_ERROR_CHECK(rmt_new_tx_channel(&tx_chan_config, &strip->channels[i]));
+        ESP_ERROR_CHECK(rmt_new_led_strip_encoder(&encoder_config, &strip->encoders[i]));
+    }
+    led_strip_rmt_output_config_t output_config = {
+        .channels = strip->channels,
+        .encoders = strip->encoders,
+        .num_channels = num_channels,
+        .num_pixels = num_pixels,
+        .chip = chip,
+    };
+    ESP_ERROR_CHECK(led_strip_new_rmt_output(&output_config, &strip->output));
+    led_strip_pipeline_config_t pipeline_config = {
+        .output = strip->output,
+        .frame_size = num_pixels * led_strip_get_chip_info(chip)->bytes_per_pixel,
+        .num_buffers = 2,
+        .done_latency = &s_done_latency,
+    };
+    ESP_ERROR_CHECK(led_strip_pipeline_new(&pipeline_config, &strip->pipeline));
+}
+
+static void test_strip_new_chip(test_strip_t *strip, size_t num_channels, led_strip_chip_t chip)
+{
+    test_strip_new_strip(strip, num_channels, TEST_NUM_PIXELS, chip);
+}
+
+static void test_strip_new(test_strip_t *strip, size_t num_channels)
+{
+    test_strip_new_chip(strip, num_channels, LED_STRIP_CHIP_WS2812);
+}
+
+static void test_strip_del(test_strip_t *strip)
+{
+    ESP_ERROR_CHECK(led_strip_pipeline_del(strip->pipeline));
+    ESP_ERROR_CHECK(led_strip_del_output(strip->output));
+    for (size_t i = 0; i < strip->num_channels; i++) {
+        ESP_ERROR_CHECK(rmt_disable(strip->channels[i]));
+        ESP_ERROR_CHECK(rmt_del_channel(strip->channels[i]));
+        rmt_del_encoder(strip->encoders[i]);
+    }
+}
+
+// recover the pixel bytes of one transaction, returns the number of bytes it carried, 0 if its timing is off
+static size_t decode_transaction_bytes(rmt_channel_handle_t channel, size_t index, uint8_t *bytes)
+{
+    rmt_symbol_word_t symbols[TEST_NUM_PIXELS * 32 + 1];
+    size_t num_symbols = rmt_stub_copy_transaction(channel, index, symbols, sizeof(symbols) / sizeof(symbols[0]));
+    led_strip_decode_report_t report;
+    if (!led_strip_decode(&s_decoder, symbols, num_symbols, bytes, TEST_NUM_PIXELS * 4, &report)) {
+        return 0;
+    }
+    return report.num_bytes;
+}
+
+// same for 3 byte pixels, returns the number of pixels
+static size_t decode_transaction(rmt_channel_handle_t channel, size_t index, uint8_t *bytes)
+{
+    return decode_transaction_bytes(channel, index, bytes) / 3;
+}
+
+static void test_pipeline_sends_changed_prefix(void)
+{
+    test_strip_t strip;
+    test_strip_new(&strip, 1);
+    rmt_channel_handle_t channel = strip.channels[0];
+    // nothing can go out before the channel is enabled
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, led_strip_pipeline_present(strip.pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, led_strip_pipeline_enable(strip.pipeline));
+    TEST_ASSERT(!rmt_stub_is_synced(channel));
+
+    uint8_t bytes[TEST_NUM_PIXELS * 3];
+    // the first frame always covers the whole strip
+    TEST_ASSERT_EQUAL(ESP_OK, led_strip_pipeline_present(strip.pipeline));
+    TEST_ASSERT_EQUAL(1, rmt_stub_get_num_transactions(channel));
+    TEST_ASSERT_EQUAL(TEST_NUM_PIXELS, decode_transaction(channel, 0, bytes));
+
+    led_strip_pipeline_set_pixel(strip.pipeline, 3, 0x11, 0x22, 0x33);
+    TEST_ASSERT_EQUAL(ESP_OK, led_strip_pipeline_present(strip.pipeline));
+    TEST_ASSERT_EQUAL(2, rmt_stub_get_num_transactions(channel));
+    TEST_ASSERT_EQUAL(4, decode_transaction(channel, 1, bytes));
+    // GRB order
+    TEST_ASSERT_EQUAL(0x22, bytes[9]);
+    TEST_ASSERT_EQUAL(0x11, bytes[10]);
+    TEST_ASSERT_EQUAL(0x33, bytes[11]);
+
+    // unchanged frames, and a clear followed by the same redraw, send nothing
+    TEST_ASSERT_EQUAL(ESP_OK, led_strip_pipeline_present(strip.pipeline));
+    led_strip_pipeline_clear(strip.pipeline);
+    led_strip_pipeline_set_pixel(strip.pipeline, 3, 0x11, 0x22, 0x33);
+    TEST_ASSERT_EQUAL(ESP_OK, led_strip_pipeline_present(strip.pipeline));
+    TEST_ASSERT_EQUAL(2, rmt_stub_get_num_transactions(channel));
+
+    led_strip_pipeline_stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_OK, led_strip_pipeline_get_stats(strip.pipeline, &stats));
+    TEST_ASSERT_EQUAL(2, stats.frames_sent);
+    TEST_ASSERT_EQUAL(2, stats.frames_skipped);
+    TEST_ASSERT_EQUAL(TEST_NUM_PIXELS + 4, stats.pixels_sent);
+    test_strip_del(&strip);
+}
+
+static void test_pipeline_splits_segments(void)
+{
+    test_strip_t strip;
+    test_strip_new(&strip, 3);
+    TEST_ASSERT_EQUAL(ESP_OK, led_strip_pipeline_enable(strip.pipeline));
+    for (size_t i = 0; i < 3; i++) {
+        TEST_ASSERT(rmt_stub_is_synced(strip.channels[i]));
+    }
+    for (int i = 0; i < TEST_NUM_PIXELS; i++) {
+        led_strip_pipeline_set_pixel(strip.pipeline, i, i, 0, 0);
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, led_strip_pipeline_present(strip.pipeline));
+
+    // 10 pixels over 3 channels: 3 + 3 + 4
+    static const size_t full_segments[] = {3, 3, 4};
+    uint8_t bytes[TEST_NUM_PIXELS * 3];
+    for (size_t i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL(full_segments[i], decode_transaction(strip.channels[i], 0, bytes));
+        TEST_ASSERT_EQUAL(i * 3, bytes[1]);
+    }
+
+    // pixel 5 is the last one of the middle segment, the last segment still resends its first pixel
+    led_strip_pipeline_set_pixel(strip.pipeline, 5, 0xFF, 0, 0);
+    TEST_ASSERT_EQUAL(ESP_OK, led_strip_pipeline_present(strip.pipeline));
+    static const size_t prefix_segments[] = {3, 3, 1};
+    for (size_t i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL(2, rmt_stub_get_num_transactions(strip.channels[i]));
+        TEST_ASSERT_EQUAL(prefix_segments[i], decode_transaction(strip.channels[i], 1, bytes));
+    }
+    decode_transaction(strip.channels[1], 1, bytes);
+    TEST_ASSERT_EQUAL(0xFF, bytes[7]);
+    decode_transaction(strip.channels[2], 1, bytes);
+    TEST_ASSERT_EQUAL(6, bytes[1]);
+    test_strip_del(&strip);
+}
+
+// strips that do not divide evenly: every segment gets pixels, and only pixels of the frame go out
+static void test_pipeline_splits_uneven_strips(void)
+{
+    static const struct {
+        size_t num_pixels;
+        size_t num_channels;
+        size_t segments[TEST_MAX_CHANNELS];
+    } cases[] = {
+        {9, 4, {2, 2, 2, 3}},
+        {5, 4, {1, 1, 1, 2}},
+        {7, 3, {2, 2, 3}},
+        {4, 4, {1, 1, 1, 1}},
+    };
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        size_t num_pixels = cases[c].num_pixels;
+        test_strip_t strip;
+        test_strip_new_strip(&strip, cases[c].num_channels, num_pixels, LED_STRIP_CHIP_WS2812);
+        TEST_ASSERT_EQUAL(ESP_OK, led_strip_pipeline_enable(strip.pipeline));
+        for (size_t i = 0; i < num_pixels; i++) {
+            led_strip_pipeline_set_pixel(strip.pipeline, i, i + 1, 0, 0);
+        }
+        TEST_ASSERT_EQUAL(ESP_OK, led_strip_pipeline_present(strip.pipeline));
+        uint8_t bytes[TEST_NUM_PIXELS * 3];
+        size_t first_pixel = 0;
+        for (size_t i = 0; i < cases[c].num_channels; i++) {
+            size_t segment_pixels = decode_transaction(strip.channels[i], 0, bytes);
+            TEST_ASSERT_EQUAL(cases[c].segments[i], segment_pixels);
+            for (size_t j = 0; j < segment_pixels; j++) {
+                TEST_ASSERT_EQUAL(first_pixel + j + 1, bytes[j * 3 + 1]);
+            }
+            first_pixel += segment_pixels;
+        }
+        TEST_ASSERT_EQUAL(num_pixels, first_pixel);
+
+        // a change in the first pixel only, the other segments resend their own first pixel
+        led_strip_pipeline_set_pixel(strip.pipeline, 0, 0xFF, 0, 0);
+        TEST_ASSERT_EQUAL(ESP_OK, led_strip_pipeline_present(strip.pipeline));
+        first_pixel = 0;
+        for (size_t i = 0; i < cases[c].num_channels; i++) {
+            TEST_ASSERT_EQUAL(1, decode_transaction(strip.channels[i], 1, bytes));
+            TEST_ASSERT_EQUAL(i ? first_pixel + 1 : 0xFF, bytes[1]);
+            first_pixel += cases[c].segments[i];
+        }
+
+        // a prefix past the end of the strip is refused
+        size_t pixels_sent = 0;
+        uint8_t frame[(TEST_NUM_PIXELS + 1) * 3] = {0};
+        TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, led_strip_output_transmit(strip.output, frame, num_pixels + 1, &pixels_sent));
+        test_strip_del(&strip);
+    }
+
+    // more channels than pixels would leave a segment empty
+    rmt_channel_handle_t channels[4] = {(rmt_channel_handle_t)1, (rmt_channel_handle_t)1, (rmt_channel_handle_t)1,
+                                        (rmt_channel_handle_t)1};
+    rmt_encoder_handle_t encoders[4] = {(rmt_encoder_handle_t)1, (rmt_encoder_handle_t)1, (rmt_encoder_handle_t)1,
+                                        (rmt_encoder_handle_t)1};
+    led_strip_rmt_output_config_t output_config = {
+        .channels = channels,
+        .encoders = encoders,
+        .num_channels = 4,
+        .num_pixels = 3,
+    };
+    led_strip_output_handle_t output = NULL;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, led_strip_new_rmt_output(&output_config, &output));
+}
+
+static void test_pipeline_releases_after_all_channels(void)
+{
+    test_strip_t strip;
+    test_strip_new(&strip, 2);
+    TEST_ASSERT_EQUAL(ESP_OK, led_strip_pipeline_enable(strip.pipeline));
+    for (size_t i = 0; i < 2; i++) {
+        rmt_stub_set_manual_done(strip.channels[i], true);
+    }
+    latency_histogram_reset(&s_done_latency);
+
+    led_strip_pipeline_set_origin(strip.pipeline, (uint32_t)esp_timer_get_time());
+    TEST_ASSERT_EQUAL(ESP_OK, led_strip_pipeline_present(strip.pipeline));
+    TEST_ASSERT_EQUAL(1, rmt_stub_get_pending(strip.channels[0]));
+    TEST_ASSERT_EQUAL(1, rmt_stub_get_pending(strip.channels[1]));
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, led_strip_pipeline_wait_all_done(strip.pipeline, 0));
+
+    // the frame is only done once its last segment is
+    TEST_ASSERT_EQUAL(1, rmt_stub_complete(strip.channels[0], 1));
+    TEST_ASSERT_EQUAL(0, s_done_latency.count);
+    TEST_ASSERT_EQUAL(1, rmt_stub_complete(strip.channels[1], 1));
+    TEST_ASSERT_EQUAL(1, s_done_latency.count);
+
+    // frames without an origin record nothing
+    led_strip_pipeline_set_pixel(strip.pipeline, 0, 1, 2, 3);
+    TEST_ASSERT_EQUAL(ESP_OK, led_strip_pipeline_present(strip.pipeline));
+    TEST_ASSERT_EQUAL(1, rmt_stub_complete(strip.channels[1], 2));
+    TEST_ASSERT_EQUAL(1, rmt_stub_complete(strip.channels[0], 2));
+    TEST_ASSERT_EQUAL(1, s_done_latency.count);
+    TEST_ASSERT_EQUAL(ESP_OK, led_strip_pipeline_wait_all_done(strip.pipeline, 0));
+    test_strip_del(&strip);
+}
+
+static void test_pipeline_rgbw_pixels(void)
+{
+    test_strip_t strip;
+    test_strip_new_chip(&strip, 2, LED_STRIP_CHIP_SK6812_RGBW);
+    TEST_ASSERT_EQUAL(ESP_OK, led_strip_pipeline_enable(strip.pipeline));
+    TEST_ASSERT_EQUAL(ESP_OK, led_strip_pipeline_present(strip.pipeline));
+    uint8_t bytes[TEST_NUM_PIXELS * 4];
+    // 5 pixels of 4 bytes per segment
+    TEST_ASSERT_EQUAL(20, decode_transaction_bytes(strip.channels[0], 0, bytes));
+    TEST_ASSERT_EQUAL(20, decode_transaction_bytes(strip.channels[1], 0, bytes));
+
+    // GRBW order, white off, and the changed prefix counts 4 byte pixels
+    uint8_t *frame = led_strip_pipeline_get_frame(strip.pipeline);
+    frame[1 * 4 + 3] = 0x44;
+    TEST_ASSERT_EQUAL(ESP_OK, led_strip_pipeline_present(strip.pipeline));
+    led_strip_pipeline_set_pixel(strip.pipeline, 1, 0x11, 0x22, 0x33);
+    TEST_ASSERT_EQUAL(ESP_OK, led_strip_pipeline_present(strip.pipeline));
+    TEST_ASSERT_EQUAL(8, decode_transaction_bytes(strip.channels[0], 2, bytes));
+    TEST_ASSERT_EQUAL(0x22, bytes[4]);
+    TEST_ASSERT_EQUAL(0x11, bytes[5]);
+    TEST_ASSERT_EQUAL(0x33, bytes[6]);
+    TEST_ASSERT_EQUAL(0x00, bytes[7]);
+    TEST_ASSERT_EQUAL(4, decode_transaction_bytes(strip.channels[1], 2, bytes));
+
+    // the frame must hold whole pixels
+    led_strip_pipeline_config_t pipeline_config = {
+        .output = strip.output,
+        .frame_size = 30,
+        .num_buffers = 2,
+    };
+    led_strip_pipeline_handle_t pipeline = NULL;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, led_strip_pipeline_new(&pipeline_config, &pipeline));
+    test_strip_del(&strip);
+}
+
+int main(int argc, char **argv)
+{
+    RUN_TEST(test_pipeline_sends_changed_prefix);
+    RUN_TEST(test_pipeline_splits_segments);
+    RUN_TEST(test_pipeline_splits_uneven_strips);
+    RUN_TEST(test_pipeline_releases_after_all_channels);
+    RUN_TEST(test_pipeline_rgbw_pixels);
+    return TEST_EXIT();
+}
@@ -0,0 +1,164 @@
+/*
+ * Host test for the MIDI event ring.
+ *
+ * A producer thread pushes numbered batches while the consumer drains, every event must come out exactly once and
+ * in order, and whatever did not fit must show up in the drop counter.
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include "test_common.h"
+#include "midi_event_ring.h"
+
+static midi_event_t make_event(uint32_t seq)
+{
+    midi_event_t event = {
+        .timestamp_us = seq,
+        .type = MIDI_EVENT_NOTE_ON,
+        .channel = seq & 0x0F,
+        .note = (seq >> 4) & 0x7F,
+        .velocity = 1 + (seq % 127),
+    };
+    return event;
+}
+
+static void test_ring_push_pop_wraps(void)
+{
+    midi_event_ring_handle_t ring = NULL;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, midi_event_ring_new(12, &ring));
+    TEST_ASSERT_EQUAL(ESP_OK, midi_event_ring_new(8, &ring));
+    midi_event_t batch[5], out[8];
+    uint32_t seq_in = 0, seq_out = 0;
+    for (int round = 0; round < 10; round++) {
+        for (int i = 0; i < 5; i++) {
+            batch[i] = make_event(seq_in++);
+        }
+        TEST_ASSERT_EQUAL(5, midi_event_ring_push(ring, batch, 5));
+        size_t n = midi_event_ring_pop(ring, out, 8);
+        TEST_ASSERT_EQUAL(5, n);
+        for (size_t i = 0; i < n; i++) {
+            midi_event_t expected = make_event(seq_out++);
+            TEST_ASSERT(memcmp(&expected, &out[i], sizeof(expected)) == 0);
+        }
+    }
+    TEST_ASSERT_EQUAL(0, midi_event_ring_pop(ring, out, 8));
+    midi_event_ring_stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_OK, midi_event_ring_get_stats(ring, &stats));
+    TEST_ASSERT_EQUAL(50, stats.events_pushed);
+    TEST_ASSERT_EQUAL(0, stats.events_dropped);
+    TEST_ASSERT_EQUAL(5, stats.high_water);
+    midi_event_ring_del(ring);
+}
+
+static void test_ring_overflow_drops_newest(void)
+{
+    midi_event_ring_handle_t ring = NULL;
+    TEST_ASSERT_EQUAL(ESP_OK, midi_event_ring_new(4, &ring));
+    midi_event_t batch[6], out[4];
+    for (int i = 0; i < 6; i++) {
+        batch[i] = make_event(i);
+    }
+    TEST_ASSERT_EQUAL(4, midi_event_ring_push(ring, batch, 6));
+    TEST_ASSERT_EQUAL(0, midi_event_ring_push(ring, batch, 1));
+    TEST_ASSERT_EQUAL(2, midi_event_ring_pop(ring, out, 2));
+    TEST_ASSERT_EQUAL(0, out[0].timestamp_us);
+    TEST_ASSERT_EQUAL(1, out[1].timestamp_us);
+    TEST_ASSERT_EQUAL(2, midi_event_ring_push(ring, &batch[4], 2));
+    TEST_ASSERT_EQUAL(4, midi_event_ring_pop(ring, out, 4));
+    TEST_ASSERT_EQUAL(2, out[0].timestamp_us);
+    TEST_ASSERT_EQUAL(5, out[3].timestamp_us);
+    midi_event_ring_stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_OK, midi_event_ring_get_stats(ring, &stats));
+    TEST_ASSERT_EQUAL(6, stats.events_pushed);
+    TEST_ASSERT_EQUAL(3, stats.events_dropped);
+    TEST_ASSERT_EQUAL(4, stats.high_water);
+    midi_event_ring_del(ring);
+}
+
+#define STRESS_EVENTS 2000000
+
+typedef struct {
+    midi_event_ring_handle_t ring;
+    uint32_t dropped;   // events refused by the ring, over all push attempts
+    uint32_t abandoned; // events the producer gave up on
+    uint32_t produced;  // sequence numbers handed out
+} stress_ctx_t;
+
+static void *stress_producer(void *arg)
+{
+    stress_ctx_t *ctx = arg;
+    uint32_t seed = 7;
+    midi_event_t batch[16];
+    uint32_t seq = 0;
+    while (seq < STRESS_EVENTS) {
+        size_t n = 1 + test_rand(&seed) % 16;
+        for (size_t i = 0; i < n; i++) {
+            batch[i] = make_event(seq + i);
+        }
+        size_t pushed = 0;
+        while (1) {
+            size_t count = midi_event_ring_push(ctx->ring, &batch[pushed], n - pushed);
+            ctx->dropped += n - pushed - count;
+            pushed += count;
+            // mostly wait for room, sometimes give up on the tail of the batch like a lost USB packet
+            if (pushed == n || test_rand(&seed) % 8 == 0) {
+                break;
+            }
+            sched_yield();
+        }
+        ctx->abandoned += n - pushed;
+        seq += n;
+    }
+    ctx->produced = seq;
+    return NULL;
+}
+
+static void test_ring_threaded(void)
+{
+    stress_ctx_t ctx = {0};
+    TEST_ASSERT_EQUAL(ESP_OK, midi_event_ring_new(64, &ctx.ring));
+    pthread_t producer;
+    pthread_create(&producer, NULL, stress_producer, &ctx);
+    midi_event_t out[32];
+    uint32_t received = 0;
+    uint32_t last_seq = 0;
+    int ordered = 1;
+    int intact = 1;
+    int producer_done = 0;
+    while (1) {
+        size_t n = midi_event_ring_pop(ctx.ring, out, 32);
+        for (size_t i = 0; i < n; i++) {
+            midi_event_t expected = make_event(out[i].timestamp_us);
+            intact &= memcmp(&expected, &out[i], sizeof(expected)) == 0;
+            ordered &= received == 0 || out[i].timestamp_us > last_seq;
+            last_seq = out[i].timestamp_us;
+            received++;
+        }
+        if (!n) {
+            if (producer_done) {
+                break;
+            }
+            // one more pass after the producer finished picks up its last batch
+            producer_done = pthread_tryjoin_np(producer, NULL) == 0;
+            sched_yield();
+        }
+    }
+    midi_event_ring_stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_OK, midi_event_ring_get_stats(ctx.ring, &stats));
+    midi_event_ring_del(ctx.ring);
+    TEST_ASSERT_MESSAGE(intact, "event corrupted");
+    TEST_ASSERT_MESSAGE(ordered, "events out of order");
+    TEST_ASSERT_EQUAL(ctx.produced, received + ctx.abandoned);
+    TEST_ASSERT_EQUAL(received, stats.events_pushed);
+    TEST_ASSERT_EQUAL(ctx.dropped, stats.events_dropped);
+    printf("  %u events received, %u abandoned, %u drops counted, high water %u\n", received, ctx.abandoned,
+           ctx.dropped, stats.high_water);
+}
+
+int main(void)
+{
+    RUN_TEST(test_ring_push_pop_wraps);
+    RUN_TEST(test_ring_overflow_drops_newest);
+    RUN_TEST(test_ring_threaded);
+    return TEST_EXIT();
+}
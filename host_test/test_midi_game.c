@@ -0,0 +1,295 @@
+/*
+ * End to end host test of the MIDI LED game, app_main() running on the FreeRTOS, RMT and USB host stand-ins.
+ *
+ * The test plugs a USB-MIDI keyboard in, plays the melody with a few wrong notes and rebuilds the strip from the
+ * RMT transactions: every note must be shown in blue, answered in green when right and red when wrong while the key
+ * is held, and fade back once released. Unplugging and plugging the keyboard back in must keep the game going, and
+ * notes played faster than the feedback must all be judged against their own target. Every frame must pass the
+ * waveform decoder's timing checks.
+ *
+ * The LED output must be installed from the render core. Under a flood of MIDI events the frames must keep their
+ * rate; the test prints the jitter of the frame intervals and the load of both cores.
+ */
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "test_common.h"
+#include "freertos/FreeRTOS.h"
+#include "rmt_stub.h"
+#include "usb_host_stub.h"
+#include "led_strip_decoder.h"
+#include "keyboard_layout.h"
+#include "core_load.h"
+#include "class_driver.h"
+
+#define GAME_LED_GPIO       16
+#define GAME_RESOLUTION_HZ  10000000
+#define GAME_NUM_LEDS       KEYBOARD_NUM_LEDS // one LED per key in the host build
+#define GAME_LOWEST_NOTE    KEYBOARD_LOWEST_NOTE // LED 0
+#define MIDI_IN_EP          0x81
+#define WAIT_TIMEOUT_SEC    5.0
+#define FRAME_PERIOD_US     10000 // LED_FRAME_RATE_HZ of the game
+#define STRESS_SEC          1.0
+
+void app_main(void);
+
+// Config descriptor of a one port USB-MIDI keyboard: AudioControl interface, MIDIStreaming interface with a bulk
+// OUT and a bulk IN endpoint, each followed by its class specific descriptor
+static const uint8_t s_midi_config_desc[] = {
+    0x09, 0x02, 0x57, 0x00, 0x02, 0x01, 0x00, 0x80, 0x32,   // configuration, wTotalLength 87, 2 interfaces
+    0x09, 0x04, 0x00, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00,   // interface 0, Audio / AudioControl
+    0x09, 0x24, 0x01, 0x00, 0x01, 0x09, 0x00, 0x01, 0x01,   // CS AC header
+    0x09, 0x04, 0x01, 0x00, 0x02, 0x01, 0x03, 0x00, 0x00,   // interface 1, Audio / MIDIStreaming, 2 endpoints
+    0x07, 0x24, 0x01, 0x00, 0x01, 0x25, 0x00,               // CS MS header
+    0x06, 0x24, 0x02, 0x01, 0x01, 0x00,                     // MIDI IN jack, embedded
+    0x06, 0x24, 0x02, 0x02, 0x02, 0x00,                     // MIDI IN jack, external
+    0x09, 0x24, 0x03, 0x01, 0x03, 0x01, 0x02, 0x01, 0x00,   // MIDI OUT jack, embedded
+    0x09, 0x05, 0x01, 0x02, 0x40, 0x00, 0x00, 0x00, 0x00,   // endpoint 0x01, bulk OUT, MPS 64
+    0x05, 0x25, 0x01, 0x01, 0x01,                           // CS endpoint
+    0x09, 0x05, 0x81, 0x02, 0x40, 0x00, 0x00, 0x00, 0x00,   // endpoint 0x81, bulk IN, MPS 64
+};
+
+// Melody of the game, as MIDI notes
+static const uint8_t s_melody[] = {64, 62, 60, 62, 64, 64, 64, 62, 62, 62, 64, 67, 67};
+
+static rmt_channel_handle_t s_channel;
+static led_strip_decoder_t s_decoder;
+static size_t s_next_transaction;
+static size_t s_bad_transactions;          // waveforms the decoder rejected, they are not applied
+static uint8_t s_strip[GAME_NUM_LEDS * 3]; // GRB, what the physical strip shows
+
+// Apply the transactions sent since the last call, each one rewrites a prefix of the strip
+static void strip_update(void)
+{
+    static rmt_symbol_word_t symbols[GAME_NUM_LEDS * 24 + 1];
+    static uint8_t bytes[GAME_NUM_LEDS * 3];
+    size_t num_transactions = rmt_stub_get_num_transactions(s_channel);
+    for (; s_next_transaction < num_transactions; s_next_transaction++) {
+        size_t num_symbols = rmt_stub_copy_transaction(s_channel, s_next_transaction, symbols,
+                                                       sizeof(symbols) / sizeof(symbols[0]));
+        led_strip_decode_report_t report;
+        if (!led_strip_decode(&s_decoder, symbols, num_symbols, bytes, sizeof(bytes), &report)) {
+            fprintf(stderr, "transaction %zu: %zu bad bits, reset %llu ns\n", s_next_transaction, report.bad_bits,
+                    (unsigned long long)report.reset_ns);
+            s_bad_transactions++;
+            continue;
+        }
+        memcpy(s_strip, bytes, report.num_bytes < sizeof(s_strip) ? report.num_bytes : sizeof(s_strip));
+    }
+}
+
+// Whether the strip shows exactly the given pixels lit, the encoder's gamma keeps 0 and 255 as they are
+static bool strip_shows(int led_a, uint8_t r_a, uint8_t g_a, uint8_t b_a, int led_b, uint8_t r_b, uint8_t g_b, uint8_t b_b)
+{
+    for (int i = 0; i < GAME_NUM_LEDS; i++) {
+        uint8_t expected[3] = {0, 0, 0};
+        if (i == led_a) {
+            expected[0] = g_a;
+            expected[1] = r_a;
+            expected[2] = b_a;
+        }
+        if (i == led_b) {
+            expected[0] = g_b;
+            expected[1] = r_b;
+            expected[2] = b_b;
+        }
+        if (memcmp(&s_strip[i * 3], expected, 3) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#define WAIT_FOR(cond) do {                                                             \
+        double deadline_ = test_now_sec() + WAIT_TIMEOUT_SEC;                           \
+        while (strip_update(), !(cond) && test_now_sec() < deadline_) {                 \
+            usleep(200);                                                                \
+        }                                                                               \
+        TEST_ASSERT_MESSAGE(cond, "timed out");                                         \
+    } while (0)
+
+static esp_err_t send_packets(uint8_t dev_addr, const uint8_t *packets, size_t size)
+{
+    double deadline = test_now_sec() + WAIT_TIMEOUT_SEC;
+    esp_err_t err;
+    // no queued transfer is a NAK, a real keyboard would simply send again
+    while ((err = usb_stub_send_in(dev_addr, MIDI_IN_EP, packets, size)) == ESP_ERR_INVALID_STATE &&
+            test_now_sec() < deadline) {
+        usleep(200);
+    }
+    return err;
+}
+
+// full velocity, the feedback color is then exact
+static esp_err_t press_key(uint8_t dev_addr, uint8_t note)
+{
+    const uint8_t packet[4] = {0x09, 0x90, note, 127}; // cable 0, Note On, channel 1
+    return send_packets(dev_addr, packet, sizeof(packet));
+}
+
+static esp_err_t release_key(uint8_t dev_addr, uint8_t note)
+{
+    const uint8_t packet[4] = {0x08, 0x80, note, 64}; // cable 0, Note Off, channel 1
+    return send_packets(dev_addr, packet, sizeof(packet));
+}
+
+static void test_game_starts(void)
+{
+    // 500 ms of feedback become 5 ms
+    freertos_stub_tick_us = 100;
+    app_main();
+    s_channel = rmt_stub_find_channel(GAME_LED_GPIO);
+    TEST_ASSERT(s_channel);
+    // refills and frame done callbacks come on the render core, away from the USB host
+    TEST_ASSERT_EQUAL(CONFIG_APP_RENDER_CORE, rmt_stub_get_intr_core(s_channel));
+    TEST_ASSERT(led_strip_decoder_init(&s_decoder, LED_STRIP_CHIP_WS2812, GAME_RESOLUTION_HZ));
+    // first target, before any keyboard is there
+    WAIT_FOR(strip_shows(s_melody[0] - GAME_LOWEST_NOTE, 0, 0, 255, -1, 0, 0, 0));
+}
+
+static void test_game_plays_melody(void)
+{
+    TEST_ASSERT_EQUAL(ESP_OK, usb_stub_attach(1, s_midi_config_desc, sizeof(s_midi_config_desc)));
+    WAIT_FOR(usb_stub_get_num_queued(1, MIDI_IN_EP) == CONFIG_CLASS_DRIVER_MIDI_IN_TRANSFERS);
+    for (size_t n = 0; n < sizeof(s_melody); n++) {
+        int target = s_melody[n] - GAME_LOWEST_NOTE;
+        WAIT_FOR(strip_shows(target, 0, 0, 255, -1, 0, 0, 0));
+        if (n % 4 == 2) {
+            // a wrong note is shown in red next to the target
+            int wrong = target + 1;
+            TEST_ASSERT_EQUAL(ESP_OK, press_key(1, s_melody[n] + 1));
+            WAIT_FOR(strip_shows(target, 0, 0, 255, wrong, 255, 0, 0));
+            TEST_ASSERT_EQUAL(ESP_OK, release_key(1, s_melody[n] + 1));
+            WAIT_FOR(strip_shows(target, 0, 0, 255, -1, 0, 0, 0));
+        }
+        // the game moves on while the key is still held, the next target may show up next to it
+        int next = s_melody[(n + 1) % sizeof(s_melody)] - GAME_LOWEST_NOTE;
+        TEST_ASSERT_EQUAL(ESP_OK, press_key(1, s_melody[n]));
+        WAIT_FOR(strip_shows(target, 0, 255, 0, next == target ? -1 : next, 0, 0, 255));
+        TEST_ASSERT_EQUAL(ESP_OK, release_key(1, s_melody[n]));
+    }
+    // the melody starts over
+    WAIT_FOR(strip_shows(s_melody[0] - GAME_LOWEST_NOTE, 0, 0, 255, -1, 0, 0, 0));
+}
+
+static void test_game_survives_replug(void)
+{
+    // every transfer is resubmitted as soon as it completes, the queue never went below one short of the pool
+    class_driver_stats_t stats;
+    class_driver_get_stats(&stats);
+    uint32_t outstanding_min = stats.transfers_outstanding_min;
+    TEST_ASSERT_EQUAL(CONFIG_CLASS_DRIVER_MIDI_IN_TRANSFERS - 1, outstanding_min);
+    TEST_ASSERT_EQUAL(ESP_OK, usb_stub_detach(1));
+    // the class driver must release and close the old device before the library can free it
+    TEST_ASSERT_EQUAL(ESP_OK, usb_stub_attach(2, s_midi_config_desc, sizeof(s_midi_config_desc)));
+    WAIT_FOR(usb_stub_get_num_queued(2, MIDI_IN_EP) == CONFIG_CLASS_DRIVER_MIDI_IN_TRANSFERS);
+    // the transfers cancelled by the unplug do not count as the endpoint running dry
+    class_driver_get_stats(&stats);
+    TEST_ASSERT_EQUAL(outstanding_min, stats.transfers_outstanding_min);
+    TEST_ASSERT_EQUAL(ESP_OK, press_key(2, s_melody[0]));
+    WAIT_FOR(strip_shows(s_melody[0] - GAME_LOWEST_NOTE, 0, 255, 0, s_melody[1] - GAME_LOWEST_NOTE, 0, 0, 255));
+    TEST_ASSERT_EQUAL(ESP_OK, release_key(2, s_melody[0]));
+    WAIT_FOR(strip_shows(s_melody[1] - GAME_LOWEST_NOTE, 0, 0, 255, -1, 0, 0, 0));
+}
+
+static void test_game_keeps_up_with_fast_player(void)
+{
+    // the rest of the melody as fast as the keyboard sends it, with a wrong note in between, without waiting for
+    // any feedback: every note is judged against its own target and the game wraps around
+    for (size_t n = 1; n < sizeof(s_melody); n++) {
+        if (n == 5) {
+            TEST_ASSERT_EQUAL(ESP_OK, press_key(2, s_melody[n] - 1));
+            TEST_ASSERT_EQUAL(ESP_OK, release_key(2, s_melody[n] - 1));
+        }
+        TEST_ASSERT_EQUAL(ESP_OK, press_key(2, s_melody[n]));
+        TEST_ASSERT_EQUAL(ESP_OK, release_key(2, s_melody[n]));
+    }
+    WAIT_FOR(strip_shows(s_melody[0] - GAME_LOWEST_NOTE, 0, 0, 255, -1, 0, 0, 0));
+}
+
+static void test_game_under_stress(void)
+{
+    // full bulk packets of random Note On and Off pairs, as fast as the class driver takes them: every key fades
+    // all the time, so every frame slot has a frame to send
+    core_load_snapshot_t load_from, load_to;
+    TEST_ASSERT_EQUAL(ESP_OK, core_load_take_snapshot(&load_from));
+    size_t first_transaction = rmt_stub_get_num_transactions(s_channel);
+    uint32_t seed = 0x5EED;
+    size_t num_events = 0;
+    double start = test_now_sec();
+    while (test_now_sec() - start < STRESS_SEC) {
+        uint8_t packets[64];
+        for (size_t i = 0; i < sizeof(packets); i += 8) {
+            uint8_t note = GAME_LOWEST_NOTE + test_rand(&seed) % KEYBOARD_NUM_KEYS;
+            const uint8_t pair[8] = {0x09, 0x90, note, 1 + test_rand(&seed) % 127, 0x08, 0x80, note, 64};
+            memcpy(&packets[i], pair, sizeof(pair));
+        }
+        TEST_ASSERT_EQUAL(ESP_OK, send_packets(2, packets, sizeof(packets)));
+        num_events += sizeof(packets) / 4;
+    }
+    double elapsed = test_now_sec() - start;
+    TEST_ASSERT_EQUAL(ESP_OK, core_load_take_snapshot(&load_to));
+    size_t last_transaction = rmt_stub_get_num_transactions(s_channel);
+
+    // jitter of the frame intervals against the frame period
+    size_t num_intervals = 0;
+    uint64_t jitter_sum_us = 0;
+    uint32_t jitter_max_us = 0;
+    for (size_t i = first_transaction + 1; i < last_transaction; i++) {
+        int64_t interval_us = rmt_stub_get_transaction_time(s_channel, i) - rmt_stub_get_transaction_time(s_channel, i - 1);
+        uint32_t jitter_us = llabs(interval_us - FRAME_PERIOD_US);
+        jitter_sum_us += jitter_us;
+        if (jitter_us > jitter_max_us) {
+            jitter_max_us = jitter_us;
+        }
+        num_intervals++;
+    }
+    uint32_t load_usb = core_load_get_permille(&load_from, &load_to, CONFIG_APP_USB_CORE);
+    uint32_t load_render = core_load_get_permille(&load_from, &load_to, CONFIG_APP_RENDER_CORE);
+    printf("stress: %zu MIDI events in %.2f s, %zu frames, jitter %llu us mean / %"PRIu32" us max, "
+           "load USB core %d: %"PRIu32".%"PRIu32"%%, render core %d: %"PRIu32".%"PRIu32"%%\n",
+           num_events, elapsed, last_transaction - first_transaction,
+           (unsigned long long)(num_intervals ? jitter_sum_us / num_intervals : 0), jitter_max_us,
+           CONFIG_APP_USB_CORE, load_usb / 10, load_usb % 10, CONFIG_APP_RENDER_CORE, load_render / 10, load_render % 10);
+    // the MIDI flood must not starve the frames, loose bounds for a loaded host
+    TEST_ASSERT(num_events > 1000);
+    TEST_ASSERT((last_transaction - first_transaction) * FRAME_PERIOD_US >= elapsed * 1e6 / 2);
+}
+
+static void test_game_survives_unplug_with_queued_transfers(void)
+{
+    // the library may report the unplug before the transfers, the class driver has to cancel them itself before it
+    // can release the interface and close the device
+    TEST_ASSERT_EQUAL(ESP_OK, usb_stub_detach_late(2));
+    TEST_ASSERT_EQUAL(ESP_OK, usb_stub_attach(3, s_midi_config_desc, sizeof(s_midi_config_desc)));
+    WAIT_FOR(usb_stub_get_num_queued(3, MIDI_IN_EP) == CONFIG_CLASS_DRIVER_MIDI_IN_TRANSFERS);
+    // the flushed transfers were not resubmitted and do not count as the endpoint running dry
+    class_driver_stats_t stats;
+    class_driver_get_stats(&stats);
+    TEST_ASSERT_EQUAL(CONFIG_CLASS_DRIVER_MIDI_IN_TRANSFERS - 1, stats.transfers_outstanding_min);
+    TEST_ASSERT_EQUAL(ESP_OK, press_key(3, s_melody[0]));
+    TEST_ASSERT_EQUAL(ESP_OK, release_key(3, s_melody[0]));
+    WAIT_FOR(usb_stub_get_num_queued(3, MIDI_IN_EP) == CONFIG_CLASS_DRIVER_MIDI_IN_TRANSFERS);
+}
+
+static void test_game_waveforms_in_tolerance(void)
+{
+    // every frame of the whole game went out with WS2812 timing and a full reset gap
+    strip_update();
+    TEST_ASSERT(s_next_transaction > 0);
+    TEST_ASSERT_EQUAL(0, s_bad_transactions);
+}
+
+int main(int argc, char **argv)
+{
+    RUN_TEST(test_game_starts);
+    RUN_TEST(test_game_plays_melody);
+    RUN_TEST(test_game_survives_replug);
+    RUN_TEST(test_game_keeps_up_with_fast_player);
+    RUN_TEST(test_game_under_stress);
+    RUN_TEST(test_game_survives_unplug_with_queued_transfers);
+    RUN_TEST(test_game_waveforms_in_tolerance);
+    // the game tasks never return, leave them behind
+    return TEST_EXIT();
+}
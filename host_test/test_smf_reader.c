@@ -0,0 +1,269 @@
+/*
+ * Host test for the streaming Standard MIDI File reader.
+ *
+ * Files are built byte by byte: tracks must be merged in song order with tempo changes applied, everything but
+ * channel voice events skipped, and malformed data rejected without reading past the buffer.
+ */
+#include <string.h>
+#include "test_common.h"
+#include "smf_reader.h"
+
+static uint8_t s_file[2048];
+static size_t s_size;
+static size_t s_track_start;
+
+static void put(const uint8_t *bytes, size_t num_bytes)
+{
+    memcpy(s_file + s_size, bytes, num_bytes);
+    s_size += num_bytes;
+}
+
+#define PUT(...) put((const uint8_t[]){__VA_ARGS__}, sizeof((const uint8_t[]){__VA_ARGS__}))
+
+static void file_begin(uint16_t format, uint16_t num_tracks, uint16_t division)
+{
+    s_size = 0;
+    PUT('M', 'T', 'h', 'd', 0, 0, 0, 6, 0, format, num_tracks >> 8, num_tracks & 0xFF, division >> 8, division & 0xFF);
+}
+
+static void track_begin(void)
+{
+    PUT('M', 'T', 'r', 'k', 0, 0, 0, 0);
+    s_track_start = s_size;
+}
+
+static void track_end(void)
+{
+    PUT(0x00, 0xFF, 0x2F, 0x00);
+    size_t len = s_size - s_track_start;
+    s_file[s_track_start - 2] = len >> 8;
+    s_file[s_track_start - 1] = len & 0xFF;
+}
+
+static void test_smf_format0_running_status(void)
+{
+    file_begin(0, 1, 96);
+    track_begin();
+    PUT(0x00, 0xFF, 0x03, 0x04, 'S', 'o', 'n', 'g');  // sequence name
+    PUT(0x00, 0xFF, 0x51, 0x03, 0x09, 0x27, 0xC0);    // 600000 us per quarter
+    PUT(0x00, 0x90, 0x40, 0x64);                      // E4 on
+    PUT(0x30, 0x40, 0x00);                            // E4 off, running status, an eighth later
+    PUT(0x81, 0x00, 0x3E, 0x7F);                      // D4 on, 128 ticks later (two byte delta)
+    PUT(0x10, 0xC3, 0x05);                            // program change, channel 4
+    PUT(0x00, 0x83, 0x3E, 0x40);                      // D4 off, channel 4
+    track_end();
+
+    smf_reader_t reader;
+    midi_event_t event;
+    TEST_ASSERT_EQUAL(ESP_OK, smf_reader_open(&reader, s_file, s_size));
+    TEST_ASSERT_EQUAL(4, reader.name_len);
+    TEST_ASSERT(memcmp(reader.name, "Song", 4) == 0);
+
+    TEST_ASSERT_EQUAL(ESP_OK, smf_reader_next(&reader, &event));
+    TEST_ASSERT_EQUAL(MIDI_EVENT_NOTE_ON, event.type);
+    TEST_ASSERT_EQUAL(0x40, event.note);
+    TEST_ASSERT_EQUAL(0x64, event.velocity);
+    TEST_ASSERT_EQUAL(0, event.timestamp_us);
+    TEST_ASSERT_EQUAL(ESP_OK, smf_reader_next(&reader, &event));
+    TEST_ASSERT_EQUAL(MIDI_EVENT_NOTE_OFF, event.type);
+    TEST_ASSERT_EQUAL(300000, event.timestamp_us);
+    TEST_ASSERT_EQUAL(ESP_OK, smf_reader_next(&reader, &event));
+    TEST_ASSERT_EQUAL(MIDI_EVENT_NOTE_ON, event.type);
+    TEST_ASSERT_EQUAL(0x3E, event.note);
+    TEST_ASSERT_EQUAL(1100000, event.timestamp_us);
+    TEST_ASSERT_EQUAL(ESP_OK, smf_reader_next(&reader, &event));
+    TEST_ASSERT_EQUAL(MIDI_EVENT_PROGRAM_CHANGE, event.type);
+    TEST_ASSERT_EQUAL(3, event.channel);
+    TEST_ASSERT_EQUAL(5, event.note);
+    TEST_ASSERT_EQUAL(ESP_OK, smf_reader_next(&reader, &event));
+    TEST_ASSERT_EQUAL(MIDI_EVENT_NOTE_OFF, event.type);
+    TEST_ASSERT_EQUAL(3, event.channel);
+    TEST_ASSERT_EQUAL(0x40, event.velocity);
+    TEST_ASSERT_EQUAL(1200000, event.timestamp_us);
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, smf_reader_next(&reader, &event));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, smf_reader_next(&reader, &event));
+}
+
+static void test_smf_format1_merges_tracks(void)
+{
+    file_begin(1, 3, 100);
+    // tempo map: 500000 us per quarter, 250000 from tick 100 on
+    track_begin();
+    PUT(0x64, 0xFF, 0x51, 0x03, 0x03, 0xD0, 0x90);
+    track_end();
+    // an unknown chunk between the tracks is skipped
+    PUT('X', 'Y', 'Z', 'W', 0, 0, 0, 2, 0xAA, 0xBB);
+    track_begin();
+    PUT(0x00, 0x90, 0x30, 0x40);
+    PUT(0x64, 0x90, 0x31, 0x40);       // tick 100
+    PUT(0x64, 0xF0, 0x02, 0x7E, 0xF7); // SysEx at tick 200, skipped
+    PUT(0x00, 0x90, 0x32, 0x40);       // tick 200
+    track_end();
+    track_begin();
+    PUT(0x64, 0x91, 0x40, 0x40);       // tick 100, after track 1 at the same tick
+    track_end();
+
+    smf_reader_t reader;
+    midi_event_t event;
+    TEST_ASSERT_EQUAL(ESP_OK, smf_reader_open(&reader, s_file, s_size));
+    TEST_ASSERT_EQUAL(3, reader.num_tracks);
+    TEST_ASSERT(!reader.name);
+    static const struct {
+        uint8_t device;
+        uint8_t note;
+        uint32_t time_us;
+    } expected[] = {
+        {1, 0x30, 0}, {1, 0x31, 500000}, {2, 0x40, 500000}, {1, 0x32, 750000},
+    };
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, smf_reader_next(&reader, &event));
+        TEST_ASSERT_EQUAL(expected[i].device, event.device);
+        TEST_ASSERT_EQUAL(expected[i].note, event.note);
+        TEST_ASSERT_EQUAL(expected[i].time_us, event.timestamp_us);
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, smf_reader_next(&reader, &event));
+}
+
+static void test_smf_smpte_ignores_tempo(void)
+{
+    file_begin(0, 1, 0xE728); // 25 fps, 40 ticks per frame: 1 ms per tick
+    track_begin();
+    PUT(0x00, 0xFF, 0x51, 0x03, 0x01, 0x00, 0x00);
+    PUT(0x83, 0x60, 0x90, 0x3C, 0x40); // tick 480
+    track_end();
+    smf_reader_t reader;
+    midi_event_t event;
+    TEST_ASSERT_EQUAL(ESP_OK, smf_reader_open(&reader, s_file, s_size));
+    TEST_ASSERT_EQUAL(ESP_OK, smf_reader_next(&reader, &event));
+    TEST_ASSERT_EQUAL(480000, event.timestamp_us);
+}
+
+static void test_smf_rejects_malformed(void)
+{
+    smf_reader_t reader;
+    midi_event_t event;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, smf_reader_open(&reader, (const uint8_t *)"RIFF0000000000", 14));
+    file_begin(2, 1, 96);
+    track_begin();
+    track_end();
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, smf_reader_open(&reader, s_file, s_size));
+
+    // the track chunk claims more than there is
+    file_begin(0, 1, 96);
+    track_begin();
+    PUT(0x00, 0x90, 0x3C, 0x40);
+    track_end();
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, smf_reader_open(&reader, s_file, s_size - 1));
+    TEST_ASSERT_EQUAL(0, smf_file_size(s_file, s_size - 1));
+
+    // an event cut by the end of its track
+    file_begin(0, 1, 96);
+    track_begin();
+    PUT(0x00, 0x90, 0x3C);
+    s_file[s_track_start - 1] = s_size - s_track_start;
+    TEST_ASSERT_EQUAL(ESP_OK, smf_reader_open(&reader, s_file, s_size));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, smf_reader_next(&reader, &event));
+
+    // a data byte with no running status to apply
+    file_begin(0, 1, 96);
+    track_begin();
+    PUT(0x00, 0x3C, 0x40);
+    track_end();
+    TEST_ASSERT_EQUAL(ESP_OK, smf_reader_open(&reader, s_file, s_size));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_RESPONSE, smf_reader_next(&reader, &event));
+}
+
+static void test_smf_general_midi_layout(void)
+{
+    // a conductor track and one track per MIDI channel, as most sequencers export
+    file_begin(1, 17, 96);
+    track_begin();
+    PUT(0x00, 0xFF, 0x51, 0x03, 0x07, 0xA1, 0x20);    // 500000 us per quarter
+    track_end();
+    for (int channel = 0; channel < 16; channel++) {
+        track_begin();
+        PUT(channel, 0x90 | channel, 0x30 + channel, 0x40);
+        track_end();
+    }
+    smf_reader_t reader;
+    midi_event_t event;
+    TEST_ASSERT_EQUAL(ESP_OK, smf_reader_open(&reader, s_file, s_size));
+    TEST_ASSERT_EQUAL(17, reader.num_tracks);
+    for (int channel = 0; channel < 16; channel++) {
+        TEST_ASSERT_EQUAL(ESP_OK, smf_reader_next(&reader, &event));
+        TEST_ASSERT_EQUAL(channel + 1, event.device);
+        TEST_ASSERT_EQUAL(channel, event.channel);
+        TEST_ASSERT_EQUAL(0x30 + channel, event.note);
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, smf_reader_next(&reader, &event));
+}
+
+static void test_smf_skips_tracks_past_the_limit(void)
+{
+    // every other track has no notes, they go first, then the tracks with notes that do not fit
+    const int num_tracks = 2 * SMF_READER_MAX_TRACKS;
+    file_begin(1, num_tracks, 96);
+    for (int i = 0; i < num_tracks; i++) {
+        track_begin();
+        if (i % 2) {
+            PUT(0x00, 0x90, i, 0x40);
+        } else {
+            PUT(0x00, 0xB0, 0x07, 0x64, 0x00, 0x90, 0x3C, 0x00); // volume, and a note on that is a note off
+        }
+        track_end();
+    }
+    smf_reader_t reader;
+    midi_event_t event;
+    TEST_ASSERT_EQUAL(ESP_OK, smf_reader_open(&reader, s_file, s_size));
+    TEST_ASSERT_EQUAL(SMF_READER_MAX_TRACKS, reader.num_tracks);
+    // the first track is kept for its tempo map, then the first tracks with notes
+    TEST_ASSERT_EQUAL(ESP_OK, smf_reader_next(&reader, &event));
+    TEST_ASSERT_EQUAL(MIDI_EVENT_CONTROL_CHANGE, event.type);
+    TEST_ASSERT_EQUAL(ESP_OK, smf_reader_next(&reader, &event));
+    TEST_ASSERT_EQUAL(MIDI_EVENT_NOTE_OFF, event.type);
+    for (int i = 1; i < SMF_READER_MAX_TRACKS; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, smf_reader_next(&reader, &event));
+        TEST_ASSERT_EQUAL(MIDI_EVENT_NOTE_ON, event.type);
+        TEST_ASSERT_EQUAL(2 * i - 1, event.note);
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, smf_reader_next(&reader, &event));
+}
+
+static void test_smf_file_size_walks_concatenated_files(void)
+{
+    static uint8_t library[sizeof(s_file) * 2];
+    size_t library_size = 0;
+    file_begin(0, 1, 96);
+    track_begin();
+    PUT(0x00, 0x90, 0x3C, 0x40);
+    track_end();
+    memcpy(library, s_file, s_size);
+    library_size += s_size;
+    size_t first_size = s_size;
+    file_begin(1, 2, 96);
+    track_begin();
+    track_end();
+    track_begin();
+    PUT(0x00, 0x90, 0x3D, 0x40);
+    track_end();
+    memcpy(library + library_size, s_file, s_size);
+    library_size += s_size;
+    memset(library + library_size, 0xFF, 64); // erased flash
+    library_size += 64;
+
+    TEST_ASSERT_EQUAL(first_size, smf_file_size(library, library_size));
+    TEST_ASSERT_EQUAL(s_size, smf_file_size(library + first_size, library_size - first_size));
+    TEST_ASSERT_EQUAL(0, smf_file_size(library + first_size + s_size, 64));
+}
+
+int main(int argc, char **argv)
+{
+    RUN_TEST(test_smf_format0_running_status);
+    RUN_TEST(test_smf_format1_merges_tracks);
+    RUN_TEST(test_smf_smpte_ignores_tempo);
+    RUN_TEST(test_smf_rejects_malformed);
+    RUN_TEST(test_smf_general_midi_layout);
+    RUN_TEST(test_smf_skips_tracks_past_the_limit);
+    RUN_TEST(test_smf_file_size_walks_concatenated_files);
+    return TEST_EXIT();
+}
@@ -0,0 +1,112 @@
+/*
+ * Host test for the song library on the stub flash partitions.
+ *
+ * Songs stored back to back in a partition must be found in place, in any order, and a missing or empty partition
+ * must fall back to the built-in song.
+ */
+#include <string.h>
+#include "test_common.h"
+#include "esp_partition_stub.h"
+#include "song_library.h"
+
+#define TEST_NUM_SONGS 200
+
+static uint8_t s_partition[64 * 1024];
+
+// a format 0 song of a single note, the song number encoded in the note and the velocity
+static size_t put_song(uint8_t *data, int number)
+{
+    static const uint8_t header[] = {'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 0, 0, 1, 0, 96, 'M', 'T', 'r', 'k', 0, 0, 0, 8};
+    memcpy(data, header, sizeof(header));
+    const uint8_t track[] = {0x00, 0x90, number % 128, 1 + number / 128, 0x00, 0xFF, 0x2F, 0x00};
+    memcpy(data + sizeof(header), track, sizeof(track));
+    return sizeof(header) + sizeof(track);
+}
+
+static int read_song_number(song_library_handle_t library, size_t index)
+{
+    smf_reader_t reader;
+    midi_event_t event;
+    if (song_library_open_song(library, index, &reader) != ESP_OK || smf_reader_next(&reader, &event) != ESP_OK) {
+        return -1;
+    }
+    return event.note + (event.velocity - 1) * 128;
+}
+
+static void test_library_falls_back_to_builtin_song(void)
+{
+    song_library_handle_t library = NULL;
+    esp_partition_stub_clear();
+    TEST_ASSERT_EQUAL(ESP_OK, song_library_open(NULL, &library));
+    TEST_ASSERT_EQUAL(1, song_library_get_count(library));
+    smf_reader_t reader;
+    TEST_ASSERT_EQUAL(ESP_OK, song_library_open_song(library, 0, &reader));
+    TEST_ASSERT(reader.name && memcmp(reader.name, "Mary Had a Little Lamb", reader.name_len) == 0);
+    // the melody of the game, one note on each
+    static const uint8_t melody[] = {64, 62, 60, 62, 64, 64, 64, 62, 62, 62, 64, 67, 67};
+    midi_event_t event;
+    size_t num_notes = 0;
+    while (smf_reader_next(&reader, &event) == ESP_OK) {
+        if (event.type == MIDI_EVENT_NOTE_ON) {
+            TEST_ASSERT(num_notes < sizeof(melody));
+            TEST_ASSERT_EQUAL(melody[num_notes], event.note);
+            num_notes++;
+        }
+    }
+    TEST_ASSERT_EQUAL(sizeof(melody), num_notes);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, song_library_open_song(library, 1, &reader));
+    TEST_ASSERT_EQUAL(ESP_OK, song_library_close(library));
+
+    // an erased partition is no better
+    memset(s_partition, 0xFF, sizeof(s_partition));
+    esp_partition_stub_add(ESP_PARTITION_TYPE_DATA, SONG_LIBRARY_PARTITION_SUBTYPE, "songs", s_partition,
+                           sizeof(s_partition));
+    TEST_ASSERT_EQUAL(ESP_OK, song_library_open("songs", &library));
+    TEST_ASSERT_EQUAL(1, song_library_get_count(library));
+    TEST_ASSERT_EQUAL(0, esp_partition_stub_get_num_mapped());
+    TEST_ASSERT_EQUAL(ESP_OK, song_library_close(library));
+}
+
+static void test_library_reads_songs_in_place(void)
+{
+    memset(s_partition, 0xFF, sizeof(s_partition));
+    size_t offset = 0;
+    for (int i = 0; i < TEST_NUM_SONGS; i++) {
+        offset += put_song(s_partition + offset, i);
+    }
+    esp_partition_stub_clear();
+    esp_partition_stub_add(ESP_PARTITION_TYPE_DATA, SONG_LIBRARY_PARTITION_SUBTYPE, "songs", s_partition,
+                           sizeof(s_partition));
+    song_library_handle_t library = NULL;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, song_library_open("songs", NULL));
+    TEST_ASSERT_EQUAL(ESP_OK, song_library_open("songs", &library));
+    TEST_ASSERT_EQUAL(TEST_NUM_SONGS, song_library_get_count(library));
+    TEST_ASSERT_EQUAL(1, esp_partition_stub_get_num_mapped());
+
+    // in order, backwards and at random
+    for (int i = 0; i < TEST_NUM_SONGS; i++) {
+        TEST_ASSERT_EQUAL(i, read_song_number(library, i));
+    }
+    for (int i = TEST_NUM_SONGS - 1; i >= 0; i--) {
+        TEST_ASSERT_EQUAL(i, read_song_number(library, i));
+    }
+    uint32_t seed = 1;
+    for (int i = 0; i < 100; i++) {
+        size_t index = test_rand(&seed) % TEST_NUM_SONGS;
+        TEST_ASSERT_EQUAL(index, read_song_number(library, index));
+    }
+
+    // the reader points into the partition, nothing was copied
+    smf_reader_t reader;
+    TEST_ASSERT_EQUAL(ESP_OK, song_library_open_song(library, 3, &reader));
+    TEST_ASSERT(reader.tracks[0].pos > s_partition && reader.tracks[0].end <= s_partition + sizeof(s_partition));
+    TEST_ASSERT_EQUAL(ESP_OK, song_library_close(library));
+    TEST_ASSERT_EQUAL(0, esp_partition_stub_get_num_mapped());
+}
+
+int main(int argc, char **argv)
+{
+    RUN_TEST(test_library_falls_back_to_builtin_song);
+    RUN_TEST(test_library_reads_songs_in_place);
+    return TEST_EXIT();
+}
@@ -0,0 +1,209 @@
+/*
+ * Host test, fuzz and benchmark for the USB-MIDI packet parser.
+ *
+ * Known packets of every CIN must decode to the expected events, random input must never write past the event
+ * buffer or produce out of range fields, and the benchmark replays a dense synthetic performance.
+ */
+#include <string.h>
+#include "test_common.h"
+#include "usb_midi.h"
+
+static void test_parse_channel_voice(void)
+{
+    const uint8_t packets[] = {
+        0x09, 0x90, 60, 100, // note on
+        0x09, 0x91, 62, 0,   // note on with velocity 0 is a note off
+        0x08, 0x82, 64, 40,  // note off
+        0x0A, 0xA3, 65, 70,  // poly pressure
+        0x0B, 0xB4, 64, 127, // sustain pedal
+        0x0C, 0xC5, 12, 0,   // program change
+        0x0D, 0xD6, 90, 0,   // channel pressure
+        0x1E, 0xEF, 0x00, 0x40, // pitch bend center, cable 1
+    };
+    midi_event_t events[8];
+    TEST_ASSERT_EQUAL(8, usb_midi_parse(packets, sizeof(packets), 1234, events, 8));
+    const uint8_t expected[8][4] = {
+        {MIDI_EVENT_NOTE_ON, 0, 60, 100},
+        {MIDI_EVENT_NOTE_OFF, 1, 62, 0},
+        {MIDI_EVENT_NOTE_OFF, 2, 64, 40},
+        {MIDI_EVENT_POLY_PRESSURE, 3, 65, 70},
+        {MIDI_EVENT_CONTROL_CHANGE, 4, 64, 127},
+        {MIDI_EVENT_PROGRAM_CHANGE, 5, 12, 0},
+        {MIDI_EVENT_CHANNEL_PRESSURE, 6, 90, 0},
+        {MIDI_EVENT_PITCH_BEND, 15, 0x00, 0x40},
+    };
+    for (int i = 0; i < 8; i++) {
+        TEST_ASSERT_EQUAL(1234, events[i].timestamp_us);
+        TEST_ASSERT_EQUAL(expected[i][0], events[i].type);
+        TEST_ASSERT_EQUAL(expected[i][1], events[i].channel);
+        TEST_ASSERT_EQUAL(expected[i][2], events[i].note);
+        TEST_ASSERT_EQUAL(expected[i][3], events[i].velocity);
+    }
+}
+
+static void test_parse_system_and_sysex(void)
+{
+    const uint8_t packets[] = {
+        0x04, 0xF0, 0x7E, 0x7F, // SysEx starts
+        0x04, 0x06, 0x01, 0x02, // continues
+        0x06, 0x03, 0xF7, 0x00, // ends with two bytes
+        0x05, 0xF7, 0x00, 0x00, // ends with one byte
+        0x07, 0x10, 0x20, 0xF7, // ends with three bytes
+        0x02, 0xF3, 0x05, 0x00, // song select
+        0x03, 0xF2, 0x10, 0x20, // song position
+        0x05, 0xF6, 0x00, 0x00, // tune request
+        0x0F, 0xF8, 0x00, 0x00, // timing clock
+        0x0F, 0xFE, 0x00, 0x00, // active sensing
+    };
+    midi_event_t events[10];
+    TEST_ASSERT_EQUAL(10, usb_midi_parse(packets, sizeof(packets), 0, events, 10));
+    const uint8_t expected[10][4] = {
+        {MIDI_EVENT_SYSEX, 0xF0, 0x7E, 0x7F},
+        {MIDI_EVENT_SYSEX, 0x06, 0x01, 0x02},
+        {MIDI_EVENT_SYSEX, 0x03, 0xF7, 0x00},
+        {MIDI_EVENT_SYSEX, 0xF7, 0x00, 0x00},
+        {MIDI_EVENT_SYSEX, 0x10, 0x20, 0xF7},
+        {MIDI_EVENT_SYSTEM_COMMON, 0xF3, 0x05, 0x00},
+        {MIDI_EVENT_SYSTEM_COMMON, 0xF2, 0x10, 0x20},
+        {MIDI_EVENT_SYSTEM_COMMON, 0xF6, 0x00, 0x00},
+        {MIDI_EVENT_REALTIME, 0xF8, 0x00, 0x00},
+        {MIDI_EVENT_REALTIME, 0xFE, 0x00, 0x00},
+    };
+    for (int i = 0; i < 10; i++) {
+        TEST_ASSERT_EQUAL(expected[i][0], events[i].type);
+        TEST_ASSERT(memcmp(events[i].data, &expected[i][1], 3) == 0);
+    }
+}
+
+static void test_parse_skips_invalid(void)
+{
+    const uint8_t packets[] = {
+        0x00, 0x90, 60, 100, // reserved CIN
+        0x01, 0x90, 60, 100, // reserved CIN
+        0x09, 0x80, 60, 100, // status does not match the CIN
+        0x09, 0x3C, 60, 100, // running status is not allowed in USB-MIDI
+        0x09, 0x90, 61, 1,
+        0x08, 0x80, 61, // trailing partial packet
+    };
+    midi_event_t events[4];
+    TEST_ASSERT_EQUAL(1, usb_midi_parse(packets, sizeof(packets), 0, events, 4));
+    TEST_ASSERT_EQUAL(MIDI_EVENT_NOTE_ON, events[0].type);
+    TEST_ASSERT_EQUAL(61, events[0].note);
+    // decoding stops once the buffer is full
+    const uint8_t notes[] = {0x09, 0x90, 60, 1, 0x09, 0x90, 61, 1, 0x09, 0x90, 62, 1};
+    TEST_ASSERT_EQUAL(2, usb_midi_parse(notes, sizeof(notes), 0, events, 2));
+    TEST_ASSERT_EQUAL(61, events[1].note);
+}
+
+static int event_is_valid(const midi_event_t *event)
+{
+    switch (event->type) {
+    case MIDI_EVENT_NOTE_ON:
+        if (!event->velocity) {
+            return 0;
+        }
+    // fall through
+    case MIDI_EVENT_NOTE_OFF:
+    case MIDI_EVENT_POLY_PRESSURE:
+    case MIDI_EVENT_CONTROL_CHANGE:
+    case MIDI_EVENT_PROGRAM_CHANGE:
+    case MIDI_EVENT_CHANNEL_PRESSURE:
+    case MIDI_EVENT_PITCH_BEND:
+        return event->channel < 16 && event->note < 0x80 && event->velocity < 0x80;
+    case MIDI_EVENT_SYSEX:
+        return 1;
+    case MIDI_EVENT_SYSTEM_COMMON:
+        return event->data[0] > 0xF0 && event->data[0] < 0xF7;
+    case MIDI_EVENT_REALTIME:
+        return event->data[0] >= 0xF8;
+    default:
+        return 0;
+    }
+}
+
+static void test_parse_fuzz(void)
+{
+    uint32_t seed = 0xC0FFEE;
+    uint8_t data[256];
+    midi_event_t events[80];
+    for (int iter = 0; iter < 200000; iter++) {
+        size_t size = test_rand(&seed) % sizeof(data);
+        for (size_t i = 0; i < size; i++) {
+            data[i] = test_rand(&seed);
+        }
+        size_t max_events = test_rand(&seed) % 70;
+        memset(events, 0xA5, sizeof(events));
+        size_t n = usb_midi_parse(data, size, iter, events, max_events);
+        TEST_ASSERT(n <= max_events && n <= size / 4);
+        for (size_t i = 0; i < n; i++) {
+            TEST_ASSERT_MESSAGE(event_is_valid(&events[i]), "invalid event");
+            TEST_ASSERT_EQUAL(iter, events[i].timestamp_us);
+        }
+        // nothing written past the returned events
+        for (size_t i = n * sizeof(midi_event_t); i < sizeof(events); i++) {
+            TEST_ASSERT_EQUAL(0xA5, ((uint8_t *)events)[i]);
+        }
+    }
+}
+
+// Two hands of four note chords on a 16th note grid at 180 bpm with sustain pedal, pitch bend and aftertouch,
+// 24 ppqn clock and active sensing, packed into 64-byte transfers the way a keyboard sends them.
+static size_t make_dense_performance(uint8_t *data, size_t size)
+{
+    uint32_t seed = 99;
+    size_t len = 0;
+    uint8_t held[8] = {0};
+#define PUT(cin, b1, b2, b3) do { if (len + 4 > size) return len; \
+        data[len++] = (cin); data[len++] = (b1); data[len++] = (b2); data[len++] = (b3); } while (0)
+    for (int step = 0; ; step++) {
+        for (int k = 0; k < 8; k++) {
+            if (held[k]) {
+                PUT(0x08, 0x80, held[k], 64);
+            }
+            held[k] = 36 + test_rand(&seed) % 61;
+            PUT(0x09, 0x90, held[k], 1 + test_rand(&seed) % 127);
+        }
+        PUT(0x0B, 0xB0, 64, step % 8 < 6 ? 127 : 0);
+        PUT(0x0E, 0xE0, test_rand(&seed) & 0x7F, 0x40);
+        PUT(0x0D, 0xD0, test_rand(&seed) & 0x7F, 0);
+        for (int tick = 0; tick < 6; tick++) {
+            PUT(0x0F, 0xF8, 0, 0);
+        }
+        PUT(0x0F, 0xFE, 0, 0);
+    }
+#undef PUT
+}
+
+static void run_bench(void)
+{
+    static uint8_t data[64 * 16384];
+    size_t size = make_dense_performance(data, sizeof(data));
+    size_t num_packets = size / 4;
+    midi_event_t events[16];
+    size_t total_packets = 0;
+    size_t total_events = 0;
+    double start = test_now_sec();
+    double elapsed;
+    do {
+        for (size_t off = 0; off < size; off += 64) {
+            total_events += usb_midi_parse(&data[off], 64, off, events, 16);
+        }
+        total_packets += num_packets;
+        elapsed = test_now_sec() - start;
+    } while (elapsed < 0.2);
+    printf("%zu packets in %zu transfers: %.0f packets/s, %.0f events/s\n", num_packets, size / 64,
+           total_packets / elapsed, total_events / elapsed);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        run_bench();
+        return EXIT_SUCCESS;
+    }
+    RUN_TEST(test_parse_channel_voice);
+    RUN_TEST(test_parse_system_and_sysex);
+    RUN_TEST(test_parse_skips_invalid);
+    RUN_TEST(test_parse_fuzz);
+    return TEST_EXIT();
+}
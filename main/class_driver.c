@@ -7,11 +7,19 @@
 #include <stdlib.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "usb/usb_host.h"
+#include "usb/usb_helpers.h"
 #include "class_driver.h"
+#include "usb_midi.h"
 
 #define CLIENT_NUM_EVENT_MSG        5
+#define MIDI_IN_MAX_PACKET_SIZE     64 // USB-MIDI event packets are 4 bytes each
+#define MIDI_IN_NUM_TRANSFERS       CONFIG_CLASS_DRIVER_MIDI_IN_TRANSFERS
+#define MIDI_IN_MAX_ENDPOINTS       4    // MIDI IN endpoints serviced per device
+#define USB_SUBCLASS_MIDISTREAMING  0x03 // Audio class subclass of USB-MIDI interfaces
 
 typedef enum {
     ACTION_OPEN_DEV         = (1 << 0),
@@ -23,13 +31,30 @@ typedef enum {
 
 #define DEV_MAX_COUNT           8 // Максимальна кількість пристроїв для обробки
 
+typedef struct usb_device_s usb_device_t;
+
 typedef struct {
+    usb_device_t *device;
+    uint8_t intf_num;
+    uint8_t alt_setting;
+    uint8_t ep_addr;
+    uint16_t ep_mps;
+    bool claim_intf;  // first endpoint of its interface, the one that claims and releases it
+    usb_transfer_t *transfers[MIDI_IN_NUM_TRANSFERS]; // all queued on the endpoint while the device is open
+    int outstanding;  // transfers submitted and not completed yet
+} midi_in_endpoint_t;
+
+struct usb_device_s {
     usb_host_client_handle_t client_hdl;
     uint8_t dev_addr;
+    uint8_t slot;            // index in the device table, tags every MIDI event of the device
     usb_device_handle_t dev_hdl;
     action_t actions;
-    usb_transfer_t *midi_in_transfer;
-} usb_device_t;
+    midi_in_endpoint_t midi_in[MIDI_IN_MAX_ENDPOINTS]; // found in the config descriptor
+    int num_midi_in;
+    int64_t attach_us;       // when the device was reported, 0 once its first MIDI event has been measured
+    bool closing;            // endpoints halted and flushed, waiting for their transfers to come back
+};
 
 typedef struct {
     struct {
@@ -44,51 +69,146 @@ typedef struct {
         usb_device_t device[DEV_MAX_COUNT];
     } mux_protected;
 
+    class_driver_stats_t stats; // only touched from the class driver task
+
     struct {
         usb_host_client_handle_t client_hdl;
         SemaphoreHandle_t mux_lock;
-        QueueHandle_t midi_queue;
     } constant;
 } class_driver_t;
 
 static const char *TAG = "CLASS";
 static class_driver_t *s_driver_obj;
 
+// Where received MIDI events go, may be set before the class driver task runs
+static struct {
+    midi_event_ring_handle_t ring;
+    TaskHandle_t consumer;
+    latency_histogram_t *callback_latency;
+} s_midi_sink;
+
+static void midi_transfer_submit(midi_in_endpoint_t *endpoint, usb_transfer_t *transfer)
+{
+    if (endpoint->device->closing) {
+        return; // The pool is being drained for the close
+    }
+    esp_err_t err = usb_host_transfer_submit(transfer);
+    if (err != ESP_OK) {
+        // The other transfers of the pool keep the endpoint serviced
+        ESP_LOGW(TAG, "Failed to resubmit MIDI transfer: 0x%x", err);
+        return;
+    }
+    endpoint->outstanding++;
+}
+
+// Once the last transfer of a closing device is back, have the class driver task finish the close
+static void midi_in_check_drained(midi_in_endpoint_t *endpoint)
+{
+    usb_device_t *device_obj = endpoint->device;
+    if (!device_obj->closing || endpoint->outstanding || !s_driver_obj) {
+        return;
+    }
+    // Transfer callbacks run from usb_host_client_handle_events, outside of mux_lock
+    xSemaphoreTake(s_driver_obj->constant.mux_lock, portMAX_DELAY);
+    device_obj->actions |= ACTION_CLOSE_DEV;
+    s_driver_obj->mux_protected.flags.unhandled_devices = 1;
+    xSemaphoreGive(s_driver_obj->constant.mux_lock);
+}
+
 static void midi_transfer_cb(usb_transfer_t *transfer)
 {
-    // A transfer has been completed. Handle the received data.
+    midi_in_endpoint_t *endpoint = (midi_in_endpoint_t *)transfer->context;
+    usb_device_t *device_obj = endpoint->device;
+    int64_t now_us = esp_timer_get_time();
+    endpoint->outstanding--;
+    if (transfer->status == USB_TRANSFER_STATUS_NO_DEVICE || transfer->status == USB_TRANSFER_STATUS_CANCELED) {
+        // The pool drains on purpose while the device goes away, that is not the endpoint running dry
+        midi_in_check_drained(endpoint);
+        return;
+    }
+    if (s_driver_obj && endpoint->outstanding < (int)s_driver_obj->stats.transfers_outstanding_min) {
+        s_driver_obj->stats.transfers_outstanding_min = endpoint->outstanding;
+    }
+    // A transfer has been completed. Handle the received data while the rest of the pool stays queued.
     if (transfer->status == USB_TRANSFER_STATUS_COMPLETED) {
-        // Process MIDI data
-        for (int i = 0; i < transfer->actual_num_bytes; i += 4) {
-            // Check for Note On event (CIN 0x9) with velocity > 0
-            if ((transfer->data_buffer[i] & 0x0F) == 0x09 && transfer->data_buffer[i + 2] > 0) {
-                uint8_t note = transfer->data_buffer[i + 2];
-                if (s_driver_obj && s_driver_obj->constant.midi_queue) {
-                    // Send the note to the main application queue
-                    xQueueSend(s_driver_obj->constant.midi_queue, &note, 0);
-                }
+        // Every event of the packet arrived at the same time, stamp them once and publish them as one batch
+        midi_event_t events[MIDI_IN_MAX_PACKET_SIZE / 4];
+        size_t num_events = usb_midi_parse(transfer->data_buffer, transfer->actual_num_bytes,
+                                           (uint32_t)now_us, events, sizeof(events) / sizeof(events[0]));
+        for (size_t i = 0; i < num_events; i++) {
+            events[i].device = device_obj->slot;
+        }
+        if (num_events && device_obj->attach_us && s_driver_obj) {
+            s_driver_obj->stats.attach_to_first_event_us = now_us - device_obj->attach_us;
+            device_obj->attach_us = 0;
+        }
+        if (num_events && s_midi_sink.ring) {
+            // Overflow is counted by the ring, the consumer is woken either way to make room
+            midi_event_ring_push(s_midi_sink.ring, events, num_events);
+            if (s_midi_sink.consumer) {
+                xTaskNotifyGive(s_midi_sink.consumer);
+            }
+            if (s_midi_sink.callback_latency) {
+                latency_histogram_record(s_midi_sink.callback_latency, esp_timer_get_time() - now_us);
             }
         }
-        // Resubmit the transfer to continue listening for MIDI messages
-        ESP_ERROR_CHECK(usb_host_transfer_submit(transfer));
-    } else if (transfer->status != USB_TRANSFER_STATUS_NO_DEVICE && transfer->status != USB_TRANSFER_STATUS_CANCELED) {
+        // Recycle the buffer to the back of the endpoint queue
+        midi_transfer_submit(endpoint, transfer);
+    } else {
         ESP_LOGW(TAG, "MIDI transfer failed status %d, resubmitting", transfer->status);
-        ESP_ERROR_CHECK(usb_host_transfer_submit(transfer)); // Try to resubmit
+        midi_transfer_submit(endpoint, transfer); // Try to resubmit
+    }
+    if (s_driver_obj) {
+        uint32_t resubmit_us = esp_timer_get_time() - now_us;
+        s_driver_obj->stats.resubmit_us_last = resubmit_us;
+        if (resubmit_us > s_driver_obj->stats.resubmit_us_max) {
+            s_driver_obj->stats.resubmit_us_max = resubmit_us;
+        }
     }
+    midi_in_check_drained(endpoint);
 }
 
-void class_driver_set_midi_queue(QueueHandle_t queue)
+void class_driver_set_midi_ring(midi_event_ring_handle_t ring, TaskHandle_t consumer)
 {
-    if (s_driver_obj) {
-        s_driver_obj->constant.midi_queue = queue;
+    s_midi_sink.consumer = consumer;
+    s_midi_sink.ring = ring;
+}
+
+// Take a free slot for a newly reported device, called with mux_lock held
+static void class_driver_add_device(class_driver_t *driver_obj, uint8_t dev_addr)
+{
+    int free_slot = -1;
+    for (int i = 0; i < DEV_MAX_COUNT; i++) {
+        if (driver_obj->mux_protected.device[i].dev_addr == dev_addr) {
+            return; // already handled
+        }
+        if (free_slot < 0 && driver_obj->mux_protected.device[i].dev_addr == 0) {
+            free_slot = i;
+        }
     }
+    if (free_slot < 0) {
+        ESP_LOGW(TAG, "No free slot for device with address %d", dev_addr);
+        return;
+    }
+    ESP_LOGI(TAG, "Found new device with address %d", dev_addr);
+    usb_device_t *device_obj = &driver_obj->mux_protected.device[free_slot];
+    device_obj->dev_addr = dev_addr;
+    device_obj->attach_us = esp_timer_get_time();
+    device_obj->actions |= ACTION_OPEN_DEV;
+    driver_obj->mux_protected.flags.unhandled_devices = 1;
 }
 
 static void client_event_cb(const usb_host_client_event_msg_t *event_msg, void *arg)
 {
-    // This callback only handles device disconnection since polling is used for detection.
+    // Runs from usb_host_client_handle_events() in the class driver task, which handles the actions right after.
     class_driver_t *driver_obj = (class_driver_t *)arg;
-    if (event_msg->event == USB_HOST_CLIENT_EVENT_DEV_GONE) {
+    switch (event_msg->event) {
+    case USB_HOST_CLIENT_EVENT_NEW_DEV:
+        xSemaphoreTake(driver_obj->constant.mux_lock, portMAX_DELAY);
+        class_driver_add_device(driver_obj, event_msg->new_dev.address);
+        xSemaphoreGive(driver_obj->constant.mux_lock);
+        break;
+    case USB_HOST_CLIENT_EVENT_DEV_GONE:
         ESP_LOGI(TAG, "MIDI device disconnected");
         xSemaphoreTake(driver_obj->constant.mux_lock, portMAX_DELAY);
         for (uint8_t i = 0; i < DEV_MAX_COUNT; i++) {
@@ -99,6 +219,37 @@ static void client_event_cb(const usb_host_client_event_msg_t *event_msg, void *
             }
         }
         xSemaphoreGive(driver_obj->constant.mux_lock);
+        break;
+    default:
+        break;
+    }
+}
+
+// Scan the library's device list for devices without a NEW_DEV event, e.g. attached before the client registered
+static void class_driver_scan_devices(class_driver_t *driver_obj)
+{
+    uint8_t dev_addr_list[DEV_MAX_COUNT];
+    int num_devs;
+    ESP_ERROR_CHECK(usb_host_device_addr_list_fill(sizeof(dev_addr_list), dev_addr_list, &num_devs));
+
+    xSemaphoreTake(driver_obj->constant.mux_lock, portMAX_DELAY);
+    for (int i = 0; i < num_devs; i++) {
+        if (dev_addr_list[i] != 0) {
+            class_driver_add_device(driver_obj, dev_addr_list[i]);
+        }
+    }
+    xSemaphoreGive(driver_obj->constant.mux_lock);
+}
+
+void class_driver_set_latency_histogram(latency_histogram_t *hist)
+{
+    s_midi_sink.callback_latency = hist;
+}
+
+void class_driver_get_stats(class_driver_stats_t *ret_stats)
+{
+    if (s_driver_obj) {
+        *ret_stats = s_driver_obj->stats;
     }
 }
 
@@ -121,6 +272,56 @@ static void action_get_info(usb_device_t *device_obj)
     device_obj->actions |= ACTION_GET_CONFIG_DESC; // Next action: get config descriptor
 }
 
+// Record every bulk or interrupt IN endpoint of the Audio class MIDIStreaming interfaces
+static void midi_in_find_endpoints(usb_device_t *device_obj, const usb_config_desc_t *config_desc)
+{
+    const usb_standard_desc_t *desc = (const usb_standard_desc_t *)config_desc;
+    const usb_intf_desc_t *intf = NULL; // current MIDIStreaming interface, NULL inside any other interface
+    int offset = 0;
+    device_obj->num_midi_in = 0;
+    while ((desc = usb_parse_next_descriptor(desc, config_desc->wTotalLength, &offset)) != NULL) {
+        if (desc->bDescriptorType == USB_B_DESCRIPTOR_TYPE_INTERFACE) {
+            intf = (const usb_intf_desc_t *)desc;
+            if (intf->bInterfaceClass != USB_CLASS_AUDIO || intf->bInterfaceSubClass != USB_SUBCLASS_MIDISTREAMING) {
+                intf = NULL;
+            }
+            continue;
+        }
+        if (!intf || desc->bDescriptorType != USB_B_DESCRIPTOR_TYPE_ENDPOINT) {
+            continue;
+        }
+        const usb_ep_desc_t *ep = (const usb_ep_desc_t *)desc;
+        uint8_t xfer_type = ep->bmAttributes & USB_BM_ATTRIBUTES_XFERTYPE_MASK;
+        if (!(ep->bEndpointAddress & USB_B_ENDPOINT_ADDRESS_EP_DIR_MASK) ||
+                (xfer_type != USB_BM_ATTRIBUTES_XFER_BULK && xfer_type != USB_BM_ATTRIBUTES_XFER_INT)) {
+            continue;
+        }
+        bool claim_intf = true;
+        bool other_alt = false;
+        for (int i = 0; i < device_obj->num_midi_in; i++) {
+            if (device_obj->midi_in[i].intf_num == intf->bInterfaceNumber) {
+                claim_intf = false;
+                // only one alternate setting of an interface can be active
+                other_alt |= device_obj->midi_in[i].alt_setting != intf->bAlternateSetting;
+            }
+        }
+        if (other_alt) {
+            continue;
+        }
+        if (USB_EP_DESC_GET_MPS(ep) > MIDI_IN_MAX_PACKET_SIZE || device_obj->num_midi_in == MIDI_IN_MAX_ENDPOINTS) {
+            ESP_LOGW(TAG, "Skipping MIDI IN endpoint 0x%02X", ep->bEndpointAddress);
+            continue;
+        }
+        midi_in_endpoint_t *endpoint = &device_obj->midi_in[device_obj->num_midi_in++];
+        endpoint->device = device_obj;
+        endpoint->intf_num = intf->bInterfaceNumber;
+        endpoint->alt_setting = intf->bAlternateSetting;
+        endpoint->ep_addr = ep->bEndpointAddress;
+        endpoint->ep_mps = USB_EP_DESC_GET_MPS(ep);
+        endpoint->claim_intf = claim_intf;
+    }
+}
+
 static void action_get_config_desc(usb_device_t *device_obj)
 {
     assert(device_obj->dev_hdl != NULL);
@@ -128,58 +329,132 @@ static void action_get_config_desc(usb_device_t *device_obj)
     const usb_config_desc_t *config_desc;
     ESP_ERROR_CHECK(usb_host_get_active_config_descriptor(device_obj->dev_hdl, &config_desc));
     usb_print_config_descriptor(config_desc, NULL);
+    midi_in_find_endpoints(device_obj, config_desc);
+    if (!device_obj->num_midi_in) {
+        ESP_LOGW(TAG, "No MIDIStreaming IN endpoint on device addr %d", device_obj->dev_addr);
+        return;
+    }
     device_obj->actions |= ACTION_CLAIM_INTERFACE; // Next action: claim interface
 }
 
-static void action_claim_interface(usb_device_t *device_obj)
+static void midi_in_free_transfers(midi_in_endpoint_t *endpoint)
 {
-    // This function claims the MIDI interface and starts listening for data.
-    // It uses hardcoded values for the Yamaha keyboard based on the logs.
-    // Interface Number: 3, Endpoint Address: 0x82, Packet Size: 64
-    assert(device_obj->dev_hdl != NULL);
-    
-    int intf_num = 3;
-    uint8_t ep_addr = 0x82;
-    size_t ep_mps = 64;
+    for (int i = 0; i < MIDI_IN_NUM_TRANSFERS; i++) {
+        if (endpoint->transfers[i]) {
+            esp_err_t err = usb_host_transfer_free(endpoint->transfers[i]);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to free transfer: 0x%x", err);
+            }
+            endpoint->transfers[i] = NULL;
+        }
+    }
+    endpoint->outstanding = 0;
+}
 
-    ESP_LOGI(TAG, "Claiming MIDI interface (num=%d, EP=0x%02X)", intf_num, ep_addr);
-    esp_err_t err = usb_host_interface_claim(device_obj->client_hdl, device_obj->dev_hdl, intf_num, 0);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to claim interface: 0x%x", err);
-        return;
+static esp_err_t midi_in_start(usb_device_t *device_obj, midi_in_endpoint_t *endpoint)
+{
+    esp_err_t err;
+    // Allocate the whole pool up front, completed transfers are recycled and never reallocated
+    for (int i = 0; i < MIDI_IN_NUM_TRANSFERS; i++) {
+        err = usb_host_transfer_alloc(endpoint->ep_mps, 0, &endpoint->transfers[i]);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to allocate transfer: 0x%x", err);
+            midi_in_free_transfers(endpoint);
+            return err;
+        }
+        usb_transfer_t *transfer = endpoint->transfers[i];
+        transfer->device_handle = device_obj->dev_hdl;
+        transfer->bEndpointAddress = endpoint->ep_addr;
+        transfer->callback = midi_transfer_cb;
+        transfer->context = endpoint;
+        transfer->num_bytes = endpoint->ep_mps;
     }
 
-    // Allocate and configure the USB transfer
-    err = usb_host_transfer_alloc(ep_mps, 0, &device_obj->midi_in_transfer);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to allocate transfer: 0x%x", err);
-        usb_host_interface_release(device_obj->client_hdl, device_obj->dev_hdl, intf_num);
-        return;
+    for (int i = 0; i < MIDI_IN_NUM_TRANSFERS; i++) {
+        err = usb_host_transfer_submit(endpoint->transfers[i]);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to submit transfer: 0x%x", err);
+            break;
+        }
+        endpoint->outstanding++;
+    }
+    if (!endpoint->outstanding) {
+        midi_in_free_transfers(endpoint);
+        return err;
     }
+    return ESP_OK;
+}
+
+static void action_claim_interface(usb_device_t *device_obj)
+{
+    // Claims every MIDIStreaming interface found in the config descriptor and starts listening on its IN endpoints.
+    assert(device_obj->dev_hdl != NULL);
 
-    device_obj->midi_in_transfer->device_handle = device_obj->dev_hdl;
-    device_obj->midi_in_transfer->bEndpointAddress = ep_addr;
-    device_obj->midi_in_transfer->callback = midi_transfer_cb;
-    device_obj->midi_in_transfer->context = device_obj;
-    device_obj->midi_in_transfer->num_bytes = ep_mps;
+    for (int i = 0; i < device_obj->num_midi_in; i++) {
+        midi_in_endpoint_t *endpoint = &device_obj->midi_in[i];
+        if (endpoint->claim_intf) {
+            ESP_LOGI(TAG, "Claiming MIDI interface (num=%d, alt=%d)", endpoint->intf_num, endpoint->alt_setting);
+            esp_err_t err = usb_host_interface_claim(device_obj->client_hdl, device_obj->dev_hdl, endpoint->intf_num,
+                                                     endpoint->alt_setting);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to claim interface: 0x%x", err);
+                // skip the endpoints of this interface
+                endpoint->claim_intf = false;
+                while (i + 1 < device_obj->num_midi_in && device_obj->midi_in[i + 1].intf_num == endpoint->intf_num) {
+                    i++;
+                }
+                continue;
+            }
+        }
+        ESP_LOGI(TAG, "Submitting %d MIDI IN transfers (EP=0x%02X, MPS=%d)", MIDI_IN_NUM_TRANSFERS, endpoint->ep_addr,
+                 endpoint->ep_mps);
+        midi_in_start(device_obj, endpoint);
+    }
+}
 
-    ESP_LOGI(TAG, "Submitting first MIDI IN transfer");
-    err = usb_host_transfer_submit(device_obj->midi_in_transfer);
+// Cancel the transfers still queued on an endpoint, they come back through midi_transfer_cb
+static void midi_in_flush(usb_device_t *device_obj, midi_in_endpoint_t *endpoint)
+{
+    esp_err_t err = usb_host_endpoint_halt(device_obj->dev_hdl, endpoint->ep_addr);
+    if (err == ESP_OK) {
+        err = usb_host_endpoint_flush(device_obj->dev_hdl, endpoint->ep_addr);
+    }
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to submit transfer: 0x%x", err);
-        usb_host_transfer_free(device_obj->midi_in_transfer);
-        device_obj->midi_in_transfer = NULL;
-        usb_host_interface_release(device_obj->client_hdl, device_obj->dev_hdl, intf_num);
+        ESP_LOGW(TAG, "Failed to flush EP 0x%02X: 0x%x", endpoint->ep_addr, err);
     }
 }
 
 static void action_close_dev(usb_device_t *device_obj)
 {
-    ESP_LOGI(TAG, "Closing device addr %d", device_obj->dev_addr);
-    if (device_obj->midi_in_transfer) {
-        usb_host_transfer_free(device_obj->midi_in_transfer);
-        device_obj->midi_in_transfer = NULL;
+    if (!device_obj->closing) {
+        ESP_LOGI(TAG, "Closing device addr %d", device_obj->dev_addr);
+        device_obj->attach_us = 0;
+        device_obj->closing = true;
+        for (int i = 0; i < device_obj->num_midi_in; i++) {
+            if (device_obj->midi_in[i].outstanding) {
+                midi_in_flush(device_obj, &device_obj->midi_in[i]);
+            }
+        }
+    }
+    // The interfaces can't be released nor the transfers freed while any of them is still queued
+    for (int i = 0; i < device_obj->num_midi_in; i++) {
+        if (device_obj->midi_in[i].outstanding) {
+            ESP_LOGD(TAG, "Waiting for %d transfers on EP 0x%02X", device_obj->midi_in[i].outstanding,
+                     device_obj->midi_in[i].ep_addr);
+            return; // midi_in_check_drained comes back here
+        }
     }
+    for (int i = 0; i < device_obj->num_midi_in; i++) {
+        midi_in_endpoint_t *endpoint = &device_obj->midi_in[i];
+        if (endpoint->claim_intf) {
+            esp_err_t err = usb_host_interface_release(device_obj->client_hdl, device_obj->dev_hdl, endpoint->intf_num);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to release interface %d: 0x%x", endpoint->intf_num, err);
+            }
+        }
+        midi_in_free_transfers(endpoint);
+    }
+    device_obj->num_midi_in = 0;
     if (device_obj->dev_hdl) {
         ESP_ERROR_CHECK(usb_host_device_close(device_obj->client_hdl, device_obj->dev_hdl));
     }
@@ -187,6 +462,7 @@ static void action_close_dev(usb_device_t *device_obj)
     device_obj->dev_hdl = NULL;
     device_obj->dev_addr = 0;
     device_obj->actions = 0;
+    device_obj->closing = false;
 }
 
 // This function handles the state machine for a single device
@@ -229,59 +505,41 @@ void class_driver_task(void *arg)
     driver_obj.constant.client_hdl = class_driver_client_hdl;
     for (uint8_t i = 0; i < DEV_MAX_COUNT; i++) {
         driver_obj.mux_protected.device[i].client_hdl = class_driver_client_hdl;
+        driver_obj.mux_protected.device[i].slot = i;
     }
+    driver_obj.stats.transfers_outstanding_min = MIDI_IN_NUM_TRANSFERS;
     s_driver_obj = &driver_obj;
 
-    while (1) {
-        // --- Polling for new devices (Workaround) ---
-        uint8_t dev_addr_list[DEV_MAX_COUNT];
-        int num_devs;
-        ESP_ERROR_CHECK(usb_host_device_addr_list_fill(sizeof(dev_addr_list), dev_addr_list, &num_devs));
-
-        xSemaphoreTake(driver_obj.constant.mux_lock, portMAX_DELAY);
-        for (int i = 0; i < num_devs; i++) {
-            uint8_t dev_addr = dev_addr_list[i];
-            if (dev_addr == 0) continue;
-
-            bool already_handled = false;
-            for (int j = 0; j < DEV_MAX_COUNT; j++) {
-                if (driver_obj.mux_protected.device[j].dev_addr == dev_addr) {
-                    already_handled = true;
-                    break;
-                }
-            }
-
-            if (!already_handled) {
-                ESP_LOGI(TAG, "Found new device with address %d", dev_addr);
-                for (int j = 0; j < DEV_MAX_COUNT; j++) {
-                    if (driver_obj.mux_protected.device[j].dev_addr == 0) { // Find an empty slot
-                        driver_obj.mux_protected.device[j].dev_addr = dev_addr;
-                        driver_obj.mux_protected.device[j].actions |= ACTION_OPEN_DEV;
-                        driver_obj.mux_protected.flags.unhandled_devices = 1;
-                        break;
-                    }
-                }
-            }
-        }
-        xSemaphoreGive(driver_obj.constant.mux_lock);
-        // --- End of Workaround ---
+#if CONFIG_CLASS_DRIVER_POLL_FALLBACK
+    const TickType_t event_timeout = pdMS_TO_TICKS(CONFIG_CLASS_DRIVER_POLL_INTERVAL_MS);
+#else
+    const TickType_t event_timeout = portMAX_DELAY;
+#endif
+    class_driver_scan_devices(&driver_obj);
 
+    while (1) {
         // Handle any pending actions for devices
         if (driver_obj.mux_protected.flags.unhandled_devices) {
             xSemaphoreTake(driver_obj.constant.mux_lock, portMAX_DELAY);
             driver_obj.mux_protected.flags.unhandled_devices = 0; // Reset flag
             for (uint8_t i = 0; i < DEV_MAX_COUNT; i++) {
-                if (driver_obj.mux_protected.device[i].actions) {
-                    class_driver_device_handle(&driver_obj.mux_protected.device[i]);
+                usb_device_t *device_obj = &driver_obj.mux_protected.device[i];
+                if (device_obj->actions) {
+                    class_driver_device_handle(device_obj);
+                    if (device_obj->num_midi_in && device_obj->midi_in[0].outstanding && device_obj->attach_us) {
+                        driver_obj.stats.attach_to_claim_us = esp_timer_get_time() - device_obj->attach_us;
+                    }
                 }
             }
             xSemaphoreGive(driver_obj.constant.mux_lock);
         }
-        
-        // Handle library events (like disconnection)
-        usb_host_client_handle_events(driver_obj.constant.client_hdl, pdMS_TO_TICKS(10));
 
-        vTaskDelay(pdMS_TO_TICKS(100)); // Poll every 100ms
+        // Sleep until the library reports an event (new device, disconnection, finished transfer)
+        usb_host_client_handle_events(driver_obj.constant.client_hdl, event_timeout);
+        driver_obj.stats.wakeups++;
+#if CONFIG_CLASS_DRIVER_POLL_FALLBACK
+        class_driver_scan_devices(&driver_obj);
+#endif
     }
 
     // Cleanup
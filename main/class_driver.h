@@ -1,8 +1,25 @@
 #pragma once
 
 #include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "midi_event_ring.h"
+#include "latency_histogram.h"
+
+typedef struct {
+    uint32_t wakeups;                  // class driver task wakeups, library events (and polls with the fallback)
+    uint32_t attach_to_claim_us;       // last device, from its attach report to the first submitted MIDI IN transfer
+    uint32_t attach_to_first_event_us; // last device, from its attach report to its first MIDI event
+    uint32_t transfers_outstanding_min; // fewest MIDI IN transfers left queued on a device, 0 means the endpoint went dry
+    uint32_t resubmit_us_last;          // last MIDI IN completion callback, from entry to resubmission
+    uint32_t resubmit_us_max;           // longest MIDI IN completion callback, from entry to resubmission
+} class_driver_stats_t;
 
 void class_driver_task(void *arg);
 void class_driver_client_deregister(void);
-void class_driver_set_midi_queue(QueueHandle_t queue);
+// Route received MIDI events into ring, consumer gets a task notification after every batch. Can be called before
+// the class driver task starts
+void class_driver_set_midi_ring(midi_event_ring_handle_t ring, TaskHandle_t consumer);
+// Snapshot of the class driver counters
+void class_driver_get_stats(class_driver_stats_t *ret_stats);
+// Record the time from MIDI IN completion to events published in the ring, hist is written from the class driver task
+void class_driver_set_latency_histogram(latency_histogram_t *hist);
@@ -0,0 +1,35 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "core_load.h"
+
+static const char *TAG = "core_load";
+
+esp_err_t core_load_take_snapshot(core_load_snapshot_t *ret_snapshot)
+{
+    ESP_RETURN_ON_FALSE(ret_snapshot, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS && CONFIG_FREERTOS_RUN_TIME_STATS_USING_ESP_TIMER
+    ret_snapshot->time_us = esp_timer_get_time();
+    for (int core = 0; core < CORE_LOAD_NUM_CORES; core++) {
+        ret_snapshot->idle_us[core] = ulTaskGetIdleRunTimeCounterForCore(core);
+    }
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+uint32_t core_load_get_permille(const core_load_snapshot_t *from, const core_load_snapshot_t *to, int core)
+{
+    int64_t elapsed_us = to->time_us - from->time_us;
+    if (core < 0 || core >= CORE_LOAD_NUM_CORES || elapsed_us <= 0) {
+        return 0;
+    }
+    // unsigned difference, right across a wrap of the 32 bit counter
+    uint32_t idle_us = to->idle_us[core] - from->idle_us[core];
+    if (idle_us >= elapsed_us) {
+        return 0;
+    }
+    return (elapsed_us - idle_us) * 1000 / elapsed_us;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Number of cores a snapshot covers
+ */
+#define CORE_LOAD_NUM_CORES CONFIG_FREERTOS_NUMBER_OF_CORES
+
+/**
+ * @brief Idle time of every core at one point in time
+ *
+ * The load of a core between two snapshots is the share of the time its idle task did not run, so everything the
+ * core did counts: the tasks pinned to it, unpinned tasks it picked up and its interrupts.
+ */
+typedef struct {
+    int64_t time_us;                        /*!< Time of the snapshot, on the `esp_timer_get_time` clock */
+    uint32_t idle_us[CORE_LOAD_NUM_CORES];  /*!< Run time of the idle task of every core, wraps after ~71 minutes */
+} core_load_snapshot_t;
+
+/**
+ * @brief Take a snapshot of the idle time of every core
+ *
+ * @param[out] ret_snapshot Returned snapshot
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_ERR_NOT_SUPPORTED if FreeRTOS does not keep run time statistics on the esp_timer clock
+ *      - ESP_OK on success
+ */
+esp_err_t core_load_take_snapshot(core_load_snapshot_t *ret_snapshot);
+
+/**
+ * @brief Get the load of a core between two snapshots
+ *
+ * @param[in] from Earlier snapshot
+ * @param[in] to Later snapshot
+ * @param[in] core Core number
+ * @return Share of the time the core was busy, in 1/1000, 0 for an out of range core or an empty interval
+ */
+uint32_t core_load_get_permille(const core_load_snapshot_t *from, const core_load_snapshot_t *to, int core);
+
+#ifdef __cplusplus
+}
+#endif
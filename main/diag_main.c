@@ -1,28 +1,41 @@
 #include <string.h>
+#include <inttypes.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "driver/rmt_tx.h"
 #include "led_strip_encoder.h"
+#include "led_strip_output.h"
+#include "led_strip_pipeline.h"
+#include "keyboard_layout.h"
 
+#define LED_STRIP_CHIP              LED_STRIP_CHIP_WS2812 // timing and pixel layout of the strip
 #define RMT_LED_STRIP_RESOLUTION_HZ 10000000 // 10MHz resolution, 1 tick = 0.1us (led strip needs a high resolution)
 #define RMT_LED_STRIP_GPIO_NUM      16
-
-// IMPORTANT: Set this to the number of LEDs you have currently soldered (e.g., 12, 24, 36...)
-#define EXAMPLE_LED_NUMBERS         61
+#define RMT_LED_STRIP_MEM_BLOCK_SYMBOLS CONFIG_LED_STRIP_RMT_MEM_BLOCK_SYMBOLS // RMT RAM or DMA buffer, see menuconfig
+#if CONFIG_LED_STRIP_RMT_WITH_DMA
+#define RMT_LED_STRIP_WITH_DMA      1
+#else
+#define RMT_LED_STRIP_WITH_DMA      0
+#endif
+_Static_assert(RMT_LED_STRIP_MEM_BLOCK_SYMBOLS % 2 == 0, "the RMT driver only takes an even number of symbols");
+
+// The strip of the keyboard layout (menuconfig, Keyboard Layout). IMPORTANT: lower this to the number of LEDs you
+// have currently soldered (e.g., 12, 24, 36...) while the strip is only partly built
+#define EXAMPLE_LED_NUMBERS         KEYBOARD_NUM_LEDS
 
 static const char *TAG = "diag_tool";
 
-static uint8_t led_strip_pixels[EXAMPLE_LED_NUMBERS * 3];
+static led_strip_pipeline_handle_t led_pipeline = NULL;
 
-// Sets the color of a single pixel
-void set_pixel_color(int index, uint8_t r, uint8_t g, uint8_t b) {
-    if (index < EXAMPLE_LED_NUMBERS) {
-        // The color order is GRB for WS2812 strips
-        led_strip_pixels[index * 3 + 0] = g;
-        led_strip_pixels[index * 3 + 1] = r;
-        led_strip_pixels[index * 3 + 2] = b;
-    }
+// Shows one pixel in one color, every other pixel off
+static void show_single_pixel(int index, uint8_t r, uint8_t g, uint8_t b)
+{
+    // The frame stores the colors at the chip's byte offsets (GRB for WS2812) and only marks the pixels that change
+    led_frame_t *frame = led_strip_pipeline_get_back_frame(led_pipeline);
+    led_frame_clear(frame);
+    led_frame_set_pixel(frame, index, r, g, b);
+    ESP_ERROR_CHECK(led_strip_pipeline_present(led_pipeline));
 }
 
 void app_main(void)
@@ -32,9 +45,10 @@ void app_main(void)
     rmt_tx_channel_config_t tx_chan_config = {
         .clk_src = RMT_CLK_SRC_DEFAULT,
         .gpio_num = RMT_LED_STRIP_GPIO_NUM,
-        .mem_block_symbols = 64,
+        .mem_block_symbols = RMT_LED_STRIP_MEM_BLOCK_SYMBOLS, // fewer, later refill interrupts as it grows
         .resolution_hz = RMT_LED_STRIP_RESOLUTION_HZ,
         .trans_queue_depth = 4,
+        .flags.with_dma = RMT_LED_STRIP_WITH_DMA,
     };
     ESP_ERROR_CHECK(rmt_new_tx_channel(&tx_chan_config, &led_chan));
 
@@ -42,72 +56,76 @@ void app_main(void)
     rmt_encoder_handle_t led_encoder = NULL;
     led_strip_encoder_config_t encoder_config = {
         .resolution = RMT_LED_STRIP_RESOLUTION_HZ,
+        .chip = LED_STRIP_CHIP,
     };
     ESP_ERROR_CHECK(rmt_new_led_strip_encoder(&encoder_config, &led_encoder));
 
+    led_strip_output_handle_t led_output = NULL;
+    led_strip_rmt_output_config_t output_config = {
+        .channels = &led_chan,
+        .encoders = &led_encoder,
+        .num_channels = 1,
+        .num_pixels = EXAMPLE_LED_NUMBERS,
+        .chip = LED_STRIP_CHIP,
+    };
+    ESP_ERROR_CHECK(led_strip_new_rmt_output(&output_config, &led_output));
+
+    ESP_LOGI(TAG, "Create LED frame pipeline");
+    led_strip_pipeline_config_t pipeline_config = {
+        .output = led_output,
+        .frame_size = EXAMPLE_LED_NUMBERS * led_strip_get_chip_info(LED_STRIP_CHIP)->bytes_per_pixel,
+        .num_buffers = 2,
+    };
+    ESP_ERROR_CHECK(led_strip_pipeline_new(&pipeline_config, &led_pipeline));
+
     ESP_LOGI(TAG, "Enable RMT TX channel");
-    ESP_ERROR_CHECK(rmt_enable(led_chan));
+    ESP_ERROR_CHECK(led_strip_pipeline_enable(led_pipeline));
 
     ESP_LOGI(TAG, "Start Diagnostics Tool");
-    rmt_transmit_config_t tx_config = {
-        .loop_count = 0,
-    };
 
     while (1) {
         ESP_LOGI(TAG, "Testing individual LEDs...");
         // --- Test 1: Cycle through each LED individually (R, G, B) ---
         for (int i = 0; i < EXAMPLE_LED_NUMBERS; i++) {
             // Red
-            memset(led_strip_pixels, 0, sizeof(led_strip_pixels));
-            set_pixel_color(i, 255, 0, 0);
-            ESP_ERROR_CHECK(rmt_transmit(led_chan, led_encoder, led_strip_pixels, sizeof(led_strip_pixels), &tx_config));
-            ESP_ERROR_CHECK(rmt_tx_wait_all_done(led_chan, portMAX_DELAY));
+            show_single_pixel(i, 255, 0, 0);
             vTaskDelay(pdMS_TO_TICKS(250));
 
             // Green
-            memset(led_strip_pixels, 0, sizeof(led_strip_pixels));
-            set_pixel_color(i, 0, 255, 0);
-            ESP_ERROR_CHECK(rmt_transmit(led_chan, led_encoder, led_strip_pixels, sizeof(led_strip_pixels), &tx_config));
-            ESP_ERROR_CHECK(rmt_tx_wait_all_done(led_chan, portMAX_DELAY));
+            show_single_pixel(i, 0, 255, 0);
             vTaskDelay(pdMS_TO_TICKS(250));
 
             // Blue
-            memset(led_strip_pixels, 0, sizeof(led_strip_pixels));
-            set_pixel_color(i, 0, 0, 255);
-            ESP_ERROR_CHECK(rmt_transmit(led_chan, led_encoder, led_strip_pixels, sizeof(led_strip_pixels), &tx_config));
-            ESP_ERROR_CHECK(rmt_tx_wait_all_done(led_chan, portMAX_DELAY));
+            show_single_pixel(i, 0, 0, 255);
             vTaskDelay(pdMS_TO_TICKS(250));
         }
 
         // Turn all off before next test
-        memset(led_strip_pixels, 0, sizeof(led_strip_pixels));
-        ESP_ERROR_CHECK(rmt_transmit(led_chan, led_encoder, led_strip_pixels, sizeof(led_strip_pixels), &tx_config));
-        ESP_ERROR_CHECK(rmt_tx_wait_all_done(led_chan, portMAX_DELAY));
+        led_strip_pipeline_clear(led_pipeline);
+        ESP_ERROR_CHECK(led_strip_pipeline_present(led_pipeline));
         vTaskDelay(pdMS_TO_TICKS(1000));
 
-        // --- Test 2: Light up the last soldered octave ---
-        int last_octave_start_index = (EXAMPLE_LED_NUMBERS / 12 - 1) * 12;
-        if (last_octave_start_index < 0) {
-            last_octave_start_index = 0;
-        }
-        int end_index = last_octave_start_index + 12;
-        if (end_index > EXAMPLE_LED_NUMBERS) {
-            end_index = EXAMPLE_LED_NUMBERS;
-        }
+        // --- Test 2: Light up the last soldered octave, the LEDs of the 12 keys up to the last soldered LED ---
+        int last_key = keyboard_note_to_key(keyboard_led_to_note(EXAMPLE_LED_NUMBERS - 1));
+        int first_key = last_key >= 11 ? last_key - 11 : 0;
+        int last_octave_start_index = keyboard_key_leds[first_key];
+        int end_index = EXAMPLE_LED_NUMBERS;
 
         ESP_LOGI(TAG, "Testing octave from LED %d to %d", last_octave_start_index, end_index - 1);
-        memset(led_strip_pixels, 0, sizeof(led_strip_pixels));
-        for (int i = last_octave_start_index; i < end_index; i++) {
-            set_pixel_color(i, 128, 128, 128); // White
-        }
-        ESP_ERROR_CHECK(rmt_transmit(led_chan, led_encoder, led_strip_pixels, sizeof(led_strip_pixels), &tx_config));
-        ESP_ERROR_CHECK(rmt_tx_wait_all_done(led_chan, portMAX_DELAY));
+        led_frame_t *frame = led_strip_pipeline_get_back_frame(led_pipeline);
+        led_frame_clear(frame);
+        led_frame_fill(frame, last_octave_start_index, end_index - last_octave_start_index, 128, 128, 128); // White
+        ESP_ERROR_CHECK(led_strip_pipeline_present(led_pipeline));
         vTaskDelay(pdMS_TO_TICKS(3000));
 
         // Turn all off before restarting loop
-        memset(led_strip_pixels, 0, sizeof(led_strip_pixels));
-        ESP_ERROR_CHECK(rmt_transmit(led_chan, led_encoder, led_strip_pixels, sizeof(led_strip_pixels), &tx_config));
-        ESP_ERROR_CHECK(rmt_tx_wait_all_done(led_chan, portMAX_DELAY));
+        led_strip_pipeline_clear(led_pipeline);
+        ESP_ERROR_CHECK(led_strip_pipeline_present(led_pipeline));
         vTaskDelay(pdMS_TO_TICKS(2000));
+
+        led_strip_pipeline_stats_t stats;
+        ESP_ERROR_CHECK(led_strip_pipeline_get_stats(led_pipeline, &stats));
+        ESP_LOGI(TAG, "LED frames sent: %"PRIu32" (%"PRIu32" pixels), skipped (unchanged): %"PRIu32,
+                 stats.frames_sent, stats.pixels_sent, stats.frames_skipped);
     }
 }
@@ -0,0 +1,180 @@
+#include <stdatomic.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "frame_scheduler.h"
+
+static const char *TAG = "frame_sched";
+
+typedef struct frame_scheduler_t {
+    frame_scheduler_render_cb_t render;
+    void *user_ctx;
+    uint32_t period_us;
+    esp_timer_handle_t timer;
+    TaskHandle_t task;
+    SemaphoreHandle_t exit_sem;  // given by the render task right before it deletes itself
+    latency_histogram_t *start_latency;
+    bool running;
+    bool exit;                   // the render task must leave, set by frame_scheduler_del
+    int64_t start_us;            // time of frame_scheduler_start, slots are due on a period grid from there
+    uint32_t next_slot;          // number of the next slot to open, timer only
+    atomic_bool busy;            // a slot has been handed to the render task and is not finished yet
+    atomic_uint frame;           // slot handed to the render task, valid while busy
+    atomic_uint open_us;         // time the timer opened it, truncated to 32 bits
+    atomic_uint deadlines_missed;
+    portMUX_TYPE spinlock;       // protects the stats below, never taken by the timer
+    frame_scheduler_stats_t stats;
+} frame_scheduler_t;
+
+static void frame_scheduler_on_timer(void *arg)
+{
+    frame_scheduler_t *scheduler = (frame_scheduler_t *)arg;
+    uint32_t slot = scheduler->next_slot++;
+    bool busy = false;
+    if (!atomic_compare_exchange_strong_explicit(&scheduler->busy, &busy, true, memory_order_acquire,
+                                                 memory_order_relaxed)) {
+        // drop the slot, queueing it would only make every following frame late as well
+        atomic_fetch_add_explicit(&scheduler->deadlines_missed, 1, memory_order_relaxed);
+        return;
+    }
+    // the notification publishes the slot to the render task
+    atomic_store_explicit(&scheduler->frame, slot, memory_order_relaxed);
+    atomic_store_explicit(&scheduler->open_us, (uint32_t)esp_timer_get_time(), memory_order_relaxed);
+    xTaskNotifyGive(scheduler->task);
+}
+
+static void frame_scheduler_task(void *arg)
+{
+    frame_scheduler_t *scheduler = (frame_scheduler_t *)arg;
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (scheduler->exit) {
+            break;
+        }
+        uint32_t frame = atomic_load_explicit(&scheduler->frame, memory_order_relaxed);
+
+        int64_t start_us = esp_timer_get_time();
+        if (scheduler->start_latency) {
+            // the slot was due at the last point of the period grid before the timer opened it, a late timer
+            // counts as much as a late render task
+            uint32_t open_us = atomic_load_explicit(&scheduler->open_us, memory_order_relaxed);
+            uint32_t due_us = open_us - (open_us - (uint32_t)scheduler->start_us) % scheduler->period_us;
+            latency_histogram_record(scheduler->start_latency, (uint32_t)start_us - due_us);
+        }
+        scheduler->render(frame, frame * scheduler->period_us, scheduler->user_ctx);
+        uint32_t render_us = esp_timer_get_time() - start_us;
+
+        portENTER_CRITICAL(&scheduler->spinlock);
+        scheduler->stats.frames_rendered++;
+        scheduler->stats.render_us_last = render_us;
+        if (render_us > scheduler->stats.render_us_max) {
+            scheduler->stats.render_us_max = render_us;
+        }
+        if (render_us > scheduler->period_us) {
+            scheduler->stats.overruns++;
+        }
+        portEXIT_CRITICAL(&scheduler->spinlock);
+        atomic_store_explicit(&scheduler->busy, false, memory_order_release);
+    }
+    xSemaphoreGive(scheduler->exit_sem);
+    vTaskDelete(NULL);
+}
+
+static void frame_scheduler_free(frame_scheduler_t *scheduler)
+{
+    if (scheduler) {
+        if (scheduler->timer) {
+            esp_timer_delete(scheduler->timer);
+        }
+        if (scheduler->exit_sem) {
+            vSemaphoreDelete(scheduler->exit_sem);
+        }
+        free(scheduler);
+    }
+}
+
+esp_err_t frame_scheduler_new(const frame_scheduler_config_t *config, frame_scheduler_handle_t *ret_scheduler)
+{
+    esp_err_t ret = ESP_OK;
+    frame_scheduler_t *scheduler = NULL;
+    ESP_GOTO_ON_FALSE(config && ret_scheduler && config->render && config->fps >= 1 && config->fps <= 1000 &&
+                      config->task_stack, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    scheduler = calloc(1, sizeof(frame_scheduler_t));
+    ESP_GOTO_ON_FALSE(scheduler, ESP_ERR_NO_MEM, err, TAG, "no mem for scheduler");
+    scheduler->render = config->render;
+    scheduler->user_ctx = config->user_ctx;
+    scheduler->period_us = 1000000 / config->fps;
+    scheduler->start_latency = config->start_latency;
+    atomic_init(&scheduler->busy, false);
+    atomic_init(&scheduler->frame, 0);
+    atomic_init(&scheduler->open_us, 0);
+    atomic_init(&scheduler->deadlines_missed, 0);
+    scheduler->spinlock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+    scheduler->exit_sem = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(scheduler->exit_sem, ESP_ERR_NO_MEM, err, TAG, "no mem for semaphore");
+
+    esp_timer_create_args_t timer_args = {
+        .callback = frame_scheduler_on_timer,
+        .arg = scheduler,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "frame_sched",
+        .skip_unhandled_events = true, // a late timer task must not fire a burst of slots
+    };
+    ESP_GOTO_ON_ERROR(esp_timer_create(&timer_args, &scheduler->timer), err, TAG, "create timer failed");
+    BaseType_t task_created = xTaskCreatePinnedToCore(frame_scheduler_task, "frame_sched", config->task_stack, scheduler,
+                                                      config->task_priority, &scheduler->task, config->task_core);
+    ESP_GOTO_ON_FALSE(task_created == pdPASS, ESP_ERR_NO_MEM, err, TAG, "create render task failed");
+    *ret_scheduler = scheduler;
+    return ESP_OK;
+err:
+    frame_scheduler_free(scheduler);
+    return ret;
+}
+
+esp_err_t frame_scheduler_start(frame_scheduler_handle_t scheduler)
+{
+    ESP_RETURN_ON_FALSE(scheduler, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(!scheduler->running, ESP_ERR_INVALID_STATE, TAG, "already running");
+    // the timer is stopped, starting it publishes these to its task
+    scheduler->next_slot = 0;
+    scheduler->start_us = esp_timer_get_time();
+    ESP_RETURN_ON_ERROR(esp_timer_start_periodic(scheduler->timer, scheduler->period_us), TAG, "start timer failed");
+    scheduler->running = true;
+    return ESP_OK;
+}
+
+esp_err_t frame_scheduler_stop(frame_scheduler_handle_t scheduler)
+{
+    ESP_RETURN_ON_FALSE(scheduler, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(scheduler->running, ESP_ERR_INVALID_STATE, TAG, "not running");
+    ESP_RETURN_ON_ERROR(esp_timer_stop(scheduler->timer), TAG, "stop timer failed");
+    scheduler->running = false;
+    return ESP_OK;
+}
+
+esp_err_t frame_scheduler_get_stats(frame_scheduler_handle_t scheduler, frame_scheduler_stats_t *ret_stats)
+{
+    ESP_RETURN_ON_FALSE(scheduler && ret_stats, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    portENTER_CRITICAL(&scheduler->spinlock);
+    *ret_stats = scheduler->stats;
+    portEXIT_CRITICAL(&scheduler->spinlock);
+    ret_stats->deadlines_missed = atomic_load_explicit(&scheduler->deadlines_missed, memory_order_relaxed);
+    return ESP_OK;
+}
+
+esp_err_t frame_scheduler_del(frame_scheduler_handle_t scheduler)
+{
+    ESP_RETURN_ON_FALSE(scheduler, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    if (scheduler->running) {
+        ESP_RETURN_ON_ERROR(frame_scheduler_stop(scheduler), TAG, "stop failed");
+    }
+    // a frame being rendered completes first, the task checks the exit flag every time it wakes up
+    scheduler->exit = true;
+    xTaskNotifyGive(scheduler->task);
+    xSemaphoreTake(scheduler->exit_sem, portMAX_DELAY);
+    frame_scheduler_free(scheduler);
+    return ESP_OK;
+}
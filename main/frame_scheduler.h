@@ -0,0 +1,118 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "latency_histogram.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Type of frame scheduler handle
+ *
+ * A periodic `esp_timer` opens one frame slot per period and wakes a render task for it. When the previous frame is
+ * still being rendered (or presented, waiting for the RMT channel to release a buffer) the slot is dropped instead of
+ * queued, so a slow frame never makes the following ones late. Effects get a stable time base from the slot number.
+ * The slot is handed over through one atomic word, the timer never waits for the render task, even when the two run
+ * on different cores.
+ */
+typedef struct frame_scheduler_t *frame_scheduler_handle_t;
+
+/**
+ * @brief Render callback, renders and presents one frame from the scheduler task
+ *
+ * @param[in] frame Slot number since `frame_scheduler_start`, dropped slots included
+ * @param[in] frame_time_us Start of the slot relative to `frame_scheduler_start`, frame * period
+ * @param[in] user_ctx User context passed in the configuration
+ */
+typedef void (*frame_scheduler_render_cb_t)(uint32_t frame, uint32_t frame_time_us, void *user_ctx);
+
+/**
+ * @brief Type of frame scheduler configuration
+ */
+typedef struct {
+    uint32_t fps;                       /*!< Target frame rate, 1 to 1000 frames per second */
+    frame_scheduler_render_cb_t render; /*!< Render callback */
+    void *user_ctx;                     /*!< User context passed to the render callback */
+    uint32_t task_stack;                /*!< Stack size of the render task, in bytes */
+    UBaseType_t task_priority;          /*!< Priority of the render task */
+    BaseType_t task_core;               /*!< Core the render task is pinned to, tskNO_AFFINITY for any */
+    latency_histogram_t *start_latency; /*!< Optional, from the period boundary a slot opened on to the start of
+                                             its render callback, recorded from the render task */
+} frame_scheduler_config_t;
+
+/**
+ * @brief Frame scheduler statistics
+ */
+typedef struct {
+    uint32_t frames_rendered;  /*!< Render callbacks completed */
+    uint32_t deadlines_missed; /*!< Slots dropped because the previous frame was not finished when they opened */
+    uint32_t overruns;         /*!< Frames whose render callback took longer than one period */
+    uint32_t render_us_last;   /*!< Duration of the last render callback, in us */
+    uint32_t render_us_max;    /*!< Longest render callback, in us */
+} frame_scheduler_stats_t;
+
+/**
+ * @brief Create a frame scheduler and its render task, stopped
+ *
+ * @param[in] config Scheduler configuration
+ * @param[out] ret_scheduler Returned scheduler handle
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_ERR_NO_MEM out of memory when creating the scheduler
+ *      - ESP_OK if creating the scheduler successfully
+ *      - Other error codes from `esp_timer_create`
+ */
+esp_err_t frame_scheduler_new(const frame_scheduler_config_t *config, frame_scheduler_handle_t *ret_scheduler);
+
+/**
+ * @brief Start opening frame slots, the first one opens one period from now
+ *
+ * @note Slot numbers and frame times restart from 0.
+ *
+ * @param[in] scheduler Scheduler handle
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_ERR_INVALID_STATE if the scheduler is already running
+ *      - ESP_OK on success
+ */
+esp_err_t frame_scheduler_start(frame_scheduler_handle_t scheduler);
+
+/**
+ * @brief Stop opening frame slots, a frame being rendered still completes
+ *
+ * @param[in] scheduler Scheduler handle
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_ERR_INVALID_STATE if the scheduler is not running
+ *      - ESP_OK on success
+ */
+esp_err_t frame_scheduler_stop(frame_scheduler_handle_t scheduler);
+
+/**
+ * @brief Get the frame counters
+ *
+ * @param[in] scheduler Scheduler handle
+ * @param[out] ret_stats Returned statistics
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_OK on success
+ */
+esp_err_t frame_scheduler_get_stats(frame_scheduler_handle_t scheduler, frame_scheduler_stats_t *ret_stats);
+
+/**
+ * @brief Stop the scheduler if needed, wait for the frame being rendered and delete the scheduler and its task
+ *
+ * @param[in] scheduler Scheduler handle
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_OK if deleting the scheduler successfully
+ */
+esp_err_t frame_scheduler_del(frame_scheduler_handle_t scheduler);
+
+#ifdef __cplusplus
+}
+#endif
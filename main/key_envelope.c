@@ -0,0 +1,190 @@
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_check.h"
+#include "key_envelope.h"
+
+static const char *TAG = "key_envelope";
+
+typedef struct {
+    uint8_t color[3];       // r, g, b at full level
+    uint8_t background[3];  // r, g, b
+    uint8_t peak;           // level held after the attack, from the velocity
+    uint8_t release_level;  // level when the key was released
+    bool held;
+    bool sounding;          // held or still fading
+    uint32_t start_us;      // note on while held, note off while fading
+} key_state_t;
+
+typedef struct key_envelope_t {
+    size_t num_keys;
+    const uint16_t *key_leds;   // NULL for one pixel per key
+    uint32_t attack_us;
+    uint32_t release_us;
+    portMUX_TYPE spinlock;  // protects everything below
+    bool has_origin;        // a note on has not been rendered yet
+    uint32_t origin_us;     // earliest such note on
+    uint32_t *active;       // one bit per key to draw in the next frame
+    key_state_t keys[];
+} key_envelope_t;
+
+// envelope level out of 255 at now_us
+static uint8_t key_envelope_level(const key_envelope_t *engine, const key_state_t *key, uint32_t now_us)
+{
+    if (!key->sounding) {
+        return 0;
+    }
+    int32_t elapsed = now_us - key->start_us;
+    if (elapsed < 0) {
+        elapsed = 0; // event stamped after the frame time
+    }
+    if (key->held) {
+        if ((uint32_t)elapsed >= engine->attack_us) {
+            return key->peak;
+        }
+        return key->peak * (uint32_t)elapsed / engine->attack_us;
+    }
+    if ((uint32_t)elapsed >= engine->release_us) {
+        return 0;
+    }
+    return key->release_level * (engine->release_us - (uint32_t)elapsed) / engine->release_us;
+}
+
+static inline void key_envelope_mark(key_envelope_t *engine, int key)
+{
+    engine->active[key / 32] |= 1u << (key % 32);
+}
+
+esp_err_t key_envelope_new(const key_envelope_config_t *config, key_envelope_handle_t *ret_engine)
+{
+    esp_err_t ret = ESP_OK;
+    key_envelope_t *engine = NULL;
+    ESP_GOTO_ON_FALSE(config && ret_engine && config->num_keys, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    engine = calloc(1, sizeof(key_envelope_t) + config->num_keys * sizeof(key_state_t));
+    ESP_GOTO_ON_FALSE(engine, ESP_ERR_NO_MEM, err, TAG, "no mem for engine");
+    engine->active = calloc((config->num_keys + 31) / 32, sizeof(uint32_t));
+    ESP_GOTO_ON_FALSE(engine->active, ESP_ERR_NO_MEM, err, TAG, "no mem for active keys");
+    engine->num_keys = config->num_keys;
+    engine->key_leds = config->key_leds;
+    engine->attack_us = config->attack_us;
+    engine->release_us = config->release_us;
+    engine->spinlock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+    *ret_engine = engine;
+    return ESP_OK;
+err:
+    if (engine) {
+        free(engine->active);
+        free(engine);
+    }
+    return ret;
+}
+
+void key_envelope_note_on(key_envelope_handle_t engine, int key, uint8_t velocity, uint8_t r, uint8_t g, uint8_t b,
+                          uint32_t time_us)
+{
+    if (key < 0 || (size_t)key >= engine->num_keys || !velocity) {
+        return;
+    }
+    key_state_t *state = &engine->keys[key];
+    portENTER_CRITICAL(&engine->spinlock);
+    state->color[0] = r;
+    state->color[1] = g;
+    state->color[2] = b;
+    state->peak = ((velocity & 0x7F) * 255 + 63) / 127;
+    state->held = true;
+    state->sounding = true;
+    state->start_us = time_us;
+    if (!engine->has_origin || (int32_t)(time_us - engine->origin_us) < 0) {
+        engine->origin_us = time_us;
+    }
+    engine->has_origin = true;
+    key_envelope_mark(engine, key);
+    portEXIT_CRITICAL(&engine->spinlock);
+}
+
+void key_envelope_note_off(key_envelope_handle_t engine, int key, uint32_t time_us)
+{
+    if (key < 0 || (size_t)key >= engine->num_keys) {
+        return;
+    }
+    key_state_t *state = &engine->keys[key];
+    portENTER_CRITICAL(&engine->spinlock);
+    if (state->held) {
+        // fade from wherever the attack got to
+        state->release_level = key_envelope_level(engine, state, time_us);
+        state->held = false;
+        state->start_us = time_us;
+        key_envelope_mark(engine, key);
+    }
+    portEXIT_CRITICAL(&engine->spinlock);
+}
+
+void key_envelope_set_background(key_envelope_handle_t engine, int key, uint8_t r, uint8_t g, uint8_t b)
+{
+    if (key < 0 || (size_t)key >= engine->num_keys) {
+        return;
+    }
+    key_state_t *state = &engine->keys[key];
+    portENTER_CRITICAL(&engine->spinlock);
+    state->background[0] = r;
+    state->background[1] = g;
+    state->background[2] = b;
+    key_envelope_mark(engine, key);
+    portEXIT_CRITICAL(&engine->spinlock);
+}
+
+size_t key_envelope_render(key_envelope_handle_t engine, led_strip_pipeline_handle_t pipeline, uint32_t now_us)
+{
+    size_t num_drawn = 0;
+    portENTER_CRITICAL(&engine->spinlock);
+    bool has_origin = engine->has_origin;
+    uint32_t origin_us = engine->origin_us;
+    engine->has_origin = false;
+    portEXIT_CRITICAL(&engine->spinlock);
+    if (has_origin) {
+        led_strip_pipeline_set_origin(pipeline, origin_us);
+    }
+    led_frame_t *frame = led_strip_pipeline_get_back_frame(pipeline);
+
+    for (size_t word = 0; word < (engine->num_keys + 31) / 32; word++) {
+        uint32_t bits = engine->active[word];
+        while (bits) {
+            int key = word * 32 + __builtin_ctz(bits);
+            bits &= bits - 1;
+            key_state_t state;
+            uint8_t level;
+            // copy the key out and retire it once it stops changing (attack over or fade over), draw outside the
+            // critical section
+            portENTER_CRITICAL(&engine->spinlock);
+            state = engine->keys[key];
+            level = key_envelope_level(engine, &state, now_us);
+            if (state.held ? level == state.peak : !level) {
+                engine->keys[key].sounding = state.held;
+                engine->active[word] &= ~(1u << (key % 32));
+            }
+            portEXIT_CRITICAL(&engine->spinlock);
+
+            uint8_t rgb[3];
+            for (int c = 0; c < 3; c++) {
+                int background = state.background[c];
+                rgb[c] = background + (state.color[c] - background) * level / 255;
+            }
+            if (engine->key_leds) {
+                int first_led = engine->key_leds[key];
+                led_frame_fill(frame, first_led, engine->key_leds[key + 1] - first_led, rgb[0], rgb[1], rgb[2]);
+            } else {
+                led_frame_set_pixel(frame, key, rgb[0], rgb[1], rgb[2]);
+            }
+            num_drawn++;
+        }
+    }
+    return num_drawn;
+}
+
+esp_err_t key_envelope_del(key_envelope_handle_t engine)
+{
+    ESP_RETURN_ON_FALSE(engine, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    free(engine->active);
+    free(engine);
+    return ESP_OK;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "led_strip_pipeline.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Type of key envelope engine handle
+ *
+ * Keeps one envelope per key, drawn on the key's pixels: a note on rises from the key's background color to its own color,
+ * at a level set by the velocity, holds while the key is down and fades back to the background after the note off.
+ * Keys in their attack or fade, or whose background or note changed, are flagged in an active-key bitmap. Rendering
+ * only visits those, so a frame costs in proportion to the changing keys and not to the strip length.
+ *
+ * Notes and backgrounds can be changed from any task while another one renders.
+ */
+typedef struct key_envelope_t *key_envelope_handle_t;
+
+/**
+ * @brief Type of key envelope engine configuration
+ */
+typedef struct {
+    size_t num_keys;          /*!< Number of keys */
+    const uint16_t *key_leds; /*!< First pixel of every key followed by the pixel after the last key, key i drives
+                                   pixels key_leds[i] to key_leds[i + 1] - 1 (see `keyboard_key_leds`). NULL for
+                                   one pixel per key, key i driving pixel i */
+    uint32_t attack_us;       /*!< Rise time after a note on, in us, 0 lights the key at once */
+    uint32_t release_us;      /*!< Fade time after a note off, in us, 0 turns the key off at once */
+} key_envelope_config_t;
+
+/**
+ * @brief Create a key envelope engine, every key silent on a black background
+ *
+ * @param[in] config Engine configuration
+ * @param[out] ret_engine Returned engine handle
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_ERR_NO_MEM out of memory when creating the engine
+ *      - ESP_OK if creating the engine successfully
+ */
+esp_err_t key_envelope_new(const key_envelope_config_t *config, key_envelope_handle_t *ret_engine);
+
+/**
+ * @brief Start the envelope of a key
+ *
+ * @note The next frame that renders the key gets `time_us` as latency origin (see `led_strip_pipeline_set_origin`).
+ *
+ * @param[in] engine Engine handle
+ * @param[in] key Key index, out of range keys are ignored
+ * @param[in] velocity MIDI velocity 1 to 127, 127 reaches the full color
+ * @param[in] r Red at full level
+ * @param[in] g Green at full level
+ * @param[in] b Blue at full level
+ * @param[in] time_us Time of the note on, on the `esp_timer_get_time` clock truncated to 32 bits
+ */
+void key_envelope_note_on(key_envelope_handle_t engine, int key, uint8_t velocity, uint8_t r, uint8_t g, uint8_t b,
+                          uint32_t time_us);
+
+/**
+ * @brief Release a key, it fades from its current level back to the background
+ *
+ * @param[in] engine Engine handle
+ * @param[in] key Key index, out of range keys and keys that are not held are ignored
+ * @param[in] time_us Time of the note off, on the `esp_timer_get_time` clock truncated to 32 bits
+ */
+void key_envelope_note_off(key_envelope_handle_t engine, int key, uint32_t time_us);
+
+/**
+ * @brief Set the background color of a key, shown when the key is silent and blended under its envelope
+ *
+ * @param[in] engine Engine handle
+ * @param[in] key Key index, out of range keys are ignored
+ * @param[in] r Red
+ * @param[in] g Green
+ * @param[in] b Blue
+ */
+void key_envelope_set_background(key_envelope_handle_t engine, int key, uint8_t r, uint8_t g, uint8_t b);
+
+/**
+ * @brief Draw the active keys into the back buffer of a pipeline
+ *
+ * @note Only keys in the active-key bitmap are visited. A key leaves the bitmap once it has been drawn at its
+ *       steady level, the peak while held or the background after the fade. The caller presents the frame.
+ *
+ * @param[in] engine Engine handle
+ * @param[in] pipeline Pipeline to draw into
+ * @param[in] now_us Frame time, on the `esp_timer_get_time` clock truncated to 32 bits
+ * @return Number of keys drawn
+ */
+size_t key_envelope_render(key_envelope_handle_t engine, led_strip_pipeline_handle_t pipeline, uint32_t now_us);
+
+/**
+ * @brief Delete the engine
+ *
+ * @param[in] engine Engine handle
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_OK if deleting the engine successfully
+ */
+esp_err_t key_envelope_del(key_envelope_handle_t engine);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,33 @@
+#include "keyboard_layout.h"
+
+// Key k starts at LED k * NUM_LEDS / NUM_KEYS. LED l thus belongs to the last key starting at or before it, key
+// ((l + 1) * NUM_KEYS - 1) / NUM_LEDS.
+#define KEY_FIRST_LED(key) ((key) < KEYBOARD_NUM_KEYS ? (key) * KEYBOARD_NUM_LEDS / KEYBOARD_NUM_KEYS : KEYBOARD_NUM_LEDS)
+#define LED_KEY(led)       ((((led) + 1) * KEYBOARD_NUM_KEYS - 1) / KEYBOARD_NUM_LEDS)
+
+#define NOTE_KEY_ENTRY(note) \
+    ((note) >= KEYBOARD_LOWEST_NOTE && (note) <= KEYBOARD_HIGHEST_NOTE ? (note) - KEYBOARD_LOWEST_NOTE : -1),
+#define KEY_LED_ENTRY(key)   KEY_FIRST_LED(key),
+#define LED_NOTE_ENTRY(led)  ((led) < KEYBOARD_NUM_LEDS ? KEYBOARD_LOWEST_NOTE + LED_KEY(led) : 0),
+
+// The preprocessor writes the tables out, entry n is entry(n)
+#define REPEAT_4(entry, n)   entry(n) entry((n) + 1) entry((n) + 2) entry((n) + 3)
+#define REPEAT_16(entry, n)  REPEAT_4(entry, n) REPEAT_4(entry, (n) + 4) REPEAT_4(entry, (n) + 8) \
+                             REPEAT_4(entry, (n) + 12)
+#define REPEAT_64(entry, n)  REPEAT_16(entry, n) REPEAT_16(entry, (n) + 16) REPEAT_16(entry, (n) + 32) \
+                             REPEAT_16(entry, (n) + 48)
+#define REPEAT_128(entry, n) REPEAT_64(entry, n) REPEAT_64(entry, (n) + 64)
+#define REPEAT_512(entry, n) REPEAT_128(entry, n) REPEAT_128(entry, (n) + 128) REPEAT_128(entry, (n) + 256) \
+                             REPEAT_128(entry, (n) + 384)
+
+const int8_t keyboard_note_keys[128] = {
+    REPEAT_128(NOTE_KEY_ENTRY, 0)
+};
+
+const uint16_t keyboard_key_leds[128] = {
+    REPEAT_128(KEY_LED_ENTRY, 0)
+};
+
+const uint8_t keyboard_led_notes[KEYBOARD_MAX_LEDS] = {
+    REPEAT_512(LED_NOTE_ENTRY, 0)
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Keyboard layout, chosen in menuconfig ("Keyboard Layout"): the keys of the keyboard and the LEDs of the strip that
+ * runs along them. The keys share the LEDs out evenly from the lowest key up, so with more LEDs than keys a key
+ * lights several adjacent LEDs, e.g. 144 LEDs over 88 keys give keys of one or two LEDs.
+ *
+ * The mapping is generated at build time as constant tables, so the hot path looks a note up instead of range
+ * checking it.
+ */
+#if CONFIG_KEYBOARD_LAYOUT_49_KEYS
+#define KEYBOARD_LOWEST_NOTE 36 /*!< C2 */
+#define KEYBOARD_NUM_KEYS    49
+#elif CONFIG_KEYBOARD_LAYOUT_61_KEYS
+#define KEYBOARD_LOWEST_NOTE 36 /*!< C2 */
+#define KEYBOARD_NUM_KEYS    61
+#elif CONFIG_KEYBOARD_LAYOUT_76_KEYS
+#define KEYBOARD_LOWEST_NOTE 28 /*!< E1 */
+#define KEYBOARD_NUM_KEYS    76
+#elif CONFIG_KEYBOARD_LAYOUT_88_KEYS
+#define KEYBOARD_LOWEST_NOTE 21 /*!< A0 */
+#define KEYBOARD_NUM_KEYS    88
+#else
+#error "no keyboard layout selected"
+#endif
+
+#define KEYBOARD_HIGHEST_NOTE (KEYBOARD_LOWEST_NOTE + KEYBOARD_NUM_KEYS - 1)
+#define KEYBOARD_NUM_LEDS     CONFIG_KEYBOARD_NUM_LEDS /*!< LEDs along the keys, the length of the strip */
+#define KEYBOARD_MAX_LEDS     512
+
+_Static_assert(KEYBOARD_NUM_LEDS >= KEYBOARD_NUM_KEYS && KEYBOARD_NUM_LEDS <= KEYBOARD_MAX_LEDS,
+               "every key needs at least one LED");
+
+/**
+ * @brief Key of every MIDI note, from 0 for the lowest key, -1 for notes off the keyboard
+ */
+extern const int8_t keyboard_note_keys[128];
+
+/**
+ * @brief First LED of every key, entry KEYBOARD_NUM_KEYS (and every one after it) is KEYBOARD_NUM_LEDS
+ *
+ * Key k lights the LEDs from `keyboard_key_leds[k]` to `keyboard_key_leds[k + 1] - 1`.
+ */
+extern const uint16_t keyboard_key_leds[128];
+
+/**
+ * @brief MIDI note of every LED, valid for the first KEYBOARD_NUM_LEDS entries
+ */
+extern const uint8_t keyboard_led_notes[KEYBOARD_MAX_LEDS];
+
+/**
+ * @brief Get the key of a MIDI note
+ *
+ * @param[in] note MIDI note, only the low 7 bits are used
+ * @return Key index, from 0 to KEYBOARD_NUM_KEYS - 1, or -1 if the keyboard does not have the note
+ */
+static inline int keyboard_note_to_key(uint8_t note)
+{
+    return keyboard_note_keys[note & 0x7F];
+}
+
+/**
+ * @brief Get the LEDs of a MIDI note
+ *
+ * @param[in] note MIDI note, only the low 7 bits are used
+ * @param[out] ret_first_led First LED of the note
+ * @param[out] ret_num_leds Number of LEDs of the note
+ * @return true if the keyboard has the note, false and no LEDs otherwise
+ */
+static inline bool keyboard_note_to_leds(uint8_t note, int *ret_first_led, int *ret_num_leds)
+{
+    int key = keyboard_note_keys[note & 0x7F];
+    if (key < 0) {
+        *ret_first_led = 0;
+        *ret_num_leds = 0;
+        return false;
+    }
+    *ret_first_led = keyboard_key_leds[key];
+    *ret_num_leds = keyboard_key_leds[key + 1] - keyboard_key_leds[key];
+    return true;
+}
+
+/**
+ * @brief Get the MIDI note of a LED
+ *
+ * @param[in] led LED index, from 0 to KEYBOARD_NUM_LEDS - 1
+ * @return MIDI note of the key the LED belongs to
+ */
+static inline uint8_t keyboard_led_to_note(int led)
+{
+    return keyboard_led_notes[led];
+}
+
+#ifdef __cplusplus
+}
+#endif
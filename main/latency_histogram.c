@@ -0,0 +1,63 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "latency_histogram.h"
+
+static const char *TAG = "latency";
+
+// exclusive upper edge of a bucket, the last one is open ended
+static uint32_t latency_histogram_bucket_limit(uint32_t bucket)
+{
+    return bucket < LATENCY_HISTOGRAM_BUCKETS - 1 ? 64u << bucket : UINT32_MAX;
+}
+
+void latency_histogram_reset(latency_histogram_t *hist)
+{
+    const char *name = hist->name;
+    memset(hist, 0, sizeof(*hist));
+    hist->name = name;
+}
+
+uint32_t latency_histogram_percentile(const latency_histogram_t *hist, uint32_t percent)
+{
+    if (!hist->count) {
+        return 0;
+    }
+    // rank of the sample, rounded up so that p100 is the last one
+    uint64_t rank = ((uint64_t)hist->count * percent + 99) / 100;
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= rank) {
+            uint32_t limit = latency_histogram_bucket_limit(i);
+            return limit < hist->max_us ? limit : hist->max_us;
+        }
+    }
+    return hist->max_us;
+}
+
+void latency_histogram_dump(const latency_histogram_t *hist)
+{
+    ESP_LOGI(TAG, "%s: n=%"PRIu32" mean=%"PRIu32"us p50<=%"PRIu32"us p99<=%"PRIu32"us max=%"PRIu32"us", hist->name,
+             hist->count, hist->count ? (uint32_t)(hist->sum_us / hist->count) : 0,
+             latency_histogram_percentile(hist, 50), latency_histogram_percentile(hist, 99), hist->max_us);
+    char line[LATENCY_HISTOGRAM_BUCKETS * 20];
+    size_t len = 0;
+    for (uint32_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS && len < sizeof(line); i++) {
+        if (!hist->buckets[i]) {
+            continue;
+        }
+        if (i < LATENCY_HISTOGRAM_BUCKETS - 1) {
+            len += snprintf(&line[len], sizeof(line) - len, " <%"PRIu32"us:%"PRIu32, latency_histogram_bucket_limit(i), hist->buckets[i]);
+        } else {
+            len += snprintf(&line[len], sizeof(line) - len, " >=%"PRIu32"us:%"PRIu32, latency_histogram_bucket_limit(i - 1), hist->buckets[i]);
+        }
+    }
+    if (len) {
+        ESP_LOGI(TAG, "%s:%s", hist->name, line);
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Number of histogram buckets
+ *
+ * Bucket 0 counts latencies below 64 us, bucket i > 0 those in [2^(i+5), 2^(i+6)) us, the last bucket everything
+ * from 2^20 us (~1 s) up.
+ */
+#define LATENCY_HISTOGRAM_BUCKETS 16
+
+/**
+ * @brief Fixed-bucket latency histogram
+ *
+ * Recording is a handful of integer operations without locks or allocation, safe from ISRs. Every histogram must
+ * have a single writer, readers get a best-effort snapshot.
+ */
+typedef struct {
+    const char *name;                             /*!< Stage name used when dumping */
+    uint32_t buckets[LATENCY_HISTOGRAM_BUCKETS];  /*!< Sample counts per bucket */
+    uint32_t count;                               /*!< Number of samples */
+    uint32_t max_us;                              /*!< Largest sample, in us */
+    uint64_t sum_us;                              /*!< Sum of all samples, in us */
+} latency_histogram_t;
+
+/**
+ * @brief Initializer for a named, empty histogram
+ */
+#define LATENCY_HISTOGRAM_INIT(stage_name) { .name = (stage_name) }
+
+/**
+ * @brief Get the bucket a latency falls into
+ */
+static inline uint32_t latency_histogram_bucket(uint32_t latency_us)
+{
+    if (latency_us < 64) {
+        return 0;
+    }
+    uint32_t bucket = 31 - __builtin_clz(latency_us) - 5;
+    return bucket < LATENCY_HISTOGRAM_BUCKETS ? bucket : LATENCY_HISTOGRAM_BUCKETS - 1;
+}
+
+/**
+ * @brief Add one sample
+ *
+ * @param[in] hist Histogram
+ * @param[in] latency_us Latency, in us
+ */
+static inline void latency_histogram_record(latency_histogram_t *hist, uint32_t latency_us)
+{
+    hist->buckets[latency_histogram_bucket(latency_us)]++;
+    hist->count++;
+    hist->sum_us += latency_us;
+    if (latency_us > hist->max_us) {
+        hist->max_us = latency_us;
+    }
+}
+
+/**
+ * @brief Drop all samples, the name is kept
+ *
+ * @note A sample recorded concurrently from another core or an ISR may be partially lost.
+ *
+ * @param[in] hist Histogram
+ */
+void latency_histogram_reset(latency_histogram_t *hist);
+
+/**
+ * @brief Get an upper bound of a latency percentile
+ *
+ * @param[in] hist Histogram
+ * @param[in] percent Percentile, 0-100
+ * @return Upper edge of the bucket holding the percentile in us, capped to the largest sample. 0 without samples
+ */
+uint32_t latency_histogram_percentile(const latency_histogram_t *hist, uint32_t percent);
+
+/**
+ * @brief Log count, mean, p50, p99, max and the non-empty buckets
+ *
+ * @param[in] hist Histogram
+ */
+void latency_histogram_dump(const latency_histogram_t *hist);
+
+#ifdef __cplusplus
+}
+#endif
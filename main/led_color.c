@@ -0,0 +1,68 @@
+#include "led_color.h"
+
+#define HUE_Q8_FULL_CIRCLE (360 << 8)
+
+// h must already be in [0,360)
+static inline void led_color_hsv2rgb_sector(uint32_t h, uint32_t rgb_max, uint32_t rgb_min, uint8_t *r, uint8_t *g, uint8_t *b)
+{
+    uint32_t i = h / 60;
+    uint32_t diff = h - i * 60;
+
+    // RGB adjustment amount by hue
+    uint32_t rgb_adj = (rgb_max - rgb_min) * diff / 60;
+
+    switch (i) {
+    case 0:
+        *r = rgb_max;
+        *g = rgb_min + rgb_adj;
+        *b = rgb_min;
+        break;
+    case 1:
+        *r = rgb_max - rgb_adj;
+        *g = rgb_max;
+        *b = rgb_min;
+        break;
+    case 2:
+        *r = rgb_min;
+        *g = rgb_max;
+        *b = rgb_min + rgb_adj;
+        break;
+    case 3:
+        *r = rgb_min;
+        *g = rgb_max - rgb_adj;
+        *b = rgb_max;
+        break;
+    case 4:
+        *r = rgb_min + rgb_adj;
+        *g = rgb_min;
+        *b = rgb_max;
+        break;
+    default:
+        *r = rgb_max;
+        *g = rgb_min;
+        *b = rgb_max - rgb_adj;
+        break;
+    }
+}
+
+void led_color_hsv2rgb(uint32_t h, uint8_t s, uint8_t v, uint8_t *r, uint8_t *g, uint8_t *b)
+{
+    led_color_hsv2rgb_sector(h % 360, v, v * (255 - s) / 255, r, g, b);
+}
+
+void led_color_fill_rainbow(uint8_t *grb, size_t num_pixels, size_t pixel_stride, uint32_t hue_start, uint32_t hue_step,
+                            uint8_t s, uint8_t v)
+{
+    // S and V are the same for the whole batch, and the hue is kept wrapped incrementally instead of a modulo per pixel
+    uint32_t rgb_min = v * (255 - s) / 255;
+    uint32_t hue = hue_start % HUE_Q8_FULL_CIRCLE;
+    hue_step %= HUE_Q8_FULL_CIRCLE;
+    for (size_t n = 0; n < num_pixels; n++) {
+        led_color_hsv2rgb_sector(hue >> 8, v, rgb_min, &grb[1], &grb[0], &grb[2]);
+        grb += pixel_stride * 3;
+        hue += hue_step;
+        if (hue >= HUE_Q8_FULL_CIRCLE) {
+            hue -= HUE_Q8_FULL_CIRCLE;
+        }
+    }
+}
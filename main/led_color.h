@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Convert a hue in degrees to the fixed point format used by `led_color_fill_rainbow`
+ */
+#define LED_COLOR_HUE_Q8(deg) ((uint32_t)((deg) * 256))
+
+/**
+ * @brief Convert HSV to RGB with integer math only
+ *
+ * Wiki: https://en.wikipedia.org/wiki/HSL_and_HSV
+ *
+ * @param[in] h Hue in degrees, wraps at 360
+ * @param[in] s Saturation, 0-255
+ * @param[in] v Value, 0-255
+ * @param[out] r Red, 0-255
+ * @param[out] g Green, 0-255
+ * @param[out] b Blue, 0-255
+ */
+void led_color_hsv2rgb(uint32_t h, uint8_t s, uint8_t v, uint8_t *r, uint8_t *g, uint8_t *b);
+
+/**
+ * @brief Fill GRB pixels with a hue gradient in one call
+ *
+ * Pixel n gets the hue `hue_start + n * hue_step`, both in 1/256 degree (see `LED_COLOR_HUE_Q8`).
+ *
+ * @param[out] grb First pixel to write, 3 bytes per pixel in WS2812 GRB order
+ * @param[in] num_pixels Number of pixels to write
+ * @param[in] pixel_stride Distance between written pixels, in pixels (1 fills every pixel)
+ * @param[in] hue_start Hue of the first pixel, in 1/256 degree
+ * @param[in] hue_step Hue increment from one written pixel to the next, in 1/256 degree
+ * @param[in] s Saturation, 0-255
+ * @param[in] v Value, 0-255
+ */
+void led_color_fill_rainbow(uint8_t *grb, size_t num_pixels, size_t pixel_stride, uint32_t hue_start, uint32_t hue_step,
+                            uint8_t s, uint8_t v);
+
+#ifdef __cplusplus
+}
+#endif
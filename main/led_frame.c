@@ -0,0 +1,241 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_check.h"
+#include "led_frame.h"
+
+static const char *TAG = "led_frame";
+
+// pixels moved through the stack per step of a rotation
+#define LED_FRAME_ROTATE_CHUNK 64
+
+static inline size_t led_frame_size_words(const led_frame_t *frame)
+{
+    return (frame->num_pixels * frame->chip->bytes_per_pixel + 3) / 4;
+}
+
+static inline void led_frame_mark(led_frame_t *frame, size_t end)
+{
+    if (end > frame->dirty_end) {
+        frame->dirty_end = end;
+    }
+}
+
+// clip [start, start + count) to the frame, false if nothing is left. *skip is the number of pixels cut at the front
+static bool led_frame_clip(const led_frame_t *frame, int *start, int *count, int *skip)
+{
+    *skip = 0;
+    if (*start < 0) {
+        *skip = -*start;
+        *count -= *skip;
+        *start = 0;
+    }
+    if (*count <= 0 || (size_t)*start >= frame->num_pixels) {
+        return false;
+    }
+    if ((size_t)*count > frame->num_pixels - *start) {
+        *count = frame->num_pixels - *start;
+    }
+    return true;
+}
+
+esp_err_t led_frame_init(led_frame_t *frame, led_strip_chip_t chip, size_t num_pixels)
+{
+    ESP_RETURN_ON_FALSE(frame && num_pixels, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    const led_strip_chip_info_t *chip_info = led_strip_get_chip_info(chip);
+    ESP_RETURN_ON_FALSE(chip_info, ESP_ERR_INVALID_ARG, TAG, "unknown chip");
+    memset(frame, 0, sizeof(led_frame_t));
+    frame->chip = chip_info;
+    frame->num_pixels = num_pixels;
+    // malloc alignment covers 32-bit words, the padding up to the next word stays zero
+    frame->pixels = calloc(led_frame_size_words(frame), sizeof(uint32_t));
+    ESP_RETURN_ON_FALSE(frame->pixels, ESP_ERR_NO_MEM, TAG, "no mem for pixels");
+    return ESP_OK;
+}
+
+void led_frame_deinit(led_frame_t *frame)
+{
+    free(frame->pixels);
+    frame->pixels = NULL;
+}
+
+uint8_t *led_frame_get_pixels(led_frame_t *frame)
+{
+    frame->dirty_end = frame->num_pixels;
+    return frame->pixels;
+}
+
+void led_frame_set_pixel(led_frame_t *frame, int index, uint8_t r, uint8_t g, uint8_t b)
+{
+    const led_strip_chip_info_t *chip = frame->chip;
+    size_t bytes_per_pixel = chip->bytes_per_pixel;
+    if (index < 0 || (size_t)index >= frame->num_pixels) {
+        return;
+    }
+    uint8_t *pixel = frame->pixels + index * bytes_per_pixel;
+    if (pixel[chip->red] != r || pixel[chip->green] != g || pixel[chip->blue] != b ||
+        (bytes_per_pixel == 4 && pixel[chip->white])) {
+        pixel[chip->red] = r;
+        pixel[chip->green] = g;
+        pixel[chip->blue] = b;
+        if (bytes_per_pixel == 4) {
+            pixel[chip->white] = 0;
+        }
+        led_frame_mark(frame, index + 1);
+    }
+}
+
+void led_frame_fill(led_frame_t *frame, int start, int count, uint8_t r, uint8_t g, uint8_t b)
+{
+    int skip;
+    if (!led_frame_clip(frame, &start, &count, &skip)) {
+        return;
+    }
+    const led_strip_chip_info_t *chip = frame->chip;
+    size_t bytes_per_pixel = chip->bytes_per_pixel;
+    uint8_t color[4] = {0};
+    color[chip->red] = r;
+    color[chip->green] = g;
+    color[chip->blue] = b;
+
+    uint8_t *p = frame->pixels + start * bytes_per_pixel;
+    uint8_t *end = p + count * bytes_per_pixel;
+    // bytes up to the first word boundary
+    size_t phase = 0;
+    while (p < end && ((uintptr_t)p & 3)) {
+        *p++ = color[phase];
+        phase = phase + 1 == bytes_per_pixel ? 0 : phase + 1;
+    }
+    // the color repeats every bytes_per_pixel words: 1 word of GRBW, 3 words of 4 GRB pixels
+    uint32_t pattern[4];
+    uint8_t *pattern_bytes = (uint8_t *)pattern;
+    for (size_t i = 0; i < bytes_per_pixel * 4; i++) {
+        pattern_bytes[i] = color[(phase + i) % bytes_per_pixel];
+    }
+    uint32_t *word = (uint32_t *)p;
+    size_t num_words = (end - p) / 4;
+    if (bytes_per_pixel == 4) {
+        for (size_t i = 0; i < num_words; i++) {
+            word[i] = pattern[0];
+        }
+    } else {
+        size_t i = 0;
+        for (; i + 3 <= num_words; i += 3) {
+            word[i] = pattern[0];
+            word[i + 1] = pattern[1];
+            word[i + 2] = pattern[2];
+        }
+        for (size_t j = 0; i < num_words; i++, j++) {
+            word[i] = pattern[j];
+        }
+    }
+    // bytes after the last whole word
+    for (size_t i = num_words * 4; p + i < end; i++) {
+        p[i] = pattern_bytes[i % (bytes_per_pixel * 4)];
+    }
+    led_frame_mark(frame, start + count);
+}
+
+void led_frame_clear(led_frame_t *frame)
+{
+    uint32_t *words = (uint32_t *)frame->pixels;
+    // only the part up to the last lit pixel changes, the padding after the last pixel is always zero
+    size_t lit_words = led_frame_size_words(frame);
+    while (lit_words && !words[lit_words - 1]) {
+        lit_words--;
+    }
+    if (lit_words) {
+        size_t lit_end = lit_words * sizeof(uint32_t);
+        while (!frame->pixels[lit_end - 1]) {
+            lit_end--;
+        }
+        memset(words, 0, lit_words * sizeof(uint32_t));
+        size_t bytes_per_pixel = frame->chip->bytes_per_pixel;
+        led_frame_mark(frame, (lit_end + bytes_per_pixel - 1) / bytes_per_pixel);
+    }
+}
+
+void led_frame_blit(led_frame_t *frame, int start, const uint8_t *pixels, int count)
+{
+    int skip;
+    if (!led_frame_clip(frame, &start, &count, &skip)) {
+        return;
+    }
+    size_t bytes_per_pixel = frame->chip->bytes_per_pixel;
+    memcpy(frame->pixels + start * bytes_per_pixel, pixels + skip * bytes_per_pixel, count * bytes_per_pixel);
+    led_frame_mark(frame, start + count);
+}
+
+void led_frame_scale(led_frame_t *frame, uint8_t scale)
+{
+    uint32_t *words = (uint32_t *)frame->pixels;
+    uint32_t factor = scale + 1;
+    size_t changed_words = 0;
+    for (size_t i = 0; i < led_frame_size_words(frame); i++) {
+        uint32_t word = words[i];
+        // two bytes per multiply, each 16-bit lane holds at most 255 * 256
+        uint32_t even = ((word & 0x00FF00FF) * factor >> 8) & 0x00FF00FF;
+        uint32_t odd = (((word >> 8) & 0x00FF00FF) * factor) & 0xFF00FF00;
+        uint32_t scaled = even | odd;
+        words[i] = scaled;
+        changed_words = scaled != word ? i + 1 : changed_words;
+    }
+    if (changed_words) {
+        size_t bytes_per_pixel = frame->chip->bytes_per_pixel;
+        size_t pixel_end = (changed_words * sizeof(uint32_t) + bytes_per_pixel - 1) / bytes_per_pixel;
+        led_frame_mark(frame, pixel_end < frame->num_pixels ? pixel_end : frame->num_pixels);
+    }
+}
+
+void led_frame_shift(led_frame_t *frame, int offset)
+{
+    size_t bytes_per_pixel = frame->chip->bytes_per_pixel;
+    size_t distance = offset < 0 ? -(size_t)offset : (size_t)offset;
+    if (!distance) {
+        return;
+    }
+    if (distance >= frame->num_pixels) {
+        led_frame_clear(frame);
+        return;
+    }
+    size_t moved = (frame->num_pixels - distance) * bytes_per_pixel;
+    size_t vacated = distance * bytes_per_pixel;
+    if (offset > 0) {
+        memmove(frame->pixels + vacated, frame->pixels, moved);
+        memset(frame->pixels, 0, vacated);
+    } else {
+        memmove(frame->pixels, frame->pixels + vacated, moved);
+        memset(frame->pixels + moved, 0, vacated);
+    }
+    frame->dirty_end = frame->num_pixels;
+}
+
+void led_frame_rotate(led_frame_t *frame, int offset)
+{
+    size_t num_pixels = frame->num_pixels;
+    size_t bytes_per_pixel = frame->chip->bytes_per_pixel;
+    // rotate towards higher indexes by up, or towards lower ones by num_pixels - up, whichever is shorter
+    size_t up = offset < 0 ? num_pixels - (-(size_t)offset % num_pixels) : (size_t)offset % num_pixels;
+    if (up == num_pixels || !up) {
+        return;
+    }
+    bool towards_end = up <= num_pixels / 2;
+    size_t distance = towards_end ? up : num_pixels - up;
+    uint8_t saved[LED_FRAME_ROTATE_CHUNK * 4];
+    while (distance) {
+        size_t step = distance < LED_FRAME_ROTATE_CHUNK ? distance : LED_FRAME_ROTATE_CHUNK;
+        size_t moved = (num_pixels - step) * bytes_per_pixel;
+        size_t wrapped = step * bytes_per_pixel;
+        if (towards_end) {
+            memcpy(saved, frame->pixels + moved, wrapped);
+            memmove(frame->pixels + wrapped, frame->pixels, moved);
+            memcpy(frame->pixels, saved, wrapped);
+        } else {
+            memcpy(saved, frame->pixels, wrapped);
+            memmove(frame->pixels, frame->pixels + wrapped, moved);
+            memcpy(frame->pixels + moved, saved, wrapped);
+        }
+        distance -= step;
+    }
+    frame->dirty_end = num_pixels;
+}
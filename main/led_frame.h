@@ -0,0 +1,133 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "led_strip_encoder.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief LED frame buffer
+ *
+ * Pixel bytes of a whole strip, laid out as the chip's profile says (GRB for WS2812). The storage is word aligned and
+ * padded with zeros to whole words, so the bulk operations below write 32 bits at a time and check the bounds once
+ * per call instead of once per pixel. Every operation tracks the highest pixel it may have changed in `dirty_end`,
+ * which `led_strip_pipeline_present` uses to trim the unchanged tail of the strip.
+ *
+ * A frame has a single writer, the operations take no locks.
+ */
+typedef struct {
+    uint8_t *pixels;                   /*!< Pixel bytes, 4 byte aligned */
+    size_t num_pixels;                 /*!< Number of pixels */
+    const led_strip_chip_info_t *chip; /*!< Pixel layout */
+    size_t dirty_end;                  /*!< One past the highest pixel changed since the owner last reset it */
+} led_frame_t;
+
+/**
+ * @brief Allocate the pixels of a frame, all off
+ *
+ * @param[out] frame Frame to initialize
+ * @param[in] chip LED chip, gives the pixel layout
+ * @param[in] num_pixels Number of pixels
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_ERR_NO_MEM out of memory when allocating the pixels
+ *      - ESP_OK if initializing the frame successfully
+ */
+esp_err_t led_frame_init(led_frame_t *frame, led_strip_chip_t chip, size_t num_pixels);
+
+/**
+ * @brief Free the pixels of a frame
+ *
+ * @param[in] frame Frame, may be zero initialized and never initialized
+ */
+void led_frame_deinit(led_frame_t *frame);
+
+/**
+ * @brief Get the pixel bytes for direct writes
+ *
+ * @note Marks the whole frame as changed, prefer the operations below which only mark what they touch.
+ *
+ * @param[in] frame Frame
+ * @return `num_pixels * bytes_per_pixel` bytes of pixel data, 4 byte aligned
+ */
+uint8_t *led_frame_get_pixels(led_frame_t *frame);
+
+/**
+ * @brief Set the color of one pixel
+ *
+ * @note The white channel of RGBW chips is turned off. The frame is only marked as changed if the color differs.
+ *
+ * @param[in] frame Frame
+ * @param[in] index Pixel index, out of range indexes are ignored
+ * @param[in] r Red
+ * @param[in] g Green
+ * @param[in] b Blue
+ */
+void led_frame_set_pixel(led_frame_t *frame, int index, uint8_t r, uint8_t g, uint8_t b);
+
+/**
+ * @brief Set a range of pixels to one color
+ *
+ * @note The white channel of RGBW chips is turned off.
+ *
+ * @param[in] frame Frame
+ * @param[in] start First pixel, the range is clipped to the frame
+ * @param[in] count Number of pixels
+ * @param[in] r Red
+ * @param[in] g Green
+ * @param[in] b Blue
+ */
+void led_frame_fill(led_frame_t *frame, int start, int count, uint8_t r, uint8_t g, uint8_t b);
+
+/**
+ * @brief Turn every pixel off
+ *
+ * @note Only the part up to the last lit pixel is written and marked as changed.
+ *
+ * @param[in] frame Frame
+ */
+void led_frame_clear(led_frame_t *frame);
+
+/**
+ * @brief Copy pixels into a range of the frame
+ *
+ * @param[in] frame Frame
+ * @param[in] start Pixel the first source pixel goes to, the range is clipped to the frame
+ * @param[in] pixels Source pixels, in the frame's layout (`bytes_per_pixel` bytes each, color offsets of the chip)
+ * @param[in] count Number of source pixels
+ */
+void led_frame_blit(led_frame_t *frame, int start, const uint8_t *pixels, int count);
+
+/**
+ * @brief Scale every channel of every pixel, for fades
+ *
+ * Each byte becomes `byte * (scale + 1) / 256`, so 255 keeps the frame and 0 turns it off.
+ *
+ * @param[in] frame Frame
+ * @param[in] scale Scale, 0-255
+ */
+void led_frame_scale(led_frame_t *frame, uint8_t scale);
+
+/**
+ * @brief Move all pixels along the strip, pixels moved in from outside are off
+ *
+ * @param[in] frame Frame
+ * @param[in] offset Number of pixels to move by, towards higher indexes if positive, lower ones if negative
+ */
+void led_frame_shift(led_frame_t *frame, int offset);
+
+/**
+ * @brief Move all pixels along the strip, pixels moved out at one end come back in at the other, for chases
+ *
+ * @param[in] frame Frame
+ * @param[in] offset Number of pixels to move by, towards higher indexes if positive, lower ones if negative
+ */
+void led_frame_rotate(led_frame_t *frame, int offset);
+
+#ifdef __cplusplus
+}
+#endif
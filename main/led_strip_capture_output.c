@@ -0,0 +1,104 @@
+#include <stdlib.h>
+#include <string.h>
+#include "esp_check.h"
+#include "led_strip_output.h"
+
+static const char *TAG = "led_capture";
+
+typedef struct {
+    led_strip_output_t base;
+    size_t frame_size;    // bytes of a whole frame
+    size_t max_frames;
+    size_t num_frames;    // frames transmitted so far, frame n is kept in slot n % max_frames
+    size_t *frame_pixels; // pixels carried by the frame in every slot
+    uint8_t *frames;
+} led_strip_capture_output_t;
+
+static esp_err_t led_strip_capture_output_enable(led_strip_output_t *output)
+{
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_capture_output_transmit(led_strip_output_t *output, const uint8_t *frame, size_t num_pixels,
+                                                   size_t *ret_pixels_sent)
+{
+    led_strip_capture_output_t *capture = __containerof(output, led_strip_capture_output_t, base);
+    size_t bytes_per_pixel = led_strip_get_chip_info(output->chip)->bytes_per_pixel;
+    ESP_RETURN_ON_FALSE(num_pixels * bytes_per_pixel <= capture->frame_size, ESP_ERR_INVALID_ARG, TAG, "frame too long");
+    size_t slot = capture->num_frames % capture->max_frames;
+    memcpy(capture->frames + slot * capture->frame_size, frame, num_pixels * bytes_per_pixel);
+    capture->frame_pixels[slot] = num_pixels;
+    capture->num_frames++;
+    *ret_pixels_sent = num_pixels;
+    if (output->on_done) {
+        output->on_done(output, output->done_ctx);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_capture_output_wait_all_done(led_strip_output_t *output, int timeout_ms)
+{
+    return ESP_OK;
+}
+
+static void led_strip_capture_output_free(led_strip_capture_output_t *capture)
+{
+    if (capture) {
+        free(capture->frame_pixels);
+        free(capture->frames);
+        free(capture);
+    }
+}
+
+static esp_err_t led_strip_capture_output_del(led_strip_output_t *output)
+{
+    led_strip_capture_output_free(__containerof(output, led_strip_capture_output_t, base));
+    return ESP_OK;
+}
+
+esp_err_t led_strip_new_capture_output(const led_strip_capture_output_config_t *config, led_strip_output_handle_t *ret_output)
+{
+    esp_err_t ret = ESP_OK;
+    led_strip_capture_output_t *capture = NULL;
+    ESP_GOTO_ON_FALSE(config && ret_output && config->num_pixels && config->max_frames &&
+                      led_strip_get_chip_info(config->chip), ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    capture = calloc(1, sizeof(led_strip_capture_output_t));
+    ESP_GOTO_ON_FALSE(capture, ESP_ERR_NO_MEM, err, TAG, "no mem for capture output");
+    capture->frame_size = config->num_pixels * led_strip_get_chip_info(config->chip)->bytes_per_pixel;
+    capture->max_frames = config->max_frames;
+    capture->frames = calloc(config->max_frames, capture->frame_size);
+    capture->frame_pixels = calloc(config->max_frames, sizeof(size_t));
+    ESP_GOTO_ON_FALSE(capture->frames && capture->frame_pixels, ESP_ERR_NO_MEM, err, TAG, "no mem for frames");
+    capture->base.chip = config->chip;
+    capture->base.enable = led_strip_capture_output_enable;
+    capture->base.transmit = led_strip_capture_output_transmit;
+    capture->base.wait_all_done = led_strip_capture_output_wait_all_done;
+    capture->base.del = led_strip_capture_output_del;
+    *ret_output = &capture->base;
+    return ESP_OK;
+err:
+    led_strip_capture_output_free(capture);
+    return ret;
+}
+
+const uint8_t *led_strip_capture_output_get_frame(led_strip_output_handle_t output, size_t index, size_t *ret_num_pixels)
+{
+    if (!output || output->transmit != led_strip_capture_output_transmit) {
+        return NULL;
+    }
+    led_strip_capture_output_t *capture = __containerof(output, led_strip_capture_output_t, base);
+    if (index >= capture->num_frames || capture->num_frames - index > capture->max_frames) {
+        return NULL;
+    }
+    size_t slot = index % capture->max_frames;
+    *ret_num_pixels = capture->frame_pixels[slot];
+    return capture->frames + slot * capture->frame_size;
+}
+
+size_t led_strip_capture_output_get_num_frames(led_strip_output_handle_t output)
+{
+    if (!output || output->transmit != led_strip_capture_output_transmit) {
+        return 0;
+    }
+    return __containerof(output, led_strip_capture_output_t, base)->num_frames;
+}
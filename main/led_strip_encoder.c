@@ -4,17 +4,46 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <math.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
 #include "esp_check.h"
 #include "led_strip_encoder.h"
 
 static const char *TAG = "led_encoder";
 
+// datasheet timings and tolerances
+static const led_strip_chip_info_t s_chips[LED_STRIP_CHIP_MAX] = {
+    [LED_STRIP_CHIP_WS2812] = {
+        .t0h_ns = 300, .t0l_ns = 900, .t1h_ns = 900, .t1l_ns = 300, .tolerance_ns = 150, .reset_us = 50,
+        .bytes_per_pixel = 3, .green = 0, .red = 1, .blue = 2,
+    },
+    [LED_STRIP_CHIP_SK6812_RGBW] = {
+        .t0h_ns = 300, .t0l_ns = 900, .t1h_ns = 600, .t1l_ns = 600, .tolerance_ns = 150, .reset_us = 80,
+        .bytes_per_pixel = 4, .green = 0, .red = 1, .blue = 2, .white = 3,
+    },
+    [LED_STRIP_CHIP_WS2811] = {
+        .t0h_ns = 250, .t0l_ns = 1000, .t1h_ns = 600, .t1l_ns = 650, .tolerance_ns = 150, .reset_us = 50,
+        .bytes_per_pixel = 3, .red = 0, .green = 1, .blue = 2,
+    },
+    [LED_STRIP_CHIP_WS2813] = {
+        .t0h_ns = 300, .t0l_ns = 900, .t1h_ns = 900, .t1l_ns = 300, .tolerance_ns = 150, .reset_us = 280,
+        .bytes_per_pixel = 3, .green = 0, .red = 1, .blue = 2,
+    },
+};
+
 typedef struct {
     rmt_encoder_t base;
-    rmt_encoder_t *bytes_encoder;
+    rmt_encoder_t *bytes_encoder; // encodes pixel bytes, either a bytes encoder or the LUT based simple encoder
     rmt_encoder_t *copy_encoder;
     int state;
     rmt_symbol_word_t reset_code;
+    float gamma;
+    const uint8_t *color_map;          // gamma and brightness, points into color_maps, NULL for the bytes encoder
+    uint8_t *pending_map;              // newest rebuilt table, taken over at the start of the next transaction
+    portMUX_TYPE spinlock;             // protects color_map and pending_map
+    uint8_t color_maps[3][256];        // the one being encoded, the pending one and the one being rebuilt
+    rmt_symbol_word_t symbol_lut[][8]; // byte -> 8 symbols, MSB first, only allocated for the LUT encoder
 } rmt_led_strip_encoder_t;
 
 RMT_ENCODER_FUNC_ATTR
@@ -54,6 +83,39 @@ out:
     return encoded_symbols;
 }
 
+RMT_ENCODER_FUNC_ATTR
+static size_t rmt_encode_led_strip_lut(const void *data, size_t data_size, size_t symbols_written, size_t symbols_free,
+                                       rmt_symbol_word_t *symbols, bool *done, void *arg)
+{
+    rmt_led_strip_encoder_t *led_encoder = (rmt_led_strip_encoder_t *)arg;
+    if (symbols_written == 0) {
+        // a brightness change only applies to whole frames
+        portENTER_CRITICAL_SAFE(&led_encoder->spinlock);
+        if (led_encoder->pending_map) {
+            led_encoder->color_map = led_encoder->pending_map;
+            led_encoder->pending_map = NULL;
+        }
+        portEXIT_CRITICAL_SAFE(&led_encoder->spinlock);
+    }
+    const uint8_t *color_map = led_encoder->color_map;
+    const uint8_t *bytes = (const uint8_t *)data + symbols_written / 8;
+    size_t num_bytes = data_size - symbols_written / 8;
+    if (num_bytes > symbols_free / 8) {
+        num_bytes = symbols_free / 8;
+    }
+    for (size_t i = 0; i < num_bytes; i++) {
+        const rmt_symbol_word_t *src = led_encoder->symbol_lut[color_map[bytes[i]]];
+        for (int bit = 0; bit < 8; bit++) {
+            symbols[bit] = src[bit];
+        }
+        symbols += 8;
+    }
+    if (symbols_written / 8 + num_bytes == data_size) {
+        *done = true;
+    }
+    return num_bytes * 8;
+}
+
 static esp_err_t rmt_del_led_strip_encoder(rmt_encoder_t *encoder)
 {
     rmt_led_strip_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_encoder_t, base);
@@ -73,46 +135,90 @@ static esp_err_t rmt_led_strip_encoder_reset(rmt_encoder_t *encoder)
     return ESP_OK;
 }
 
-esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+// nearest tick, a bit time is then off by half a tick at most
+static uint32_t led_strip_encoder_ticks(uint32_t resolution, uint32_t ns)
 {
-    esp_err_t ret = ESP_OK;
-    rmt_led_strip_encoder_t *led_encoder = NULL;
-    ESP_GOTO_ON_FALSE(config && ret_encoder, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
-    led_encoder = rmt_alloc_encoder_mem(sizeof(rmt_led_strip_encoder_t));
-    ESP_GOTO_ON_FALSE(led_encoder, ESP_ERR_NO_MEM, err, TAG, "no mem for led strip encoder");
-    led_encoder->base.encode = rmt_encode_led_strip;
-    led_encoder->base.del = rmt_del_led_strip_encoder;
-    led_encoder->base.reset = rmt_led_strip_encoder_reset;
-    // different led strip might have its own timing requirements, following parameter is for WS2812
-    rmt_bytes_encoder_config_t bytes_encoder_config = {
-        .bit0 = {
-            .level0 = 1,
-            .duration0 = 0.3 * config->resolution / 1000000, // T0H=0.3us
-            .level1 = 0,
-            .duration1 = 0.9 * config->resolution / 1000000, // T0L=0.9us
-        },
-        .bit1 = {
-            .level0 = 1,
-            .duration0 = 0.9 * config->resolution / 1000000, // T1H=0.9us
-            .level1 = 0,
-            .duration1 = 0.3 * config->resolution / 1000000, // T1L=0.3us
-        },
-        .flags.msb_first = 1 // WS2812 transfer bit order: G7...G0R7...R0B7...B0
+    return ((uint64_t)resolution * ns + 500000000) / 1000000000;
+}
+
+static bool led_strip_encoder_ticks_fit(uint32_t resolution, uint32_t ticks, uint32_t ns, uint32_t tolerance_ns)
+{
+    // compare in units of 1 / (resolution * 1e9) seconds to stay exact
+    int64_t error = (int64_t)ticks * 1000000000 - (int64_t)ns * resolution;
+    return ticks && ticks <= 0x7FFF && llabs(error) <= (int64_t)tolerance_ns * resolution;
+}
+
+static esp_err_t led_strip_encoder_bit_symbols(const led_strip_encoder_config_t *config, rmt_symbol_word_t *bit0, rmt_symbol_word_t *bit1)
+{
+    const led_strip_chip_info_t *chip = &s_chips[config->chip];
+    *bit0 = (rmt_symbol_word_t) {
+        .level0 = 1,
+        .duration0 = led_strip_encoder_ticks(config->resolution, chip->t0h_ns),
+        .level1 = 0,
+        .duration1 = led_strip_encoder_ticks(config->resolution, chip->t0l_ns),
     };
-    ESP_GOTO_ON_ERROR(rmt_new_bytes_encoder(&bytes_encoder_config, &led_encoder->bytes_encoder), err, TAG, "create bytes encoder failed");
+    *bit1 = (rmt_symbol_word_t) {
+        .level0 = 1,
+        .duration0 = led_strip_encoder_ticks(config->resolution, chip->t1h_ns),
+        .level1 = 0,
+        .duration1 = led_strip_encoder_ticks(config->resolution, chip->t1l_ns),
+    };
+    // a zero duration would end the transmission, and the rounding must keep every time within the chip's tolerance
+    uint32_t resolution = config->resolution;
+    uint32_t tolerance_ns = chip->tolerance_ns;
+    ESP_RETURN_ON_FALSE(led_strip_encoder_ticks_fit(resolution, bit0->duration0, chip->t0h_ns, tolerance_ns) &&
+                        led_strip_encoder_ticks_fit(resolution, bit0->duration1, chip->t0l_ns, tolerance_ns) &&
+                        led_strip_encoder_ticks_fit(resolution, bit1->duration0, chip->t1h_ns, tolerance_ns) &&
+                        led_strip_encoder_ticks_fit(resolution, bit1->duration1, chip->t1l_ns, tolerance_ns),
+                        ESP_ERR_INVALID_ARG, TAG, "resolution too low for the chip");
+    return ESP_OK;
+}
+
+static void led_strip_encoder_build_color_map(rmt_led_strip_encoder_t *led_encoder, uint8_t brightness)
+{
+    // neither the table being encoded nor the pending one, the ISR can only swap the pending one in meanwhile
+    portENTER_CRITICAL(&led_encoder->spinlock);
+    uint8_t *color_map = led_encoder->color_maps[0];
+    for (int i = 1; color_map == led_encoder->color_map || color_map == led_encoder->pending_map; i++) {
+        color_map = led_encoder->color_maps[i];
+    }
+    portEXIT_CRITICAL(&led_encoder->spinlock);
+    for (int value = 0; value < 256; value++) {
+        float linear = led_encoder->gamma > 0 ? powf(value / 255.0f, led_encoder->gamma) : value / 255.0f;
+        color_map[value] = (uint8_t)(linear * brightness + 0.5f);
+    }
+    portENTER_CRITICAL(&led_encoder->spinlock);
+    led_encoder->pending_map = color_map;
+    portEXIT_CRITICAL(&led_encoder->spinlock);
+}
+
+static esp_err_t led_strip_encoder_init_reset(const led_strip_encoder_config_t *config, rmt_led_strip_encoder_t *led_encoder)
+{
     rmt_copy_encoder_config_t copy_encoder_config = {};
-    ESP_GOTO_ON_ERROR(rmt_new_copy_encoder(&copy_encoder_config, &led_encoder->copy_encoder), err, TAG, "create copy encoder failed");
+    ESP_RETURN_ON_ERROR(rmt_new_copy_encoder(&copy_encoder_config, &led_encoder->copy_encoder), TAG, "create copy encoder failed");
 
-    uint32_t reset_ticks = config->resolution / 1000000 * 50 / 2; // reset code duration defaults to 50us
+    // the reset code is split across both halves of one symbol, rounded up so the strip always latches
+    uint32_t reset_ticks = ((uint64_t)config->resolution * s_chips[config->chip].reset_us + 1999999) / 2000000;
+    ESP_RETURN_ON_FALSE(reset_ticks && reset_ticks <= 0x7FFF, ESP_ERR_INVALID_ARG, TAG, "reset code out of range");
     led_encoder->reset_code = (rmt_symbol_word_t) {
         .level0 = 0,
         .duration0 = reset_ticks,
         .level1 = 0,
         .duration1 = reset_ticks,
     };
-    *ret_encoder = &led_encoder->base;
+    led_encoder->base.encode = rmt_encode_led_strip;
+    led_encoder->base.del = rmt_del_led_strip_encoder;
+    led_encoder->base.reset = rmt_led_strip_encoder_reset;
     return ESP_OK;
-err:
+}
+
+const led_strip_chip_info_t *led_strip_get_chip_info(led_strip_chip_t chip)
+{
+    return (unsigned)chip < LED_STRIP_CHIP_MAX ? &s_chips[chip] : NULL;
+}
+
+static void led_strip_encoder_free(rmt_led_strip_encoder_t *led_encoder)
+{
     if (led_encoder) {
         if (led_encoder->bytes_encoder) {
             rmt_del_encoder(led_encoder->bytes_encoder);
@@ -122,5 +228,72 @@ err:
         }
         free(led_encoder);
     }
+}
+
+esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+{
+    esp_err_t ret = ESP_OK;
+    rmt_led_strip_encoder_t *led_encoder = NULL;
+    ESP_GOTO_ON_FALSE(config && ret_encoder && (unsigned)config->chip < LED_STRIP_CHIP_MAX, ESP_ERR_INVALID_ARG, err,
+                      TAG, "invalid argument");
+    ESP_GOTO_ON_FALSE((config->gamma == 0 || config->gamma == 1) && (config->brightness == 0 || config->brightness == 255),
+                      ESP_ERR_NOT_SUPPORTED, err, TAG, "gamma and brightness need the LUT encoder");
+    led_encoder = rmt_alloc_encoder_mem(sizeof(rmt_led_strip_encoder_t));
+    ESP_GOTO_ON_FALSE(led_encoder, ESP_ERR_NO_MEM, err, TAG, "no mem for led strip encoder");
+    rmt_bytes_encoder_config_t bytes_encoder_config = {
+        .flags.msb_first = 1 // transfer bit order of every supported chip, e.g. WS2812: G7...G0R7...R0B7...B0
+    };
+    ESP_GOTO_ON_ERROR(led_strip_encoder_bit_symbols(config, &bytes_encoder_config.bit0, &bytes_encoder_config.bit1), err,
+                      TAG, "invalid bit timing");
+    ESP_GOTO_ON_ERROR(rmt_new_bytes_encoder(&bytes_encoder_config, &led_encoder->bytes_encoder), err, TAG, "create bytes encoder failed");
+    ESP_GOTO_ON_ERROR(led_strip_encoder_init_reset(config, led_encoder), err, TAG, "init reset code failed");
+    *ret_encoder = &led_encoder->base;
+    return ESP_OK;
+err:
+    led_strip_encoder_free(led_encoder);
+    return ret;
+}
+
+esp_err_t rmt_new_led_strip_lut_encoder(const led_strip_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+{
+    esp_err_t ret = ESP_OK;
+    rmt_led_strip_encoder_t *led_encoder = NULL;
+    ESP_GOTO_ON_FALSE(config && ret_encoder && (unsigned)config->chip < LED_STRIP_CHIP_MAX && config->gamma >= 0,
+                      ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    led_encoder = rmt_alloc_encoder_mem(sizeof(rmt_led_strip_encoder_t) + 256 * sizeof(led_encoder->symbol_lut[0]));
+    ESP_GOTO_ON_FALSE(led_encoder, ESP_ERR_NO_MEM, err, TAG, "no mem for led strip encoder");
+    // expand every possible byte once, so the ISR only copies symbols (transfer bit order is MSB first)
+    rmt_symbol_word_t bit0, bit1;
+    ESP_GOTO_ON_ERROR(led_strip_encoder_bit_symbols(config, &bit0, &bit1), err, TAG, "invalid bit timing");
+    for (int value = 0; value < 256; value++) {
+        for (int bit = 0; bit < 8; bit++) {
+            led_encoder->symbol_lut[value][bit] = (value & (0x80 >> bit)) ? bit1 : bit0;
+        }
+    }
+    led_encoder->gamma = config->gamma;
+    led_encoder->spinlock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+    led_strip_encoder_build_color_map(led_encoder, config->brightness ? config->brightness : 255);
+    led_encoder->color_map = led_encoder->pending_map;
+    led_encoder->pending_map = NULL;
+    rmt_simple_encoder_config_t simple_encoder_config = {
+        .callback = rmt_encode_led_strip_lut,
+        .arg = led_encoder,
+        .min_chunk_size = 8, // one byte worth of symbols
+    };
+    ESP_GOTO_ON_ERROR(rmt_new_simple_encoder(&simple_encoder_config, &led_encoder->bytes_encoder), err, TAG, "create simple encoder failed");
+    ESP_GOTO_ON_ERROR(led_strip_encoder_init_reset(config, led_encoder), err, TAG, "init reset code failed");
+    *ret_encoder = &led_encoder->base;
+    return ESP_OK;
+err:
+    led_strip_encoder_free(led_encoder);
     return ret;
 }
+
+esp_err_t rmt_led_strip_encoder_set_brightness(rmt_encoder_handle_t encoder, uint8_t brightness)
+{
+    ESP_RETURN_ON_FALSE(encoder && encoder->encode == rmt_encode_led_strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    rmt_led_strip_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_encoder_t, base);
+    ESP_RETURN_ON_FALSE(led_encoder->color_map, ESP_ERR_INVALID_ARG, TAG, "not a LUT encoder");
+    led_strip_encoder_build_color_map(led_encoder, brightness);
+    return ESP_OK;
+}
@@ -12,25 +12,101 @@
 extern "C" {
 #endif
 
+/**
+ * @brief LED chips with a built-in timing and pixel layout profile
+ */
+typedef enum {
+    LED_STRIP_CHIP_WS2812,      /*!< WS2812, GRB, 50us reset. The default */
+    LED_STRIP_CHIP_SK6812_RGBW, /*!< SK6812 RGBW, GRBW, 80us reset */
+    LED_STRIP_CHIP_WS2811,      /*!< WS2811 in 800kHz mode, RGB, 50us reset */
+    LED_STRIP_CHIP_WS2813,      /*!< WS2813, GRB, 280us reset */
+    LED_STRIP_CHIP_MAX,
+} led_strip_chip_t;
+
+/**
+ * @brief Timing and pixel layout of a LED chip
+ */
+typedef struct {
+    uint16_t t0h_ns;         /*!< High time of a 0 bit */
+    uint16_t t0l_ns;         /*!< Low time of a 0 bit */
+    uint16_t t1h_ns;         /*!< High time of a 1 bit */
+    uint16_t t1l_ns;         /*!< Low time of a 1 bit */
+    uint16_t tolerance_ns;   /*!< Deviation every high and low time may have */
+    uint16_t reset_us;       /*!< Low time that latches the data */
+    uint8_t bytes_per_pixel; /*!< 3 for RGB chips, 4 for RGBW chips */
+    uint8_t red;             /*!< Byte offsets of the colors in a pixel, white only with 4 bytes per pixel */
+    uint8_t green;
+    uint8_t blue;
+    uint8_t white;
+} led_strip_chip_info_t;
+
 /**
  * @brief Type of led strip encoder configuration
  */
 typedef struct {
-    uint32_t resolution; /*!< Encoder resolution, in Hz */
+    uint32_t resolution;   /*!< Encoder resolution, in Hz */
+    led_strip_chip_t chip; /*!< Timing of the bits and of the reset code, see `led_strip_get_chip_info` */
+    float gamma;           /*!< Gamma correction exponent, LUT encoder only. 0 or 1 keeps the pixel bytes linear */
+    uint8_t brightness;    /*!< Global brightness out of 255, LUT encoder only. 0 keeps the default of full brightness */
 } led_strip_encoder_config_t;
 
+/**
+ * @brief Get the timing and pixel layout of a LED chip
+ *
+ * @note The encoders take the pixel bytes in the chip's order and never reorder them, frames must be laid out
+ *       with `bytes_per_pixel` and the color offsets of the chip.
+ *
+ * @param[in] chip LED chip
+ * @return Chip profile, NULL if the chip is unknown
+ */
+const led_strip_chip_info_t *led_strip_get_chip_info(led_strip_chip_t chip);
+
 /**
  * @brief Create RMT encoder for encoding LED strip pixels into RMT symbols
  *
  * @param[in] config Encoder configuration
  * @param[out] ret_encoder Returned encoder handle
  * @return
- *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments, or a chip whose timing the resolution cannot express
+ *      - ESP_ERR_NOT_SUPPORTED if gamma or brightness is set, use `rmt_new_led_strip_lut_encoder` for those
  *      - ESP_ERR_NO_MEM out of memory when creating led strip encoder
  *      - ESP_OK if creating encoder successfully
  */
 esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder);
 
+/**
+ * @brief Create RMT encoder for LED strip pixels that expands bytes through a lookup table
+ *
+ * @note Produces the same symbols as `rmt_new_led_strip_encoder`, but each pixel byte is copied from a table of
+ *       256 x 8 symbols precomputed from the resolution, instead of being expanded bit by bit in the refill ISR.
+ *       The table costs 8KB of internal memory per encoder.
+ * @note Gamma correction and global brightness are applied on the fly through a 256-entry byte table, the pixel
+ *       buffer passed to `rmt_transmit` stays linear and untouched.
+ *
+ * @param[in] config Encoder configuration
+ * @param[out] ret_encoder Returned encoder handle
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments, or a chip whose timing the resolution cannot express
+ *      - ESP_ERR_NO_MEM out of memory when creating led strip encoder
+ *      - ESP_OK if creating encoder successfully
+ */
+esp_err_t rmt_new_led_strip_lut_encoder(const led_strip_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder);
+
+/**
+ * @brief Change the global brightness of a LUT encoder
+ *
+ * @note Only rebuilds the 256-entry byte table, frames are never touched. Takes effect from the next transaction,
+ *       a frame being sent keeps the brightness it started with. When called several times during one frame, the
+ *       last brightness wins. Call from one task at a time.
+ *
+ * @param[in] encoder Encoder created by `rmt_new_led_strip_lut_encoder`
+ * @param[in] brightness Brightness out of 255
+ * @return
+ *      - ESP_ERR_INVALID_ARG if the encoder is not a LUT LED strip encoder
+ *      - ESP_OK on success
+ */
+esp_err_t rmt_led_strip_encoder_set_brightness(rmt_encoder_handle_t encoder, uint8_t brightness);
+
 #ifdef __cplusplus
 }
 #endif
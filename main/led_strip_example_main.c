@@ -4,90 +4,65 @@
  * SPDX-License-Identifier: Unlicense OR CC0-1.0
  */
 #include <string.h>
+#include <inttypes.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "driver/rmt_tx.h"
 #include "led_strip_encoder.h"
+#include "led_strip_output.h"
+#include "led_strip_pipeline.h"
+#include "led_color.h"
+#include "frame_scheduler.h"
 
 #define RMT_LED_STRIP_RESOLUTION_HZ 10000000 // 10MHz resolution, 1 tick = 0.1us (led strip needs a high resolution)
 #define RMT_LED_STRIP_GPIO_NUM      16
+#define RMT_LED_STRIP_MEM_BLOCK_SYMBOLS CONFIG_LED_STRIP_RMT_MEM_BLOCK_SYMBOLS // RMT RAM or DMA buffer, see menuconfig
+#if CONFIG_LED_STRIP_RMT_WITH_DMA
+#define RMT_LED_STRIP_WITH_DMA      1
+#else
+#define RMT_LED_STRIP_WITH_DMA      0
+#endif
+_Static_assert(RMT_LED_STRIP_MEM_BLOCK_SYMBOLS % 2 == 0, "the RMT driver only takes an even number of symbols");
 
 #define EXAMPLE_LED_NUMBERS         72
 #define EXAMPLE_CHASE_SPEED_MS      10
+#define EXAMPLE_STATS_PERIOD_MS     5000
 
 static const char *TAG = "example";
 
-static uint8_t led_strip_pixels[EXAMPLE_LED_NUMBERS * 3];
-
-/**
- * @brief Simple helper function, converting HSV color space to RGB color space
- *
- * Wiki: https://en.wikipedia.org/wiki/HSL_and_HSV
- *
- */
-void led_strip_hsv2rgb(uint32_t h, uint32_t s, uint32_t v, uint32_t *r, uint32_t *g, uint32_t *b)
+// One chase step per frame: every third pixel starting at i lit, then all off, for i = 0..2, then the hue moves on
+static void render_rainbow_chase(uint32_t frame, uint32_t frame_time_us, void *user_ctx)
 {
-    h %= 360; // h -> [0,360]
-    uint32_t rgb_max = v * 2.55f;
-    uint32_t rgb_min = rgb_max * (100 - s) / 100.0f;
-
-    uint32_t i = h / 60;
-    uint32_t diff = h % 60;
-
-    // RGB adjustment amount by hue
-    uint32_t rgb_adj = (rgb_max - rgb_min) * diff / 60;
-
-    switch (i) {
-    case 0:
-        *r = rgb_max;
-        *g = rgb_min + rgb_adj;
-        *b = rgb_min;
-        break;
-    case 1:
-        *r = rgb_max - rgb_adj;
-        *g = rgb_max;
-        *b = rgb_min;
-        break;
-    case 2:
-        *r = rgb_min;
-        *g = rgb_max;
-        *b = rgb_min + rgb_adj;
-        break;
-    case 3:
-        *r = rgb_min;
-        *g = rgb_max - rgb_adj;
-        *b = rgb_max;
-        break;
-    case 4:
-        *r = rgb_min + rgb_adj;
-        *g = rgb_min;
-        *b = rgb_max;
-        break;
-    default:
-        *r = rgb_max;
-        *g = rgb_min;
-        *b = rgb_max - rgb_adj;
-        break;
+    led_strip_pipeline_handle_t led_pipeline = (led_strip_pipeline_handle_t)user_ctx;
+    uint32_t step = frame % 6;
+    uint32_t start_rgb = (frame / 6) * 60 % 360;
+    int i = step / 2;
+    led_frame_t *back = led_strip_pipeline_get_back_frame(led_pipeline);
+    if (step % 2 == 0) {
+        // Build RGB pixels, every third one starting at i, pixel j gets hue j * 360 / EXAMPLE_LED_NUMBERS + start_rgb
+        uint8_t *led_strip_pixels = led_frame_get_pixels(back);
+        led_color_fill_rainbow(&led_strip_pixels[i * 3], (EXAMPLE_LED_NUMBERS - i + 2) / 3, 3,
+                               LED_COLOR_HUE_Q8(start_rgb) + i * LED_COLOR_HUE_Q8(360) / EXAMPLE_LED_NUMBERS,
+                               3 * LED_COLOR_HUE_Q8(360) / EXAMPLE_LED_NUMBERS, 255, 255);
+    } else {
+        led_frame_clear(back);
     }
+    // Flush RGB values to LEDs
+    ESP_ERROR_CHECK(led_strip_pipeline_present(led_pipeline));
 }
 
 void app_main(void)
 {
-    uint32_t red = 0;
-    uint32_t green = 0;
-    uint32_t blue = 0;
-    uint16_t hue = 0;
-    uint16_t start_rgb = 0;
-
     ESP_LOGI(TAG, "Create RMT TX channel");
     rmt_channel_handle_t led_chan = NULL;
     rmt_tx_channel_config_t tx_chan_config = {
         .clk_src = RMT_CLK_SRC_DEFAULT, // select source clock
         .gpio_num = RMT_LED_STRIP_GPIO_NUM,
-        .mem_block_symbols = 64, // increase the block size can make the LED less flickering
+        .mem_block_symbols = RMT_LED_STRIP_MEM_BLOCK_SYMBOLS, // fewer, later refill interrupts as it grows
         .resolution_hz = RMT_LED_STRIP_RESOLUTION_HZ,
         .trans_queue_depth = 4, // set the number of transactions that can be pending in the background
+        .flags.with_dma = RMT_LED_STRIP_WITH_DMA,
     };
     ESP_ERROR_CHECK(rmt_new_tx_channel(&tx_chan_config, &led_chan));
 
@@ -98,32 +73,44 @@ void app_main(void)
     };
     ESP_ERROR_CHECK(rmt_new_led_strip_encoder(&encoder_config, &led_encoder));
 
+    led_strip_output_handle_t led_output = NULL;
+    led_strip_rmt_output_config_t output_config = {
+        .channels = &led_chan,
+        .encoders = &led_encoder,
+        .num_channels = 1,
+        .num_pixels = EXAMPLE_LED_NUMBERS,
+    };
+    ESP_ERROR_CHECK(led_strip_new_rmt_output(&output_config, &led_output));
+
+    ESP_LOGI(TAG, "Create LED frame pipeline");
+    led_strip_pipeline_handle_t led_pipeline = NULL;
+    led_strip_pipeline_config_t pipeline_config = {
+        .output = led_output,
+        .frame_size = EXAMPLE_LED_NUMBERS * 3,
+        .num_buffers = 2, // render the next frame while the current one is shifted out
+    };
+    ESP_ERROR_CHECK(led_strip_pipeline_new(&pipeline_config, &led_pipeline));
+
     ESP_LOGI(TAG, "Enable RMT TX channel");
-    ESP_ERROR_CHECK(rmt_enable(led_chan));
+    ESP_ERROR_CHECK(led_strip_pipeline_enable(led_pipeline));
 
     ESP_LOGI(TAG, "Start LED rainbow chase");
-    rmt_transmit_config_t tx_config = {
-        .loop_count = 0, // no transfer loop
+    frame_scheduler_handle_t scheduler = NULL;
+    frame_scheduler_config_t scheduler_config = {
+        .fps = 1000 / EXAMPLE_CHASE_SPEED_MS,
+        .render = render_rainbow_chase,
+        .user_ctx = led_pipeline,
+        .task_stack = 4096,
+        .task_priority = 5,
+        .task_core = tskNO_AFFINITY,
     };
+    ESP_ERROR_CHECK(frame_scheduler_new(&scheduler_config, &scheduler));
+    ESP_ERROR_CHECK(frame_scheduler_start(scheduler));
     while (1) {
-        for (int i = 0; i < 3; i++) {
-            for (int j = i; j < EXAMPLE_LED_NUMBERS; j += 3) {
-                // Build RGB pixels
-                hue = j * 360 / EXAMPLE_LED_NUMBERS + start_rgb;
-                led_strip_hsv2rgb(hue, 100, 100, &red, &green, &blue);
-                led_strip_pixels[j * 3 + 0] = green;
-                led_strip_pixels[j * 3 + 1] = blue;
-                led_strip_pixels[j * 3 + 2] = red;
-            }
-            // Flush RGB values to LEDs
-            ESP_ERROR_CHECK(rmt_transmit(led_chan, led_encoder, led_strip_pixels, sizeof(led_strip_pixels), &tx_config));
-            ESP_ERROR_CHECK(rmt_tx_wait_all_done(led_chan, portMAX_DELAY));
-            vTaskDelay(pdMS_TO_TICKS(EXAMPLE_CHASE_SPEED_MS));
-            memset(led_strip_pixels, 0, sizeof(led_strip_pixels));
-            ESP_ERROR_CHECK(rmt_transmit(led_chan, led_encoder, led_strip_pixels, sizeof(led_strip_pixels), &tx_config));
-            ESP_ERROR_CHECK(rmt_tx_wait_all_done(led_chan, portMAX_DELAY));
-            vTaskDelay(pdMS_TO_TICKS(EXAMPLE_CHASE_SPEED_MS));
-        }
-        start_rgb += 60;
+        vTaskDelay(pdMS_TO_TICKS(EXAMPLE_STATS_PERIOD_MS));
+        frame_scheduler_stats_t stats;
+        ESP_ERROR_CHECK(frame_scheduler_get_stats(scheduler, &stats));
+        ESP_LOGI(TAG, "Frames: %"PRIu32", missed deadlines: %"PRIu32", overruns: %"PRIu32", render: %"PRIu32" us (max %"PRIu32" us)",
+                 stats.frames_rendered, stats.deadlines_missed, stats.overruns, stats.render_us_last, stats.render_us_max);
     }
 }
@@ -0,0 +1,38 @@
+#include "esp_check.h"
+#include "led_strip_output.h"
+
+static const char *TAG = "led_output";
+
+esp_err_t led_strip_output_register_done_callback(led_strip_output_handle_t output, led_strip_output_done_cb_t on_done,
+                                                  void *user_ctx)
+{
+    ESP_RETURN_ON_FALSE(output, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    output->on_done = on_done;
+    output->done_ctx = user_ctx;
+    return ESP_OK;
+}
+
+esp_err_t led_strip_output_enable(led_strip_output_handle_t output)
+{
+    ESP_RETURN_ON_FALSE(output, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return output->enable(output);
+}
+
+esp_err_t led_strip_output_transmit(led_strip_output_handle_t output, const uint8_t *frame, size_t num_pixels,
+                                    size_t *ret_pixels_sent)
+{
+    ESP_RETURN_ON_FALSE(output && frame && num_pixels && ret_pixels_sent, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return output->transmit(output, frame, num_pixels, ret_pixels_sent);
+}
+
+esp_err_t led_strip_output_wait_all_done(led_strip_output_handle_t output, int timeout_ms)
+{
+    ESP_RETURN_ON_FALSE(output, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return output->wait_all_done(output, timeout_ms);
+}
+
+esp_err_t led_strip_del_output(led_strip_output_handle_t output)
+{
+    ESP_RETURN_ON_FALSE(output, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return output->del(output);
+}
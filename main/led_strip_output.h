@@ -0,0 +1,234 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/rmt_tx.h"
+#include "driver/spi_master.h"
+#include "led_strip_encoder.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Type of LED strip output handle
+ *
+ * An output shifts whole frames, or the prefix of a frame, out to the strip. The frame pipeline flushes through
+ * this interface, so the peripheral behind a strip is chosen where the output is created:
+ *      - `led_strip_new_rmt_output`: RMT TX channels and their LED strip encoders, one or more segments
+ *      - `led_strip_new_spi_output`: a SPI bus with DMA, every bit pre-expanded into SPI bit patterns
+ *      - `led_strip_new_capture_output`: frames kept in memory, for tests
+ */
+typedef struct led_strip_output_t led_strip_output_t;
+typedef led_strip_output_t *led_strip_output_handle_t;
+
+/**
+ * @brief Frame done callback, called once per transmitted frame and in order, possibly from an ISR
+ *
+ * @return Whether a high priority task has been woken up by this callback
+ */
+typedef bool (*led_strip_output_done_cb_t)(led_strip_output_handle_t output, void *user_ctx);
+
+/**
+ * @brief Interface of a LED strip output, implemented by every backend
+ */
+struct led_strip_output_t {
+    /**
+     * @brief Pixel layout of the frames the output takes
+     */
+    led_strip_chip_t chip;
+
+    /**
+     * @brief Get the peripheral ready to transmit
+     */
+    esp_err_t (*enable)(led_strip_output_t *output);
+
+    /**
+     * @brief Queue the first `num_pixels` pixels of a frame of the whole strip
+     *
+     * @note The frame must stay untouched until its done callback, only blocks while the output's queue is full.
+     * @note `ret_pixels_sent` returns the pixels actually shifted out, summed over all data lines.
+     */
+    esp_err_t (*transmit)(led_strip_output_t *output, const uint8_t *frame, size_t num_pixels, size_t *ret_pixels_sent);
+
+    /**
+     * @brief Wait until every queued frame has been shifted out
+     */
+    esp_err_t (*wait_all_done)(led_strip_output_t *output, int timeout_ms);
+
+    /**
+     * @brief Free the output, the RMT channels and encoders of a RMT output are left to the caller
+     */
+    esp_err_t (*del)(led_strip_output_t *output);
+
+    led_strip_output_done_cb_t on_done; /*!< Set by `led_strip_output_register_done_callback` */
+    void *done_ctx;
+};
+
+/**
+ * @brief Type of RMT output configuration
+ */
+typedef struct {
+    const rmt_channel_handle_t *channels; /*!< RMT TX channels, still in init state (not enabled), one per segment */
+    const rmt_encoder_handle_t *encoders; /*!< LED strip encoders, one per channel, encoders cannot be shared */
+    size_t num_channels;                  /*!< Number of channels, at most `SOC_RMT_TX_CANDIDATES_PER_GROUP` */
+    size_t num_pixels;                    /*!< Pixels of the whole logical strip */
+    led_strip_chip_t chip;                /*!< Pixel layout, must match the encoders' chip */
+} led_strip_rmt_output_config_t;
+
+/**
+ * @brief Type of SPI output configuration
+ */
+typedef struct {
+    spi_host_device_t spi_host; /*!< SPI bus, the output initializes it with DMA and frees it again */
+    gpio_num_t gpio_num;        /*!< GPIO of the data line, the bus MOSI */
+    size_t num_pixels;          /*!< Pixels of the strip */
+    led_strip_chip_t chip;      /*!< Timing and pixel layout */
+    float gamma;                /*!< Gamma correction exponent, folded into the bit patterns. 0 or 1 keeps the
+                                     pixel bytes linear */
+    size_t trans_queue_depth;   /*!< Frames that can be queued, one DMA buffer each */
+} led_strip_spi_output_config_t;
+
+/**
+ * @brief Type of capture output configuration
+ */
+typedef struct {
+    size_t num_pixels;     /*!< Pixels of the strip */
+    led_strip_chip_t chip; /*!< Pixel layout */
+    size_t max_frames;     /*!< Frames kept, older ones are dropped */
+} led_strip_capture_output_config_t;
+
+/**
+ * @brief Create an output on one or more RMT TX channels
+ *
+ * @note The strip is split into `num_channels` segments whose lengths differ by one pixel at most, channel i drives
+ *       the pixels from i * num_pixels / num_channels up to (i + 1) * num_pixels / num_channels, rounded down. With
+ *       more than one channel the segments start together through an RMT sync manager, installed by
+ *       `led_strip_output_enable`.
+ * @note Registers the channels' `on_trans_done` callback, the channels must not be used for other transmissions.
+ *
+ * @param[in] config Output configuration
+ * @param[out] ret_output Returned output handle
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_ERR_NO_MEM out of memory when creating the output
+ *      - ESP_OK if creating the output successfully
+ */
+esp_err_t led_strip_new_rmt_output(const led_strip_rmt_output_config_t *config, led_strip_output_handle_t *ret_output);
+
+/**
+ * @brief Create an output on a SPI bus with DMA
+ *
+ * @note Every LED bit becomes 3 to 8 SPI bits at a clock picked from the chip's timing, one LED byte exactly that
+ *       many SPI bytes. The patterns of all 256 byte values are computed once, a frame is expanded into a DMA buffer
+ *       with table lookups and goes out in a single transaction, without any refill interrupt. The buffers cost
+ *       up to 8 times the frame size each.
+ *
+ * @param[in] config Output configuration
+ * @param[out] ret_output Returned output handle
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_ERR_NOT_SUPPORTED if no SPI clock can reproduce the chip's timing
+ *      - ESP_ERR_NO_MEM out of memory when creating the output
+ *      - ESP_OK if creating the output successfully
+ *      - Other error codes from `spi_bus_initialize` and `spi_bus_add_device`
+ */
+esp_err_t led_strip_new_spi_output(const led_strip_spi_output_config_t *config, led_strip_output_handle_t *ret_output);
+
+/**
+ * @brief Create an output that keeps the transmitted frames in memory
+ *
+ * @note Frames are done as soon as they are transmitted.
+ *
+ * @param[in] config Output configuration
+ * @param[out] ret_output Returned output handle
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_ERR_NO_MEM out of memory when creating the output
+ *      - ESP_OK if creating the output successfully
+ */
+esp_err_t led_strip_new_capture_output(const led_strip_capture_output_config_t *config, led_strip_output_handle_t *ret_output);
+
+/**
+ * @brief Get a frame kept by a capture output
+ *
+ * @param[in] output Capture output handle
+ * @param[in] index Frame index, counted from the first frame ever transmitted
+ * @param[out] ret_num_pixels Returned number of pixels the frame carried
+ * @return Pixel bytes of the frame, NULL if there is no such frame or it has been dropped
+ */
+const uint8_t *led_strip_capture_output_get_frame(led_strip_output_handle_t output, size_t index, size_t *ret_num_pixels);
+
+/**
+ * @brief Get the number of frames a capture output has transmitted
+ *
+ * @param[in] output Capture output handle
+ * @return Number of frames
+ */
+size_t led_strip_capture_output_get_num_frames(led_strip_output_handle_t output);
+
+/**
+ * @brief Register the frame done callback, before enabling the output
+ *
+ * @param[in] output Output handle
+ * @param[in] on_done Callback
+ * @param[in] user_ctx User context passed to the callback
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_OK on success
+ */
+esp_err_t led_strip_output_register_done_callback(led_strip_output_handle_t output, led_strip_output_done_cb_t on_done,
+                                                  void *user_ctx);
+
+/**
+ * @brief Get the output ready to transmit
+ *
+ * @param[in] output Output handle
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_OK if the output is enabled
+ *      - Other error codes from the backend
+ */
+esp_err_t led_strip_output_enable(led_strip_output_handle_t output);
+
+/**
+ * @brief Queue the first pixels of a frame, see `led_strip_output_t::transmit`
+ *
+ * @param[in] output Output handle
+ * @param[in] frame Pixel bytes of the whole strip, laid out as the output's chip says
+ * @param[in] num_pixels Number of pixels to send, at least 1
+ * @param[out] ret_pixels_sent Returned number of pixels shifted out, summed over all data lines
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_OK if the frame was queued
+ *      - Other error codes from the backend
+ */
+esp_err_t led_strip_output_transmit(led_strip_output_handle_t output, const uint8_t *frame, size_t num_pixels,
+                                    size_t *ret_pixels_sent);
+
+/**
+ * @brief Wait until every queued frame has been shifted out
+ *
+ * @param[in] output Output handle
+ * @param[in] timeout_ms Wait timeout, in ms. Specially, -1 means to wait forever.
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_ERR_TIMEOUT if frames are still pending after the timeout
+ *      - ESP_OK if all frames are done
+ */
+esp_err_t led_strip_output_wait_all_done(led_strip_output_handle_t output, int timeout_ms);
+
+/**
+ * @brief Delete an output
+ *
+ * @param[in] output Output handle
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_OK if deleting the output successfully
+ */
+esp_err_t led_strip_del_output(led_strip_output_handle_t output);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,194 @@
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_attr.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "led_strip_pipeline.h"
+
+static const char *TAG = "led_pipeline";
+
+typedef struct led_strip_pipeline_t led_strip_pipeline_t;
+
+struct led_strip_pipeline_t {
+    led_strip_output_handle_t output;
+    uint32_t frames_done;              // frames the output has finished, written from its done callback only
+    size_t frame_size;
+    size_t bytes_per_pixel;
+    size_t num_buffers;
+    SemaphoreHandle_t free_sem; // counts buffers whose transmission has finished
+    size_t back_index;          // buffers are used round robin, transmissions finish in the same order
+    bool synced;                // the strip shows the last sent frame, false until the first one goes out
+    led_strip_pipeline_stats_t stats;
+    latency_histogram_t *submit_latency;
+    latency_histogram_t *done_latency; // written from the done callback only
+    bool has_origin;                   // the back buffer reacts to an input at origin_us
+    uint32_t origin_us;
+    struct {
+        bool has_origin;
+        uint32_t origin_us;
+    } *in_flight;                      // origin of every buffer, indexed like frames
+    led_frame_t frames[];              // dirty_end of the back frame counts from the last sent frame
+};
+
+static bool IRAM_ATTR led_strip_pipeline_on_frame_done(led_strip_output_handle_t output, void *user_ctx)
+{
+    led_strip_pipeline_t *pipeline = (led_strip_pipeline_t *)user_ctx;
+    BaseType_t high_task_wakeup = pdFALSE;
+    // frames are sent round robin, so frame n (counting from 1) went out of buffer (n - 1) % num_buffers
+    size_t index = pipeline->frames_done++ % pipeline->num_buffers;
+    if (pipeline->done_latency && pipeline->in_flight[index].has_origin) {
+        latency_histogram_record(pipeline->done_latency, (uint32_t)esp_timer_get_time() - pipeline->in_flight[index].origin_us);
+    }
+    xSemaphoreGiveFromISR(pipeline->free_sem, &high_task_wakeup);
+    return high_task_wakeup == pdTRUE;
+}
+
+static void led_strip_pipeline_free(led_strip_pipeline_t *pipeline)
+{
+    if (pipeline) {
+        if (pipeline->free_sem) {
+            vSemaphoreDelete(pipeline->free_sem);
+        }
+        free(pipeline->in_flight);
+        for (size_t i = 0; i < pipeline->num_buffers; i++) {
+            led_frame_deinit(&pipeline->frames[i]);
+        }
+        free(pipeline);
+    }
+}
+
+esp_err_t led_strip_pipeline_new(const led_strip_pipeline_config_t *config, led_strip_pipeline_handle_t *ret_pipeline)
+{
+    esp_err_t ret = ESP_OK;
+    led_strip_pipeline_t *pipeline = NULL;
+    ESP_GOTO_ON_FALSE(config && ret_pipeline && config->output && config->frame_size && config->num_buffers >= 2,
+                      ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    const led_strip_chip_info_t *chip = led_strip_get_chip_info(config->output->chip);
+    ESP_GOTO_ON_FALSE(config->frame_size % chip->bytes_per_pixel == 0, ESP_ERR_INVALID_ARG, err, TAG,
+                      "frame size is not a number of pixels");
+    pipeline = calloc(1, sizeof(led_strip_pipeline_t) + config->num_buffers * sizeof(led_frame_t));
+    ESP_GOTO_ON_FALSE(pipeline, ESP_ERR_NO_MEM, err, TAG, "no mem for pipeline");
+    pipeline->num_buffers = config->num_buffers;
+    pipeline->in_flight = calloc(config->num_buffers, sizeof(*pipeline->in_flight));
+    ESP_GOTO_ON_FALSE(pipeline->in_flight, ESP_ERR_NO_MEM, err, TAG, "no mem for frame origins");
+    pipeline->submit_latency = config->submit_latency;
+    pipeline->done_latency = config->done_latency;
+    for (size_t i = 0; i < config->num_buffers; i++) {
+        ESP_GOTO_ON_ERROR(led_frame_init(&pipeline->frames[i], config->output->chip, config->frame_size / chip->bytes_per_pixel),
+                          err, TAG, "init frame buffer failed");
+    }
+    // every buffer but the back buffer is free in the beginning
+    pipeline->free_sem = xSemaphoreCreateCounting(config->num_buffers, config->num_buffers - 1);
+    ESP_GOTO_ON_FALSE(pipeline->free_sem, ESP_ERR_NO_MEM, err, TAG, "no mem for semaphore");
+    pipeline->frame_size = config->frame_size;
+    pipeline->bytes_per_pixel = chip->bytes_per_pixel;
+    pipeline->output = config->output;
+    ESP_GOTO_ON_ERROR(led_strip_output_register_done_callback(config->output, led_strip_pipeline_on_frame_done, pipeline),
+                      err, TAG, "register done callback failed");
+    *ret_pipeline = pipeline;
+    return ESP_OK;
+err:
+    led_strip_pipeline_free(pipeline);
+    return ret;
+}
+
+esp_err_t led_strip_pipeline_enable(led_strip_pipeline_handle_t pipeline)
+{
+    ESP_RETURN_ON_FALSE(pipeline, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return led_strip_output_enable(pipeline->output);
+}
+
+led_frame_t *led_strip_pipeline_get_back_frame(led_strip_pipeline_handle_t pipeline)
+{
+    return &pipeline->frames[pipeline->back_index];
+}
+
+uint8_t *led_strip_pipeline_get_frame(led_strip_pipeline_handle_t pipeline)
+{
+    return led_frame_get_pixels(&pipeline->frames[pipeline->back_index]);
+}
+
+void led_strip_pipeline_set_pixel(led_strip_pipeline_handle_t pipeline, int index, uint8_t r, uint8_t g, uint8_t b)
+{
+    led_frame_set_pixel(&pipeline->frames[pipeline->back_index], index, r, g, b);
+}
+
+void led_strip_pipeline_clear(led_strip_pipeline_handle_t pipeline)
+{
+    led_frame_clear(&pipeline->frames[pipeline->back_index]);
+}
+
+void led_strip_pipeline_set_origin(led_strip_pipeline_handle_t pipeline, uint32_t origin_us)
+{
+    if (!pipeline->has_origin || (int32_t)(origin_us - pipeline->origin_us) < 0) {
+        pipeline->origin_us = origin_us;
+    }
+    pipeline->has_origin = true;
+}
+
+esp_err_t led_strip_pipeline_present(led_strip_pipeline_handle_t pipeline)
+{
+    ESP_RETURN_ON_FALSE(pipeline, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    led_frame_t *back = &pipeline->frames[pipeline->back_index];
+    const uint8_t *frame = back->pixels;
+    const uint8_t *last_frame = pipeline->frames[(pipeline->back_index + pipeline->num_buffers - 1) % pipeline->num_buffers].pixels;
+    size_t bytes_per_pixel = pipeline->bytes_per_pixel;
+    size_t num_pixels = pipeline->frame_size / bytes_per_pixel;
+    if (pipeline->synced) {
+        // WS2812 pixels keep their color when the data ends early, so only the prefix up to the last pixel that
+        // differs from the strip needs to go out. A clear followed by the same redraw ends up with nothing to send.
+        num_pixels = back->dirty_end;
+        while (num_pixels && memcmp(&frame[(num_pixels - 1) * bytes_per_pixel], &last_frame[(num_pixels - 1) * bytes_per_pixel],
+                                    bytes_per_pixel) == 0) {
+            num_pixels--;
+        }
+        if (!num_pixels) {
+            pipeline->stats.frames_skipped++;
+            back->dirty_end = 0;
+            pipeline->has_origin = false;
+            return ESP_OK;
+        }
+    }
+    // set before transmitting, the done callback can fire before the call returns
+    pipeline->in_flight[pipeline->back_index].has_origin = pipeline->has_origin;
+    pipeline->in_flight[pipeline->back_index].origin_us = pipeline->origin_us;
+    size_t pixels_sent = 0;
+    ESP_RETURN_ON_ERROR(led_strip_output_transmit(pipeline->output, frame, num_pixels, &pixels_sent), TAG, "transmit failed");
+    pipeline->stats.pixels_sent += pixels_sent;
+    if (pipeline->has_origin && pipeline->submit_latency) {
+        latency_histogram_record(pipeline->submit_latency, (uint32_t)esp_timer_get_time() - pipeline->origin_us);
+    }
+    pipeline->has_origin = false;
+    pipeline->stats.frames_sent++;
+    back->dirty_end = 0;
+    pipeline->synced = true;
+    pipeline->back_index = (pipeline->back_index + 1) % pipeline->num_buffers;
+    // the next back buffer is the oldest one in flight, wait for the output to release it
+    xSemaphoreTake(pipeline->free_sem, portMAX_DELAY);
+    // the new back frame was reset when it was presented itself, or has never been written
+    memcpy(pipeline->frames[pipeline->back_index].pixels, frame, pipeline->frame_size);
+    return ESP_OK;
+}
+
+esp_err_t led_strip_pipeline_get_stats(led_strip_pipeline_handle_t pipeline, led_strip_pipeline_stats_t *ret_stats)
+{
+    ESP_RETURN_ON_FALSE(pipeline && ret_stats, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    *ret_stats = pipeline->stats;
+    return ESP_OK;
+}
+
+esp_err_t led_strip_pipeline_wait_all_done(led_strip_pipeline_handle_t pipeline, int timeout_ms)
+{
+    ESP_RETURN_ON_FALSE(pipeline, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return led_strip_output_wait_all_done(pipeline->output, timeout_ms);
+}
+
+esp_err_t led_strip_pipeline_del(led_strip_pipeline_handle_t pipeline)
+{
+    ESP_RETURN_ON_FALSE(pipeline, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_ERROR(led_strip_pipeline_wait_all_done(pipeline, -1), TAG, "wait for pending frames failed");
+    led_strip_pipeline_free(pipeline);
+    return ESP_OK;
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "latency_histogram.h"
+#include "led_frame.h"
+#include "led_strip_output.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Type of LED strip frame pipeline handle
+ *
+ * The pipeline owns several frame buffers and rotates them: the application renders into the back buffer while
+ * the output (see `led_strip_output.h`) shifts out the frames that were presented before it. Buffers are recycled
+ * from the output's frame done callback, so presenting a frame never waits for its own transmission.
+ */
+typedef struct led_strip_pipeline_t *led_strip_pipeline_handle_t;
+
+/**
+ * @brief Type of LED strip frame pipeline configuration
+ */
+typedef struct {
+    led_strip_output_handle_t output;     /*!< Output the frames go to, in the pixel layout of its chip */
+    size_t frame_size;                    /*!< Size of one frame of the whole logical strip, in bytes */
+    size_t num_buffers;                   /*!< Number of frame buffers, at least 2 and not more than the output's queue depth */
+    latency_histogram_t *submit_latency;  /*!< Optional, origin to the transmit call of frames with an origin */
+    latency_histogram_t *done_latency;    /*!< Optional, origin to the end of transmission on every data line,
+                                               recorded from the output's done callback */
+} led_strip_pipeline_config_t;
+
+/**
+ * @brief Frame pipeline statistics
+ */
+typedef struct {
+    uint32_t frames_sent;    /*!< Frames handed to the output */
+    uint32_t frames_skipped; /*!< Presents skipped because nothing changed since the last sent frame */
+    uint32_t pixels_sent;    /*!< Pixels shifted out, summed over all data lines. Frames only carry the prefix up to
+                                  the last changed pixel, plus at least one pixel per RMT channel */
+} led_strip_pipeline_stats_t;
+
+/**
+ * @brief Create a frame pipeline on top of an output
+ *
+ * @note Registers the output's frame done callback, the output must not be used for other transmissions.
+ *
+ * @param[in] config Pipeline configuration
+ * @param[out] ret_pipeline Returned pipeline handle
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_ERR_NO_MEM out of memory when creating the pipeline
+ *      - ESP_OK if creating the pipeline successfully
+ */
+esp_err_t led_strip_pipeline_new(const led_strip_pipeline_config_t *config, led_strip_pipeline_handle_t *ret_pipeline);
+
+/**
+ * @brief Enable the pipeline's output
+ *
+ * @param[in] pipeline Pipeline handle
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_OK if the output is enabled
+ *      - Other error codes from `led_strip_output_enable`
+ */
+esp_err_t led_strip_pipeline_enable(led_strip_pipeline_handle_t pipeline);
+
+/**
+ * @brief Get the back buffer to render the next frame into, for the bulk operations of `led_frame.h`
+ *
+ * @note The back buffer starts as a copy of the last presented frame, so partial updates are fine.
+ * @note The frame changes with every present, get it again for each frame.
+ *
+ * @param[in] pipeline Pipeline handle
+ * @return Back frame, owned by the pipeline
+ */
+led_frame_t *led_strip_pipeline_get_back_frame(led_strip_pipeline_handle_t pipeline);
+
+/**
+ * @brief Get the pixel bytes of the back buffer, same as `led_frame_get_pixels` on the back frame
+ *
+ * @note The back buffer starts as a copy of the last presented frame, so partial updates are fine.
+ * @note Direct access marks the whole frame as changed, prefer the operations of `led_frame.h` which only do so
+ *       for the pixels they touch.
+ *
+ * @param[in] pipeline Pipeline handle
+ * @return Pointer to `frame_size` bytes of pixel data, laid out as the chip's profile says (GRB for WS2812)
+ */
+uint8_t *led_strip_pipeline_get_frame(led_strip_pipeline_handle_t pipeline);
+
+/**
+ * @brief Set the color of one pixel in the back buffer, same as `led_frame_set_pixel` on the back frame
+ *
+ * @note The white channel of RGBW chips is turned off.
+ *
+ * @param[in] pipeline Pipeline handle
+ * @param[in] index Pixel index, out of range indexes are ignored
+ * @param[in] r Red
+ * @param[in] g Green
+ * @param[in] b Blue
+ */
+void led_strip_pipeline_set_pixel(led_strip_pipeline_handle_t pipeline, int index, uint8_t r, uint8_t g, uint8_t b);
+
+/**
+ * @brief Turn every pixel of the back buffer off, same as `led_frame_clear` on the back frame
+ *
+ * @param[in] pipeline Pipeline handle
+ */
+void led_strip_pipeline_clear(led_strip_pipeline_handle_t pipeline);
+
+/**
+ * @brief Tag the back buffer with the time of the input it reacts to
+ *
+ * @note When the frame goes out, the time from the origin to its submission and to the end of its transmission is
+ *       recorded in the configured latency histograms. The earliest origin of a frame wins, frames skipped because
+ *       nothing changed record nothing.
+ *
+ * @param[in] pipeline Pipeline handle
+ * @param[in] origin_us Input time, on the `esp_timer_get_time` clock truncated to 32 bits
+ */
+void led_strip_pipeline_set_origin(led_strip_pipeline_handle_t pipeline, uint32_t origin_us);
+
+/**
+ * @brief Queue the back buffer for transmission and switch to the next buffer
+ *
+ * @note Only blocks while all other buffers are still queued in the output.
+ * @note Only the pixels up to the last one that differs from the last sent frame are transmitted, the rest of the
+ *       strip keeps its colors. If nothing changed, nothing is transmitted.
+ *
+ * @param[in] pipeline Pipeline handle
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_OK if the frame was queued successfully
+ *      - Other error codes from `led_strip_output_transmit`
+ */
+esp_err_t led_strip_pipeline_present(led_strip_pipeline_handle_t pipeline);
+
+/**
+ * @brief Get the sent and skipped frame counters
+ *
+ * @param[in] pipeline Pipeline handle
+ * @param[out] ret_stats Returned statistics
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_OK on success
+ */
+esp_err_t led_strip_pipeline_get_stats(led_strip_pipeline_handle_t pipeline, led_strip_pipeline_stats_t *ret_stats);
+
+/**
+ * @brief Wait until every presented frame has been shifted out
+ *
+ * @param[in] pipeline Pipeline handle
+ * @param[in] timeout_ms Wait timeout, in ms. Specially, -1 means to wait forever.
+ * @return
+ *      - ESP_ERR_TIMEOUT if frames are still pending after the timeout
+ *      - ESP_OK if all frames are done
+ */
+esp_err_t led_strip_pipeline_wait_all_done(led_strip_pipeline_handle_t pipeline, int timeout_ms);
+
+/**
+ * @brief Delete the pipeline after waiting for pending frames
+ *
+ * @note The output is not deleted.
+ *
+ * @param[in] pipeline Pipeline handle
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_OK if deleting the pipeline successfully
+ */
+esp_err_t led_strip_pipeline_del(led_strip_pipeline_handle_t pipeline);
+
+#ifdef __cplusplus
+}
+#endif
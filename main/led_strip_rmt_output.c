@@ -0,0 +1,166 @@
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_attr.h"
+#include "esp_check.h"
+#include "soc/soc_caps.h"
+#include "led_strip_output.h"
+
+static const char *TAG = "led_rmt_output";
+
+typedef struct led_strip_rmt_output_t led_strip_rmt_output_t;
+
+typedef struct {
+    led_strip_rmt_output_t *rmt_output;
+    rmt_channel_handle_t channel;
+    rmt_encoder_handle_t encoder;
+    size_t first_pixel;      // segment of the logical strip driven by this channel
+    size_t num_pixels;
+    uint32_t frames_done;    // transmissions finished on this channel
+} led_strip_rmt_segment_t;
+
+struct led_strip_rmt_output_t {
+    led_strip_output_t base;
+    led_strip_rmt_segment_t segments[SOC_RMT_TX_CANDIDATES_PER_GROUP];
+    size_t num_segments;
+    size_t num_pixels;
+    size_t bytes_per_pixel;
+    rmt_sync_manager_handle_t synchro; // starts all segments together, only with more than one channel
+    portMUX_TYPE spinlock;             // protects frames_done and frames_released
+    uint32_t frames_released;          // frames finished on every channel
+};
+
+static bool IRAM_ATTR led_strip_rmt_output_on_trans_done(rmt_channel_handle_t channel, const rmt_tx_done_event_data_t *edata, void *user_ctx)
+{
+    led_strip_rmt_segment_t *segment = (led_strip_rmt_segment_t *)user_ctx;
+    led_strip_rmt_output_t *rmt_output = segment->rmt_output;
+    bool released = false;
+    // a frame is done once the last of its segments has been shifted out
+    portENTER_CRITICAL_ISR(&rmt_output->spinlock);
+    segment->frames_done++;
+    uint32_t frames_done = segment->frames_done;
+    for (size_t i = 0; i < rmt_output->num_segments; i++) {
+        if (rmt_output->segments[i].frames_done < frames_done) {
+            frames_done = rmt_output->segments[i].frames_done;
+        }
+    }
+    if (frames_done != rmt_output->frames_released) {
+        rmt_output->frames_released = frames_done;
+        released = true;
+    }
+    portEXIT_CRITICAL_ISR(&rmt_output->spinlock);
+    if (released && rmt_output->base.on_done) {
+        return rmt_output->base.on_done(&rmt_output->base, rmt_output->base.done_ctx);
+    }
+    return false;
+}
+
+static esp_err_t led_strip_rmt_output_enable(led_strip_output_t *output)
+{
+    led_strip_rmt_output_t *rmt_output = __containerof(output, led_strip_rmt_output_t, base);
+    rmt_channel_handle_t channels[SOC_RMT_TX_CANDIDATES_PER_GROUP];
+    for (size_t i = 0; i < rmt_output->num_segments; i++) {
+        channels[i] = rmt_output->segments[i].channel;
+        ESP_RETURN_ON_ERROR(rmt_enable(channels[i]), TAG, "enable channel %zu failed", i);
+    }
+    if (rmt_output->num_segments > 1 && !rmt_output->synchro) {
+        // channels must be enabled before they can join a sync manager
+        rmt_sync_manager_config_t synchro_config = {
+            .tx_channel_array = channels,
+            .array_size = rmt_output->num_segments,
+        };
+        ESP_RETURN_ON_ERROR(rmt_new_sync_manager(&synchro_config, &rmt_output->synchro), TAG, "create sync manager failed");
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_output_transmit(led_strip_output_t *output, const uint8_t *frame, size_t num_pixels,
+                                               size_t *ret_pixels_sent)
+{
+    led_strip_rmt_output_t *rmt_output = __containerof(output, led_strip_rmt_output_t, base);
+    rmt_transmit_config_t tx_config = {
+        .loop_count = 0, // no transfer loop
+    };
+    ESP_RETURN_ON_FALSE(num_pixels <= rmt_output->num_pixels, ESP_ERR_INVALID_ARG, TAG, "frame longer than the strip");
+    size_t pixels_sent = 0;
+    for (size_t i = 0; i < rmt_output->num_segments; i++) {
+        led_strip_rmt_segment_t *segment = &rmt_output->segments[i];
+        size_t segment_pixels = segment->num_pixels;
+        if (num_pixels < segment->first_pixel + segment_pixels) {
+            // every channel of a sync group has to transmit before any of them starts, so a segment the prefix does
+            // not reach resends its own first pixel, unchanged. Segments are never empty, that pixel is in the frame
+            segment_pixels = num_pixels > segment->first_pixel ? num_pixels - segment->first_pixel : 1;
+        }
+        ESP_RETURN_ON_ERROR(rmt_transmit(segment->channel, segment->encoder, &frame[segment->first_pixel * rmt_output->bytes_per_pixel],
+                                         segment_pixels * rmt_output->bytes_per_pixel, &tx_config),
+                            TAG, "transmit segment %zu failed", i);
+        pixels_sent += segment_pixels;
+    }
+    *ret_pixels_sent = pixels_sent;
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_output_wait_all_done(led_strip_output_t *output, int timeout_ms)
+{
+    led_strip_rmt_output_t *rmt_output = __containerof(output, led_strip_rmt_output_t, base);
+    for (size_t i = 0; i < rmt_output->num_segments; i++) {
+        ESP_RETURN_ON_ERROR(rmt_tx_wait_all_done(rmt_output->segments[i].channel, timeout_ms), TAG, "wait channel %zu failed", i);
+    }
+    return ESP_OK;
+}
+
+static void led_strip_rmt_output_free(led_strip_rmt_output_t *rmt_output)
+{
+    if (rmt_output) {
+        if (rmt_output->synchro) {
+            rmt_del_sync_manager(rmt_output->synchro);
+        }
+        free(rmt_output);
+    }
+}
+
+static esp_err_t led_strip_rmt_output_del(led_strip_output_t *output)
+{
+    led_strip_rmt_output_free(__containerof(output, led_strip_rmt_output_t, base));
+    return ESP_OK;
+}
+
+esp_err_t led_strip_new_rmt_output(const led_strip_rmt_output_config_t *config, led_strip_output_handle_t *ret_output)
+{
+    esp_err_t ret = ESP_OK;
+    led_strip_rmt_output_t *rmt_output = NULL;
+    ESP_GOTO_ON_FALSE(config && ret_output && config->channels && config->encoders && led_strip_get_chip_info(config->chip),
+                      ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    ESP_GOTO_ON_FALSE(config->num_channels >= 1 && config->num_channels <= SOC_RMT_TX_CANDIDATES_PER_GROUP &&
+                      config->num_channels <= config->num_pixels, ESP_ERR_INVALID_ARG, err, TAG, "invalid number of channels");
+    rmt_output = calloc(1, sizeof(led_strip_rmt_output_t));
+    ESP_GOTO_ON_FALSE(rmt_output, ESP_ERR_NO_MEM, err, TAG, "no mem for rmt output");
+    rmt_output->spinlock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+    rmt_output->bytes_per_pixel = led_strip_get_chip_info(config->chip)->bytes_per_pixel;
+    rmt_output->num_pixels = config->num_pixels;
+
+    // split the strip as evenly as possible, segment lengths differ by one pixel at most and none is empty
+    rmt_output->num_segments = config->num_channels;
+    for (size_t i = 0; i < config->num_channels; i++) {
+        led_strip_rmt_segment_t *segment = &rmt_output->segments[i];
+        ESP_GOTO_ON_FALSE(config->channels[i] && config->encoders[i], ESP_ERR_INVALID_ARG, err, TAG, "invalid channel %zu", i);
+        segment->rmt_output = rmt_output;
+        segment->channel = config->channels[i];
+        segment->encoder = config->encoders[i];
+        segment->first_pixel = i * config->num_pixels / config->num_channels;
+        segment->num_pixels = (i + 1) * config->num_pixels / config->num_channels - segment->first_pixel;
+        rmt_tx_event_callbacks_t cbs = {
+            .on_trans_done = led_strip_rmt_output_on_trans_done,
+        };
+        ESP_GOTO_ON_ERROR(rmt_tx_register_event_callbacks(segment->channel, &cbs, segment), err, TAG, "register callbacks failed");
+    }
+    rmt_output->base.chip = config->chip;
+    rmt_output->base.enable = led_strip_rmt_output_enable;
+    rmt_output->base.transmit = led_strip_rmt_output_transmit;
+    rmt_output->base.wait_all_done = led_strip_rmt_output_wait_all_done;
+    rmt_output->base.del = led_strip_rmt_output_del;
+    *ret_output = &rmt_output->base;
+    return ESP_OK;
+err:
+    led_strip_rmt_output_free(rmt_output);
+    return ret;
+}
@@ -0,0 +1,228 @@
+#include <inttypes.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_attr.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "led_strip_output.h"
+
+static const char *TAG = "led_spi_output";
+
+#define SPI_OUTPUT_MIN_BITS     3   // SPI bits per LED bit, a 0 and a 1 need distinct high times and a low time
+#define SPI_OUTPUT_MAX_BITS     8
+
+typedef struct {
+    led_strip_output_t base;
+    spi_host_device_t spi_host;
+    spi_device_handle_t device;
+    size_t frame_size;       // bytes of a whole frame
+    size_t bits_per_bit;     // SPI bits per LED bit, also SPI bytes per LED byte
+    size_t reset_bytes;      // zero bytes after the pixels, the reset code
+    size_t queue_depth;
+    size_t next;             // transaction and buffer of the next frame, used round robin
+    size_t in_flight;        // frames queued and not reaped with spi_device_get_trans_result yet
+    spi_transaction_t *trans;
+    uint8_t **buffers;       // DMA capable, one per transaction
+    uint8_t patterns[256][SPI_OUTPUT_MAX_BITS]; // byte -> SPI bytes, gamma included
+} led_strip_spi_output_t;
+
+static void IRAM_ATTR led_strip_spi_output_post_cb(spi_transaction_t *trans)
+{
+    led_strip_output_t *output = (led_strip_output_t *)trans->user;
+    if (output->on_done && output->on_done(output, output->done_ctx)) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+static esp_err_t led_strip_spi_output_enable(led_strip_output_t *output)
+{
+    return ESP_OK;
+}
+
+// take back the oldest frame, its transaction and buffer can be reused afterwards
+static esp_err_t led_strip_spi_output_reap(led_strip_spi_output_t *spi_output, TickType_t ticks_to_wait)
+{
+    spi_transaction_t *trans = NULL;
+    ESP_RETURN_ON_ERROR(spi_device_get_trans_result(spi_output->device, &trans, ticks_to_wait), TAG, "frame not done");
+    spi_output->in_flight--;
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_output_transmit(led_strip_output_t *output, const uint8_t *frame, size_t num_pixels,
+                                               size_t *ret_pixels_sent)
+{
+    led_strip_spi_output_t *spi_output = __containerof(output, led_strip_spi_output_t, base);
+    size_t num_bytes = num_pixels * led_strip_get_chip_info(output->chip)->bytes_per_pixel;
+    ESP_RETURN_ON_FALSE(num_bytes <= spi_output->frame_size, ESP_ERR_INVALID_ARG, TAG, "frame too long");
+    if (spi_output->in_flight == spi_output->queue_depth) {
+        ESP_RETURN_ON_ERROR(led_strip_spi_output_reap(spi_output, portMAX_DELAY), TAG, "reap failed");
+    }
+    // every byte expands to exactly bits_per_bit bytes, MSB first like the LED data
+    uint8_t *buffer = spi_output->buffers[spi_output->next];
+    uint8_t *dst = buffer;
+    size_t bits_per_bit = spi_output->bits_per_bit;
+    for (size_t i = 0; i < num_bytes; i++) {
+        memcpy(dst, spi_output->patterns[frame[i]], bits_per_bit);
+        dst += bits_per_bit;
+    }
+    memset(dst, 0, spi_output->reset_bytes);
+    dst += spi_output->reset_bytes;
+
+    spi_transaction_t *trans = &spi_output->trans[spi_output->next];
+    *trans = (spi_transaction_t) {
+        .length = (dst - buffer) * 8,
+        .tx_buffer = buffer,
+        .user = output,
+    };
+    ESP_RETURN_ON_ERROR(spi_device_queue_trans(spi_output->device, trans, portMAX_DELAY), TAG, "queue frame failed");
+    spi_output->in_flight++;
+    spi_output->next = (spi_output->next + 1) % spi_output->queue_depth;
+    *ret_pixels_sent = num_pixels;
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_output_wait_all_done(led_strip_output_t *output, int timeout_ms)
+{
+    led_strip_spi_output_t *spi_output = __containerof(output, led_strip_spi_output_t, base);
+    TickType_t ticks_to_wait = timeout_ms < 0 ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    while (spi_output->in_flight) {
+        ESP_RETURN_ON_FALSE(led_strip_spi_output_reap(spi_output, ticks_to_wait) == ESP_OK, ESP_ERR_TIMEOUT, TAG,
+                            "frames still pending");
+    }
+    return ESP_OK;
+}
+
+static void led_strip_spi_output_free(led_strip_spi_output_t *spi_output)
+{
+    if (spi_output) {
+        if (spi_output->device) {
+            spi_bus_remove_device(spi_output->device);
+            spi_bus_free(spi_output->spi_host);
+        }
+        if (spi_output->buffers) {
+            for (size_t i = 0; i < spi_output->queue_depth; i++) {
+                heap_caps_free(spi_output->buffers[i]);
+            }
+        }
+        free(spi_output->buffers);
+        free(spi_output->trans);
+        free(spi_output);
+    }
+}
+
+static esp_err_t led_strip_spi_output_del(led_strip_output_t *output)
+{
+    led_strip_spi_output_t *spi_output = __containerof(output, led_strip_spi_output_t, base);
+    ESP_RETURN_ON_ERROR(led_strip_spi_output_wait_all_done(output, -1), TAG, "wait for pending frames failed");
+    led_strip_spi_output_free(spi_output);
+    return ESP_OK;
+}
+
+// Pick the number of SPI bits per LED bit whose high times come closest to the chip's, the SPI clock follows from it
+static size_t led_strip_spi_output_pick_bits(const led_strip_chip_info_t *chip, size_t *ret_high0, size_t *ret_high1)
+{
+    double bit_ns = chip->t0h_ns + chip->t0l_ns;
+    size_t best_bits = 0;
+    double best_error = chip->tolerance_ns;
+    for (size_t bits = SPI_OUTPUT_MIN_BITS; bits <= SPI_OUTPUT_MAX_BITS; bits++) {
+        double unit_ns = bit_ns / bits;
+        size_t high0 = lround(chip->t0h_ns / unit_ns);
+        size_t high1 = lround(chip->t1h_ns / unit_ns);
+        if (high0 < 1 || high1 <= high0 || high1 >= bits) {
+            continue;
+        }
+        double error = fmax(fabs(high0 * unit_ns - chip->t0h_ns), fabs(high1 * unit_ns - chip->t1h_ns));
+        if (error < best_error) {
+            best_error = error;
+            best_bits = bits;
+            *ret_high0 = high0;
+            *ret_high1 = high1;
+        }
+    }
+    return best_bits;
+}
+
+static void led_strip_spi_output_build_patterns(led_strip_spi_output_t *spi_output, float gamma, size_t high0, size_t high1)
+{
+    size_t bits_per_bit = spi_output->bits_per_bit;
+    for (int value = 0; value < 256; value++) {
+        // same rounding as the LUT encoder's color map
+        float linear = gamma > 0 ? powf(value / 255.0f, gamma) : value / 255.0f;
+        uint8_t mapped = (uint8_t)(linear * 255 + 0.5f);
+        uint8_t *pattern = spi_output->patterns[value];
+        memset(pattern, 0, SPI_OUTPUT_MAX_BITS);
+        for (size_t bit = 0; bit < 8; bit++) {
+            size_t high = (mapped & (0x80 >> bit)) ? high1 : high0;
+            for (size_t i = 0; i < high; i++) {
+                size_t spi_bit = bit * bits_per_bit + i;
+                pattern[spi_bit / 8] |= 0x80 >> (spi_bit % 8);
+            }
+        }
+    }
+}
+
+esp_err_t led_strip_new_spi_output(const led_strip_spi_output_config_t *config, led_strip_output_handle_t *ret_output)
+{
+    esp_err_t ret = ESP_OK;
+    led_strip_spi_output_t *spi_output = NULL;
+    ESP_GOTO_ON_FALSE(config && ret_output && config->num_pixels && config->trans_queue_depth && config->gamma >= 0 &&
+                      led_strip_get_chip_info(config->chip), ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    const led_strip_chip_info_t *chip = led_strip_get_chip_info(config->chip);
+    spi_output = calloc(1, sizeof(led_strip_spi_output_t));
+    ESP_GOTO_ON_FALSE(spi_output, ESP_ERR_NO_MEM, err, TAG, "no mem for spi output");
+    size_t high0 = 0, high1 = 0;
+    spi_output->bits_per_bit = led_strip_spi_output_pick_bits(chip, &high0, &high1);
+    ESP_GOTO_ON_FALSE(spi_output->bits_per_bit, ESP_ERR_NOT_SUPPORTED, err, TAG, "no SPI clock fits the chip");
+    uint32_t clock_hz = (uint64_t)spi_output->bits_per_bit * 1000000000 / (chip->t0h_ns + chip->t0l_ns);
+    led_strip_spi_output_build_patterns(spi_output, config->gamma, high0, high1);
+    spi_output->spi_host = config->spi_host;
+    spi_output->frame_size = config->num_pixels * chip->bytes_per_pixel;
+    spi_output->reset_bytes = ((uint64_t)chip->reset_us * clock_hz + 7999999) / 8000000;
+    size_t buffer_size = spi_output->frame_size * spi_output->bits_per_bit + spi_output->reset_bytes;
+
+    spi_output->queue_depth = config->trans_queue_depth;
+    spi_output->trans = calloc(config->trans_queue_depth, sizeof(spi_transaction_t));
+    spi_output->buffers = calloc(config->trans_queue_depth, sizeof(uint8_t *));
+    ESP_GOTO_ON_FALSE(spi_output->trans && spi_output->buffers, ESP_ERR_NO_MEM, err, TAG, "no mem for transactions");
+    for (size_t i = 0; i < config->trans_queue_depth; i++) {
+        spi_output->buffers[i] = heap_caps_calloc(1, buffer_size, MALLOC_CAP_DMA);
+        ESP_GOTO_ON_FALSE(spi_output->buffers[i], ESP_ERR_NO_MEM, err, TAG, "no mem for DMA buffer");
+    }
+
+    // the strip only needs the data line, no clock or chip select
+    spi_bus_config_t bus_config = {
+        .mosi_io_num = config->gpio_num,
+        .miso_io_num = -1,
+        .sclk_io_num = -1,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = buffer_size,
+    };
+    ESP_GOTO_ON_ERROR(spi_bus_initialize(config->spi_host, &bus_config, SPI_DMA_CH_AUTO), err, TAG, "init SPI bus failed");
+    spi_device_interface_config_t device_config = {
+        .mode = 0,
+        .clock_speed_hz = clock_hz,
+        .spics_io_num = -1,
+        .queue_size = config->trans_queue_depth,
+        .post_cb = led_strip_spi_output_post_cb,
+    };
+    ret = spi_bus_add_device(config->spi_host, &device_config, &spi_output->device);
+    if (ret != ESP_OK) {
+        spi_bus_free(config->spi_host);
+        ESP_GOTO_ON_ERROR(ret, err, TAG, "add SPI device failed");
+    }
+    ESP_LOGD(TAG, "%zu SPI bits per LED bit at %"PRIu32" Hz, %zu byte DMA buffers", spi_output->bits_per_bit, clock_hz,
+             buffer_size);
+    spi_output->base.chip = config->chip;
+    spi_output->base.enable = led_strip_spi_output_enable;
+    spi_output->base.transmit = led_strip_spi_output_transmit;
+    spi_output->base.wait_all_done = led_strip_spi_output_wait_all_done;
+    spi_output->base.del = led_strip_spi_output_del;
+    *ret_output = &spi_output->base;
+    return ESP_OK;
+err:
+    led_strip_spi_output_free(spi_output);
+    return ret;
+}
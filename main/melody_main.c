@@ -4,36 +4,26 @@
 #include "esp_log.h"
 #include "driver/rmt_tx.h"
 #include "led_strip_encoder.h"
+#include "led_strip_output.h"
+#include "led_strip_pipeline.h"
+#include "song_library.h"
+#include "keyboard_layout.h"
 
+#define LED_STRIP_CHIP              LED_STRIP_CHIP_WS2812 // timing and pixel layout of the strip
 #define RMT_LED_STRIP_RESOLUTION_HZ 10000000 // 10MHz resolution, 1 tick = 0.1us (led strip needs a high resolution)
 #define RMT_LED_STRIP_GPIO_NUM      16
+#define RMT_LED_STRIP_MEM_BLOCK_SYMBOLS CONFIG_LED_STRIP_RMT_MEM_BLOCK_SYMBOLS // RMT RAM or DMA buffer, see menuconfig
+#if CONFIG_LED_STRIP_RMT_WITH_DMA
+#define RMT_LED_STRIP_WITH_DMA      1
+#else
+#define RMT_LED_STRIP_WITH_DMA      0
+#endif
+_Static_assert(RMT_LED_STRIP_MEM_BLOCK_SYMBOLS % 2 == 0, "the RMT driver only takes an even number of symbols");
 
-#define EXAMPLE_LED_NUMBERS         72
+#define SONG_PARTITION_LABEL        "songs"
 
 static const char *TAG = "melody_example";
 
-static uint8_t led_strip_pixels[EXAMPLE_LED_NUMBERS * 3];
-
-// Define notes and melody
-#define NOTE_C4 30
-#define NOTE_D4 32
-#define NOTE_E4 34
-#define NOTE_G4 37
-
-// Simple melody structure
-typedef struct {
-    int note_led;
-    int duration_ms;
-} musical_note_t;
-
-// A simple melody (e.g., part of "Mary Had a Little Lamb")
-musical_note_t melody[] = {
-    {NOTE_E4, 300}, {NOTE_D4, 300}, {NOTE_C4, 300}, {NOTE_D4, 300},
-    {NOTE_E4, 300}, {NOTE_E4, 300}, {NOTE_E4, 600},
-    {NOTE_D4, 300}, {NOTE_D4, 300}, {NOTE_D4, 600},
-    {NOTE_E4, 300}, {NOTE_G4, 300}, {NOTE_G4, 600},
-};
-
 void app_main(void)
 {
     ESP_LOGI(TAG, "Create RMT TX channel");
@@ -41,9 +31,10 @@ void app_main(void)
     rmt_tx_channel_config_t tx_chan_config = {
         .clk_src = RMT_CLK_SRC_DEFAULT, // select source clock
         .gpio_num = RMT_LED_STRIP_GPIO_NUM,
-        .mem_block_symbols = 64, // increase the block size can make the LED less flickering
+        .mem_block_symbols = RMT_LED_STRIP_MEM_BLOCK_SYMBOLS, // fewer, later refill interrupts as it grows
         .resolution_hz = RMT_LED_STRIP_RESOLUTION_HZ,
         .trans_queue_depth = 4, // set the number of transactions that can be pending in the background
+        .flags.with_dma = RMT_LED_STRIP_WITH_DMA,
     };
     ESP_ERROR_CHECK(rmt_new_tx_channel(&tx_chan_config, &led_chan));
 
@@ -51,40 +42,68 @@ void app_main(void)
     rmt_encoder_handle_t led_encoder = NULL;
     led_strip_encoder_config_t encoder_config = {
         .resolution = RMT_LED_STRIP_RESOLUTION_HZ,
+        .chip = LED_STRIP_CHIP,
     };
     ESP_ERROR_CHECK(rmt_new_led_strip_encoder(&encoder_config, &led_encoder));
 
-    ESP_LOGI(TAG, "Enable RMT TX channel");
-    ESP_ERROR_CHECK(rmt_enable(led_chan));
-
-    ESP_LOGI(TAG, "Start playing melody");
-    rmt_transmit_config_t tx_config = {
-        .loop_count = 0, // no transfer loop
+    led_strip_output_handle_t led_output = NULL;
+    led_strip_rmt_output_config_t output_config = {
+        .channels = &led_chan,
+        .encoders = &led_encoder,
+        .num_channels = 1,
+        .num_pixels = KEYBOARD_NUM_LEDS,
+        .chip = LED_STRIP_CHIP,
     };
+    ESP_ERROR_CHECK(led_strip_new_rmt_output(&output_config, &led_output));
+
+    ESP_LOGI(TAG, "Create LED frame pipeline");
+    led_strip_pipeline_handle_t led_pipeline = NULL;
+    led_strip_pipeline_config_t pipeline_config = {
+        .output = led_output,
+        .frame_size = KEYBOARD_NUM_LEDS * led_strip_get_chip_info(LED_STRIP_CHIP)->bytes_per_pixel,
+        .num_buffers = 2, // render the next frame while the current one is shifted out
+    };
+    ESP_ERROR_CHECK(led_strip_pipeline_new(&pipeline_config, &led_pipeline));
 
-    int melody_len = sizeof(melody) / sizeof(melody[0]);
-
-    while (1) {
-        for (int i = 0; i < melody_len; i++) {
-            // 1. Clear all LEDs to turn them off
-            memset(led_strip_pixels, 0, sizeof(led_strip_pixels));
-
-            // 2. Light up the LED for the current note (in blue)
-            int led_index = melody[i].note_led;
-            if (led_index >= 0 && led_index < EXAMPLE_LED_NUMBERS) {
-                led_strip_pixels[led_index * 3 + 0] = 0;   // Green
-                led_strip_pixels[led_index * 3 + 1] = 255; // Blue
-                led_strip_pixels[led_index * 3 + 2] = 0;   // Red
+    ESP_LOGI(TAG, "Enable RMT TX channel");
+    ESP_ERROR_CHECK(led_strip_pipeline_enable(led_pipeline));
+
+    // Songs are read in place from the flash partition, "Mary Had a Little Lamb" is built in
+    song_library_handle_t library = NULL;
+    ESP_ERROR_CHECK(song_library_open(SONG_PARTITION_LABEL, &library));
+    size_t num_songs = song_library_get_count(library);
+    ESP_LOGI(TAG, "Start playing %zu songs", num_songs);
+
+    for (size_t song_index = 0;; song_index = (song_index + 1) % num_songs) {
+        smf_reader_t song;
+        if (song_library_open_song(library, song_index, &song) == ESP_OK) {
+            ESP_LOGI(TAG, "Playing song %zu: %.*s", song_index + 1, (int)song.name_len, song.name ? song.name : "");
+            TickType_t start_tick = xTaskGetTickCount();
+            midi_event_t event;
+            while (smf_reader_next(&song, &event) == ESP_OK) {
+                int first_led, num_leds;
+                if (event.type != MIDI_EVENT_NOTE_ON || !keyboard_note_to_leds(event.note, &first_led, &num_leds)) {
+                    continue;
+                }
+                // 1. Wait for the note's time in the song
+                TickType_t note_tick = start_tick + pdMS_TO_TICKS(event.timestamp_us / 1000);
+                TickType_t now_tick = xTaskGetTickCount();
+                if ((int32_t)(note_tick - now_tick) > 0) {
+                    vTaskDelay(note_tick - now_tick);
+                }
+
+                // 2. Light up the LEDs of the note's key (in blue), every other LED off
+                led_frame_t *frame = led_strip_pipeline_get_back_frame(led_pipeline);
+                led_frame_clear(frame);
+                led_frame_fill(frame, first_led, num_leds, 0, 0, 255);
+
+                // 3. Queue the updated pixel data for the LED strip (skipped when the same note repeats)
+                ESP_ERROR_CHECK(led_strip_pipeline_present(led_pipeline));
             }
-
-            // 3. Send the updated pixel data to the LED strip
-            ESP_ERROR_CHECK(rmt_transmit(led_chan, led_encoder, led_strip_pixels, sizeof(led_strip_pixels), &tx_config));
-            ESP_ERROR_CHECK(rmt_tx_wait_all_done(led_chan, portMAX_DELAY));
-
-            // 4. Wait for the note duration
-            vTaskDelay(pdMS_TO_TICKS(melody[i].duration_ms));
+        } else {
+            ESP_LOGW(TAG, "song %zu cannot be read, skipping it", song_index + 1);
         }
-        // Wait a bit before repeating the melody
+        // Wait a bit before the next song
         vTaskDelay(pdMS_TO_TICKS(1000));
     }
 }
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief MIDI event types, channel voice types have the same value as the high nibble of their status byte
+ */
+typedef enum {
+    MIDI_EVENT_NOTE_OFF = 0x8,         /*!< Note off, also used for a note on with velocity 0 */
+    MIDI_EVENT_NOTE_ON = 0x9,          /*!< Note on, velocity is never 0 */
+    MIDI_EVENT_POLY_PRESSURE = 0xA,    /*!< Polyphonic key pressure, velocity holds the pressure */
+    MIDI_EVENT_CONTROL_CHANGE = 0xB,   /*!< Control change, note holds the controller and velocity the value */
+    MIDI_EVENT_PROGRAM_CHANGE = 0xC,   /*!< Program change, note holds the program */
+    MIDI_EVENT_CHANNEL_PRESSURE = 0xD, /*!< Channel pressure, note holds the pressure */
+    MIDI_EVENT_PITCH_BEND = 0xE,       /*!< Pitch bend, note holds the LSB and velocity the MSB */
+    MIDI_EVENT_SYSEX = 0xF0,           /*!< Up to 3 bytes of a System Exclusive message in `data`, 3 unless an 0xF7
+                                            ends the message early, unused bytes are 0 */
+    MIDI_EVENT_SYSTEM_COMMON = 0xF1,   /*!< System Common message, status byte and up to 2 data bytes in `data` */
+    MIDI_EVENT_REALTIME = 0xF8,        /*!< System Real-Time message, status byte in `data[0]` */
+} midi_event_type_t;
+
+/**
+ * @brief Compact MIDI event record, 12 bytes
+ */
+typedef struct {
+    uint32_t timestamp_us; /*!< Arrival time of the USB packet that carried the event, in us, wraps after ~71 minutes */
+    uint8_t type;          /*!< One of `midi_event_type_t` */
+    uint8_t device;        /*!< Source the event came from, the class driver's device slot for USB keyboards */
+    union {
+        struct {
+            uint8_t channel;  /*!< MIDI channel, 0-15 */
+            uint8_t note;     /*!< Note number or first data byte */
+            uint8_t velocity; /*!< Velocity or second data byte, 0 for messages with a single data byte */
+        };
+        uint8_t data[3];      /*!< Raw message bytes of system and SysEx events */
+    };
+} midi_event_t;
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,80 @@
+#include <stdlib.h>
+#include <stdatomic.h>
+#include "esp_check.h"
+#include "midi_event_ring.h"
+
+static const char *TAG = "midi_ring";
+
+struct midi_event_ring_t {
+    // free running indexes, only the low bits address the slots
+    _Atomic uint32_t head; // written by the producer only
+    _Atomic uint32_t tail; // written by the consumer only
+    uint32_t mask;
+    // producer owned counters, read by the consumer as a snapshot
+    volatile uint32_t events_pushed;
+    volatile uint32_t events_dropped;
+    volatile uint32_t high_water;
+    midi_event_t events[];
+};
+
+esp_err_t midi_event_ring_new(size_t capacity, midi_event_ring_handle_t *ret_ring)
+{
+    ESP_RETURN_ON_FALSE(ret_ring && capacity && !(capacity & (capacity - 1)) && capacity <= UINT32_MAX / 2,
+                        ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    midi_event_ring_handle_t ring = calloc(1, sizeof(struct midi_event_ring_t) + capacity * sizeof(midi_event_t));
+    ESP_RETURN_ON_FALSE(ring, ESP_ERR_NO_MEM, TAG, "no mem for event ring");
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    ring->mask = capacity - 1;
+    *ret_ring = ring;
+    return ESP_OK;
+}
+
+size_t midi_event_ring_push(midi_event_ring_handle_t ring, const midi_event_t *events, size_t num_events)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    // acquire: the consumer is done reading the slots it released
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t space = ring->mask + 1 - (head - tail);
+    size_t count = num_events < space ? num_events : space;
+    for (size_t i = 0; i < count; i++) {
+        ring->events[(head + i) & ring->mask] = events[i];
+    }
+    // release: the slots are written before the consumer can see the new head
+    atomic_store_explicit(&ring->head, head + count, memory_order_release);
+    ring->events_pushed += count;
+    ring->events_dropped += num_events - count;
+    if (head + count - tail > ring->high_water) {
+        ring->high_water = head + count - tail;
+    }
+    return count;
+}
+
+size_t midi_event_ring_pop(midi_event_ring_handle_t ring, midi_event_t *events, size_t max_events)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t pending = head - tail;
+    size_t count = pending < max_events ? pending : max_events;
+    for (size_t i = 0; i < count; i++) {
+        events[i] = ring->events[(tail + i) & ring->mask];
+    }
+    atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+    return count;
+}
+
+esp_err_t midi_event_ring_get_stats(midi_event_ring_handle_t ring, midi_event_ring_stats_t *ret_stats)
+{
+    ESP_RETURN_ON_FALSE(ring && ret_stats, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ret_stats->events_pushed = ring->events_pushed;
+    ret_stats->events_dropped = ring->events_dropped;
+    ret_stats->high_water = ring->high_water;
+    return ESP_OK;
+}
+
+esp_err_t midi_event_ring_del(midi_event_ring_handle_t ring)
+{
+    ESP_RETURN_ON_FALSE(ring, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    free(ring);
+    return ESP_OK;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "midi_event.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Type of MIDI event ring handle
+ *
+ * Lock-free single producer, single consumer ring of `midi_event_t`. The producer (USB transfer callback) appends
+ * a whole batch and publishes it with a single index store, the consumer drains everything pending in one pass.
+ * Neither side ever blocks, waking the consumer is left to the caller.
+ */
+typedef struct midi_event_ring_t *midi_event_ring_handle_t;
+
+/**
+ * @brief MIDI event ring statistics
+ */
+typedef struct {
+    uint32_t events_pushed;  /*!< Events accepted by the ring */
+    uint32_t events_dropped; /*!< Events dropped because the ring was full */
+    uint32_t high_water;     /*!< Highest number of events pending at once */
+} midi_event_ring_stats_t;
+
+/**
+ * @brief Create a MIDI event ring
+ *
+ * @param[in] capacity Number of events the ring can hold, must be a power of 2
+ * @param[out] ret_ring Returned ring handle
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_ERR_NO_MEM out of memory when creating the ring
+ *      - ESP_OK if creating the ring successfully
+ */
+esp_err_t midi_event_ring_new(size_t capacity, midi_event_ring_handle_t *ret_ring);
+
+/**
+ * @brief Append a batch of events, producer side only
+ *
+ * @note Events that do not fit are dropped (the newest ones) and counted in `events_dropped`.
+ *
+ * @param[in] ring Ring handle
+ * @param[in] events Events to append
+ * @param[in] num_events Number of events
+ * @return Number of events appended
+ */
+size_t midi_event_ring_push(midi_event_ring_handle_t ring, const midi_event_t *events, size_t num_events);
+
+/**
+ * @brief Take up to `max_events` pending events in arrival order, consumer side only
+ *
+ * @param[in] ring Ring handle
+ * @param[out] events Buffer for the events
+ * @param[in] max_events Size of the buffer, in events
+ * @return Number of events taken, 0 if the ring is empty
+ */
+size_t midi_event_ring_pop(midi_event_ring_handle_t ring, midi_event_t *events, size_t max_events);
+
+/**
+ * @brief Get the pushed and dropped event counters
+ *
+ * @param[in] ring Ring handle
+ * @param[out] ret_stats Returned statistics
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_OK on success
+ */
+esp_err_t midi_event_ring_get_stats(midi_event_ring_handle_t ring, midi_event_ring_stats_t *ret_stats);
+
+/**
+ * @brief Delete the ring, neither side may use it anymore
+ *
+ * @param[in] ring Ring handle
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_OK on success
+ */
+esp_err_t midi_event_ring_del(midi_event_ring_handle_t ring);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,103 +1,385 @@
 #include <string.h>
+#include <inttypes.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/queue.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "driver/rmt_tx.h"
+#include "soc/soc_caps.h"
 #include "led_strip_encoder.h"
+#include "led_strip_output.h"
+#include "led_strip_pipeline.h"
+#include "key_envelope.h"
+#include "frame_scheduler.h"
+#include "song_library.h"
+#include "keyboard_layout.h"
+#include "core_load.h"
 #include "usb/usb_host.h"
 #include "driver/gpio.h"
 #include "class_driver.h"
 
+#define LED_STRIP_CHIP              LED_STRIP_CHIP_WS2812 // timing and pixel layout of the strip
 #define RMT_LED_STRIP_RESOLUTION_HZ 10000000 // 10MHz
-#define RMT_LED_STRIP_GPIO_NUM      16
-#define EXAMPLE_LED_NUMBERS         72
+#define RMT_LED_STRIP_GPIO_NUMS     {16} // one GPIO per strip segment, add more to split the strip
+#define RMT_LED_STRIP_MEM_BLOCK_SYMBOLS CONFIG_LED_STRIP_RMT_MEM_BLOCK_SYMBOLS // RMT RAM or DMA buffer, see menuconfig
+#if CONFIG_LED_STRIP_RMT_WITH_DMA
+#define RMT_LED_STRIP_WITH_DMA      1
+#else
+#define RMT_LED_STRIP_WITH_DMA      0
+#endif
+_Static_assert(RMT_LED_STRIP_MEM_BLOCK_SYMBOLS % 2 == 0, "the RMT driver only takes an even number of symbols");
+// only one TX channel can be fed by DMA, it takes the first segment and the others keep a RAM block
+#define RMT_LED_STRIP_SEGMENT_SYMBOLS (RMT_LED_STRIP_WITH_DMA ? 64 : RMT_LED_STRIP_MEM_BLOCK_SYMBOLS)
+#define SPI_LED_STRIP_HOST          SPI2_HOST // with the SPI output, only the first GPIO is used
 #define APP_QUIT_PIN                CONFIG_APP_QUIT_PIN
+#define APP_USB_CORE                CONFIG_APP_USB_CORE    // USB host library and class driver, MIDI is parsed there
+#define APP_RENDER_CORE             CONFIG_APP_RENDER_CORE // game, frame rendering and the LED output's interrupts
+#define MIDI_EVENT_RING_CAPACITY    64 // a ten finger chord with pedal fits many times over
+#define LED_FRAME_RATE_HZ           100
+#define KEY_ATTACK_MS               0   // light up with the note, anything slower adds to note-to-photon latency
+#define KEY_RELEASE_MS              250
+#define FEEDBACK_MS                 500 // shortest time a verdict stays lit
+#define SONG_PARTITION_LABEL        "songs"
 
 static const char *TAG = "midi_game";
 
-static uint8_t led_strip_pixels[EXAMPLE_LED_NUMBERS * 3];
-static rmt_channel_handle_t led_chan = NULL;
-static rmt_encoder_handle_t led_encoder = NULL;
-static QueueHandle_t midi_event_queue = NULL;
+static const gpio_num_t led_gpios[] = RMT_LED_STRIP_GPIO_NUMS;
+#define RMT_LED_STRIP_CHANNELS      (sizeof(led_gpios) / sizeof(led_gpios[0]))
+// the TX channels share the group's RMT RAM, each takes its size rounded up to whole blocks
+#define RMT_LED_STRIP_RAM_BLOCKS(symbols) \
+    (((symbols) + SOC_RMT_MEM_WORDS_PER_CHANNEL - 1) / SOC_RMT_MEM_WORDS_PER_CHANNEL)
+_Static_assert(RMT_LED_STRIP_CHANNELS == 1 ||
+               (RMT_LED_STRIP_WITH_DMA ? 0 : RMT_LED_STRIP_RAM_BLOCKS(RMT_LED_STRIP_MEM_BLOCK_SYMBOLS)) +
+               (RMT_LED_STRIP_CHANNELS - 1) * RMT_LED_STRIP_RAM_BLOCKS(RMT_LED_STRIP_SEGMENT_SYMBOLS) <=
+               SOC_RMT_TX_CANDIDATES_PER_GROUP, "the strip segments need more RMT RAM than the TX channels have");
 
-// Melody and notes, mapped to a 61-key keyboard starting at C2 (MIDI 36)
-#define NOTE_C4 24 // MIDI 60
-#define NOTE_D4 26 // MIDI 62
-#define NOTE_E4 28 // MIDI 64
-#define NOTE_G4 31 // MIDI 67
+static rmt_channel_handle_t led_chans[RMT_LED_STRIP_CHANNELS];
+static rmt_encoder_handle_t led_encoders[RMT_LED_STRIP_CHANNELS];
+static led_strip_output_handle_t led_output = NULL;
+static led_strip_pipeline_handle_t led_pipeline = NULL;
+static key_envelope_handle_t led_keys = NULL;
+static frame_scheduler_handle_t led_scheduler = NULL;
+static midi_event_ring_handle_t midi_event_ring = NULL;
+static song_library_handle_t song_library = NULL;
+
+// Note-to-photon latency, every stage measured from the completion of the USB transfer that carried the note
+static latency_histogram_t latency_usb = LATENCY_HISTOGRAM_INIT("usb callback");
+static latency_histogram_t latency_dequeue = LATENCY_HISTOGRAM_INIT("dequeue");
+static latency_histogram_t latency_submit = LATENCY_HISTOGRAM_INIT("rmt submit");
+static latency_histogram_t latency_done = LATENCY_HISTOGRAM_INIT("rmt done");
+// How late frames start after their slot is due, the jitter of the render core
+static latency_histogram_t latency_frame_start = LATENCY_HISTOGRAM_INIT("frame start");
+static core_load_snapshot_t load_since; // core load is logged for the time since the last melody
+
+// Runs from the frame scheduler task, the only one touching the pipeline. Only keys whose envelope changes are
+// drawn, and nothing is sent when the frame did not change.
+static void render_frame(uint32_t frame, uint32_t frame_time_us, void *user_ctx)
+{
+    key_envelope_render(led_keys, led_pipeline, (uint32_t)esp_timer_get_time());
+    // Queue the frame and keep going, the pipeline recycles the buffer once it has been shifted out
+    ESP_ERROR_CHECK(led_strip_pipeline_present(led_pipeline));
+}
+
+// Log the USB, MIDI ring and LED statistics of the melody just played, the latency histograms start over
+static void log_melody_stats(void)
+{
+    led_strip_pipeline_stats_t stats;
+    ESP_ERROR_CHECK(led_strip_pipeline_get_stats(led_pipeline, &stats));
+    ESP_LOGI(TAG, "Melody done, LED frames sent: %"PRIu32" (%"PRIu32" pixels), skipped: %"PRIu32,
+             stats.frames_sent, stats.pixels_sent, stats.frames_skipped);
+    frame_scheduler_stats_t frame_stats;
+    ESP_ERROR_CHECK(frame_scheduler_get_stats(led_scheduler, &frame_stats));
+    ESP_LOGI(TAG, "Render frames: %"PRIu32", missed deadlines: %"PRIu32", overruns: %"PRIu32", longest: %"PRIu32" us",
+             frame_stats.frames_rendered, frame_stats.deadlines_missed, frame_stats.overruns,
+             frame_stats.render_us_max);
+    midi_event_ring_stats_t ring_stats;
+    ESP_ERROR_CHECK(midi_event_ring_get_stats(midi_event_ring, &ring_stats));
+    ESP_LOGI(TAG, "MIDI events: %"PRIu32", dropped: %"PRIu32", most pending: %"PRIu32,
+             ring_stats.events_pushed, ring_stats.events_dropped, ring_stats.high_water);
+    class_driver_stats_t usb_stats = {0};
+    class_driver_get_stats(&usb_stats);
+    ESP_LOGI(TAG, "USB class driver wakeups: %"PRIu32", attach to claim: %"PRIu32" us, to first event: %"PRIu32" us",
+             usb_stats.wakeups, usb_stats.attach_to_claim_us, usb_stats.attach_to_first_event_us);
+    ESP_LOGI(TAG, "MIDI IN transfers outstanding at least: %"PRIu32", resubmit: %"PRIu32" us (max %"PRIu32" us)",
+             usb_stats.transfers_outstanding_min, usb_stats.resubmit_us_last, usb_stats.resubmit_us_max);
+    latency_histogram_t *latencies[] = {&latency_usb, &latency_dequeue, &latency_submit, &latency_done,
+                                        &latency_frame_start};
+    for (size_t i = 0; i < sizeof(latencies) / sizeof(latencies[0]); i++) {
+        latency_histogram_dump(latencies[i]);
+        latency_histogram_reset(latencies[i]);
+    }
+    core_load_snapshot_t load_now;
+    if (core_load_take_snapshot(&load_now) == ESP_OK) {
+        for (int core = 0; core < CORE_LOAD_NUM_CORES; core++) {
+            uint32_t permille = core_load_get_permille(&load_since, &load_now, core);
+            ESP_LOGI(TAG, "Core %d load: %"PRIu32".%"PRIu32"%%%s", core, permille / 10, permille % 10,
+                     core == APP_USB_CORE ? (core == APP_RENDER_CORE ? " (USB, render)" : " (USB)") :
+                     core == APP_RENDER_CORE ? " (render)" : "");
+        }
+        load_since = load_now;
+    }
+}
+
+// The game never sleeps: it is a state machine advanced by MIDI events and feedback timeouts, so every note is judged
+// against the target shown when it was played, however fast the notes come. A verdict is a timed overlay on the
+// key, lit for at least FEEDBACK_MS even when the key is only tapped.
+typedef enum {
+    FEEDBACK_NONE,      // the key shows its background, or fades back to it
+    FEEDBACK_HELD,      // verdict lit, key still down
+    FEEDBACK_RELEASED,  // verdict lit, key released before the overlay expired
+} feedback_state_t;
+
+typedef struct {
+    feedback_state_t state;
+    TickType_t expires;     // tick the overlay ends at, unless FEEDBACK_NONE
+} feedback_overlay_t;
 
 typedef struct {
-    int note_led;
-    int duration_ms;
-} musical_note_t;
-
-musical_note_t melody[] = {
-    {NOTE_E4, 300}, {NOTE_D4, 300}, {NOTE_C4, 300}, {NOTE_D4, 300},
-    {NOTE_E4, 300}, {NOTE_E4, 300}, {NOTE_E4, 600},
-    {NOTE_D4, 300}, {NOTE_D4, 300}, {NOTE_D4, 600},
-    {NOTE_E4, 300}, {NOTE_G4, 300}, {NOTE_G4, 600},
-};
-
-static void set_pixel_color(int index, uint8_t r, uint8_t g, uint8_t b) {
-    if (index >= 0 && index < EXAMPLE_LED_NUMBERS) {
-        led_strip_pixels[index * 3 + 0] = g;
-        led_strip_pixels[index * 3 + 1] = r;
-        led_strip_pixels[index * 3 + 2] = b;
+    size_t song_index;      // song being played
+    smf_reader_t song;      // position in the song, read in place from flash
+    size_t notes_played;    // notes of the song played so far
+    uint8_t target_note;    // next note to play
+    int target_key;         // its key, -1 when no song has a note on the keyboard
+    feedback_overlay_t feedback[KEYBOARD_NUM_KEYS];
+} melody_game_t;
+
+static void game_open_song(melody_game_t *game, size_t song_index)
+{
+    game->song_index = song_index;
+    game->notes_played = 0;
+    esp_err_t err = song_library_open_song(song_library, song_index, &game->song);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "song %zu cannot be read (0x%x), skipping it", song_index, err);
+        game->song.num_tracks = 0; // reads as an empty song
+        return;
     }
+    ESP_LOGI(TAG, "Playing song %zu of %zu: %.*s", song_index + 1, song_library_get_count(song_library),
+             (int)game->song.name_len, game->song.name ? game->song.name : "");
 }
 
-static void flush_leds()
+// Move the target to the next note of the song that the keyboard has, on to the next song at the end
+static void game_next_target(melody_game_t *game)
 {
-    rmt_transmit_config_t tx_config = {
-        .loop_count = 0,
-    };
-    ESP_ERROR_CHECK(rmt_transmit(led_chan, led_encoder, led_strip_pixels, sizeof(led_strip_pixels), &tx_config));
-    ESP_ERROR_CHECK(rmt_tx_wait_all_done(led_chan, portMAX_DELAY));
+    size_t num_songs = song_library_get_count(song_library);
+    // every song in turn, and the current one once more from the start, before giving up
+    for (size_t songs_tried = 0; songs_tried <= num_songs;) {
+        midi_event_t event;
+        esp_err_t err = smf_reader_next(&game->song, &event);
+        if (err == ESP_OK) {
+            int key_index = event.type == MIDI_EVENT_NOTE_ON ? keyboard_note_to_key(event.note) : -1;
+            if (key_index >= 0) {
+                game->target_note = event.note;
+                game->target_key = key_index;
+                return;
+            }
+            continue;
+        }
+        if (err != ESP_ERR_NOT_FOUND) {
+            ESP_LOGW(TAG, "song %zu is malformed (0x%x), skipping the rest", game->song_index, err);
+        }
+        if (game->notes_played) {
+            log_melody_stats();
+        }
+        game_open_song(game, (game->song_index + 1) % num_songs);
+        songs_tried++;
+    }
+    ESP_LOGE(TAG, "no song has a note on the keyboard");
+    game->target_key = -1;
+}
+
+// Show the target as the background under the key envelopes
+static void game_show_target(melody_game_t *game, int prev_key_index)
+{
+    if (game->target_key != prev_key_index) {
+        key_envelope_set_background(led_keys, prev_key_index, 0, 0, 0);
+        key_envelope_set_background(led_keys, game->target_key, 0, 0, 255); // Blue
+    }
+    ESP_LOGI(TAG, "Next note to play: key %d (MIDI %d)", game->target_key, game->target_note);
 }
 
-static void show_feedback(int led_index, bool correct)
+static void game_on_note_on(melody_game_t *game, const midi_event_t *event)
 {
+    int key_index = game->target_key;
+    int received_key_index = keyboard_note_to_key(event->note);
+    ESP_LOGI(TAG, "Received MIDI note: %d (dev %d, ch %d, vel %d), Mapped to key: %d", event->note, event->device,
+             event->channel + 1, event->velocity, received_key_index);
+    if (received_key_index < 0) {
+        return; // off the keyboard, nothing to judge
+    }
+
+    // Velocity sets the brightness, the key fades back to its background once released and the overlay is over
+    bool correct = received_key_index == key_index;
     if (correct) {
-        set_pixel_color(led_index, 0, 255, 0); // Green
+        key_envelope_note_on(led_keys, received_key_index, event->velocity, 0, 255, 0, event->timestamp_us); // Green
     } else {
-        set_pixel_color(led_index, 255, 0, 0); // Red
+        key_envelope_note_on(led_keys, received_key_index, event->velocity, 255, 0, 0, event->timestamp_us); // Red
+    }
+    feedback_overlay_t *feedback = &game->feedback[received_key_index];
+    feedback->state = FEEDBACK_HELD;
+    feedback->expires = xTaskGetTickCount() + pdMS_TO_TICKS(FEEDBACK_MS);
+
+    if (correct) {
+        game->notes_played++;
+        game_next_target(game);
+        game_show_target(game, key_index);
     }
-    flush_leds();
-    vTaskDelay(pdMS_TO_TICKS(500));
+}
+
+static void game_on_note_off(melody_game_t *game, const midi_event_t *event)
+{
+    int key_index = keyboard_note_to_key(event->note);
+    if (key_index < 0) {
+        return;
+    }
+    feedback_overlay_t *feedback = &game->feedback[key_index];
+    switch (feedback->state) {
+    case FEEDBACK_HELD:
+        feedback->state = FEEDBACK_RELEASED; // fade once the overlay is over
+        break;
+    case FEEDBACK_RELEASED:
+        break;
+    case FEEDBACK_NONE:
+        key_envelope_note_off(led_keys, key_index, event->timestamp_us);
+        break;
+    }
+}
+
+// End the overlays that are due, returns the ticks until the next one is
+static TickType_t game_expire_feedback(melody_game_t *game, TickType_t now)
+{
+    TickType_t next_timeout = portMAX_DELAY;
+    for (int i = 0; i < KEYBOARD_NUM_KEYS; i++) {
+        feedback_overlay_t *feedback = &game->feedback[i];
+        if (feedback->state == FEEDBACK_NONE) {
+            continue;
+        }
+        TickType_t remaining = feedback->expires - now;
+        if ((int32_t)remaining > 0) {
+            if (remaining < next_timeout) {
+                next_timeout = remaining;
+            }
+            continue;
+        }
+        if (feedback->state == FEEDBACK_RELEASED) {
+            key_envelope_note_off(led_keys, i, (uint32_t)esp_timer_get_time());
+        }
+        // a key still held stays lit until its Note Off
+        feedback->state = FEEDBACK_NONE;
+    }
+    return next_timeout;
+}
+
+// Runs on the render core: the RMT or SPI driver allocates its interrupts on the core that installs it, so the
+// refills and frame done callbacks stay next to the render task and away from the USB host
+static void led_setup(void)
+{
+#if CONFIG_LED_STRIP_OUTPUT_SPI
+    ESP_LOGI(TAG, "Create SPI output");
+    led_strip_spi_output_config_t output_config = {
+        .spi_host = SPI_LED_STRIP_HOST,
+        .gpio_num = led_gpios[0],
+        .num_pixels = KEYBOARD_NUM_LEDS,
+        .chip = LED_STRIP_CHIP,
+        .gamma = 2.2f, // perceptually even fades, folded into the bit patterns
+        .trans_queue_depth = 2,
+    };
+    ESP_ERROR_CHECK(led_strip_new_spi_output(&output_config, &led_output));
+#else
+    ESP_LOGI(TAG, "Create RMT TX channel");
+    for (size_t i = 0; i < RMT_LED_STRIP_CHANNELS; i++) {
+        rmt_tx_channel_config_t tx_chan_config = {
+            .clk_src = RMT_CLK_SRC_DEFAULT,
+            .gpio_num = led_gpios[i],
+            .mem_block_symbols = i == 0 ? RMT_LED_STRIP_MEM_BLOCK_SYMBOLS : RMT_LED_STRIP_SEGMENT_SYMBOLS,
+            .resolution_hz = RMT_LED_STRIP_RESOLUTION_HZ,
+            .trans_queue_depth = 4,
+            .flags.with_dma = i == 0 && RMT_LED_STRIP_WITH_DMA,
+        };
+        ESP_ERROR_CHECK(rmt_new_tx_channel(&tx_chan_config, &led_chans[i]));
+    }
+
+    ESP_LOGI(TAG, "Install led strip encoder");
+    led_strip_encoder_config_t encoder_config = {
+        .resolution = RMT_LED_STRIP_RESOLUTION_HZ,
+        .chip = LED_STRIP_CHIP,
+        .gamma = 2.2f, // perceptually even fades, applied while encoding
+    };
+    for (size_t i = 0; i < RMT_LED_STRIP_CHANNELS; i++) {
+        ESP_ERROR_CHECK(rmt_new_led_strip_lut_encoder(&encoder_config, &led_encoders[i]));
+    }
+    led_strip_rmt_output_config_t output_config = {
+        .channels = led_chans,
+        .encoders = led_encoders,
+        .num_channels = RMT_LED_STRIP_CHANNELS,
+        .num_pixels = KEYBOARD_NUM_LEDS,
+        .chip = LED_STRIP_CHIP,
+    };
+    ESP_ERROR_CHECK(led_strip_new_rmt_output(&output_config, &led_output));
+#endif
+
+    ESP_LOGI(TAG, "Create LED frame pipeline");
+    led_strip_pipeline_config_t pipeline_config = {
+        .output = led_output,
+        .frame_size = KEYBOARD_NUM_LEDS * led_strip_get_chip_info(LED_STRIP_CHIP)->bytes_per_pixel,
+        .num_buffers = 2, // render the next frame while the current one is shifted out
+        .submit_latency = &latency_submit,
+        .done_latency = &latency_done,
+    };
+    ESP_ERROR_CHECK(led_strip_pipeline_new(&pipeline_config, &led_pipeline));
+
+    ESP_LOGI(TAG, "Enable LED output");
+    ESP_ERROR_CHECK(led_strip_pipeline_enable(led_pipeline));
+
+    ESP_LOGI(TAG, "Start rendering at %d fps", LED_FRAME_RATE_HZ);
+    key_envelope_config_t keys_config = {
+        .num_keys = KEYBOARD_NUM_KEYS,
+        .key_leds = keyboard_key_leds,
+        .attack_us = KEY_ATTACK_MS * 1000,
+        .release_us = KEY_RELEASE_MS * 1000,
+    };
+    ESP_ERROR_CHECK(key_envelope_new(&keys_config, &led_keys));
+    frame_scheduler_config_t scheduler_config = {
+        .fps = LED_FRAME_RATE_HZ,
+        .render = render_frame,
+        .task_stack = 4096,
+        .task_priority = 5,
+        .task_core = APP_RENDER_CORE,
+        .start_latency = &latency_frame_start,
+    };
+    ESP_ERROR_CHECK(frame_scheduler_new(&scheduler_config, &led_scheduler));
+    ESP_ERROR_CHECK(frame_scheduler_start(led_scheduler));
 }
 
 void melody_game_task(void *arg)
 {
-    int melody_len = sizeof(melody) / sizeof(melody[0]);
-    int current_note_index = 0;
-
-    while(1) {
-        musical_note_t current_note = melody[current_note_index];
-        int led_index = current_note.note_led;
-
-        // 1. Show the note to be played
-        memset(led_strip_pixels, 0, sizeof(led_strip_pixels));
-        set_pixel_color(led_index, 0, 0, 255); // Blue
-        flush_leds();
-        ESP_LOGI(TAG, "Next note to play: LED %d (MIDI %d)", led_index, led_index + 36);
-
-        // 2. Wait for user input
-        uint8_t received_note;
-        if (xQueueReceive(midi_event_queue, &received_note, portMAX_DELAY)) {
-            int received_led_index = received_note - 36; // Lowest note on 61-key keyboard is C2 (MIDI 36)
-            ESP_LOGI(TAG, "Received MIDI note: %d, Mapped to LED: %d", received_note, received_led_index);
-
-            if (received_led_index == led_index) {
-                // Correct note
-                show_feedback(led_index, true);
-                current_note_index = (current_note_index + 1) % melody_len;
-            } else {
-                // Incorrect note
-                show_feedback(received_led_index, false);
+    static melody_game_t game;
+    static midi_event_t events[16];
+    led_setup();
+    core_load_take_snapshot(&load_since);
+    xTaskNotifyGive(arg);
+    game_open_song(&game, 0);
+    game_next_target(&game);
+    game_show_target(&game, -1);
+
+    while (1) {
+        // Drain every pending event from the ring in one pass, then handle the overlays that ran out meanwhile
+        size_t num_events = midi_event_ring_pop(midi_event_ring, events, sizeof(events) / sizeof(events[0]));
+        uint32_t now_us = (uint32_t)esp_timer_get_time();
+        for (size_t i = 0; i < num_events; i++) {
+            latency_histogram_record(&latency_dequeue, now_us - events[i].timestamp_us);
+        }
+        for (size_t i = 0; i < num_events; i++) {
+            if (events[i].type == MIDI_EVENT_NOTE_ON) {
+                game_on_note_on(&game, &events[i]);
+            } else if (events[i].type == MIDI_EVENT_NOTE_OFF) {
+                game_on_note_off(&game, &events[i]);
             }
         }
-        vTaskDelay(pdMS_TO_TICKS(100)); // Small delay
+        TickType_t timeout = game_expire_feedback(&game, xTaskGetTickCount());
+        if (!num_events) {
+            // woken by the next event or the next overlay to expire
+            ulTaskNotifyTake(pdTRUE, timeout);
+        }
     }
 }
 
@@ -134,38 +416,25 @@ static void usb_host_lib_task(void *arg)
 
 void app_main(void)
 {
-    ESP_LOGI(TAG, "Create RMT TX channel");
-    rmt_tx_channel_config_t tx_chan_config = {
-        .clk_src = RMT_CLK_SRC_DEFAULT,
-        .gpio_num = RMT_LED_STRIP_GPIO_NUM,
-        .mem_block_symbols = 64,
-        .resolution_hz = RMT_LED_STRIP_RESOLUTION_HZ,
-        .trans_queue_depth = 4,
-    };
-    ESP_ERROR_CHECK(rmt_new_tx_channel(&tx_chan_config, &led_chan));
-
-    ESP_LOGI(TAG, "Install led strip encoder");
-    led_strip_encoder_config_t encoder_config = {
-        .resolution = RMT_LED_STRIP_RESOLUTION_HZ,
-    };
-    ESP_ERROR_CHECK(rmt_new_led_strip_encoder(&encoder_config, &led_encoder));
-
-    ESP_LOGI(TAG, "Enable RMT TX channel");
-    ESP_ERROR_CHECK(rmt_enable(led_chan));
-
-    midi_event_queue = xQueueCreate(10, sizeof(uint8_t));
+    ESP_ERROR_CHECK(song_library_open(SONG_PARTITION_LABEL, &song_library));
+    ESP_ERROR_CHECK(midi_event_ring_new(MIDI_EVENT_RING_CAPACITY, &midi_event_ring));
 
+    // The two sides only share the lock-free MIDI event ring, and the frame slots the esp_timer task hands over
+    ESP_LOGI(TAG, "USB host and MIDI on core %d, game and LEDs on core %d", APP_USB_CORE, APP_RENDER_CORE);
     TaskHandle_t host_lib_task_hdl, class_driver_task_hdl, game_task_hdl;
 
-    BaseType_t task_created = xTaskCreatePinnedToCore(usb_host_lib_task, "usb_host", 4096, xTaskGetCurrentTaskHandle(), 2, &host_lib_task_hdl, 0);
+    BaseType_t task_created = xTaskCreatePinnedToCore(melody_game_task, "melody_game", 4096, xTaskGetCurrentTaskHandle(), 4, &game_task_hdl, APP_RENDER_CORE);
+    assert(task_created == pdTRUE);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY); // LEDs set up
+
+    task_created = xTaskCreatePinnedToCore(usb_host_lib_task, "usb_host", 4096, xTaskGetCurrentTaskHandle(), 2, &host_lib_task_hdl, APP_USB_CORE);
     assert(task_created == pdTRUE);
     ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
 
-    task_created = xTaskCreatePinnedToCore(class_driver_task, "class", 5 * 1024, NULL, 3, &class_driver_task_hdl, 0);
+    task_created = xTaskCreatePinnedToCore(class_driver_task, "class", 5 * 1024, NULL, 3, &class_driver_task_hdl, APP_USB_CORE);
     assert(task_created == pdTRUE);
     vTaskDelay(pdMS_TO_TICKS(100)); // Allow class driver to initialize
-    class_driver_set_midi_queue(midi_event_queue);
 
-    task_created = xTaskCreatePinnedToCore(melody_game_task, "melody_game", 4096, NULL, 4, &game_task_hdl, 0);
-    assert(task_created == pdTRUE);
+    class_driver_set_midi_ring(midi_event_ring, game_task_hdl);
+    class_driver_set_latency_histogram(&latency_usb);
 }
@@ -0,0 +1,315 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+#include "esp_log.h"
+#include "smf_reader.h"
+
+#define SMF_HEADER_SIZE       14 // "MThd", length, format, number of tracks, division
+#define SMF_CHUNK_HEADER_SIZE 8  // type, length
+#define SMF_DEFAULT_TEMPO_US  500000 // 120 bpm until the first tempo change
+#define SMF_META_SEQUENCE_NAME 0x03
+#define SMF_META_END_OF_TRACK 0x2F
+#define SMF_META_TEMPO        0x51
+
+static const char *TAG = "smf_reader";
+
+static inline uint32_t smf_read_be(const uint8_t *data, size_t num_bytes)
+{
+    uint32_t value = 0;
+    for (size_t i = 0; i < num_bytes; i++) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+// variable length quantity, at most 4 bytes
+static bool smf_read_varlen(const uint8_t **pos, const uint8_t *end, uint32_t *ret_value)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < 4 && *pos < end; i++) {
+        uint8_t byte = *(*pos)++;
+        value = (value << 7) | (byte & 0x7F);
+        if (!(byte & 0x80)) {
+            *ret_value = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint64_t smf_tick_to_us(const smf_reader_t *reader, uint32_t tick)
+{
+    return reader->tempo_time_us + (uint64_t)(tick - reader->tempo_tick) * reader->us_per_tick_num /
+           reader->us_per_tick_den;
+}
+
+size_t smf_file_size(const uint8_t *data, size_t size)
+{
+    if (!data || size < SMF_HEADER_SIZE || memcmp(data, "MThd", 4) != 0) {
+        return 0;
+    }
+    uint32_t header_len = smf_read_be(data + 4, 4);
+    if (header_len < 6 || header_len > size - SMF_CHUNK_HEADER_SIZE) {
+        return 0;
+    }
+    uint32_t num_tracks = smf_read_be(data + 10, 2);
+    size_t offset = SMF_CHUNK_HEADER_SIZE + header_len;
+    // the file ends with its last track chunk, other chunk types in between are skipped
+    for (uint32_t found = 0; found < num_tracks;) {
+        if (size - offset < SMF_CHUNK_HEADER_SIZE) {
+            return 0;
+        }
+        uint32_t chunk_len = smf_read_be(data + offset + 4, 4);
+        if (chunk_len > size - offset - SMF_CHUNK_HEADER_SIZE) {
+            return 0;
+        }
+        if (memcmp(data + offset, "MTrk", 4) == 0) {
+            found++;
+        }
+        offset += SMF_CHUNK_HEADER_SIZE + chunk_len;
+    }
+    return offset;
+}
+
+// whether a track chunk plays any note, malformed tracks count as playing so that reading them reports the error
+static bool smf_track_has_notes(const uint8_t *pos, const uint8_t *end)
+{
+    uint8_t running_status = 0;
+    uint32_t value;
+    while (pos < end) {
+        if (!smf_read_varlen(&pos, end, &value) || pos >= end) {
+            return true;
+        }
+        uint8_t status = *pos;
+        if (status & 0x80) {
+            pos++;
+        } else if (running_status) {
+            status = running_status;
+        } else {
+            return true;
+        }
+        if (status < 0xF0) {
+            uint8_t type = status >> 4;
+            size_t num_data = (type == MIDI_EVENT_PROGRAM_CHANGE || type == MIDI_EVENT_CHANNEL_PRESSURE) ? 1 : 2;
+            if ((size_t)(end - pos) < num_data) {
+                return true;
+            }
+            if (type == MIDI_EVENT_NOTE_ON && pos[1]) {
+                return true;
+            }
+            running_status = status;
+            pos += num_data;
+            continue;
+        }
+        if (status == 0xFF && pos++ >= end) {
+            return true;
+        }
+        if (!smf_read_varlen(&pos, end, &value) || value > (size_t)(end - pos)) {
+            return true;
+        }
+        pos += value;
+        running_status = 0;
+    }
+    return false;
+}
+
+// sequence name: a meta event among those at the very start of the first track
+static void smf_find_name(smf_reader_t *reader)
+{
+    const smf_track_t *track = &reader->tracks[0];
+    const uint8_t *pos = track->pos;
+    uint32_t tick = track->next_tick;
+    while (tick == 0 && track->end - pos >= 2 && pos[0] == 0xFF) {
+        uint8_t type = pos[1];
+        uint32_t len;
+        pos += 2;
+        if (!smf_read_varlen(&pos, track->end, &len) || len > (size_t)(track->end - pos)) {
+            return;
+        }
+        if (type == SMF_META_SEQUENCE_NAME) {
+            reader->name = (const char *)pos;
+            reader->name_len = len;
+            return;
+        }
+        pos += len;
+        uint32_t delta;
+        if (!smf_read_varlen(&pos, track->end, &delta)) {
+            return;
+        }
+        tick += delta;
+    }
+}
+
+esp_err_t smf_reader_open(smf_reader_t *reader, const uint8_t *data, size_t size)
+{
+    if (!reader || !data || size < SMF_HEADER_SIZE || memcmp(data, "MThd", 4) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint32_t header_len = smf_read_be(data + 4, 4);
+    if (header_len < 6) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (header_len > size - SMF_CHUNK_HEADER_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint32_t format = smf_read_be(data + 8, 2);
+    uint32_t num_tracks = smf_read_be(data + 10, 2);
+    uint32_t division = smf_read_be(data + 12, 2);
+    if (format > 2 || division == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // format 2 tracks are independent songs, not parts to merge
+    if (format == 2) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    memset(reader, 0, sizeof(*reader));
+    if (division & 0x8000) {
+        // SMPTE time: frames per second (negative) and ticks per frame, tempo changes do not apply
+        int fps = -(int8_t)(division >> 8);
+        uint32_t ticks_per_frame = division & 0xFF;
+        if (fps <= 0 || !ticks_per_frame) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        reader->us_per_tick_num = fps == 29 ? 100000000 : 1000000; // 29 is 29.97 drop frame
+        reader->us_per_tick_den = (fps == 29 ? 2997 : fps) * ticks_per_frame;
+        reader->smpte = true;
+    } else {
+        reader->us_per_tick_num = SMF_DEFAULT_TEMPO_US;
+        reader->us_per_tick_den = division;
+    }
+
+    size_t offset = SMF_CHUNK_HEADER_SIZE + header_len;
+    for (uint32_t found = 0; found < num_tracks;) {
+        if (size - offset < SMF_CHUNK_HEADER_SIZE) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        uint32_t chunk_len = smf_read_be(data + offset + 4, 4);
+        if (chunk_len > size - offset - SMF_CHUNK_HEADER_SIZE) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        const uint8_t *chunk = data + offset + SMF_CHUNK_HEADER_SIZE;
+        offset += SMF_CHUNK_HEADER_SIZE + chunk_len;
+        if (memcmp(chunk - SMF_CHUNK_HEADER_SIZE, "MTrk", 4) != 0) {
+            continue;
+        }
+        found++;
+        // more tracks than fit: the first one holds the tempo map, of the others only those with notes matter
+        bool keep = num_tracks <= SMF_READER_MAX_TRACKS || found == 1 || smf_track_has_notes(chunk, chunk + chunk_len);
+        if (keep && reader->num_tracks == SMF_READER_MAX_TRACKS) {
+            ESP_LOGW(TAG, "more than %d tracks with notes, skipping track %"PRIu32, SMF_READER_MAX_TRACKS, found - 1);
+            keep = false;
+        }
+        if (!keep) {
+            continue;
+        }
+        smf_track_t *track = &reader->tracks[reader->num_tracks++];
+        track->pos = chunk;
+        track->end = chunk + chunk_len;
+        if (track->pos < track->end && !smf_read_varlen(&track->pos, track->end, &track->next_tick)) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+    }
+    if (reader->num_tracks) {
+        smf_find_name(reader);
+    }
+    return ESP_OK;
+}
+
+static void smf_set_tempo(smf_reader_t *reader, uint32_t tick, uint32_t tempo_us)
+{
+    if (reader->smpte) {
+        return;
+    }
+    reader->tempo_time_us = smf_tick_to_us(reader, tick);
+    reader->tempo_tick = tick;
+    reader->us_per_tick_num = tempo_us;
+}
+
+esp_err_t smf_reader_next(smf_reader_t *reader, midi_event_t *event)
+{
+    while (1) {
+        // merge the tracks: earliest event first, the lower track first on a tie
+        smf_track_t *track = NULL;
+        for (size_t i = 0; i < reader->num_tracks; i++) {
+            smf_track_t *candidate = &reader->tracks[i];
+            if (candidate->pos < candidate->end && (!track || candidate->next_tick < track->next_tick)) {
+                track = candidate;
+            }
+        }
+        if (!track) {
+            return ESP_ERR_NOT_FOUND;
+        }
+
+        const uint8_t *pos = track->pos;
+        uint32_t tick = track->next_tick;
+        uint8_t status = *pos;
+        if (status & 0x80) {
+            pos++;
+        } else if (track->running_status) {
+            status = track->running_status;
+        } else {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+
+        bool is_channel_voice = false;
+        if (status < 0xF0) {
+            uint8_t type = status >> 4;
+            size_t num_data = (type == MIDI_EVENT_PROGRAM_CHANGE || type == MIDI_EVENT_CHANNEL_PRESSURE) ? 1 : 2;
+            if ((size_t)(track->end - pos) < num_data) {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            event->type = type;
+            event->device = track - reader->tracks;
+            event->channel = status & 0x0F;
+            event->note = pos[0] & 0x7F;
+            event->velocity = num_data == 2 ? pos[1] & 0x7F : 0;
+            if (type == MIDI_EVENT_NOTE_ON && event->velocity == 0) {
+                event->type = MIDI_EVENT_NOTE_OFF;
+            }
+            track->running_status = status;
+            pos += num_data;
+            is_channel_voice = true;
+        } else if (status == 0xF0 || status == 0xF7) {
+            // System Exclusive, or an escaped sequence of arbitrary bytes
+            uint32_t len;
+            if (!smf_read_varlen(&pos, track->end, &len) || len > (size_t)(track->end - pos)) {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            pos += len;
+            track->running_status = 0;
+        } else if (status == 0xFF) {
+            uint32_t len;
+            if (pos >= track->end) {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            uint8_t type = *pos++;
+            if (!smf_read_varlen(&pos, track->end, &len) || len > (size_t)(track->end - pos)) {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            if (type == SMF_META_END_OF_TRACK) {
+                track->pos = track->end;
+                continue;
+            }
+            if (type == SMF_META_TEMPO && len == 3) {
+                smf_set_tempo(reader, tick, smf_read_be(pos, 3));
+            }
+            pos += len;
+            track->running_status = 0;
+        } else {
+            // System Common and Real-Time messages have no place in a file
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+
+        uint32_t delta = 0;
+        if (pos < track->end && !smf_read_varlen(&pos, track->end, &delta)) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        track->pos = pos;
+        track->next_tick = tick + delta;
+        if (is_channel_voice) {
+            event->timestamp_us = smf_tick_to_us(reader, tick);
+            return ESP_OK;
+        }
+    }
+}
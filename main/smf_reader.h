@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "midi_event.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SMF_READER_MAX_TRACKS 32 /*!< Most tracks merged, a conductor track and 16 channel tracks fit easily */
+
+/**
+ * @brief Read position in one track chunk
+ */
+typedef struct {
+    const uint8_t *pos;     /*!< Next event, or end when the track is over */
+    const uint8_t *end;     /*!< End of the track chunk */
+    uint32_t next_tick;     /*!< Song position of the event at `pos`, in ticks */
+    uint8_t running_status; /*!< Status byte of the last channel message, 0 if none */
+} smf_track_t;
+
+/**
+ * @brief Streaming Standard MIDI File reader
+ *
+ * Walks a format 0 or format 1 file in place, the data is never copied: every track keeps a pointer into the file
+ * and the tracks are merged on the fly, in song order. The reader is a plain struct the caller allocates, its size
+ * does not depend on the file, so a song of any length costs the same RAM.
+ */
+typedef struct {
+    smf_track_t tracks[SMF_READER_MAX_TRACKS];
+    size_t num_tracks;
+    uint32_t us_per_tick_num; /*!< Tick length is us_per_tick_num / us_per_tick_den us */
+    uint32_t us_per_tick_den;
+    bool smpte;               /*!< SMPTE time division, tempo changes do not apply */
+    uint32_t tempo_tick;      /*!< Song position of the last tempo change, in ticks */
+    uint64_t tempo_time_us;   /*!< Song time of the last tempo change, in us */
+    const char *name;         /*!< Sequence name from the first track, not NUL terminated, NULL if none */
+    size_t name_len;          /*!< Length of the name */
+} smf_reader_t;
+
+/**
+ * @brief Get the size of the Standard MIDI File at the start of a buffer
+ *
+ * @note Only the chunk headers are read, so walking a buffer of concatenated files is cheap.
+ *
+ * @param[in] data Buffer starting with a file
+ * @param[in] size Size of the buffer, in bytes
+ * @return Size of the file, header chunk, track chunks and any other chunk in between included, or 0 if the buffer
+ *         does not start with a complete file
+ */
+size_t smf_file_size(const uint8_t *data, size_t size);
+
+/**
+ * @brief Start reading a Standard MIDI File
+ *
+ * @param[out] reader Reader to initialize, positioned at the start of the song
+ * @param[in] data File data, must stay valid and unchanged while the reader is used
+ * @param[in] size Size of the file, in bytes
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments, or data that is not a Standard MIDI File
+ *      - ESP_ERR_INVALID_SIZE if a chunk runs past the end of the data
+ *      - ESP_ERR_NOT_SUPPORTED for format 2 files
+ *      - ESP_OK if the file can be read
+ *
+ * @note A file with more than SMF_READER_MAX_TRACKS tracks keeps its first track (tempo map and name) and the
+ *       tracks with notes, as long as they fit. Tracks beyond that are skipped with a warning, `num_tracks` and the
+ *       track index of every event then count the kept tracks only.
+ */
+esp_err_t smf_reader_open(smf_reader_t *reader, const uint8_t *data, size_t size);
+
+/**
+ * @brief Read the next channel voice event of the song
+ *
+ * @note System Exclusive and meta events are skipped, tempo changes are applied to the event times. A note on with
+ *       velocity 0 is returned as a note off.
+ *
+ * @param[in] reader Reader
+ * @param[out] event Next event, `timestamp_us` is its time from the start of the song and `device` the index of the
+ *                   track it comes from
+ * @return
+ *      - ESP_ERR_NOT_FOUND at the end of the song
+ *      - ESP_ERR_INVALID_SIZE if an event runs past the end of its track
+ *      - ESP_ERR_INVALID_RESPONSE for a data byte without a running status
+ *      - ESP_OK if an event was read
+ */
+esp_err_t smf_reader_next(smf_reader_t *reader, midi_event_t *event);
+
+#ifdef __cplusplus
+}
+#endif
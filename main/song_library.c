@@ -0,0 +1,118 @@
+#include <stdlib.h>
+#include "esp_check.h"
+#include "esp_partition.h"
+#include "song_library.h"
+
+static const char *TAG = "song_library";
+
+// "Mary Had a Little Lamb", format 0, 100 bpm, the song served when the partition holds none
+static const uint8_t s_builtin_song[] = {
+    0x4D, 0x54, 0x68, 0x64, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x01, 0x00, 0x60, // MThd, 96 ticks per quarter
+    0x4D, 0x54, 0x72, 0x6B, 0x00, 0x00, 0x00, 0x74,                                     // MTrk, 116 bytes
+    0x00, 0xFF, 0x03, 0x16, 'M', 'a', 'r', 'y', ' ', 'H', 'a', 'd', ' ', 'a', ' ',      // sequence name
+    'L', 'i', 't', 't', 'l', 'e', ' ', 'L', 'a', 'm', 'b',
+    0x00, 0xFF, 0x51, 0x03, 0x09, 0x27, 0xC0,                                           // tempo, 600000 us per quarter
+    // note on, then note off as a running status note on with velocity 0, an eighth (48 ticks) or a quarter later
+    0x00, 0x90, 0x40, 0x64, 0x30, 0x40, 0x00, // E4
+    0x00, 0x3E, 0x64, 0x30, 0x3E, 0x00,       // D4
+    0x00, 0x3C, 0x64, 0x30, 0x3C, 0x00,       // C4
+    0x00, 0x3E, 0x64, 0x30, 0x3E, 0x00,       // D4
+    0x00, 0x40, 0x64, 0x30, 0x40, 0x00,       // E4
+    0x00, 0x40, 0x64, 0x30, 0x40, 0x00,       // E4
+    0x00, 0x40, 0x64, 0x60, 0x40, 0x00,       // E4
+    0x00, 0x3E, 0x64, 0x30, 0x3E, 0x00,       // D4
+    0x00, 0x3E, 0x64, 0x30, 0x3E, 0x00,       // D4
+    0x00, 0x3E, 0x64, 0x60, 0x3E, 0x00,       // D4
+    0x00, 0x40, 0x64, 0x30, 0x40, 0x00,       // E4
+    0x00, 0x43, 0x64, 0x30, 0x43, 0x00,       // G4
+    0x00, 0x43, 0x64, 0x60, 0x43, 0x00,       // G4
+    0x00, 0xFF, 0x2F, 0x00,                   // end of track
+};
+
+typedef struct song_library_t {
+    const uint8_t *data;                    // mapped partition, or the built-in song
+    size_t size;
+    size_t num_songs;
+    bool mapped;
+    esp_partition_mmap_handle_t mmap_handle;
+    size_t cursor_index;                    // song whose file starts at cursor_offset, the last one opened
+    size_t cursor_offset;
+} song_library_t;
+
+esp_err_t song_library_open(const char *partition_label, song_library_handle_t *ret_library)
+{
+    esp_err_t ret = ESP_OK;
+    song_library_t *library = NULL;
+    ESP_GOTO_ON_FALSE(ret_library, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    library = calloc(1, sizeof(song_library_t));
+    ESP_GOTO_ON_FALSE(library, ESP_ERR_NO_MEM, err, TAG, "no mem for song library");
+
+    esp_partition_subtype_t subtype = (esp_partition_subtype_t)SONG_LIBRARY_PARTITION_SUBTYPE;
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, subtype, partition_label);
+    if (partition) {
+        const void *data = NULL;
+        ESP_GOTO_ON_ERROR(esp_partition_mmap(partition, 0, partition->size, ESP_PARTITION_MMAP_DATA, &data,
+                                             &library->mmap_handle), err, TAG, "mmap partition %s failed",
+                          partition->label);
+        library->mapped = true;
+        library->data = data;
+        library->size = partition->size;
+        // count the songs, only the chunk headers are read
+        for (size_t offset = 0, file_size; offset < library->size; offset += file_size) {
+            file_size = smf_file_size(library->data + offset, library->size - offset);
+            if (!file_size) {
+                break;
+            }
+            library->num_songs++;
+        }
+        ESP_LOGI(TAG, "%zu songs in partition %s", library->num_songs, partition->label);
+    }
+    if (!library->num_songs) {
+        ESP_LOGW(TAG, "no song partition or no song in it, using the built-in song");
+        if (library->mapped) {
+            esp_partition_munmap(library->mmap_handle);
+            library->mapped = false;
+        }
+        library->data = s_builtin_song;
+        library->size = sizeof(s_builtin_song);
+        library->num_songs = 1;
+    }
+    *ret_library = library;
+    return ESP_OK;
+err:
+    free(library);
+    return ret;
+}
+
+size_t song_library_get_count(song_library_handle_t library)
+{
+    return library->num_songs;
+}
+
+esp_err_t song_library_open_song(song_library_handle_t library, size_t index, smf_reader_t *reader)
+{
+    ESP_RETURN_ON_FALSE(library && reader && index < library->num_songs, ESP_ERR_INVALID_ARG, TAG,
+                        "invalid argument");
+    if (index < library->cursor_index) {
+        library->cursor_index = 0;
+        library->cursor_offset = 0;
+    }
+    while (library->cursor_index < index) {
+        library->cursor_offset += smf_file_size(library->data + library->cursor_offset,
+                                                library->size - library->cursor_offset);
+        library->cursor_index++;
+    }
+    const uint8_t *song = library->data + library->cursor_offset;
+    size_t remaining = library->size - library->cursor_offset;
+    return smf_reader_open(reader, song, smf_file_size(song, remaining));
+}
+
+esp_err_t song_library_close(song_library_handle_t library)
+{
+    ESP_RETURN_ON_FALSE(library, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    if (library->mapped) {
+        esp_partition_munmap(library->mmap_handle);
+    }
+    free(library);
+    return ESP_OK;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stddef.h>
+#include "esp_err.h"
+#include "smf_reader.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SONG_LIBRARY_PARTITION_SUBTYPE 0x40 /*!< Data partition subtype of song libraries, see partitions.csv */
+
+/**
+ * @brief Type of song library handle
+ *
+ * Songs are Standard MIDI Files stored back to back in a flash data partition, e.g. `cat *.mid > songs.bin`.
+ * The partition is memory mapped once, songs are read in place through `smf_reader_t` and nothing is copied to RAM,
+ * so neither the number nor the size of the songs costs memory. The library ends at the first byte that does not
+ * start a complete file, such as erased flash.
+ *
+ * Without the partition, or when it holds no song, the library serves a single built-in song.
+ */
+typedef struct song_library_t *song_library_handle_t;
+
+/**
+ * @brief Open the song library of a partition
+ *
+ * @param[in] partition_label Label of the data partition, NULL for the first partition of subtype
+ *                            SONG_LIBRARY_PARTITION_SUBTYPE
+ * @param[out] ret_library Returned library handle
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_ERR_NO_MEM out of memory when creating the library
+ *      - Any error of `esp_partition_mmap` if the partition could not be memory mapped
+ *      - ESP_OK if opening the library successfully, the built-in song included
+ */
+esp_err_t song_library_open(const char *partition_label, song_library_handle_t *ret_library);
+
+/**
+ * @brief Get the number of songs in the library
+ *
+ * @param[in] library Library handle
+ * @return Number of songs, at least 1
+ */
+size_t song_library_get_count(song_library_handle_t library);
+
+/**
+ * @brief Start reading a song
+ *
+ * @note Songs are found by walking the file headers from the closest known position, reading them in order costs
+ *       nothing extra.
+ *
+ * @param[in] library Library handle
+ * @param[in] index Song index, from 0 to `song_library_get_count() - 1`
+ * @param[out] reader Reader positioned at the start of the song, valid until the library is closed
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - Any error of `smf_reader_open` for a song that cannot be read
+ *      - ESP_OK if the song can be read
+ */
+esp_err_t song_library_open_song(song_library_handle_t library, size_t index, smf_reader_t *reader);
+
+/**
+ * @brief Close the library and unmap its partition
+ *
+ * @param[in] library Library handle
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_OK if closing the library successfully
+ */
+esp_err_t song_library_close(song_library_handle_t library);
+
+#ifdef __cplusplus
+}
+#endif
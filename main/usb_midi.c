@@ -0,0 +1,108 @@
+#include <stdbool.h>
+#include "usb_midi.h"
+
+#define USB_MIDI_PACKET_SIZE 4
+
+typedef bool (*usb_midi_decode_t)(const uint8_t *packet, uint8_t num_bytes, midi_event_t *event);
+
+typedef struct {
+    uint8_t num_bytes;        // MIDI bytes carried by the packet, per USB-MIDI 1.0 table 4-1
+    usb_midi_decode_t decode; // returns false to skip the packet
+} usb_midi_cin_t;
+
+static bool usb_midi_decode_reserved(const uint8_t *packet, uint8_t num_bytes, midi_event_t *event)
+{
+    return false;
+}
+
+static bool usb_midi_decode_channel_voice(const uint8_t *packet, uint8_t num_bytes, midi_event_t *event)
+{
+    uint8_t cin = packet[0] & 0x0F;
+    if ((packet[1] >> 4) != cin) {
+        return false;
+    }
+    event->type = cin;
+    event->channel = packet[1] & 0x0F;
+    event->note = packet[2] & 0x7F;
+    event->velocity = num_bytes == 3 ? packet[3] & 0x7F : 0;
+    if (cin == MIDI_EVENT_NOTE_ON && event->velocity == 0) {
+        event->type = MIDI_EVENT_NOTE_OFF;
+    }
+    return true;
+}
+
+static void usb_midi_copy_raw(const uint8_t *packet, uint8_t num_bytes, midi_event_t *event)
+{
+    for (uint8_t i = 0; i < 3; i++) {
+        event->data[i] = i < num_bytes ? packet[1 + i] : 0;
+    }
+}
+
+static bool usb_midi_decode_system_common(const uint8_t *packet, uint8_t num_bytes, midi_event_t *event)
+{
+    if (packet[1] <= 0xF0 || packet[1] >= 0xF7) {
+        return false;
+    }
+    event->type = MIDI_EVENT_SYSTEM_COMMON;
+    usb_midi_copy_raw(packet, num_bytes, event);
+    return true;
+}
+
+static bool usb_midi_decode_sysex(const uint8_t *packet, uint8_t num_bytes, midi_event_t *event)
+{
+    event->type = MIDI_EVENT_SYSEX;
+    usb_midi_copy_raw(packet, num_bytes, event);
+    return true;
+}
+
+// CIN 0x5 and 0xF carry a single byte, its value tells what it belongs to
+static bool usb_midi_decode_single_byte(const uint8_t *packet, uint8_t num_bytes, midi_event_t *event)
+{
+    uint8_t byte = packet[1];
+    if (byte >= 0xF8) {
+        event->type = MIDI_EVENT_REALTIME;
+    } else if (byte == 0xF0 || byte == 0xF7 || byte < 0x80) {
+        event->type = MIDI_EVENT_SYSEX; // start, end or data byte of a SysEx sent byte by byte
+    } else if (byte > 0xF0) {
+        event->type = MIDI_EVENT_SYSTEM_COMMON;
+    } else {
+        return false; // channel status without its data
+    }
+    usb_midi_copy_raw(packet, 1, event);
+    return true;
+}
+
+static const usb_midi_cin_t s_cin_table[16] = {
+    [0x0] = {0, usb_midi_decode_reserved},       // miscellaneous, reserved
+    [0x1] = {0, usb_midi_decode_reserved},       // cable events, reserved
+    [0x2] = {2, usb_midi_decode_system_common},  // two-byte System Common
+    [0x3] = {3, usb_midi_decode_system_common},  // three-byte System Common
+    [0x4] = {3, usb_midi_decode_sysex},          // SysEx starts or continues
+    [0x5] = {1, usb_midi_decode_single_byte},    // single-byte System Common or SysEx ends with one byte
+    [0x6] = {2, usb_midi_decode_sysex},          // SysEx ends with two bytes
+    [0x7] = {3, usb_midi_decode_sysex},          // SysEx ends with three bytes
+    [0x8] = {3, usb_midi_decode_channel_voice},  // Note Off
+    [0x9] = {3, usb_midi_decode_channel_voice},  // Note On
+    [0xA] = {3, usb_midi_decode_channel_voice},  // Poly Key Pressure
+    [0xB] = {3, usb_midi_decode_channel_voice},  // Control Change
+    [0xC] = {2, usb_midi_decode_channel_voice},  // Program Change
+    [0xD] = {2, usb_midi_decode_channel_voice},  // Channel Pressure
+    [0xE] = {3, usb_midi_decode_channel_voice},  // Pitch Bend
+    [0xF] = {1, usb_midi_decode_single_byte},    // single byte, mostly System Real-Time
+};
+
+size_t usb_midi_parse(const uint8_t *data, size_t size, uint32_t timestamp_us, midi_event_t *events, size_t max_events)
+{
+    size_t num_events = 0;
+    for (size_t i = 0; i + USB_MIDI_PACKET_SIZE <= size && num_events < max_events; i += USB_MIDI_PACKET_SIZE) {
+        const uint8_t *packet = &data[i];
+        const usb_midi_cin_t *cin = &s_cin_table[packet[0] & 0x0F];
+        midi_event_t *event = &events[num_events];
+        if (cin->decode(packet, cin->num_bytes, event)) {
+            event->timestamp_us = timestamp_us;
+            event->device = 0;
+            num_events++;
+        }
+    }
+    return num_events;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "midi_event.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Decode USB-MIDI 1.0 event packets into MIDI events
+ *
+ * Every 32-bit packet is dispatched on its Code Index Number (CIN): channel voice messages (0x8-0xE) become
+ * typed events, SysEx packets (0x4-0x7) and System Common or Real-Time packets (0x2, 0x3, 0x5, 0xF) keep their raw
+ * bytes. Reserved CINs (0x0, 0x1) and channel voice packets whose status byte does not match the CIN are skipped.
+ * The cable number is ignored. Pure function, safe to call from any context.
+ *
+ * @param[in] data Packets as received from the MIDI IN endpoint, a trailing partial packet is ignored
+ * @param[in] size Size of the data, in bytes
+ * @param[in] timestamp_us Timestamp stored in every decoded event, `device` is set to 0 for the caller to fill in
+ * @param[out] events Buffer for the decoded events
+ * @param[in] max_events Size of the buffer, in events. At most size / 4 events are produced, decoding stops once
+ *                       the buffer is full
+ * @return Number of events written to `events`
+ */
+size_t usb_midi_parse(const uint8_t *data, size_t size, uint32_t timestamp_us, midi_event_t *events, size_t max_events);
+
+#ifdef __cplusplus
+}
+#endif